@@ -378,6 +378,7 @@ void DebugModifyPresent(PresentEvent const& p)
         FlushModifiedPresent();
         gModifiedPresent = &p;
         gOriginalPresentValues = p;
+        gOriginalPresentValues.Extension = nullptr; // Only the PresentEvent members are compared
     }
 }
 
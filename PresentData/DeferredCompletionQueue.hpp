@@ -0,0 +1,73 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <algorithm>
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+// DeferredCompletionQueue holds a process' deferred completions: items that
+// must wait for a number of the process' subsequent Present_Stop events.
+//
+// Rather than counting down every item's wait on every Present_Stop, the
+// queue counts Present_Stops in an epoch and stores each item with the epoch
+// at which it expires, in a min-heap.  AdvanceEpoch() then only touches the
+// items that expire, so a Present_Stop costs O(log n) per expired item no
+// matter how many items are waiting.
+//
+// Items that expire in the same epoch are popped in the order they were
+// pushed.
+
+template<typename T>
+class DeferredCompletionQueue {
+    struct Entry {
+        uint64_t mEpoch;        // Epoch at which the item expires
+        uint64_t mSequence;     // Push order, to break ties
+        T mItem;
+    };
+
+    // std::push_heap() etc. keep the largest entry at the front, so order
+    // entries in reverse to keep the earliest-expiring entry there instead.
+    struct ExpiresLater {
+        bool operator()(Entry const& a, Entry const& b) const
+        {
+            return a.mEpoch != b.mEpoch ? a.mEpoch > b.mEpoch : a.mSequence > b.mSequence;
+        }
+    };
+
+    std::vector<Entry> mHeap;
+    uint64_t mEpoch = 0;
+    uint64_t mNextSequence = 0;
+
+public:
+    bool Empty() const { return mHeap.empty(); }
+    size_t Size() const { return mHeap.size(); }
+
+    // Adds item, to expire on the waitCount'th subsequent AdvanceEpoch().
+    void Push(T item, uint32_t waitCount)
+    {
+        assert(waitCount > 0);
+        mHeap.push_back({ mEpoch + waitCount, mNextSequence, std::move(item) });
+        mNextSequence += 1;
+        std::push_heap(mHeap.begin(), mHeap.end(), ExpiresLater());
+    }
+
+    // Advances the epoch and calls onExpired(item) for each item that has
+    // now expired.  Each item is removed from the queue before onExpired() is
+    // called with it.
+    template<typename Fn>
+    void AdvanceEpoch(Fn&& onExpired)
+    {
+        mEpoch += 1;
+        while (!mHeap.empty() && mHeap.front().mEpoch <= mEpoch) {
+            std::pop_heap(mHeap.begin(), mHeap.end(), ExpiresLater());
+            auto item = std::move(mHeap.back().mItem);
+            mHeap.pop_back();
+            onExpired(item);
+        }
+    }
+};
@@ -3,7 +3,7 @@
 //
 // This file originally generated by etw_list
 //     version:    development branch e5985e637875db6cb6f90e8c92d0857b6fb95324
-//     parameters: --no_event_structs --event=Present::Start --event=Present::Stop --provider=Microsoft-Windows-D3D9
+//     parameters: --no_event_structs --event_views --event=Present::Start --event=Present::Stop --view_field=Present::Start::pSwapchain --view_field=Present::Start::Flags --view_field=Present::Stop::Result --provider=Microsoft-Windows-D3D9
 #pragma once
 
 namespace Microsoft_Windows_D3D9 {
@@ -32,7 +32,7 @@ enum class Channel : uint8_t {
     static uint8_t  const Level   = level_; \
     static uint8_t  const Opcode  = opcode_; \
     static uint16_t const Task    = task_; \
-    static Keyword  const Keyword = (Keyword) keyword_; \
+    static Microsoft_Windows_D3D9::Keyword const Keyword = (Microsoft_Windows_D3D9::Keyword) keyword_; \
 };
 
 EVENT_DESCRIPTOR_DECL(Present_Start, 0x0001, 0x00, 0x10, 0x00, 0x01, 0x0001, 0x8000000000000002)
@@ -49,4 +49,44 @@ enum class D3D9PresentFlags : uint32_t {
     D3DPRESENT_FORCEIMMEDIATE = 256,
 };
 
+
+// Event views:
+
+struct Present_Start_View : public EventView {
+    enum Field : uint32_t {
+        pSwapchain_Field,
+        Flags_Field,
+        FieldCount
+    };
+
+    static EventViewField const* GetFields()
+    {
+        static EventViewField const fields[FieldCount] = {
+            { L"pSwapchain", EVENT_VIEW_POINTER_SIZE },
+            { L"Flags",      sizeof(D3D9PresentFlags) },
+        };
+        return fields;
+    }
+
+    uint64_t         pSwapchain() const { return GetPointer(pSwapchain_Field); }
+    D3D9PresentFlags Flags()      const { return Get<D3D9PresentFlags>(Flags_Field); }
+};
+
+struct Present_Stop_View : public EventView {
+    enum Field : uint32_t {
+        Result_Field,
+        FieldCount
+    };
+
+    static EventViewField const* GetFields()
+    {
+        static EventViewField const fields[FieldCount] = {
+            { L"Result", sizeof(uint32_t) },
+        };
+        return fields;
+    }
+
+    uint32_t Result() const { return Get<uint32_t>(Result_Field); }
+};
+
 }
@@ -3,7 +3,7 @@
 //
 // This file originally generated by etw_list
 //     version:    development branch e5985e637875db6cb6f90e8c92d0857b6fb95324
-//     parameters: --no_event_structs --event=Present::Start --event=Present::Stop --event=PresentMultiplaneOverlay::Start --event=PresentMultiplaneOverlay::Stop --provider=Microsoft-Windows-DXGI
+//     parameters: --no_event_structs --event_views --event=Present::Start --event=Present::Stop --event=PresentMultiplaneOverlay::Start --event=PresentMultiplaneOverlay::Stop --view_field=Present::Start::pIDXGISwapChain --view_field=Present::Start::Flags --view_field=Present::Start::SyncInterval --view_field=Present::Stop::Result --provider=Microsoft-Windows-DXGI
 #pragma once
 
 namespace Microsoft_Windows_DXGI {
@@ -36,7 +36,7 @@ enum class Channel : uint8_t {
     static uint8_t  const Level   = level_; \
     static uint8_t  const Opcode  = opcode_; \
     static uint16_t const Task    = task_; \
-    static Keyword  const Keyword = (Keyword) keyword_; \
+    static Microsoft_Windows_DXGI::Keyword const Keyword = (Microsoft_Windows_DXGI::Keyword) keyword_; \
 };
 
 EVENT_DESCRIPTOR_DECL(PresentMultiplaneOverlay_Start, 0x0037, 0x00, 0x10, 0x00, 0x01, 0x000e, 0x8000000000000002)
@@ -56,4 +56,47 @@ enum class DXGIPresentFlags : uint32_t {
     DXGI_PRESENT_RESTRICT_TO_OUTPUT = 64,
 };
 
+
+// Event views:
+
+struct Present_Start_View : public EventView {
+    enum Field : uint32_t {
+        pIDXGISwapChain_Field,
+        Flags_Field,
+        SyncInterval_Field,
+        FieldCount
+    };
+
+    static EventViewField const* GetFields()
+    {
+        static EventViewField const fields[FieldCount] = {
+            { L"pIDXGISwapChain", EVENT_VIEW_POINTER_SIZE },
+            { L"Flags",           sizeof(DXGIPresentFlags) },
+            { L"SyncInterval",    sizeof(int32_t) },
+        };
+        return fields;
+    }
+
+    uint64_t         pIDXGISwapChain() const { return GetPointer(pIDXGISwapChain_Field); }
+    DXGIPresentFlags Flags()           const { return Get<DXGIPresentFlags>(Flags_Field); }
+    int32_t          SyncInterval()    const { return Get<int32_t>(SyncInterval_Field); }
+};
+
+struct Present_Stop_View : public EventView {
+    enum Field : uint32_t {
+        Result_Field,
+        FieldCount
+    };
+
+    static EventViewField const* GetFields()
+    {
+        static EventViewField const fields[FieldCount] = {
+            { L"Result", sizeof(uint32_t) },
+        };
+        return fields;
+    }
+
+    uint32_t Result() const { return Get<uint32_t>(Result_Field); }
+};
+
 }
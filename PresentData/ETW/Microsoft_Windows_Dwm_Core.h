@@ -3,7 +3,7 @@
 //
 // This file originally generated by etw_list
 //     version:    development branch e5985e637875db6cb6f90e8c92d0857b6fb95324
-//     parameters: --no_event_structs --event=MILEVENT_MEDIA_UCE_PROCESSPRESENTHISTORY_GetPresentHistory::Info --event=SCHEDULE_PRESENT::Start --event=SCHEDULE_SURFACEUPDATE::Info --provider=Microsoft-Windows-Dwm-Core
+//     parameters: --no_event_structs --event_views --event=MILEVENT_MEDIA_UCE_PROCESSPRESENTHISTORY_GetPresentHistory::Info --event=SCHEDULE_PRESENT::Start --event=SCHEDULE_SURFACEUPDATE::Info --view_field=SCHEDULE_SURFACEUPDATE::Info::luidSurface --view_field=SCHEDULE_SURFACEUPDATE::Info::PresentCount --view_field=SCHEDULE_SURFACEUPDATE::Info::bindId --provider=Microsoft-Windows-Dwm-Core
 #pragma once
 
 namespace Microsoft_Windows_Dwm_Core {
@@ -55,7 +55,7 @@ enum class Channel : uint8_t {
     static uint8_t  const Level   = level_; \
     static uint8_t  const Opcode  = opcode_; \
     static uint16_t const Task    = task_; \
-    static Keyword  const Keyword = (Keyword) keyword_; \
+    static Microsoft_Windows_Dwm_Core::Keyword const Keyword = (Microsoft_Windows_Dwm_Core::Keyword) keyword_; \
 };
 
 EVENT_DESCRIPTOR_DECL(MILEVENT_MEDIA_UCE_PROCESSPRESENTHISTORY_GetPresentHistory_Info, 0x0040, 0x00, 0x10, 0x05, 0x00, 0x003f, 0x8000000000000001)
@@ -69,4 +69,55 @@ EVENT_DESCRIPTOR_DECL(FlipChain_Pending
 
 #undef EVENT_DESCRIPTOR_DECL
 
+
+// Event views:
+
+struct SCHEDULE_SURFACEUPDATE_Info_View : public EventView {
+    enum Field : uint32_t {
+        luidSurface_Field,
+        PresentCount_Field,
+        bindId_Field,
+        FieldCount
+    };
+
+    static EventViewField const* GetFields()
+    {
+        static EventViewField const fields[FieldCount] = {
+            { L"luidSurface",  sizeof(uint64_t) },
+            { L"PresentCount", sizeof(uint64_t) },
+            { L"bindId",       sizeof(uint64_t) },
+        };
+        return fields;
+    }
+
+    uint64_t luidSurface()  const { return Get<uint64_t>(luidSurface_Field); }
+    uint64_t PresentCount() const { return Get<uint64_t>(PresentCount_Field); }
+    uint64_t bindId()       const { return Get<uint64_t>(bindId_Field); }
+};
+
+// These views added manually:
+
+struct FlipChain_Pending_View : public EventView {
+    enum Field : uint32_t {
+        ulFlipChain_Field,
+        ulSerialNumber_Field,
+        hwnd_Field,
+        FieldCount
+    };
+
+    static EventViewField const* GetFields()
+    {
+        static EventViewField const fields[FieldCount] = {
+            { L"ulFlipChain",    sizeof(uint32_t) },
+            { L"ulSerialNumber", sizeof(uint32_t) },
+            { L"hwnd",           EVENT_VIEW_POINTER_SIZE },
+        };
+        return fields;
+    }
+
+    uint32_t ulFlipChain()    const { return Get<uint32_t>(ulFlipChain_Field); }
+    uint32_t ulSerialNumber() const { return Get<uint32_t>(ulSerialNumber_Field); }
+    uint64_t hwnd()           const { return GetPointer(hwnd_Field); }
+};
+
 }
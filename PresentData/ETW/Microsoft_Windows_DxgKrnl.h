@@ -3,7 +3,7 @@
 //
 // This file originally generated by etw_list
 //     version:    main 9c6bf7de6fb2c08c84df4141ffc8a9b175ac5150
-//     parameters: --no_event_structs --event=Blit::Info --event=Flip::Info --event=FlipMultiPlaneOverlay::Info --event=IndependentFlip::Info --event=HSyncDPCMultiPlane::Info --event=VSyncDPCMultiPlane::Info --event=MMIOFlip::Info --event=MMIOFlipMultiPlaneOverlay::Info --event=Present::Info --event=PresentHistory::Start --event=PresentHistory::Info --event=PresentHistoryDetailed::Start --event=QueuePacket::Start --event=QueuePacket::Stop --event=VSyncDPC::Info --provider=Microsoft-Windows-DxgKrnl
+//     parameters: --no_event_structs --event_views --event=Blit::Info --event=Flip::Info --event=FlipMultiPlaneOverlay::Info --event=IndependentFlip::Info --event=HSyncDPCMultiPlane::Info --event=VSyncDPCMultiPlane::Info --event=MMIOFlip::Info --event=MMIOFlipMultiPlaneOverlay::Info --event=Present::Info --event=PresentHistory::Start --event=PresentHistory::Info --event=PresentHistoryDetailed::Start --event=QueuePacket::Start --event=QueuePacket::Stop --event=VSyncDPC::Info --view_field=Blit::Info::hwnd --view_field=Blit::Info::bRedirectedPresent --view_field=Flip::Info::FlipInterval --view_field=Flip::Info::MMIOFlip --view_field=IndependentFlip::Info::SubmitSequence --view_field=MMIOFlip::Info::FlipSubmitSequence --view_field=MMIOFlip::Info::Flags --view_field=MMIOFlipMultiPlaneOverlay::Info::FlipSubmitSequence --view_field=MMIOFlipMultiPlaneOverlay::Info::FlipEntryStatusAfterFlip --view_field=Present::Info::hWindow --view_field=PresentHistory::Start::Token --view_field=PresentHistory::Start::Model --view_field=PresentHistory::Start::TokenData --view_field=PresentHistory::Info::Token --view_field=QueuePacket::Start::hContext --view_field=QueuePacket::Start::PacketType --view_field=QueuePacket::Start::SubmitSequence --view_field=QueuePacket::Start::bPresent --view_field=QueuePacket::Stop::SubmitSequence --view_field=VSyncDPC::Info::FlipFenceId --provider=Microsoft-Windows-DxgKrnl
 #pragma once
 
 namespace Microsoft_Windows_DxgKrnl {
@@ -89,7 +89,7 @@ enum class Channel : uint8_t {
     static uint8_t  const Level   = level_; \
     static uint8_t  const Opcode  = opcode_; \
     static uint16_t const Task    = task_; \
-    static Keyword  const Keyword = (Keyword) keyword_; \
+    static Microsoft_Windows_DxgKrnl::Keyword const Keyword = (Microsoft_Windows_DxgKrnl::Keyword) keyword_; \
 };
 
 EVENT_DESCRIPTOR_DECL(Blit_Info                     , 0x00a6, 0x00, 0x11, 0x04, 0x00, 0x0067, 0x4000000000000001)
@@ -229,4 +229,221 @@ enum class SetVidPnSourceAddressFlags : uint32_t {
     FlipOnNextVSync = 4,
 };
 
+
+// Event views:
+
+struct Blit_Info_View : public EventView {
+    enum Field : uint32_t {
+        hwnd_Field,
+        bRedirectedPresent_Field,
+        FieldCount
+    };
+
+    static EventViewField const* GetFields()
+    {
+        static EventViewField const fields[FieldCount] = {
+            { L"hwnd",               EVENT_VIEW_POINTER_SIZE },
+            { L"bRedirectedPresent", sizeof(uint32_t) },
+        };
+        return fields;
+    }
+
+    uint64_t hwnd()               const { return GetPointer(hwnd_Field); }
+    uint32_t bRedirectedPresent() const { return Get<uint32_t>(bRedirectedPresent_Field); }
+};
+
+struct Flip_Info_View : public EventView {
+    enum Field : uint32_t {
+        FlipInterval_Field,
+        MMIOFlip_Field,
+        FieldCount
+    };
+
+    static EventViewField const* GetFields()
+    {
+        static EventViewField const fields[FieldCount] = {
+            { L"FlipInterval", sizeof(uint32_t) },
+            { L"MMIOFlip",     sizeof(uint32_t) },
+        };
+        return fields;
+    }
+
+    uint32_t FlipInterval() const { return Get<uint32_t>(FlipInterval_Field); }
+    uint32_t MMIOFlip()     const { return Get<uint32_t>(MMIOFlip_Field); }
+};
+
+struct IndependentFlip_Info_View : public EventView {
+    enum Field : uint32_t {
+        SubmitSequence_Field,
+        FieldCount
+    };
+
+    static EventViewField const* GetFields()
+    {
+        static EventViewField const fields[FieldCount] = {
+            { L"SubmitSequence", sizeof(uint32_t) },
+        };
+        return fields;
+    }
+
+    uint32_t SubmitSequence() const { return Get<uint32_t>(SubmitSequence_Field); }
+};
+
+struct MMIOFlipMultiPlaneOverlay_Info_View : public EventView {
+    enum Field : uint32_t {
+        FlipSubmitSequence_Field,
+        FlipEntryStatusAfterFlip_Field,
+        FieldCount
+    };
+
+    static EventViewField const* GetFields()
+    {
+        static EventViewField const fields[FieldCount] = {
+            { L"FlipSubmitSequence",       sizeof(uint64_t) },
+            { L"FlipEntryStatusAfterFlip", sizeof(FlipEntryStatus) },
+        };
+        return fields;
+    }
+
+    uint64_t        FlipSubmitSequence()       const { return Get<uint64_t>(FlipSubmitSequence_Field); }
+    FlipEntryStatus FlipEntryStatusAfterFlip() const { return Get<FlipEntryStatus>(FlipEntryStatusAfterFlip_Field); }
+};
+
+struct MMIOFlip_Info_View : public EventView {
+    enum Field : uint32_t {
+        FlipSubmitSequence_Field,
+        Flags_Field,
+        FieldCount
+    };
+
+    static EventViewField const* GetFields()
+    {
+        static EventViewField const fields[FieldCount] = {
+            { L"FlipSubmitSequence", sizeof(uint32_t) },
+            { L"Flags",              sizeof(SetVidPnSourceAddressFlags) },
+        };
+        return fields;
+    }
+
+    uint32_t                   FlipSubmitSequence() const { return Get<uint32_t>(FlipSubmitSequence_Field); }
+    SetVidPnSourceAddressFlags Flags()              const { return Get<SetVidPnSourceAddressFlags>(Flags_Field); }
+};
+
+struct PresentHistory_Info_View : public EventView {
+    enum Field : uint32_t {
+        Token_Field,
+        FieldCount
+    };
+
+    static EventViewField const* GetFields()
+    {
+        static EventViewField const fields[FieldCount] = {
+            { L"Token", sizeof(uint64_t) },
+        };
+        return fields;
+    }
+
+    uint64_t Token() const { return Get<uint64_t>(Token_Field); }
+};
+
+struct PresentHistory_Start_View : public EventView {
+    enum Field : uint32_t {
+        Token_Field,
+        Model_Field,
+        TokenData_Field,
+        FieldCount
+    };
+
+    static EventViewField const* GetFields()
+    {
+        static EventViewField const fields[FieldCount] = {
+            { L"Token",     sizeof(uint64_t) },
+            { L"Model",     sizeof(PresentModel) },
+            { L"TokenData", sizeof(uint64_t) },
+        };
+        return fields;
+    }
+
+    uint64_t     Token()     const { return Get<uint64_t>(Token_Field); }
+    PresentModel Model()     const { return Get<PresentModel>(Model_Field); }
+    uint64_t     TokenData() const { return Get<uint64_t>(TokenData_Field); }
+};
+
+struct Present_Info_View : public EventView {
+    enum Field : uint32_t {
+        hWindow_Field,
+        FieldCount
+    };
+
+    static EventViewField const* GetFields()
+    {
+        static EventViewField const fields[FieldCount] = {
+            { L"hWindow", EVENT_VIEW_POINTER_SIZE },
+        };
+        return fields;
+    }
+
+    uint64_t hWindow() const { return GetPointer(hWindow_Field); }
+};
+
+struct QueuePacket_Start_View : public EventView {
+    enum Field : uint32_t {
+        hContext_Field,
+        PacketType_Field,
+        SubmitSequence_Field,
+        bPresent_Field,
+        FieldCount
+    };
+
+    static EventViewField const* GetFields()
+    {
+        static EventViewField const fields[FieldCount] = {
+            { L"hContext",       EVENT_VIEW_POINTER_SIZE },
+            { L"PacketType",     sizeof(QueuePacketType) },
+            { L"SubmitSequence", sizeof(uint32_t) },
+            { L"bPresent",       sizeof(uint32_t) },
+        };
+        return fields;
+    }
+
+    uint64_t        hContext()       const { return GetPointer(hContext_Field); }
+    QueuePacketType PacketType()     const { return Get<QueuePacketType>(PacketType_Field); }
+    uint32_t        SubmitSequence() const { return Get<uint32_t>(SubmitSequence_Field); }
+    uint32_t        bPresent()       const { return Get<uint32_t>(bPresent_Field); }
+};
+
+struct QueuePacket_Stop_View : public EventView {
+    enum Field : uint32_t {
+        SubmitSequence_Field,
+        FieldCount
+    };
+
+    static EventViewField const* GetFields()
+    {
+        static EventViewField const fields[FieldCount] = {
+            { L"SubmitSequence", sizeof(uint32_t) },
+        };
+        return fields;
+    }
+
+    uint32_t SubmitSequence() const { return Get<uint32_t>(SubmitSequence_Field); }
+};
+
+struct VSyncDPC_Info_View : public EventView {
+    enum Field : uint32_t {
+        FlipFenceId_Field,
+        FieldCount
+    };
+
+    static EventViewField const* GetFields()
+    {
+        static EventViewField const fields[FieldCount] = {
+            { L"FlipFenceId", sizeof(uint64_t) },
+        };
+        return fields;
+    }
+
+    uint64_t FlipFenceId() const { return Get<uint64_t>(FlipFenceId_Field); }
+};
+
 }
@@ -3,7 +3,7 @@
 //
 // This file originally generated by etw_list
 //     version:    development branch e5985e637875db6cb6f90e8c92d0857b6fb95324
-//     parameters: --no_event_structs --event=TokenCompositionSurfaceObject::Info --event=TokenStateChanged::Info --provider=Microsoft-Windows-Win32k
+//     parameters: --no_event_structs --event_views --event=TokenCompositionSurfaceObject::Info --event=TokenStateChanged::Info --view_field=TokenCompositionSurfaceObject::Info::PresentCount --view_field=TokenCompositionSurfaceObject::Info::BindId --view_field=TokenCompositionSurfaceObject::Info::CompositionSurfaceLuid --view_field=TokenCompositionSurfaceObject::Info::DestWidth --view_field=TokenCompositionSurfaceObject::Info::DestHeight --view_field=TokenStateChanged::Info::CompositionSurfaceLuid --view_field=TokenStateChanged::Info::PresentCount --view_field=TokenStateChanged::Info::BindId --view_field=TokenStateChanged::Info::NewState --view_field=TokenStateChanged::Info::IndependentFlip --provider=Microsoft-Windows-Win32k
 #pragma once
 
 namespace Microsoft_Windows_Win32k {
@@ -82,7 +82,7 @@ enum class Channel : uint8_t {
     static uint8_t  const Level   = level_; \
     static uint8_t  const Opcode  = opcode_; \
     static uint16_t const Task    = task_; \
-    static Keyword  const Keyword = (Keyword) keyword_; \
+    static Microsoft_Windows_Win32k::Keyword const Keyword = (Microsoft_Windows_Win32k::Keyword) keyword_; \
 };
 
 EVENT_DESCRIPTOR_DECL(TokenCompositionSurfaceObject_Info, 0x00c9, 0x01, 0x10, 0x04, 0x00, 0x008a, 0x8000000400001000)
@@ -100,4 +100,65 @@ enum class TokenState : uint32_t {
     Discarded = 6,
 };
 
+
+// Event views:
+
+struct TokenCompositionSurfaceObject_Info_View : public EventView {
+    enum Field : uint32_t {
+        PresentCount_Field,
+        BindId_Field,
+        CompositionSurfaceLuid_Field,
+        DestWidth_Field,
+        DestHeight_Field,
+        FieldCount
+    };
+
+    static EventViewField const* GetFields()
+    {
+        static EventViewField const fields[FieldCount] = {
+            { L"PresentCount",           sizeof(uint64_t) },
+            { L"BindId",                 sizeof(uint64_t) },
+            { L"CompositionSurfaceLuid", sizeof(uint64_t) },
+            { L"DestWidth",              sizeof(uint32_t) },
+            { L"DestHeight",             sizeof(uint32_t) },
+        };
+        return fields;
+    }
+
+    uint64_t PresentCount()           const { return Get<uint64_t>(PresentCount_Field); }
+    uint64_t BindId()                 const { return Get<uint64_t>(BindId_Field); }
+    uint64_t CompositionSurfaceLuid() const { return Get<uint64_t>(CompositionSurfaceLuid_Field); }
+    uint32_t DestWidth()              const { return Get<uint32_t>(DestWidth_Field); }
+    uint32_t DestHeight()             const { return Get<uint32_t>(DestHeight_Field); }
+};
+
+struct TokenStateChanged_Info_View : public EventView {
+    enum Field : uint32_t {
+        CompositionSurfaceLuid_Field,
+        PresentCount_Field,
+        BindId_Field,
+        NewState_Field,
+        IndependentFlip_Field,
+        FieldCount
+    };
+
+    static EventViewField const* GetFields()
+    {
+        static EventViewField const fields[FieldCount] = {
+            { L"CompositionSurfaceLuid", sizeof(uint64_t) },
+            { L"PresentCount",           sizeof(uint32_t) },
+            { L"BindId",                 sizeof(uint64_t) },
+            { L"NewState",               sizeof(TokenState) },
+            { L"IndependentFlip",        sizeof(uint32_t) },
+        };
+        return fields;
+    }
+
+    uint64_t   CompositionSurfaceLuid() const { return Get<uint64_t>(CompositionSurfaceLuid_Field); }
+    uint32_t   PresentCount()           const { return Get<uint32_t>(PresentCount_Field); }
+    uint64_t   BindId()                 const { return Get<uint64_t>(BindId_Field); }
+    TokenState NewState()               const { return Get<TokenState>(NewState_Field); }
+    uint32_t   IndependentFlip()        const { return Get<uint32_t>(IndependentFlip_Field); }
+};
+
 }
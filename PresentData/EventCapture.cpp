@@ -0,0 +1,231 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+
+#include "EventCapture.hpp"
+
+namespace {
+
+FILE* OpenFile(char const* path, char const* mode)
+{
+#ifdef _WIN32
+    FILE* fp = nullptr;
+    return fopen_s(&fp, path, mode) == 0 ? fp : nullptr;
+#else
+    return fopen(path, mode);
+#endif
+}
+
+uint32_t PaddedSize(uint32_t size)
+{
+    return (size + 7u) & ~7u;
+}
+
+}
+
+bool EventCaptureWriter::Open(char const* path, int64_t qpcFrequency, int64_t startQpc)
+{
+    Close();
+
+    mFile = OpenFile(path, "wb");
+    if (mFile == nullptr) {
+        return false;
+    }
+
+    // Events are written one at a time from the consumer thread, so use a
+    // large buffer to keep the number of writes down.
+    setvbuf(mFile, nullptr, _IOFBF, 1 << 20);
+
+    EventCaptureFileHeader header = {};
+    header.Magic        = EVENT_CAPTURE_MAGIC;
+    header.Version      = EVENT_CAPTURE_VERSION;
+    header.QpcFrequency = qpcFrequency;
+    header.StartQpc     = startQpc;
+
+    mError = fwrite(&header, sizeof(header), 1, mFile) != 1;
+    mMetadataWritten.clear();
+    return !mError;
+}
+
+bool EventCaptureWriter::Close()
+{
+    if (mFile != nullptr) {
+        mError |= fclose(mFile) != 0;
+        mFile = nullptr;
+    }
+    return !mError;
+}
+
+void EventCaptureWriter::WriteRecord(EventCaptureRecordType type, void const* header, uint32_t headerSize, void const* data, uint32_t dataSize)
+{
+    static uint8_t const padding[8] = {};
+
+    if (mFile == nullptr || mError) {
+        return;
+    }
+
+    EventCaptureRecordHeader recordHeader = {};
+    recordHeader.Type = type;
+    recordHeader.Size = headerSize + dataSize;
+
+    auto paddingSize = PaddedSize(recordHeader.Size) - recordHeader.Size;
+    if (fwrite(&recordHeader, sizeof(recordHeader), 1, mFile) != 1 ||
+        fwrite(header, headerSize, 1, mFile) != 1 ||
+        (dataSize > 0 && fwrite(data, dataSize, 1, mFile) != 1) ||
+        (paddingSize > 0 && fwrite(padding, paddingSize, 1, mFile) != 1)) {
+        mError = true;
+    }
+}
+
+bool EventCaptureWriter::NeedsMetadata(EventMetadataKey const& key)
+{
+    return mMetadataWritten.insert(key).second;
+}
+
+void EventCaptureWriter::WriteMetadata(EventMetadataKey const& key, void const* traceEventInfo, uint32_t traceEventInfoSize)
+{
+    EventCaptureMetadata metadata = {};
+    metadata.ProviderId      = key.guid_;
+    metadata.EventDescriptor = key.desc_;
+    WriteRecord(EVENT_CAPTURE_RECORD_METADATA, &metadata, sizeof(metadata), traceEventInfo, traceEventInfoSize);
+}
+
+void EventCaptureWriter::WriteEvent(EVENT_RECORD const& eventRecord)
+{
+    auto const& hdr = eventRecord.EventHeader;
+
+    EventCaptureEvent event = {};
+    event.ProviderId      = hdr.ProviderId;
+    event.EventDescriptor = hdr.EventDescriptor;
+    event.TimeStamp       = hdr.TimeStamp.QuadPart;
+    event.ThreadId        = hdr.ThreadId;
+    event.ProcessId       = hdr.ProcessId;
+    event.Flags           = hdr.Flags;
+    event.UserDataLength  = eventRecord.UserDataLength;
+    WriteRecord(EVENT_CAPTURE_RECORD_EVENT, &event, sizeof(event), eventRecord.UserData, eventRecord.UserDataLength);
+}
+
+bool EventCaptureReader::IsCaptureFile(char const* path)
+{
+    auto fp = OpenFile(path, "rb");
+    if (fp == nullptr) {
+        return false;
+    }
+
+    uint32_t magic = 0;
+    auto isCapture = fread(&magic, sizeof(magic), 1, fp) == 1 && magic == EVENT_CAPTURE_MAGIC;
+    fclose(fp);
+    return isCapture;
+}
+
+ULONG EventCaptureReader::Open(char const* path)
+{
+    mData.clear();
+    mSize = 0;
+    mOffset = 0;
+
+    auto fp = OpenFile(path, "rb");
+    if (fp == nullptr) {
+        return ERROR_FILE_NOT_FOUND;
+    }
+
+    // Read the whole file; replay then runs at memory speed.
+    std::vector<uint64_t> data;
+    size_t size = 0;
+    for (;;) {
+        data.resize(data.empty() ? (size_t) (1 << 17) : data.size() * 2);
+        auto bytes = (uint8_t*) data.data();
+        auto capacity = data.size() * sizeof(uint64_t);
+        auto read = fread(bytes + size, 1, capacity - size, fp);
+        size += read;
+        if (size < capacity) {
+            break;
+        }
+    }
+    fclose(fp);
+
+    if (size < sizeof(EventCaptureFileHeader)) {
+        return ERROR_FILE_CORRUPT;
+    }
+
+    auto header = (EventCaptureFileHeader const*) data.data();
+    if (header->Magic != EVENT_CAPTURE_MAGIC) {
+        return ERROR_FILE_CORRUPT;
+    }
+    if (header->Version != EVENT_CAPTURE_VERSION) {
+        return ERROR_NOT_SUPPORTED;
+    }
+    if (header->QpcFrequency <= 0) {
+        return ERROR_FILE_CORRUPT;
+    }
+
+    data.resize((size + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+    mData.swap(data);
+    mSize = size;
+    mOffset = sizeof(EventCaptureFileHeader);
+    return ERROR_SUCCESS;
+}
+
+bool EventCaptureReader::NextRecord(EventCaptureRecord* record)
+{
+    auto bytes = (uint8_t const*) mData.data();
+    if (mOffset + sizeof(EventCaptureRecordHeader) > mSize) {
+        return false;
+    }
+
+    auto recordHeader = (EventCaptureRecordHeader const*) (bytes + mOffset);
+    auto payloadOffset = mOffset + sizeof(EventCaptureRecordHeader);
+    if (payloadOffset + recordHeader->Size > mSize) {
+        return false;
+    }
+
+    // Validate that the payload is large enough for its fixed-size header
+    // so that GetEventRecord() and GetMetadata() don't need to.  Truncated
+    // records end the capture.
+    switch (recordHeader->Type) {
+    case EVENT_CAPTURE_RECORD_METADATA:
+        if (recordHeader->Size < sizeof(EventCaptureMetadata)) {
+            return false;
+        }
+        break;
+    case EVENT_CAPTURE_RECORD_EVENT:
+        if (recordHeader->Size < sizeof(EventCaptureEvent) ||
+            recordHeader->Size - sizeof(EventCaptureEvent) < ((EventCaptureEvent const*) (bytes + payloadOffset))->UserDataLength) {
+            return false;
+        }
+        break;
+    }
+
+    record->type_    = recordHeader->Type;
+    record->payload_ = bytes + payloadOffset;
+    record->size_    = recordHeader->Size;
+
+    mOffset = payloadOffset + PaddedSize(recordHeader->Size);
+    return true;
+}
+
+void EventCaptureReader::GetEventRecord(EventCaptureRecord const& record, EVENT_RECORD* eventRecord)
+{
+    assert(record.type_ == EVENT_CAPTURE_RECORD_EVENT);
+    auto event = (EventCaptureEvent const*) record.payload_;
+
+    auto hdr = &eventRecord->EventHeader;
+    hdr->ProviderId         = event->ProviderId;
+    hdr->EventDescriptor    = event->EventDescriptor;
+    hdr->TimeStamp.QuadPart = event->TimeStamp;
+    hdr->ThreadId           = event->ThreadId;
+    hdr->ProcessId          = event->ProcessId;
+    hdr->Flags              = event->Flags;
+    eventRecord->UserDataLength = event->UserDataLength;
+    eventRecord->UserData       = (void*) (event + 1);
+}
+
+void EventCaptureReader::GetMetadata(EventCaptureRecord const& record, EventMetadataKey* key, void const** traceEventInfo, uint32_t* traceEventInfoSize)
+{
+    assert(record.type_ == EVENT_CAPTURE_RECORD_METADATA);
+    auto metadata = (EventCaptureMetadata const*) record.payload_;
+
+    key->guid_ = metadata->ProviderId;
+    key->desc_ = metadata->EventDescriptor;
+    *traceEventInfo = metadata + 1;
+    *traceEventInfoSize = record.size_ - (uint32_t) sizeof(EventCaptureMetadata);
+}
@@ -0,0 +1,144 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <unordered_set>
+#include <vector>
+#include <windows.h>
+#include <evntcons.h> // must include after windows.h
+
+#include "TraceConsumer.hpp"
+
+// An event capture is a compact binary recording of the ETW events consumed
+// by a TraceSession, which can be replayed into the trace consumers without
+// ETW (see TraceSession::Start()).  Captures contain only the EVENT_HEADER
+// fields that the consumers use, each event's UserData, and the
+// TRACE_EVENT_INFO metadata needed to decode the events.  This makes captures
+// a deterministic input for regression testing and performance profiling.
+//
+// File layout (little-endian):
+//
+//     EventCaptureFileHeader
+//     Records...
+//
+// Each record is an EventCaptureRecordHeader followed by Size bytes of
+// payload, padded with zeros to an 8-byte boundary:
+//
+//     EVENT_CAPTURE_RECORD_METADATA: EventCaptureMetadata then TRACE_EVENT_INFO
+//     EVENT_CAPTURE_RECORD_EVENT:    EventCaptureEvent then UserData
+//
+// A metadata record is written before the first event that uses it.  Readers
+// must skip records with an unknown type, so new record types can be added
+// without changing EVENT_CAPTURE_VERSION.
+
+enum {
+    EVENT_CAPTURE_MAGIC   = 0x43454d50, // "PMEC"
+    EVENT_CAPTURE_VERSION = 1,
+};
+
+enum EventCaptureRecordType : uint32_t {
+    EVENT_CAPTURE_RECORD_METADATA = 1,
+    EVENT_CAPTURE_RECORD_EVENT    = 2,
+};
+
+struct EventCaptureFileHeader {
+    uint32_t Magic;
+    uint32_t Version;
+    int64_t QpcFrequency;       // Timestamp frequency
+    int64_t StartQpc;           // Session start time, or 0 to use the first event's timestamp
+};
+
+struct EventCaptureRecordHeader {
+    uint32_t Type;              // EventCaptureRecordType
+    uint32_t Size;              // Payload size, not including padding
+};
+
+struct EventCaptureMetadata {
+    GUID ProviderId;
+    EVENT_DESCRIPTOR EventDescriptor;
+};
+
+struct EventCaptureEvent {
+    GUID ProviderId;
+    EVENT_DESCRIPTOR EventDescriptor;
+    int64_t TimeStamp;
+    uint32_t ThreadId;
+    uint32_t ProcessId;
+    uint16_t Flags;
+    uint16_t UserDataLength;
+    uint32_t Reserved;
+};
+
+static_assert(sizeof(EventCaptureFileHeader) == 24, "EventCaptureFileHeader layout changed");
+static_assert(sizeof(EventCaptureRecordHeader) == 8, "EventCaptureRecordHeader layout changed");
+static_assert(sizeof(EventCaptureMetadata) == 32, "EventCaptureMetadata layout changed");
+static_assert(sizeof(EventCaptureEvent) == 56, "EventCaptureEvent layout changed");
+
+class EventCaptureWriter {
+    FILE* mFile = nullptr;
+    std::unordered_set<EventMetadataKey, EventMetadataKeyHash, EventMetadataKeyEqual> mMetadataWritten;
+    bool mError = false;
+
+    EventCaptureWriter(EventCaptureWriter const&) = delete;
+    EventCaptureWriter& operator=(EventCaptureWriter const&) = delete;
+
+    void WriteRecord(EventCaptureRecordType type, void const* header, uint32_t headerSize, void const* data, uint32_t dataSize);
+
+public:
+    EventCaptureWriter() = default;
+    ~EventCaptureWriter() { Close(); }
+
+    bool Open(char const* path, int64_t qpcFrequency, int64_t startQpc);
+    bool Close();   // Returns false if any write failed
+
+    // Returns true the first time it is called for a key, after which the
+    // caller should call WriteMetadata() for that key.
+    bool NeedsMetadata(EventMetadataKey const& key);
+    void WriteMetadata(EventMetadataKey const& key, void const* traceEventInfo, uint32_t traceEventInfoSize);
+    void WriteEvent(EVENT_RECORD const& eventRecord);
+};
+
+struct EventCaptureRecord {
+    uint32_t type_;             // EventCaptureRecordType
+    void const* payload_;       // 8-byte aligned
+    uint32_t size_;
+};
+
+class EventCaptureReader {
+    std::vector<uint64_t> mData;    // Entire file, as uint64_t so that payloads are 8-byte aligned
+    size_t mSize = 0;               // File size in bytes
+    size_t mOffset = 0;             // Offset of the next record
+
+    EventCaptureReader(EventCaptureReader const&) = delete;
+    EventCaptureReader& operator=(EventCaptureReader const&) = delete;
+
+public:
+    EventCaptureReader() = default;
+
+    // Returns whether path is an event capture file (as opposed to, e.g., an
+    // ETL file).
+    static bool IsCaptureFile(char const* path);
+
+    // Reads the entire capture into memory.  Returns ERROR_SUCCESS,
+    // ERROR_FILE_NOT_FOUND, ERROR_FILE_CORRUPT, or ERROR_NOT_SUPPORTED (for an
+    // unknown version).
+    ULONG Open(char const* path);
+
+    EventCaptureFileHeader const& GetHeader() const { return *(EventCaptureFileHeader const*) mData.data(); }
+
+    // Get the next record.  Returns false at the end of the capture, or if the
+    // rest of the capture is truncated.
+    bool NextRecord(EventCaptureRecord* record);
+
+    // Fill in the fields of eventRecord that the consumers use from an
+    // EVENT_CAPTURE_RECORD_EVENT record.  eventRecord->UserData points into
+    // the reader's buffer.
+    static void GetEventRecord(EventCaptureRecord const& record, EVENT_RECORD* eventRecord);
+
+    // Get the key and TRACE_EVENT_INFO from an EVENT_CAPTURE_RECORD_METADATA
+    // record.
+    static void GetMetadata(EventCaptureRecord const& record, EventMetadataKey* key, void const** traceEventInfo, uint32_t* traceEventInfoSize);
+};
@@ -0,0 +1,286 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <assert.h>
+#include <iterator>
+#include <stddef.h>
+#include <stdint.h>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// FlatHashMap is an open-addressing hash table used for PMTraceConsumer's
+// in-flight tracking maps.  These maps are keyed by integers (thread ids,
+// tokens, contexts, hwnds), are looked up on almost every event, and
+// typically only hold a handful of entries, so they benefit from storing the
+// entries contiguously rather than in std::map's heap-allocated tree nodes.
+//
+// - Entries are stored in a power-of-two sized slot array and collisions are
+//   resolved with linear probing.  The first INLINE_CAPACITY slots are stored
+//   inside the map itself, so small maps don't allocate at all.
+// - The slot index is taken from the high bits of the key's hash multiplied
+//   by the 64-bit golden ratio (Fibonacci hashing), so FlatHash only needs to
+//   be cheap, not well mixed.  Pointer-like keys with zero low bits and
+//   consecutive ids both spread well.
+// - erase() uses backward-shift deletion, so there are no tombstones and
+//   lookups never degrade after many insert/erase cycles.
+// - Iteration order is unspecified.  Any insert or erase invalidates
+//   iterators and references to entries.
+// - Erased slots are reset to a default-constructed value so that resources
+//   owned by the value (e.g., PoolPtr references) are released immediately.
+//
+// The interface is the subset of std::map's that PMTraceConsumer uses.
+
+template<typename Key>
+struct FlatHash {
+    uint64_t operator()(Key const& key) const
+    {
+        return (uint64_t) key;
+    }
+};
+
+template<typename... Types>
+struct FlatHash<std::tuple<Types...>> {
+    uint64_t operator()(std::tuple<Types...> const& key) const
+    {
+        return Combine(key, std::index_sequence_for<Types...>());
+    }
+
+private:
+    // Each element is multiplied by a different odd constant, which keeps the
+    // multiplies independent of each other.
+    template<size_t... I>
+    static uint64_t Combine(std::tuple<Types...> const& key, std::index_sequence<I...>)
+    {
+        static_assert(sizeof...(Types) <= 4, "FlatHash<std::tuple> supports up to 4 elements");
+        static constexpr uint64_t multipliers[] = {
+            1ull,
+            0xC2B2AE3D27D4EB4Full,
+            0x165667B19E3779F9ull,
+            0xD6E8FEB86659FD93ull,
+        };
+        uint64_t h = 0;
+        ((h += (uint64_t) std::get<I>(key) * multipliers[I]), ...);
+        return h ^ (h >> 29);
+    }
+};
+
+template<typename Key, typename Value, typename Hash = FlatHash<Key>, size_t INLINE_CAPACITY = 8>
+class FlatHashMap {
+    static_assert(INLINE_CAPACITY >= 2 && (INLINE_CAPACITY & (INLINE_CAPACITY - 1)) == 0,
+                  "INLINE_CAPACITY must be a power of two");
+
+public:
+    using value_type = std::pair<Key, Value>;
+
+private:
+    struct Slot {
+        value_type mEntry;
+        uint64_t mHash = 0;     // Fibonacci-scrambled hash, cached so erase() and Rehash() don't re-hash keys
+        bool mOccupied = false;
+    };
+
+    Slot mInlineSlots[INLINE_CAPACITY];
+    std::vector<Slot> mHeapSlots;   // Used instead of mInlineSlots once grown
+    size_t mCapacity = INLINE_CAPACITY;
+    size_t mSize = 0;
+    uint32_t mShift = ShiftForCapacity(INLINE_CAPACITY);
+
+    static uint32_t ShiftForCapacity(size_t capacity)
+    {
+        uint32_t shift = 64;
+        for (; capacity > 1; capacity >>= 1) {
+            shift -= 1;
+        }
+        return shift;
+    }
+
+    static uint64_t ScrambledHash(Key const& key) { return Hash()(key) * 0x9E3779B97F4A7C15ull; }
+    size_t HomeIndex(uint64_t hash) const { return (size_t) (hash >> mShift); }
+
+    Slot* Slots() { return mHeapSlots.empty() ? mInlineSlots : mHeapSlots.data(); }
+    Slot const* Slots() const { return mHeapSlots.empty() ? mInlineSlots : mHeapSlots.data(); }
+
+    template<typename SlotType>
+    SlotType* FindSlot(SlotType* slots, Key const& key, uint64_t hash) const
+    {
+        for (auto i = HomeIndex(hash); slots[i].mOccupied; i = (i + 1) & (mCapacity - 1)) {
+            if (slots[i].mHash == hash && slots[i].mEntry.first == key) {
+                return slots + i;
+            }
+        }
+        return nullptr;
+    }
+
+public:
+    template<typename SlotType, typename EntryType>
+    class Iterator {
+        SlotType* mSlot;
+        SlotType* mEnd;
+
+        void SkipEmpty() { while (mSlot != mEnd && !mSlot->mOccupied) ++mSlot; }
+
+        friend class FlatHashMap;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = typename std::remove_const<EntryType>::type;
+        using difference_type   = ptrdiff_t;
+        using pointer           = EntryType*;
+        using reference         = EntryType&;
+
+        Iterator(SlotType* slot, SlotType* end) : mSlot(slot), mEnd(end) { SkipEmpty(); }
+
+        EntryType& operator*() const { return mSlot->mEntry; }
+        EntryType* operator->() const { return &mSlot->mEntry; }
+        Iterator& operator++() { ++mSlot; SkipEmpty(); return *this; }
+        bool operator==(Iterator const& rhs) const { return mSlot == rhs.mSlot; }
+        bool operator!=(Iterator const& rhs) const { return mSlot != rhs.mSlot; }
+    };
+
+    using iterator       = Iterator<Slot, value_type>;
+    using const_iterator = Iterator<Slot const, value_type const>;
+
+    FlatHashMap() = default;
+
+    FlatHashMap(FlatHashMap const&) = delete;
+    FlatHashMap& operator=(FlatHashMap const&) = delete;
+
+    size_t size() const { return mSize; }
+    bool empty() const { return mSize == 0; }
+
+    iterator begin() { return iterator(Slots(), Slots() + mCapacity); }
+    iterator end() { return iterator(Slots() + mCapacity, Slots() + mCapacity); }
+    const_iterator begin() const { return const_iterator(Slots(), Slots() + mCapacity); }
+    const_iterator end() const { return const_iterator(Slots() + mCapacity, Slots() + mCapacity); }
+
+    iterator find(Key const& key)
+    {
+        auto slots = Slots();
+        auto slot = FindSlot(slots, key, ScrambledHash(key));
+        return slot == nullptr ? end() : iterator(slot, slots + mCapacity);
+    }
+
+    const_iterator find(Key const& key) const
+    {
+        auto slots = Slots();
+        auto slot = FindSlot(slots, key, ScrambledHash(key));
+        return slot == nullptr ? end() : const_iterator(slot, slots + mCapacity);
+    }
+
+    template<typename V>
+    std::pair<iterator, bool> emplace(Key const& key, V&& value)
+    {
+        // Grow when the load factor would exceed 1/2, which keeps linear
+        // probe sequences short.
+        if ((mSize + 1) * 2 > mCapacity) {
+            Rehash(mCapacity * 2);
+        }
+
+        auto slots = Slots();
+        auto hash = ScrambledHash(key);
+        auto i = HomeIndex(hash);
+        for (; slots[i].mOccupied; i = (i + 1) & (mCapacity - 1)) {
+            if (slots[i].mHash == hash && slots[i].mEntry.first == key) {
+                return std::make_pair(iterator(slots + i, slots + mCapacity), false);
+            }
+        }
+
+        slots[i].mEntry.first = key;
+        slots[i].mEntry.second = std::forward<V>(value);
+        slots[i].mHash = hash;
+        slots[i].mOccupied = true;
+        mSize += 1;
+        return std::make_pair(iterator(slots + i, slots + mCapacity), true);
+    }
+
+    Value& operator[](Key const& key)
+    {
+        auto ii = find(key);
+        if (ii == end()) {
+            ii = emplace(key, Value()).first;
+        }
+        return ii->second;
+    }
+
+    void erase(iterator ii)
+    {
+        assert(ii != end());
+
+        // Backward-shift deletion: move any following entries in the same
+        // probe sequence back into the hole so that lookups never have to
+        // skip over deleted slots.
+        auto slots = Slots();
+        auto mask = mCapacity - 1;
+        auto hole = (size_t) (ii.mSlot - slots);
+        for (auto i = (hole + 1) & mask; slots[i].mOccupied; i = (i + 1) & mask) {
+            auto home = HomeIndex(slots[i].mHash);
+            if (((i - home) & mask) >= ((i - hole) & mask)) {
+                slots[hole].mEntry = std::move(slots[i].mEntry);
+                slots[hole].mHash = slots[i].mHash;
+                hole = i;
+            }
+        }
+
+        slots[hole].mEntry = value_type();
+        slots[hole].mOccupied = false;
+        mSize -= 1;
+    }
+
+    size_t erase(Key const& key)
+    {
+        auto ii = find(key);
+        if (ii == end()) {
+            return 0;
+        }
+        erase(ii);
+        return 1;
+    }
+
+    // Removes all entries but keeps the current capacity.
+    void clear()
+    {
+        if (mSize == 0) {
+            return;
+        }
+
+        auto slots = Slots();
+        for (size_t i = 0; i < mCapacity; ++i) {
+            if (slots[i].mOccupied) {
+                slots[i].mEntry = value_type();
+                slots[i].mOccupied = false;
+            }
+        }
+        mSize = 0;
+    }
+
+private:
+    void Rehash(size_t newCapacity)
+    {
+        std::vector<Slot> newSlots(newCapacity);
+        auto newShift = ShiftForCapacity(newCapacity);
+        auto oldSlots = Slots();
+        auto oldCapacity = mCapacity;
+
+        for (size_t i = 0; i < oldCapacity; ++i) {
+            if (oldSlots[i].mOccupied) {
+                auto j = (size_t) (oldSlots[i].mHash >> newShift);
+                while (newSlots[j].mOccupied) {
+                    j = (j + 1) & (newCapacity - 1);
+                }
+                newSlots[j].mEntry = std::move(oldSlots[i].mEntry);
+                newSlots[j].mHash = oldSlots[i].mHash;
+                newSlots[j].mOccupied = true;
+                oldSlots[i].mEntry = value_type();
+                oldSlots[i].mOccupied = false;
+            }
+        }
+
+        mHeapSlots.swap(newSlots);
+        mCapacity = newCapacity;
+        mShift = newShift;
+    }
+};
@@ -0,0 +1,114 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <windows.h>
+
+#include "SpscQueue.hpp"
+
+// HandoffSignal is used by the trace consumers to wake the thread that
+// dequeues their completed events, so that it can block until there is work
+// to do instead of polling.
+//
+// The waiting thread sets mWaiting before it re-checks its queues and blocks,
+// and Notify() only calls SetEvent() if a waiter has advertised itself.  This
+// keeps the common case on the consumer thread (pushing an event while the
+// waiter is already awake) down to a fence and a load, and guarantees that a
+// push that races with Wait() is never missed.
+
+class HandoffSignal {
+    HANDLE mEvent;
+    std::atomic<bool> mWaiting;
+
+    HandoffSignal(HandoffSignal const&) = delete;
+    HandoffSignal& operator=(HandoffSignal const&) = delete;
+
+public:
+    HandoffSignal()
+        : mEvent(CreateEventW(nullptr, FALSE, FALSE, nullptr))
+        , mWaiting(false)
+    {
+    }
+
+    ~HandoffSignal()
+    {
+        if (mEvent != NULL) {
+            CloseHandle(mEvent);
+        }
+    }
+
+    // Wake the waiting thread, if any.  Can be called from any thread.
+    void Notify()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (mWaiting.load(std::memory_order_relaxed) && mWaiting.exchange(false)) {
+            SetEvent(mEvent);
+        }
+    }
+
+    // Block until Notify() is called or timeoutMs elapses.  isReady() is
+    // called after the waiter is advertised and, if it returns true, Wait()
+    // returns immediately.  Returns true if woken by Notify() or isReady().
+    template<typename IsReadyFn>
+    bool Wait(DWORD timeoutMs, IsReadyFn isReady)
+    {
+        mWaiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (isReady()) {
+            mWaiting.store(false, std::memory_order_relaxed);
+            return true;
+        }
+
+        if (mEvent == NULL) {
+            Sleep(timeoutMs);
+            mWaiting.store(false, std::memory_order_relaxed);
+            return false;
+        }
+
+        auto woken = WaitForSingleObject(mEvent, timeoutMs) == WAIT_OBJECT_0;
+        mWaiting.store(false, std::memory_order_relaxed);
+        return woken;
+    }
+};
+
+// Move as many overflowed items as fit into queue, waking the dequeuing
+// thread if any were moved.  Must be called on the consumer thread.  Returns
+// true if overflow is empty.
+template<typename T>
+bool FlushOverflow(SpscQueue<T>* queue, std::deque<T>* overflow, HandoffSignal* signal)
+{
+    auto moved = false;
+    while (!overflow->empty() && queue->TryPush(overflow->front())) {
+        overflow->pop_front();
+        moved = true;
+    }
+    if (moved && signal != nullptr) {
+        signal->Notify();
+    }
+    return overflow->empty();
+}
+
+// Push item onto queue and wake the dequeuing thread.
+//
+// The consumer thread must never wait for the dequeuing thread: the output
+// thread can itself be blocked behind a slow disk, and any time the consumer
+// thread spends waiting is time that ETW buffers are not being drained.  So
+// if the queue is full, item is appended to overflow instead.  overflow is
+// owned by the consumer thread, and its items are moved into the queue (in
+// order, ahead of any newer items) as room becomes available on later pushes
+// or FlushOverflow() calls.  overflow is unbounded; it only grows while the
+// dequeuing thread is falling behind.
+template<typename T>
+void PushAndNotify(SpscQueue<T>* queue, std::deque<T>* overflow, T& item, HandoffSignal* signal)
+{
+    if (!overflow->empty() || !queue->TryPush(item)) {
+        overflow->emplace_back(std::move(item));
+        FlushOverflow(queue, overflow, nullptr);
+    }
+    if (signal != nullptr) {
+        signal->Notify();
+    }
+}
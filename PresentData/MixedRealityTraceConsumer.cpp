@@ -106,10 +106,7 @@ void MRTraceConsumer::CompleteLSR(std::shared_ptr<LateStageReprojectionEvent> p)
     }
 
     p->Completed = true;
-    {
-        std::lock_guard<std::mutex> lock(mMutex);
-        mCompletedLSRs.push_back(p);
-    }
+    PushAndNotify(&mCompletedLSRs, &mCompletedLSROverflow, p, mHandoffSignal);
 }
 
 void MRTraceConsumer::CompleteHolographicFrame(std::shared_ptr<HolographicFrame> p)
@@ -213,11 +213,15 @@ struct MRTraceConsumer
 
     const bool mSimpleMode;
 
-    std::mutex mMutex;
+    enum { COMPLETED_LSR_QUEUE_CAPACITY = 4096 };
+
     // A set of LSRs that are "completed":
     // They progressed as far as they can through the pipeline before being either discarded or hitting the screen.
-    // These will be handed off to the consumer thread.
-    std::vector<std::shared_ptr<LateStageReprojectionEvent>> mCompletedLSRs;
+    // These will be handed off to the output thread, which is woken through mHandoffSignal if set.
+    // While the queue is full, they are held in mCompletedLSROverflow (see PushAndNotify()).
+    HandoffSignal* mHandoffSignal = nullptr;
+    SpscQueue<std::shared_ptr<LateStageReprojectionEvent>> mCompletedLSRs { COMPLETED_LSR_QUEUE_CAPACITY };
+    std::deque<std::shared_ptr<LateStageReprojectionEvent>> mCompletedLSROverflow;
 
     // A high-level description of the sequence of events:
     // HolographicFrameStart (by HolographicFrameId, for App's CPU frame render start time) -> HolographicFrameStop (by HolographicFrameId, for App's CPU frame render end/Present time) -> 
@@ -237,8 +241,17 @@ struct MRTraceConsumer
     std::shared_ptr<LateStageReprojectionEvent> mActiveLSR;
     void DequeueLSRs(std::vector<std::shared_ptr<LateStageReprojectionEvent>>& outLSRs)
     {
-        std::lock_guard<std::mutex> lock(mMutex);
-        outLSRs.swap(mCompletedLSRs);
+        mCompletedLSRs.PopAll(&outLSRs);
+    }
+
+    bool HasQueuedEvents()
+    {
+        return !mCompletedLSRs.Empty();
+    }
+
+    bool FlushHandoffOverflow()
+    {
+        return FlushOverflow(&mCompletedLSRs, &mCompletedLSROverflow, mHandoffSignal);
     }
 
     void CompleteLSR(std::shared_ptr<LateStageReprojectionEvent> p);
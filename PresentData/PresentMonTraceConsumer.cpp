@@ -16,10 +16,13 @@
 #include <dxgi.h>
 #include <unordered_set>
 
+// The maximum number of in-flight presents.  Presents are normally
+// considered lost once they are older than mLostPresentAge, but if there are
+// more than this many in flight the oldest are considered lost early.
 #ifdef DEBUG
-static constexpr int PRESENTEVENT_CIRCULAR_BUFFER_SIZE = 32768;
+static constexpr size_t MAX_IN_FLIGHT_PRESENTS = 32768;
 #else
-static constexpr int PRESENTEVENT_CIRCULAR_BUFFER_SIZE = 8192;
+static constexpr size_t MAX_IN_FLIGHT_PRESENTS = 8192;
 #endif
 
 // These macros, when enabled, record what PresentMon analysis below was done
@@ -50,8 +53,6 @@ static constexpr int PRESENTEVENT_CIRCULAR_BUFFER_SIZE = 8192;
 
 PresentEvent::PresentEvent(EVENT_HEADER const& hdr, ::Runtime runtime)
     : QpcTime(*(uint64_t*) &hdr.TimeStamp)
-    , ProcessId(hdr.ProcessId)
-    , ThreadId(hdr.ThreadId)
     , TimeTaken(0)
     , ReadyTime(0)
     , ScreenTime(0)
@@ -60,10 +61,10 @@ PresentEvent::PresentEvent(EVENT_HEADER const& hdr, ::Runtime runtime)
     , PresentFlags(0)
     , Hwnd(0)
     , TokenPtr(0)
-    , CompositionSurfaceLuid(0)
     , QueueSubmitSequence(0)
-    , DestWidth(0)
-    , DestHeight(0)
+    , SwapChainId(0)
+    , ProcessId(hdr.ProcessId)
+    , ThreadId(hdr.ThreadId)
     , DriverBatchThreadId(0)
     , Runtime(runtime)
     , PresentMode(PresentMode::Unknown)
@@ -77,11 +78,6 @@ PresentEvent::PresentEvent(EVENT_HEADER const& hdr, ::Runtime runtime)
     , CompletionIsDeferred(false)
     , IsCompleted(false)
     , IsLost(false)
-    , mAllPresentsTrackingIndex(UINT32_MAX)
-    , DxgKrnlHContext(0)
-    , Win32KPresentCount(0)
-    , Win32KBindId(0)
-    , LegacyBlitTokenData(0)
     , PresentInDwmWaitingStruct(false)
 {
 #ifdef TRACK_PRESENT_PATHS
@@ -96,8 +92,13 @@ PresentEvent::PresentEvent(EVENT_HEADER const& hdr, ::Runtime runtime)
 }
 
 PMTraceConsumer::PMTraceConsumer()
-    : mAllPresents(PRESENTEVENT_CIRCULAR_BUFFER_SIZE)
 {
+    SetQpcFrequency(10000000);
+}
+
+void PMTraceConsumer::SetQpcFrequency(int64_t qpcFrequency)
+{
+    mLostPresents.Configure((uint64_t) (mLostPresentAge * qpcFrequency), MAX_IN_FLIGHT_PRESENTS);
 }
 
 void PMTraceConsumer::HandleD3D9Event(EVENT_RECORD* pEventRecord)
@@ -113,15 +114,11 @@ void PMTraceConsumer::HandleD3D9Event(EVENT_RECORD* pEventRecord)
     switch (hdr.EventDescriptor.Id) {
     case Microsoft_Windows_D3D9::Present_Start::Id:
     {
-        EventDataDesc desc[] = {
-            { L"pSwapchain" },
-            { L"Flags" },
-        };
-        mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-        auto pSwapchain = desc[0].GetData<uint64_t>();
-        auto Flags      = desc[1].GetData<uint32_t>();
+        auto view = mMetadata.GetEventView<Microsoft_Windows_D3D9::Present_Start_View>(pEventRecord);
+        auto pSwapchain = view.pSwapchain();
+        auto Flags      = (uint32_t) view.Flags();
 
-        auto present = std::make_shared<PresentEvent>(hdr, Runtime::D3D9);
+        auto present = mPresentEventPool.Allocate(hdr, Runtime::D3D9);
         present->SwapChainAddress = pSwapchain;
         present->PresentFlags =
             ((Flags & D3DPRESENT_DONOTFLIP) ? DXGI_PRESENT_DO_NOT_SEQUENCE : 0) |
@@ -137,7 +134,7 @@ void PMTraceConsumer::HandleD3D9Event(EVENT_RECORD* pEventRecord)
     }
     case Microsoft_Windows_D3D9::Present_Stop::Id:
     {
-        auto result = mMetadata.GetEventData<uint32_t>(pEventRecord, L"Result");
+        auto result = mMetadata.GetEventView<Microsoft_Windows_D3D9::Present_Stop_View>(pEventRecord).Result();
 
         bool AllowBatching =
             SUCCEEDED(result) &&
@@ -166,15 +163,10 @@ void PMTraceConsumer::HandleDXGIEvent(EVENT_RECORD* pEventRecord)
     case Microsoft_Windows_DXGI::Present_Start::Id:
     case Microsoft_Windows_DXGI::PresentMultiplaneOverlay_Start::Id:
     {
-        EventDataDesc desc[] = {
-            { L"pIDXGISwapChain" },
-            { L"Flags" },
-            { L"SyncInterval" },
-        };
-        mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-        auto pIDXGISwapChain = desc[0].GetData<uint64_t>();
-        auto Flags           = desc[1].GetData<uint32_t>();
-        auto SyncInterval    = desc[2].GetData<int32_t>();
+        auto view = mMetadata.GetEventView<Microsoft_Windows_DXGI::Present_Start_View>(pEventRecord);
+        auto pIDXGISwapChain = view.pIDXGISwapChain();
+        auto Flags           = (uint32_t) view.Flags();
+        auto SyncInterval    = view.SyncInterval();
 
         // Ignore PRESENT_TEST: it's just to check if you're still fullscreen
         if ((Flags & DXGI_PRESENT_TEST) != 0) {
@@ -190,7 +182,7 @@ void PMTraceConsumer::HandleDXGIEvent(EVENT_RECORD* pEventRecord)
             break;
         }
 
-        auto present = std::make_shared<PresentEvent>(hdr, Runtime::DXGI);
+        auto present = mPresentEventPool.Allocate(hdr, Runtime::DXGI);
         present->SwapChainAddress = pIDXGISwapChain;
         present->PresentFlags     = Flags;
         present->SyncInterval     = SyncInterval;
@@ -202,7 +194,7 @@ void PMTraceConsumer::HandleDXGIEvent(EVENT_RECORD* pEventRecord)
     case Microsoft_Windows_DXGI::Present_Stop::Id:
     case Microsoft_Windows_DXGI::PresentMultiplaneOverlay_Stop::Id:
     {
-        auto result = mMetadata.GetEventData<uint32_t>(pEventRecord, L"Result");
+        auto result = mMetadata.GetEventView<Microsoft_Windows_DXGI::Present_Stop_View>(pEventRecord).Result();
 
         bool AllowBatching =
             SUCCEEDED(result) &&
@@ -261,9 +253,12 @@ void PMTraceConsumer::HandleDxgkBltCancel(EVENT_HEADER const& hdr)
     auto eventIter = mPresentByThreadId.find(hdr.ThreadId);
 
     if (eventIter != mPresentByThreadId.end()) {
-        TRACK_PRESENT_PATH(eventIter->second);
-        eventIter->second->FinalState = PresentResult::Discarded;
-        CompletePresent(eventIter->second);
+        // Copy the present out of the map, as CompletePresent() will remove
+        // it from mPresentByThreadId.
+        auto present = eventIter->second;
+        TRACK_PRESENT_PATH(present);
+        present->FinalState = PresentResult::Discarded;
+        CompletePresent(present);
     }
 }
 
@@ -308,10 +303,7 @@ void PMTraceConsumer::HandleDxgkFlip(EVENT_HEADER const& hdr, int32_t flipInterv
 
     // If this is the DWM thread, piggyback these pending presents on our fullscreen present
     if (hdr.ThreadId == DwmPresentThreadId) {
-        for (auto iter = mPresentsWaitingForDWM.begin(); iter != mPresentsWaitingForDWM.end(); iter++) {
-            iter->get()->PresentInDwmWaitingStruct = false;
-        }
-        std::swap(presentEvent->DependentPresents, mPresentsWaitingForDWM);
+        MovePresentsWaitingForDWM(&GetExtension(presentEvent)->DependentPresents);
         DwmPresentThreadId = 0;
     }
 }
@@ -332,12 +324,15 @@ void PMTraceConsumer::HandleDxgkQueueSubmit(
         bool completedPresent = false;
         auto eventIter = mBltsByDxgContext.find(context);
         if (eventIter != mBltsByDxgContext.end()) {
-            TRACK_PRESENT_PATH(eventIter->second);
-            if (eventIter->second->PresentMode == PresentMode::Hardware_Legacy_Copy_To_Front_Buffer) {
-                DebugModifyPresent(*eventIter->second);
-                eventIter->second->SeenDxgkPresent = true;
-                if (eventIter->second->ScreenTime != 0) {
-                    CompletePresent(eventIter->second);
+            // Copy the present out of the map, as CompletePresent() will
+            // remove it from mBltsByDxgContext.
+            auto present = eventIter->second;
+            TRACK_PRESENT_PATH(present);
+            if (present->PresentMode == PresentMode::Hardware_Legacy_Copy_To_Front_Buffer) {
+                DebugModifyPresent(*present);
+                present->SeenDxgkPresent = true;
+                if (present->ScreenTime != 0) {
+                    CompletePresent(present);
                     completedPresent = true;
                 }
             }
@@ -367,7 +362,7 @@ void PMTraceConsumer::HandleDxgkQueueSubmit(
 
         if (eventIter->second->PresentMode == PresentMode::Hardware_Legacy_Copy_To_Front_Buffer && !supportsDxgkPresentEvent) {
             mBltsByDxgContext[context] = eventIter->second;
-            eventIter->second->DxgKrnlHContext = context;
+            GetExtension(eventIter->second)->DxgKrnlHContext = context;
         }
     }
 }
@@ -592,12 +587,11 @@ void PMTraceConsumer::HandleDxgkPresentHistory(
     } else if (presentEvent->PresentMode == PresentMode::Composed_Copy_CPU_GDI) {
         if (tokenData == 0) {
             // This is the best we can do, we won't be able to tell how many frames are actually displayed.
-            mPresentsWaitingForDWM.emplace_back(presentEvent);
-            presentEvent->PresentInDwmWaitingStruct = true;
+            AddPresentWaitingForDWM(presentEvent);
         } else {
             assert(mPresentsByLegacyBlitToken.find(tokenData) == mPresentsByLegacyBlitToken.end());
             mPresentsByLegacyBlitToken[tokenData] = presentEvent;
-            presentEvent->LegacyBlitTokenData = tokenData;
+            GetExtension(presentEvent)->LegacyBlitTokenData = tokenData;
         }
     }
 
@@ -626,8 +620,7 @@ void PMTraceConsumer::HandleDxgkPresentHistoryInfo(EVENT_HEADER const& hdr, uint
     // Composed Composition Atlas or Win7 Flip does not have DWM events indicating intent to present this frame.
     if (eventIter->second->PresentMode == PresentMode::Composed_Composition_Atlas ||
         (eventIter->second->PresentMode == PresentMode::Composed_Flip && !eventIter->second->SeenWin32KEvents)) {
-        mPresentsWaitingForDWM.emplace_back(eventIter->second);
-        eventIter->second->PresentInDwmWaitingStruct = true;
+        AddPresentWaitingForDWM(eventIter->second);
         eventIter->second->DwmNotified = true;
     }
 
@@ -650,13 +643,9 @@ void PMTraceConsumer::HandleDXGKEvent(EVENT_RECORD* pEventRecord)
     switch (hdr.EventDescriptor.Id) {
     case Microsoft_Windows_DxgKrnl::Flip_Info::Id:
     {
-        EventDataDesc desc[] = {
-            { L"FlipInterval" },
-            { L"MMIOFlip" },
-        };
-        mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-        auto FlipInterval = desc[0].GetData<uint32_t>();
-        auto MMIOFlip     = desc[1].GetData<BOOL>() != 0;
+        auto view = mMetadata.GetEventView<Microsoft_Windows_DxgKrnl::Flip_Info_View>(pEventRecord);
+        auto FlipInterval = view.FlipInterval();
+        auto MMIOFlip     = view.MMIOFlip() != 0;
 
         TRACK_PRESENT_PATH_GENERATE_ID();
         HandleDxgkFlip(hdr, FlipInterval, MMIOFlip);
@@ -664,11 +653,7 @@ void PMTraceConsumer::HandleDXGKEvent(EVENT_RECORD* pEventRecord)
     }
     case Microsoft_Windows_DxgKrnl::IndependentFlip_Info::Id:
     {
-        EventDataDesc desc[] = {
-            { L"SubmitSequence" },
-        };
-        mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-        auto flipSubmitSequence = desc[0].GetData<uint32_t>();
+        auto flipSubmitSequence = mMetadata.GetEventView<Microsoft_Windows_DxgKrnl::IndependentFlip_Info_View>(pEventRecord).SubmitSequence();
 
         auto pEvent = FindBySubmitSequence(flipSubmitSequence);
 
@@ -683,34 +668,24 @@ void PMTraceConsumer::HandleDXGKEvent(EVENT_RECORD* pEventRecord)
         break;
     case Microsoft_Windows_DxgKrnl::QueuePacket_Start::Id:
     {
-        EventDataDesc desc[] = {
-            { L"PacketType" },
-            { L"SubmitSequence" },
-            { L"hContext" },
-            { L"bPresent" },
-        };
-        mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-        auto PacketType     = desc[0].GetData<uint32_t>();
-        auto SubmitSequence = desc[1].GetData<uint32_t>();
-        auto hContext       = desc[2].GetData<uint64_t>();
-        auto bPresent       = desc[3].GetData<BOOL>() != 0;
+        auto view = mMetadata.GetEventView<Microsoft_Windows_DxgKrnl::QueuePacket_Start_View>(pEventRecord);
+        auto PacketType     = (uint32_t) view.PacketType();
+        auto SubmitSequence = view.SubmitSequence();
+        auto hContext       = view.hContext();
+        auto bPresent       = view.bPresent() != 0;
 
         HandleDxgkQueueSubmit(hdr, PacketType, SubmitSequence, hContext, bPresent, true);
         break;
     }
     case Microsoft_Windows_DxgKrnl::QueuePacket_Stop::Id:
         TRACK_PRESENT_PATH_GENERATE_ID();
-        HandleDxgkQueueComplete(hdr, mMetadata.GetEventData<uint32_t>(pEventRecord, L"SubmitSequence"));
+        HandleDxgkQueueComplete(hdr, mMetadata.GetEventView<Microsoft_Windows_DxgKrnl::QueuePacket_Stop_View>(pEventRecord).SubmitSequence());
         break;
     case Microsoft_Windows_DxgKrnl::MMIOFlip_Info::Id:
     {
-        EventDataDesc desc[] = {
-            { L"FlipSubmitSequence" },
-            { L"Flags" },
-        };
-        mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-        auto FlipSubmitSequence = desc[0].GetData<uint32_t>();
-        auto Flags              = desc[1].GetData<uint32_t>();
+        auto view = mMetadata.GetEventView<Microsoft_Windows_DxgKrnl::MMIOFlip_Info_View>(pEventRecord);
+        auto FlipSubmitSequence = view.FlipSubmitSequence();
+        auto Flags              = (uint32_t) view.Flags();
 
         TRACK_PRESENT_PATH_GENERATE_ID();
         HandleDxgkMMIOFlip(hdr, FlipSubmitSequence, Flags);
@@ -719,13 +694,9 @@ void PMTraceConsumer::HandleDXGKEvent(EVENT_RECORD* pEventRecord)
     case Microsoft_Windows_DxgKrnl::MMIOFlipMultiPlaneOverlay_Info::Id:
     {
         auto flipEntryStatusAfterFlipValid = hdr.EventDescriptor.Version >= 2;
-        EventDataDesc desc[] = {
-            { L"FlipSubmitSequence" },
-            { L"FlipEntryStatusAfterFlip" }, // optional
-        };
-        mMetadata.GetEventData(pEventRecord, desc, _countof(desc) - (flipEntryStatusAfterFlipValid ? 0 : 1));
-        auto FlipFenceId              = desc[0].GetData<uint64_t>();
-        auto FlipEntryStatusAfterFlip = flipEntryStatusAfterFlipValid ? desc[1].GetData<uint32_t>() : 0u;
+        auto view = mMetadata.GetEventView<Microsoft_Windows_DxgKrnl::MMIOFlipMultiPlaneOverlay_Info_View>(pEventRecord);
+        auto FlipFenceId              = view.FlipSubmitSequence();
+        auto FlipEntryStatusAfterFlip = flipEntryStatusAfterFlipValid ? (uint32_t) view.FlipEntryStatusAfterFlip() : 0u;
 
         auto flipSubmitSequence = (uint32_t) (FlipFenceId >> 32u);
 
@@ -777,7 +748,7 @@ void PMTraceConsumer::HandleDXGKEvent(EVENT_RECORD* pEventRecord)
     {
         TRACK_PRESENT_PATH_GENERATE_ID();
 
-        auto FlipFenceId = mMetadata.GetEventData<uint64_t>(pEventRecord, L"FlipFenceId");
+        auto FlipFenceId = mMetadata.GetEventView<Microsoft_Windows_DxgKrnl::VSyncDPC_Info_View>(pEventRecord).FlipFenceId();
         HandleDxgkSyncDPC(hdr, (uint32_t)(FlipFenceId >> 32u));
         break;
     }
@@ -796,7 +767,7 @@ void PMTraceConsumer::HandleDXGKEvent(EVENT_RECORD* pEventRecord)
             present->SeenDxgkPresent = true;
 
             if (present->Hwnd == 0) {
-                present->Hwnd = mMetadata.GetEventData<uint64_t>(pEventRecord, L"hWindow");
+                present->Hwnd = mMetadata.GetEventView<Microsoft_Windows_DxgKrnl::Present_Info_View>(pEventRecord).hWindow();
             }
 
             // If we are not expecting an API present end event, then treat this as
@@ -824,15 +795,10 @@ void PMTraceConsumer::HandleDXGKEvent(EVENT_RECORD* pEventRecord)
     case Microsoft_Windows_DxgKrnl::PresentHistoryDetailed_Start::Id:
     case Microsoft_Windows_DxgKrnl::PresentHistory_Start::Id:
     {
-        EventDataDesc desc[] = {
-            { L"Token" },
-            { L"Model" },
-            { L"TokenData" },
-        };
-        mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-        auto Token     = desc[0].GetData<uint64_t>();
-        auto Model     = desc[1].GetData<Microsoft_Windows_DxgKrnl::PresentModel>();
-        auto TokenData = desc[2].GetData<uint64_t>();
+        auto view = mMetadata.GetEventView<Microsoft_Windows_DxgKrnl::PresentHistory_Start_View>(pEventRecord);
+        auto Token     = view.Token();
+        auto Model     = view.Model();
+        auto TokenData = view.TokenData();
 
         if (Model != Microsoft_Windows_DxgKrnl::PresentModel::D3DKMT_PM_REDIRECTED_GDI) {
             auto presentMode = PresentMode::Unknown;
@@ -850,17 +816,13 @@ void PMTraceConsumer::HandleDXGKEvent(EVENT_RECORD* pEventRecord)
     }
     case Microsoft_Windows_DxgKrnl::PresentHistory_Info::Id:
         TRACK_PRESENT_PATH_GENERATE_ID();
-        HandleDxgkPresentHistoryInfo(hdr, mMetadata.GetEventData<uint64_t>(pEventRecord, L"Token"));
+        HandleDxgkPresentHistoryInfo(hdr, mMetadata.GetEventView<Microsoft_Windows_DxgKrnl::PresentHistory_Info_View>(pEventRecord).Token());
         break;
     case Microsoft_Windows_DxgKrnl::Blit_Info::Id:
     {
-        EventDataDesc desc[] = {
-            { L"hwnd" },
-            { L"bRedirectedPresent" },
-        };
-        mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-        auto hwnd               = desc[0].GetData<uint64_t>();
-        auto bRedirectedPresent = desc[1].GetData<uint32_t>() != 0;
+        auto view = mMetadata.GetEventView<Microsoft_Windows_DxgKrnl::Blit_Info_View>(pEventRecord);
+        auto hwnd               = view.hwnd();
+        auto bRedirectedPresent = view.bRedirectedPresent() != 0;
 
         TRACK_PRESENT_PATH_GENERATE_ID();
         HandleDxgkBlt(hdr, hwnd, bRedirectedPresent);
@@ -1081,17 +1043,10 @@ void PMTraceConsumer::HandleWin32kEvent(EVENT_RECORD* pEventRecord)
     switch (hdr.EventDescriptor.Id) {
     case Microsoft_Windows_Win32k::TokenCompositionSurfaceObject_Info::Id:
     {
-        EventDataDesc desc[] = {
-            { L"CompositionSurfaceLuid" },
-            { L"PresentCount" },
-            { L"BindId" },
-            { L"DestWidth" },  // version >= 1
-            { L"DestHeight" }, // version >= 1
-        };
-        mMetadata.GetEventData(pEventRecord, desc, _countof(desc) - (hdr.EventDescriptor.Version == 0 ? 2 : 0));
-        auto CompositionSurfaceLuid = desc[0].GetData<uint64_t>();
-        auto PresentCount           = desc[1].GetData<uint64_t>();
-        auto BindId                 = desc[2].GetData<uint64_t>();
+        auto view = mMetadata.GetEventView<Microsoft_Windows_Win32k::TokenCompositionSurfaceObject_Info_View>(pEventRecord);
+        auto CompositionSurfaceLuid = view.CompositionSurfaceLuid();
+        auto PresentCount           = view.PresentCount();
+        auto BindId                 = view.BindId();
 
         // Lookup the in-progress present.  It should not have seen any Win32K
         // events yet, so SeenWin32KEvents==true implies we looked up a 'stuck'
@@ -1116,33 +1071,28 @@ void PMTraceConsumer::HandleWin32kEvent(EVENT_RECORD* pEventRecord)
         PresentEvent->PresentMode = PresentMode::Composed_Flip;
         PresentEvent->SeenWin32KEvents = true;
 
+        auto extension = GetExtension(PresentEvent);
         if (hdr.EventDescriptor.Version >= 1) {
-            PresentEvent->DestWidth  = desc[3].GetData<uint32_t>();
-            PresentEvent->DestHeight = desc[4].GetData<uint32_t>();
+            extension->DestWidth  = view.DestWidth();
+            extension->DestHeight = view.DestHeight();
         }
 
         PMTraceConsumer::Win32KPresentHistoryTokenKey key(CompositionSurfaceLuid, PresentCount, BindId);
         assert(mWin32KPresentHistoryTokens.find(key) == mWin32KPresentHistoryTokens.end());
         mWin32KPresentHistoryTokens[key] = PresentEvent;
-        PresentEvent->CompositionSurfaceLuid = CompositionSurfaceLuid;
-        PresentEvent->Win32KPresentCount = PresentCount;
-        PresentEvent->Win32KBindId = BindId;
+        extension->CompositionSurfaceLuid = CompositionSurfaceLuid;
+        extension->Win32KPresentCount = PresentCount;
+        extension->Win32KBindId = BindId;
         break;
     }
 
     case Microsoft_Windows_Win32k::TokenStateChanged_Info::Id:
     {
-        EventDataDesc desc[] = {
-            { L"CompositionSurfaceLuid" },
-            { L"PresentCount" },
-            { L"BindId" },
-            { L"NewState" },
-        };
-        mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-        auto CompositionSurfaceLuid = desc[0].GetData<uint64_t>();
-        auto PresentCount           = desc[1].GetData<uint32_t>();
-        auto BindId                 = desc[2].GetData<uint64_t>();
-        auto NewState               = desc[3].GetData<uint32_t>();
+        auto view = mMetadata.GetEventView<Microsoft_Windows_Win32k::TokenStateChanged_Info_View>(pEventRecord);
+        auto CompositionSurfaceLuid = view.CompositionSurfaceLuid();
+        auto PresentCount           = view.PresentCount();
+        auto BindId                 = view.BindId();
+        auto NewState               = (uint32_t) view.NewState();
 
         PMTraceConsumer::Win32KPresentHistoryTokenKey key(CompositionSurfaceLuid, PresentCount, BindId);
         auto eventIter = mWin32KPresentHistoryTokens.find(key);
@@ -1173,7 +1123,7 @@ void PMTraceConsumer::HandleWin32kEvent(EVENT_RECORD* pEventRecord)
             DebugModifyPresent(*presentEvent);
             presentEvent->SeenInFrameEvent = true;
 
-            bool iFlip = mMetadata.GetEventData<BOOL>(pEventRecord, L"IndependentFlip") != 0;
+            bool iFlip = view.IndependentFlip() != 0;
             if (iFlip && presentEvent->PresentMode == PresentMode::Composed_Flip) {
                 presentEvent->PresentMode = PresentMode::Hardware_Independent_Flip;
             }
@@ -1231,7 +1181,16 @@ void PMTraceConsumer::HandleDWMEvent(EVENT_RECORD* pEventRecord)
     auto const& hdr = pEventRecord->EventHeader;
     switch (hdr.EventDescriptor.Id) {
     case Microsoft_Windows_Dwm_Core::MILEVENT_MEDIA_UCE_PROCESSPRESENTHISTORY_GetPresentHistory_Info::Id:
+        // Process the windows in hwnd order, as mLastWindowPresent is
+        // unordered.
         for (auto& hWndPair : mLastWindowPresent) {
+            mLastWindowPresentSorted.emplace_back(std::move(hWndPair));
+        }
+        mLastWindowPresent.clear();
+        std::sort(mLastWindowPresentSorted.begin(), mLastWindowPresentSorted.end(),
+                  [](std::pair<uint64_t, PoolPtr<PresentEvent>> const& a, std::pair<uint64_t, PoolPtr<PresentEvent>> const& b) { return a.first < b.first; });
+
+        for (auto& hWndPair : mLastWindowPresentSorted) {
             auto& present = hWndPair.second;
             // Pickup the most recent present from a given window
             if (present->PresentMode != PresentMode::Composed_Copy_GPU_GDI &&
@@ -1241,10 +1200,9 @@ void PMTraceConsumer::HandleDWMEvent(EVENT_RECORD* pEventRecord)
             TRACK_PRESENT_PATH(present);
             DebugModifyPresent(*present);
             present->DwmNotified = true;
-            mPresentsWaitingForDWM.emplace_back(present);
-            present->PresentInDwmWaitingStruct = true;
+            AddPresentWaitingForDWM(present);
         }
-        mLastWindowPresent.clear();
+        mLastWindowPresentSorted.clear();
         break;
 
     case Microsoft_Windows_Dwm_Core::SCHEDULE_PRESENT_Start::Id:
@@ -1260,15 +1218,10 @@ void PMTraceConsumer::HandleDWMEvent(EVENT_RECORD* pEventRecord)
             return;
         }
 
-        EventDataDesc desc[] = {
-            { L"ulFlipChain" },
-            { L"ulSerialNumber" },
-            { L"hwnd" },
-        };
-        mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-        auto ulFlipChain    = desc[0].GetData<uint32_t>();
-        auto ulSerialNumber = desc[1].GetData<uint32_t>();
-        auto hwnd           = desc[2].GetData<uint64_t>();
+        auto view = mMetadata.GetEventView<Microsoft_Windows_Dwm_Core::FlipChain_Pending_View>(pEventRecord);
+        auto ulFlipChain    = view.ulFlipChain();
+        auto ulSerialNumber = view.ulSerialNumber();
+        auto hwnd           = view.hwnd();
 
         // The 64-bit token data from the PHT submission is actually two 32-bit
         // data chunks, corresponding to a "flip chain" id and present id
@@ -1289,15 +1242,10 @@ void PMTraceConsumer::HandleDWMEvent(EVENT_RECORD* pEventRecord)
     }
     case Microsoft_Windows_Dwm_Core::SCHEDULE_SURFACEUPDATE_Info::Id:
     {
-        EventDataDesc desc[] = {
-            { L"luidSurface" },
-            { L"PresentCount" },
-            { L"bindId" },
-        };
-        mMetadata.GetEventData(pEventRecord, desc, _countof(desc));
-        auto luidSurface  = desc[0].GetData<uint64_t>();
-        auto PresentCount = desc[1].GetData<uint64_t>();
-        auto bindId       = desc[2].GetData<uint64_t>();
+        auto view = mMetadata.GetEventView<Microsoft_Windows_Dwm_Core::SCHEDULE_SURFACEUPDATE_Info_View>(pEventRecord);
+        auto luidSurface  = view.luidSurface();
+        auto PresentCount = view.PresentCount();
+        auto bindId       = view.bindId();
 
         PMTraceConsumer::Win32KPresentHistoryTokenKey key(luidSurface, PresentCount, bindId);
         auto eventIter = mWin32KPresentHistoryTokens.find(key);
@@ -1305,8 +1253,7 @@ void PMTraceConsumer::HandleDWMEvent(EVENT_RECORD* pEventRecord)
             TRACK_PRESENT_PATH(eventIter->second);
             DebugModifyPresent(*eventIter->second);
             eventIter->second->DwmNotified = true;
-            mPresentsWaitingForDWM.emplace_back(eventIter->second);
-            eventIter->second->PresentInDwmWaitingStruct = true;
+            AddPresentWaitingForDWM(eventIter->second);
         }
         break;
     }
@@ -1318,16 +1265,39 @@ void PMTraceConsumer::HandleDWMEvent(EVENT_RECORD* pEventRecord)
 }
 
 // Remove the present from all temporary tracking structures.
-void PMTraceConsumer::RemovePresentFromTemporaryTrackingCollections(std::shared_ptr<PresentEvent> p, bool waitForPresentStop)
+void PMTraceConsumer::RemovePresentFromTemporaryTrackingCollections(PoolPtr<PresentEvent> p, bool waitForPresentStop)
 {
     // mPresentsByProcess
-    mPresentsByProcess[p->ProcessId].erase(p->QpcTime);
+    auto presentsByThisProcess = &mPresentsByProcess[p->ProcessId];
+    presentsByThisProcess->erase(p->QpcTime);
 
-    // mAllPresents
-    if (p->mAllPresentsTrackingIndex != UINT32_MAX) {
-        mAllPresents[p->mAllPresentsTrackingIndex] = nullptr;
+    // mPresentsBySwapChain
+    //
+    // If this was the swap chain's last in-progress present, its ID is
+    // released for reuse.
+    auto presentsByThisSwapChain = &mPresentsBySwapChain[p->SwapChainId];
+    auto eventIter = presentsByThisSwapChain->find(p->QpcTime);
+    if (eventIter != presentsByThisSwapChain->end() && eventIter->second == p) {
+        presentsByThisSwapChain->erase(eventIter);
+        if (presentsByThisSwapChain->empty()) {
+            mSwapChainIds.erase(mSwapChainKeys[p->SwapChainId]);
+            mFreeSwapChainIds.push_back(p->SwapChainId);
+        }
     }
 
+    // mUnclassifiedPresentsByProcess
+    // Presents are popped lazily, but if the process has no more in-progress
+    // presents then none of them are unclassified.
+    if (presentsByThisProcess->empty()) {
+        auto unclassifiedIter = mUnclassifiedPresentsByProcess.find(p->ProcessId);
+        if (unclassifiedIter != mUnclassifiedPresentsByProcess.end()) {
+            unclassifiedIter->second.clear();
+        }
+    }
+
+    // mLostPresents
+    mLostPresents.Remove(p);
+
     // mPresentByThreadId
     //
     // There are cases where a present can be displayed/dropped before
@@ -1358,12 +1328,15 @@ void PMTraceConsumer::RemovePresentFromTemporaryTrackingCollections(std::shared_
         }
     }
 
+    // The remaining keys are stored in the present's extension, if it has one.
+    auto extension = p->Extension.get();
+
     // mWin32KPresentHistoryTokens
-    if (p->CompositionSurfaceLuid != 0) {
+    if (extension != nullptr && extension->CompositionSurfaceLuid != 0) {
         PMTraceConsumer::Win32KPresentHistoryTokenKey key(
-            p->CompositionSurfaceLuid,
-            p->Win32KPresentCount,
-            p->Win32KBindId
+            extension->CompositionSurfaceLuid,
+            extension->Win32KPresentCount,
+            extension->Win32KBindId
         );
 
         auto eventIter = mWin32KPresentHistoryTokens.find(key);
@@ -1381,8 +1354,8 @@ void PMTraceConsumer::RemovePresentFromTemporaryTrackingCollections(std::shared_
     }
 
     // mBltsByDxgContext
-    if (p->DxgKrnlHContext != 0) {
-        auto eventIter = mBltsByDxgContext.find(p->DxgKrnlHContext);
+    if (extension != nullptr && extension->DxgKrnlHContext != 0) {
+        auto eventIter = mBltsByDxgContext.find(extension->DxgKrnlHContext);
         if (eventIter != mBltsByDxgContext.end() && eventIter->second == p) {
             mBltsByDxgContext.erase(eventIter);
         }
@@ -1399,28 +1372,84 @@ void PMTraceConsumer::RemovePresentFromTemporaryTrackingCollections(std::shared_
 
     // mPresentsWaitingForDWM
     if (p->PresentInDwmWaitingStruct) {
-        for (auto presentIter = mPresentsWaitingForDWM.begin(); presentIter != mPresentsWaitingForDWM.end(); presentIter++) {
-            // This loop should in theory be short because the present is old.
-            // If we are in this loop for dozens of times, something is likely wrong.
-            if (p == *presentIter) {
-                mPresentsWaitingForDWM.erase(presentIter);
-                p->PresentInDwmWaitingStruct = false;
-                break;
-            }
-        }
+        RemovePresentWaitingForDWM(p);
     }
 
     // mPresentsByLegacyBlitToken
     // LegacyTokenData cannot be 0 if it's in mPresentsByLegacyBlitToken list.
-    if (p->LegacyBlitTokenData != 0) {
-        auto eventIter = mPresentsByLegacyBlitToken.find(p->LegacyBlitTokenData);
+    if (extension != nullptr && extension->LegacyBlitTokenData != 0) {
+        auto eventIter = mPresentsByLegacyBlitToken.find(extension->LegacyBlitTokenData);
         if (eventIter != mPresentsByLegacyBlitToken.end() && eventIter->second == p) {
             mPresentsByLegacyBlitToken.erase(eventIter);
         }
     }
 }
 
-void PMTraceConsumer::IgnorePresent(std::shared_ptr<PresentEvent> p)
+void PMTraceConsumer::AddPresentWaitingForDWM(PoolPtr<PresentEvent> const& p)
+{
+    // A present is only completed once by DWM, so keep it at its original
+    // position if it is already waiting.
+    if (p->PresentInDwmWaitingStruct) {
+        return;
+    }
+
+    GetExtension(p)->PresentsWaitingForDWMIndex = mPresentsWaitingForDWMFirstIndex + mPresentsWaitingForDWM.size();
+    p->PresentInDwmWaitingStruct = true;
+    mPresentsWaitingForDWM.emplace_back(p);
+    mPresentsWaitingForDWMCount += 1;
+}
+
+void PMTraceConsumer::RemovePresentWaitingForDWM(PoolPtr<PresentEvent> const& p)
+{
+    auto position = p->Extension->PresentsWaitingForDWMIndex - mPresentsWaitingForDWMFirstIndex;
+    assert(position < mPresentsWaitingForDWM.size() && mPresentsWaitingForDWM[(size_t) position] == p);
+    mPresentsWaitingForDWM[(size_t) position] = nullptr;
+    mPresentsWaitingForDWMCount -= 1;
+    p->PresentInDwmWaitingStruct = false;
+
+    // Pop the cleared entries at the front.  The removed present is usually
+    // the oldest, so this is typically all of them.
+    while (!mPresentsWaitingForDWM.empty() && mPresentsWaitingForDWM.front() == nullptr) {
+        mPresentsWaitingForDWM.pop_front();
+        mPresentsWaitingForDWMFirstIndex += 1;
+    }
+
+    // If DWM isn't presenting and cleared entries accumulate, compact the
+    // queue and renumber the remaining presents.  This is O(1) amortized over
+    // the removals since the last compaction.
+    enum { MIN_COMPACT_SIZE = 64 };
+    auto size = mPresentsWaitingForDWM.size();
+    if (size >= MIN_COMPACT_SIZE && mPresentsWaitingForDWMCount < size / 2) {
+        mPresentsWaitingForDWMFirstIndex += size;
+        std::deque<PoolPtr<PresentEvent>> presents;
+        presents.swap(mPresentsWaitingForDWM);
+        mPresentsWaitingForDWMCount = 0;
+        for (auto& p2 : presents) {
+            if (p2 != nullptr) {
+                p2->PresentInDwmWaitingStruct = false;
+                AddPresentWaitingForDWM(p2);
+            }
+        }
+    }
+}
+
+// Move the presents waiting for DWM, in order, into dependentPresents (the
+// DependentPresents of DWM's present).
+void PMTraceConsumer::MovePresentsWaitingForDWM(std::vector<PoolPtr<PresentEvent>>* dependentPresents)
+{
+    for (auto& p : mPresentsWaitingForDWM) {
+        if (p != nullptr) {
+            p->PresentInDwmWaitingStruct = false;
+            dependentPresents->emplace_back(std::move(p));
+        }
+    }
+
+    mPresentsWaitingForDWMFirstIndex += mPresentsWaitingForDWM.size();
+    mPresentsWaitingForDWMCount = 0;
+    mPresentsWaitingForDWM.clear();
+}
+
+void PMTraceConsumer::IgnorePresent(PoolPtr<PresentEvent> p)
 {
     // This present should be ignored and not processed at all, and should not be added to any data structures or metrics.
 
@@ -1429,14 +1458,14 @@ void PMTraceConsumer::IgnorePresent(std::shared_ptr<PresentEvent> p)
 
     // Only DWM Hardware Legacy Flips should have Dependent Presents, and we should never be ignoring those.
     // If we are, then something is very wrong. 
-    assert(p->DependentPresents.size() == 0);
+    assert(p->Extension == nullptr || p->Extension->DependentPresents.size() == 0);
 
     // Remove the present from any tracking structures.
     auto waitForPresentStop = false;
     RemovePresentFromTemporaryTrackingCollections(p, waitForPresentStop);
 }
 
-void PMTraceConsumer::RemoveLostPresent(std::shared_ptr<PresentEvent> p)
+void PMTraceConsumer::RemoveLostPresent(PoolPtr<PresentEvent> p)
 {
     // If this is a DWM present, any other presents that contributed to it are
     // also lost.
@@ -1444,12 +1473,14 @@ void PMTraceConsumer::RemoveLostPresent(std::shared_ptr<PresentEvent> p)
     // PresentEvents that become lost are not removed from DependentPresents
     // tracking, so we need to protect against lost events (but they have
     // already been added to mLostPresentEvents etc.).
-    for (auto& p2 : p->DependentPresents) {
-        if (!p2->IsLost) {
-            RemoveLostPresent(p2);
+    if (p->Extension != nullptr) {
+        for (auto& p2 : p->Extension->DependentPresents) {
+            if (!p2->IsLost) {
+                RemoveLostPresent(p2);
+            }
         }
+        p->Extension->DependentPresents.clear();
     }
-    p->DependentPresents.clear();
 
     // Remove the present from any tracking structures.
     auto waitForPresentStop = false;
@@ -1458,10 +1489,8 @@ void PMTraceConsumer::RemoveLostPresent(std::shared_ptr<PresentEvent> p)
     // Move the present into the consumer lost queue.
     DebugLostPresent(*p);
     p->IsLost = true;
-    {
-        std::lock_guard<std::mutex> lock(mLostPresentEventMutex);
-        mLostPresentEvents.push_back(p);
-    }
+    auto handoff = mPresentEventPool.Handoff(p);
+    PushAndNotify(&mLostPresentEvents, &mLostPresentOverflow, handoff, mHandoffSignal);
 }
 
 namespace {
@@ -1481,7 +1510,7 @@ uint32_t GetDeferredCompletionWaitCount(PresentEvent const& p)
 
 }
 
-void PMTraceConsumer::CompletePresentHelper(std::shared_ptr<PresentEvent> const& p, OrderedPresents* completed)
+void PMTraceConsumer::CompletePresentHelper(PoolPtr<PresentEvent> const& p, OrderedPresents* completed)
 {
     // We use the first completed present to indicate that all necessary
     // providers are running and able to successfully track/complete presents.
@@ -1530,15 +1559,21 @@ void PMTraceConsumer::CompletePresentHelper(std::shared_ptr<PresentEvent> const&
     // |           | p2  |
     // | p3        |     |
     // |           | p4  |
-    if (p->FinalState == PresentResult::Presented) {
-        auto presentsByThisProcess = &mPresentsByProcess[p->ProcessId];
-        for (auto ii = presentsByThisProcess->begin(), ie = presentsByThisProcess->end(); ii != ie; ) {
-            auto p2 = ii->second;
-            ++ii; // increment iterator first as CompletePresentHelper() will remove it
-            if (p2->SwapChainAddress == p->SwapChainAddress) {
-                if (p2->QpcTime >= p->QpcTime) break;
-                CompletePresentHelper(p2, completed);
-            }
+    //
+    // CompletePresentHelper() removes the oldest present from the swap
+    // chain's presents, so look at the oldest again each time.
+    //
+    // The present's swap chain ID may have been reused already if the present
+    // was removed earlier (e.g., it was lost), in which case the presents with
+    // that ID are on a different swap chain.
+    if (p->FinalState == PresentResult::Presented &&
+        mSwapChainKeys[p->SwapChainId] == PMTraceConsumer::SwapChainKey(p->ProcessId, p->SwapChainAddress)) {
+        for (;;) {
+            auto presentsByThisSwapChain = &mPresentsBySwapChain[p->SwapChainId];
+            if (presentsByThisSwapChain->empty()) break;
+            auto p2 = presentsByThisSwapChain->begin()->second;
+            if (p2->QpcTime >= p->QpcTime) break;
+            CompletePresentHelper(p2, completed);
         }
     }
 
@@ -1550,24 +1585,27 @@ void PMTraceConsumer::CompletePresentHelper(std::shared_ptr<PresentEvent> const&
     // PresentEvents that become lost are not removed from DependentPresents
     // tracking, so we need to protect against lost events (but they have
     // already been added to mLostPresentEvents etc.).
-    std::unordered_set<uint64_t> completedComposedFlipHwnds;
-    for (auto ii = p->DependentPresents.rbegin(), ie = p->DependentPresents.rend(); ii != ie; ++ii) {
-        auto p2 = *ii;
-        if (!p2->IsLost && p2->PresentMode == PresentMode::Composed_Flip && !completedComposedFlipHwnds.emplace(p2->Hwnd).second) {
-            DebugModifyPresent(*p2);
-            p2->FinalState = PresentResult::Discarded;
+    if (p->Extension != nullptr && !p->Extension->DependentPresents.empty()) {
+        auto dependentPresents = &p->Extension->DependentPresents;
+        std::unordered_set<uint64_t> completedComposedFlipHwnds;
+        for (auto ii = dependentPresents->rbegin(), ie = dependentPresents->rend(); ii != ie; ++ii) {
+            auto p2 = *ii;
+            if (!p2->IsLost && p2->PresentMode == PresentMode::Composed_Flip && !completedComposedFlipHwnds.emplace(p2->Hwnd).second) {
+                DebugModifyPresent(*p2);
+                p2->FinalState = PresentResult::Discarded;
+            }
         }
-    }
-    completedComposedFlipHwnds.clear();
-    for (auto p2 : p->DependentPresents) {
-        if (!p2->IsLost && p2->FinalState != PresentResult::Discarded) {
-            DebugModifyPresent(*p2);
-            p2->FinalState = p->FinalState;
-            p2->ScreenTime = p->ScreenTime;
+        completedComposedFlipHwnds.clear();
+        for (auto p2 : *dependentPresents) {
+            if (!p2->IsLost && p2->FinalState != PresentResult::Discarded) {
+                DebugModifyPresent(*p2);
+                p2->FinalState = p->FinalState;
+                p2->ScreenTime = p->ScreenTime;
+            }
+            CompletePresentHelper(p2, completed);
         }
-        CompletePresentHelper(p2, completed);
+        dependentPresents->clear();
     }
-    p->DependentPresents.clear();
 
     // The PresentEvent is now removed from all tracking structures and we can
     // move it into the consumer thread queue. If it is still missing some
@@ -1578,7 +1616,7 @@ void PMTraceConsumer::CompletePresentHelper(std::shared_ptr<PresentEvent> const&
     if (deferredWaitCount > 0) {
         DebugModifyPresent(*p);
         p->CompletionIsDeferred = true;
-        mDeferredCompletions[p->ProcessId].emplace_back(p, deferredWaitCount);
+        mDeferredCompletions[p->ProcessId].Push(p, deferredWaitCount);
     } else {
         DebugModifyPresent(*p);
         p->IsCompleted = true;
@@ -1586,7 +1624,7 @@ void PMTraceConsumer::CompletePresentHelper(std::shared_ptr<PresentEvent> const&
     }
 }
 
-void PMTraceConsumer::CompletePresent(std::shared_ptr<PresentEvent> const& p)
+void PMTraceConsumer::CompletePresent(PoolPtr<PresentEvent> const& p)
 {
     // CompletePresentHelper() will complete the present and any of its
     // dependencies.  We collect all completed presents into an OrderedPresents
@@ -1596,17 +1634,13 @@ void PMTraceConsumer::CompletePresent(std::shared_ptr<PresentEvent> const& p)
     CompletePresentHelper(p, &completed);
 
     // Move the completed presents into the consumer thread queue.
-    auto numCompleted = completed.size();
-    if (numCompleted > 0) {
-        std::lock_guard<std::mutex> lock(mPresentEventMutex);
-        mCompletePresentEvents.reserve(mCompletePresentEvents.size() + numCompleted);
-        for (auto const& tuple : completed) {
-            mCompletePresentEvents.push_back(tuple.second);
-        }
+    for (auto const& tuple : completed) {
+        auto handoff = mPresentEventPool.Handoff(tuple.second);
+        PushAndNotify(&mCompletePresentEvents, &mCompletePresentOverflow, handoff, mHandoffSignal);
     }
 }
 
-void PMTraceConsumer::CompleteDeferredCompletion(std::shared_ptr<PresentEvent> const& present)
+void PMTraceConsumer::CompleteDeferredCompletion(PoolPtr<PresentEvent> const& present)
 {
     assert(present->CompletionIsDeferred == true);
     assert(present->IsCompleted == false);
@@ -1619,13 +1653,11 @@ void PMTraceConsumer::CompleteDeferredCompletion(std::shared_ptr<PresentEvent> c
     DebugModifyPresent(*present);
     present->IsCompleted = true;
 
-    {
-        std::lock_guard<std::mutex> lock(mPresentEventMutex);
-        mCompletePresentEvents.emplace_back(present);
-    }
+    auto handoff = mPresentEventPool.Handoff(present);
+    PushAndNotify(&mCompletePresentEvents, &mCompletePresentOverflow, handoff, mHandoffSignal);
 }
 
-std::shared_ptr<PresentEvent> PMTraceConsumer::FindBySubmitSequence(uint32_t submitSequence)
+PoolPtr<PresentEvent> PMTraceConsumer::FindBySubmitSequence(uint32_t submitSequence)
 {
     auto eventIter = mPresentsBySubmitSequence.find(submitSequence);
     if (eventIter == mPresentsBySubmitSequence.end()) {
@@ -1635,7 +1667,7 @@ std::shared_ptr<PresentEvent> PMTraceConsumer::FindBySubmitSequence(uint32_t sub
     return eventIter->second;
 }
 
-std::shared_ptr<PresentEvent> PMTraceConsumer::FindOrCreatePresent(EVENT_HEADER const& hdr)
+PoolPtr<PresentEvent> PMTraceConsumer::FindOrCreatePresent(EVENT_HEADER const& hdr)
 {
     // Check if there is an in-progress present that this thread is already
     // working on and, if so, continue working on that.
@@ -1655,10 +1687,12 @@ std::shared_ptr<PresentEvent> PMTraceConsumer::FindOrCreatePresent(EVENT_HEADER
     // presents created on a different thread, which are batched and then
     // handled later during a DXGK/Win32K event.  If found, we add it to
     // mPresentByThreadId to indicate what present this thread is working on.
-    auto presentsByThisProcess = &mPresentsByProcess[hdr.ProcessId];
-    for (auto const& tuple : *presentsByThisProcess) {
-        auto presentEvent = tuple.second;
-        if (presentEvent->PresentMode == PresentMode::Unknown) {
+    auto unclassifiedIter = mUnclassifiedPresentsByProcess.find(hdr.ProcessId);
+    if (unclassifiedIter != mUnclassifiedPresentsByProcess.end()) {
+        auto unclassifiedPresents = &unclassifiedIter->second;
+        PopClassifiedPresents(unclassifiedPresents);
+        if (!unclassifiedPresents->empty()) {
+            auto presentEvent = unclassifiedPresents->front();
             assert(presentEvent->DriverBatchThreadId == 0);
             DebugModifyPresent(*presentEvent);
             presentEvent->DriverBatchThreadId = hdr.ThreadId;
@@ -1673,31 +1707,77 @@ std::shared_ptr<PresentEvent> PMTraceConsumer::FindOrCreatePresent(EVENT_HEADER
     // D3D9) in which case a DXGKRNL event will be the first present-related
     // event we ever see.  So, we create the PresentEvent and start tracking it
     // from here.
-    auto presentEvent = std::make_shared<PresentEvent>(hdr, Runtime::Other);
-    TrackPresent(presentEvent, presentsByThisProcess);
+    auto presentEvent = mPresentEventPool.Allocate(hdr, Runtime::Other);
+    TrackPresent(presentEvent, &mPresentsByProcess[hdr.ProcessId]);
     return presentEvent;
 }
 
+PresentEventExtension* PMTraceConsumer::GetExtension(PoolPtr<PresentEvent> const& p)
+{
+    if (p->Extension == nullptr) {
+        p->Extension = mPresentEventExtensionPool.Allocate();
+    }
+    return p->Extension.get();
+}
+
+// Pop the presents at the front of a process' mUnclassifiedPresentsByProcess
+// queue that have been classified or are no longer being tracked, so that
+// the front (if any) is the process' oldest unclassified present.  Each
+// present is only popped once, so this is O(1) amortized.
+void PMTraceConsumer::PopClassifiedPresents(std::deque<PoolPtr<PresentEvent>>* unclassifiedPresents)
+{
+    while (!unclassifiedPresents->empty()) {
+        auto const& p = unclassifiedPresents->front();
+
+        // RemovePresentFromTemporaryTrackingCollections() removes the present
+        // from mLostPresents.
+        if (p->PresentMode == PresentMode::Unknown && mLostPresents.Contains(p)) {
+            break;
+        }
+        unclassifiedPresents->pop_front();
+    }
+}
+
 void PMTraceConsumer::TrackPresent(
-    std::shared_ptr<PresentEvent> present,
+    PoolPtr<PresentEvent> present,
     OrderedPresents* presentsByThisProcess)
 {
-    // If there is an existing present that hasn't completed by the time the
-    // circular buffer has come around, consider it lost.
-    if (mAllPresents[mAllPresentsNextIndex] != nullptr) {
-        RemoveLostPresent(mAllPresents[mAllPresentsNextIndex]);
-    }
+    // Any existing presents that haven't completed within mLostPresentAge of
+    // this one are considered lost.
+    auto removeLostPresent = [this](PoolPtr<PresentEvent> const& p) { RemoveLostPresent(p); };
+    mLostPresents.Advance(present->QpcTime, removeLostPresent);
 
     DebugCreatePresent(*present);
-    present->mAllPresentsTrackingIndex = mAllPresentsNextIndex;
-    mAllPresents[mAllPresentsNextIndex] = present;
-    mAllPresentsNextIndex = (mAllPresentsNextIndex + 1) % PRESENTEVENT_CIRCULAR_BUFFER_SIZE;
+    mLostPresents.Insert(present, present->QpcTime, removeLostPresent);
+
+    // Assign the swap chain an ID if it doesn't have one, reusing a released
+    // ID if there is one.
+    PMTraceConsumer::SwapChainKey swapChainKey(present->ProcessId, present->SwapChainAddress);
+    auto nextSwapChainId = mFreeSwapChainIds.empty() ? (uint32_t) mPresentsBySwapChain.size() : mFreeSwapChainIds.back();
+    auto swapChainIdIter = mSwapChainIds.emplace(swapChainKey, nextSwapChainId);
+    present->SwapChainId = swapChainIdIter.first->second;
+    if (swapChainIdIter.second) {
+        if (present->SwapChainId == mPresentsBySwapChain.size()) {
+            mPresentsBySwapChain.emplace_back();
+            mSwapChainKeys.emplace_back(swapChainKey);
+        } else {
+            mFreeSwapChainIds.pop_back();
+            mSwapChainKeys[present->SwapChainId] = swapChainKey;
+        }
+    }
 
     presentsByThisProcess->emplace(present->QpcTime, present);
+    mPresentsBySwapChain[present->SwapChainId].emplace(present->QpcTime, present);
     mPresentByThreadId.emplace(present->ThreadId, present);
+
+    if (present->PresentMode == PresentMode::Unknown) {
+        auto unclassifiedPresents = &mUnclassifiedPresentsByProcess[present->ProcessId];
+        PopClassifiedPresents(unclassifiedPresents);
+        unclassifiedPresents->emplace_back(present);
+    }
 }
 
-void PMTraceConsumer::TrackPresentOnThread(std::shared_ptr<PresentEvent> present)
+void PMTraceConsumer::TrackPresentOnThread(PoolPtr<PresentEvent> present)
 {
     // If there is an in-flight present on this thread already, then something
     // has gone wrong with it's tracking so consider it lost.
@@ -1739,22 +1819,14 @@ void PMTraceConsumer::RuntimePresentStop(EVENT_HEADER const& hdr, bool AllowPres
     // expired.  All tracking has already been removed, so we only need to add
     // these to the completed list.
     //
-    // Even if deferredCompletions->mPresents becomes empty, we leave the
+    // Even if the process' deferred completions become empty, we leave the
     // mDeferredCompletions entry because we're likely to keep using it for
     // this process.
     auto deferredIter = mDeferredCompletions.find(hdr.ProcessId);
     if (deferredIter != mDeferredCompletions.end()) {
-        auto deferredCompletions = &deferredIter->second;
-        for (auto ii = deferredCompletions->begin(); ii != deferredCompletions->end(); ) {
-            auto waitCount = &ii->second;
-            if (*waitCount == 1) {
-                CompleteDeferredCompletion(ii->first);
-                ii = deferredCompletions->erase(ii);
-            } else {
-                --*waitCount;
-                ++ii;
-            }
-        }
+        deferredIter->second.AdvanceEpoch([this](PoolPtr<PresentEvent> const& present) {
+            CompleteDeferredCompletion(present);
+        });
     }
 }
 
@@ -1773,12 +1845,11 @@ void PMTraceConsumer::HandleNTProcessEvent(EVENT_RECORD* pEventRecord)
         ProcessEvent event;
         event.QpcTime       = pEventRecord->EventHeader.TimeStamp.QuadPart;
         event.ProcessId     = desc[0].GetData<uint32_t>();
-        event.ImageFileName = desc[1].GetData<std::string>();
+        event.ImageFileName = &*mImageFileNames.insert(desc[1].GetData<std::string>()).first;
         event.IsStartEvent  = pEventRecord->EventHeader.EventDescriptor.Opcode == EVENT_TRACE_TYPE_START ||
                               pEventRecord->EventHeader.EventDescriptor.Opcode == EVENT_TRACE_TYPE_DC_START;
 
-        std::lock_guard<std::mutex> lock(mProcessEventMutex);
-        mProcessEvents.emplace_back(event);
+        PushAndNotify(&mProcessEvents, &mProcessEventOverflow, event, mHandoffSignal);
         return;
     }
 }
@@ -1790,21 +1861,14 @@ void PMTraceConsumer::HandleMetadataEvent(EVENT_RECORD* pEventRecord)
 
 void PMTraceConsumer::AddTrackedProcessForFiltering(uint32_t processID)
 {
-    std::unique_lock<std::shared_mutex> lock(mTrackedProcessFilterMutex);
-    mTrackedProcessFilter.insert(processID);
+    mTrackedProcessFilter.Insert(processID);
 }
 
 void PMTraceConsumer::RemoveTrackedProcessForFiltering(uint32_t processID)
 {
-    std::unique_lock<std::shared_mutex> lock(mTrackedProcessFilterMutex);
-    auto iterator = mTrackedProcessFilter.find(processID);
-    
-    if (iterator != mTrackedProcessFilter.end()) {
-        mTrackedProcessFilter.erase(processID);
-    }
-    else {
-        assert(false);
-    }
+    auto erased = mTrackedProcessFilter.Erase(processID);
+    assert(erased);
+    (void) erased;
 
     // Completion events will remove any currently tracked events for this process
     // from data structures, so we don't need to proactively remove them now.
@@ -1816,9 +1880,7 @@ bool PMTraceConsumer::IsProcessTrackedForFiltering(uint32_t processID)
         return true;
     }
 
-    std::shared_lock<std::shared_mutex> lock(mTrackedProcessFilterMutex);
-    auto iterator = mTrackedProcessFilter.find(processID);
-    return (iterator != mTrackedProcessFilter.end());
+    return mTrackedProcessFilter.Contains(processID);
 }
 
 #ifdef TRACK_PRESENT_PATHS
@@ -9,19 +9,25 @@
 #include <map>
 #include <memory>
 #include <mutex>
-#include <shared_mutex>
 #include <stdint.h>
 #include <string>
 #include <tuple>
+#include <unordered_set>
 #include <vector>
-#include <set>
 #include <windows.h>
 #include <evntcons.h> // must include after windows.h
 
 #include "Debug.hpp"
+#include "DeferredCompletionQueue.hpp"
+#include "FlatHashMap.hpp"
+#include "HandoffSignal.hpp"
+#include "SlabPool.hpp"
+#include "SnapshotSet.hpp"
+#include "SpscQueue.hpp"
+#include "TimerWheel.hpp"
 #include "TraceConsumer.hpp"
 
-enum class PresentMode
+enum class PresentMode : uint8_t
 {
     Unknown,
     Hardware_Legacy_Flip,
@@ -37,28 +43,61 @@ enum class PresentMode
     Hardware_Composed_Independent_Flip,
 };
 
-enum class PresentResult
+enum class PresentResult : uint8_t
 {
     Unknown, Presented, Discarded, Error
 };
 
-enum class Runtime
+enum class Runtime : uint8_t
 {
     DXGI, D3D9, Other
 };
 
 // A ProcessEvent occurs whenever a Process starts or stops.
+//
+// ImageFileName is interned by the PMTraceConsumer (see mImageFileNames), so
+// it can be kept without copying for as long as the consumer exists.
 struct ProcessEvent {
-    std::string ImageFileName;
+    std::string const* ImageFileName;
     uint64_t QpcTime;
     uint32_t ProcessId;
     bool IsStartEvent;
 };
 
-struct PresentEvent {
+struct PresentEvent;
+
+// PresentEventExtension stores the PresentEvent state that is only needed on
+// some presentation paths (e.g., the keys of tracking structures that only
+// some presents are added to, and the presents that a DWM present completes).
+// It is allocated from PMTraceConsumer::mPresentEventExtensionPool the first
+// time it is needed (see PMTraceConsumer::GetExtension()), and is only used
+// by the consumer thread.
+struct PresentEventExtension : PoolObject<PresentEventExtension> {
+    uint64_t DxgKrnlHContext = 0;           // Key for mBltsByDxgContext
+    uint64_t PresentsWaitingForDWMIndex = 0; // Sequence number in PMTraceConsumer's mPresentsWaitingForDWM, if PresentInDwmWaitingStruct
+    uint64_t CompositionSurfaceLuid = 0;    // Combine with Win32KPresentCount and Win32KBindId as key into mWin32KPresentHistoryTokens
+    uint64_t Win32KPresentCount = 0;        // Combine with CompositionSurfaceLuid and Win32KBindId as key into mWin32KPresentHistoryTokens
+    uint64_t Win32KBindId = 0;              // Combine with CompositionSurfaceLuid and Win32KPresentCount as key into mWin32KPresentHistoryTokens
+    uint64_t LegacyBlitTokenData = 0;       // Key for mPresentsByLegacyBlitToken
+
+    // Properties deduced by watching events through present pipeline
+    uint32_t DestWidth = 0;
+    uint32_t DestHeight = 0;
+
+    // The presents that contributed to this DWM present
+    std::vector<PoolPtr<PresentEvent>> DependentPresents;
+};
+
+// PresentEvents are allocated from PMTraceConsumer::mPresentEventPool and
+// referenced with PoolPtr<PresentEvent> on the consumer thread.  Completed and
+// lost presents are passed to other threads as PoolHandoffPtr<PresentEvent>
+// (see SlabPool.hpp).
+//
+// Members are grouped by size so that there is no padding between them, and
+// the flags are bit-fields.  State that most presents don't need is stored in
+// Extension.
+struct PresentEvent : PoolObject<PresentEvent> {
     uint64_t QpcTime;       // QPC value of the first event related to the Present (D3D9, DXGI, or DXGK Present_Start)
-    uint32_t ProcessId;     // ID of the process that presented
-    uint32_t ThreadId;      // ID of the thread that presented
     uint64_t TimeTaken;     // QPC duration between runtime present start and end
     uint64_t ReadyTime;     // QPC value when the last GPU commands completed prior to presentation
     uint64_t ScreenTime;    // QPC value when the present was displayed on screen
@@ -69,38 +108,35 @@ struct PresentEvent {
     uint32_t PresentFlags;
 
     // Keys used to index into PMTraceConsumer's tracking data structures:
-    uint64_t DxgKrnlHContext;           // Key for mBltsByDxgContext
-    uint64_t Win32KPresentCount;        // Combine with CompositionSurfaceLuid and Win32KBindId as key into mWin32KPresentHistoryTokens
-    uint64_t Win32KBindId;              // Combine with CompositionSurfaceLuid and Win32KPresentCount as key into mWin32KPresentHistoryTokens
-    uint64_t LegacyBlitTokenData;       // Key for mPresentsByLegacyBlitToken
     uint64_t Hwnd;
     uint64_t TokenPtr;
-    uint64_t CompositionSurfaceLuid;
-    uint32_t mAllPresentsTrackingIndex; // Index in PMTraceConsumer's mAllPresents.
+    TimerWheelHandle mLostPresentTimer; // Position in PMTraceConsumer's mLostPresents
     uint32_t QueueSubmitSequence;       // Submit sequence for the Present packet
+    uint32_t SwapChainId;               // Dense ID of the (ProcessId, SwapChainAddress) pair, see PMTraceConsumer::mSwapChainIds
+
+    // Additional tracking state, or nullptr if none has been needed yet
+    PoolPtr<PresentEventExtension> Extension;
+
+    uint32_t ProcessId;     // ID of the process that presented
+    uint32_t ThreadId;      // ID of the thread that presented
 
     // Properties deduced by watching events through present pipeline
-    uint32_t DestWidth;
-    uint32_t DestHeight;
     uint32_t DriverBatchThreadId;
-    Runtime Runtime;
-    PresentMode PresentMode;
+    ::Runtime Runtime;              // The types are qualified since the members hide them
+    ::PresentMode PresentMode;
     PresentResult FinalState;
-    bool SupportsTearing;
-    bool MMIO;
-    bool SeenDxgkPresent;
-    bool SeenWin32KEvents;
-    bool DwmNotified;
-    bool SeenInFrameEvent;      // This present has gotten a Win32k TokenStateChanged event into InFrame state
-    bool CompletionIsDeferred;  // A FinalState has been determined, but not all expected events have been observed yet
-    bool IsCompleted;           // All expected events have been observed
-    bool IsLost;                // This PresentEvent was found in an unexpected state or is too old
+    bool SupportsTearing : 1;
+    bool MMIO : 1;
+    bool SeenDxgkPresent : 1;
+    bool SeenWin32KEvents : 1;
+    bool DwmNotified : 1;
+    bool SeenInFrameEvent : 1;      // This present has gotten a Win32k TokenStateChanged event into InFrame state
+    bool CompletionIsDeferred : 1;  // A FinalState has been determined, but not all expected events have been observed yet
+    bool IsCompleted : 1;           // All expected events have been observed
+    bool IsLost : 1;                // This PresentEvent was found in an unexpected state or is too old
 
     // We need a signal to prevent us from looking fruitlessly through the WaitingForDwm list
-    bool PresentInDwmWaitingStruct;
-
-    // Additional transient tracking state
-    std::deque<std::shared_ptr<PresentEvent>> DependentPresents;
+    bool PresentInDwmWaitingStruct : 1;
 
     // Track the path the present took through the PresentMon analysis.
     #ifdef TRACK_PRESENT_PATHS
@@ -170,18 +206,30 @@ struct PMTraceConsumer
 {
     PMTraceConsumer();
 
+    // Sets the frequency of the events' timestamps, which is used to convert
+    // mLostPresentAge into timestamp ticks.  This must be called before any
+    // events are processed, and after mLostPresentAge is set.
+    void SetQpcFrequency(int64_t qpcFrequency);
+
     EventMetadata mMetadata;
 
+    // Storage for all PresentEvents and their extensions.  These must be
+    // declared before any member that references a PresentEvent so that they
+    // are destructed last, and PresentEvents reference their extensions.
+    SlabPool<PresentEventExtension> mPresentEventExtensionPool;
+    SlabPool<PresentEvent> mPresentEventPool;
+
     bool mFilteredEvents = false;       // Whether the trace session was configured to filter non-PresentMon events
     bool mFilteredProcessIds = false;   // Whether to filter presents to specific processes
     bool mTrackDisplay = true;          // Whether the analysis should track presents to display
+    double mLostPresentAge = 10.0;      // How long, in seconds, a present can be in progress before it is considered lost
 
     // Whether we've completed any presents yet.  This is used to indicate that
     // all the necessary providers have started and it's safe to start tracking
     // presents.
     bool mHasCompletedAPresent = false;
 
-    // Store completed and lost presents until the consumer thread removes them
+    // Store completed and lost presents until the output thread removes them
     // using Dequeue*PresentEvents().
     //
     // Completed presents are those that have seen all their expected events,
@@ -190,12 +238,29 @@ struct PMTraceConsumer
     // Lost presents are not yet completed, but have been waiting for
     // completion for a long time or were found in an unexpected state.  This
     // was most likely caused by a missed ETW event.
-
-    std::mutex mPresentEventMutex;
-    std::vector<std::shared_ptr<PresentEvent>> mCompletePresentEvents;
-
-    std::mutex mLostPresentEventMutex;
-    std::vector<std::shared_ptr<PresentEvent>> mLostPresentEvents;
+    //
+    // The dequeued PoolHandoffPtrs can be held, and released, by the dequeuing
+    // thread without any further synchronization with the consumer thread.
+    //
+    // These queues are single-producer (the consumer thread) and
+    // single-consumer (the dequeuing thread).  If mHandoffSignal is set, it is
+    // notified whenever an event is queued.  The consumer thread never waits
+    // for the dequeuing thread: if a queue fills up, events are held in its
+    // *Overflow deque until FlushHandoffOverflow() or a later push finds room
+    // for them (see PushAndNotify()).
+
+    enum {
+        COMPLETE_PRESENT_QUEUE_CAPACITY = 16384,
+        LOST_PRESENT_QUEUE_CAPACITY = 4096,
+        PROCESS_EVENT_QUEUE_CAPACITY = 1024,
+    };
+
+    HandoffSignal* mHandoffSignal = nullptr;
+
+    SpscQueue<PoolHandoffPtr<PresentEvent>> mCompletePresentEvents { COMPLETE_PRESENT_QUEUE_CAPACITY };
+    SpscQueue<PoolHandoffPtr<PresentEvent>> mLostPresentEvents { LOST_PRESENT_QUEUE_CAPACITY };
+    std::deque<PoolHandoffPtr<PresentEvent>> mCompletePresentOverflow;
+    std::deque<PoolHandoffPtr<PresentEvent>> mLostPresentOverflow;
 
     // If a present has been determined to be either discarded or displayed,
     // but it has not yet seen all of its expected events, it is removed from
@@ -203,15 +268,18 @@ struct PMTraceConsumer
     // with CompletionIsDeferred set.  These are not completed until a
     // case-dependent number of Presents() have occurred from the same process.
 
-    // (PresentEvent, NumPresentStopsToWaitFor)
-    using DeferredCompletions = std::vector<std::pair<std::shared_ptr<PresentEvent>, uint32_t>>;
-
-    // [Process ID] => DeferredCompletions
-    std::unordered_map<uint32_t, DeferredCompletions> mDeferredCompletions;
+    // [Process ID] => PresentEvents, expiring after a number of the process'
+    // Present_Stop events
+    std::unordered_map<uint32_t, DeferredCompletionQueue<PoolPtr<PresentEvent>>> mDeferredCompletions;
 
     // Process events
-    std::mutex mProcessEventMutex;
-    std::vector<ProcessEvent> mProcessEvents;
+    SpscQueue<ProcessEvent> mProcessEvents { PROCESS_EVENT_QUEUE_CAPACITY };
+    std::deque<ProcessEvent> mProcessEventOverflow;
+
+    // The interned ProcessEvent::ImageFileNames.  Names are never removed, and
+    // std::unordered_set doesn't move its elements, so the dequeuing thread
+    // can read them while more are added.
+    std::unordered_set<std::string> mImageFileNames;
 
 
     // These data structures store in-progress presents (i.e., ones that are
@@ -229,6 +297,11 @@ struct PMTraceConsumer
     // (DXGI/D3D/DXGK/Win32) including batched presents, and so that we know to
     // discard all older presents when a newer one is completed.
     //
+    // mPresentsBySwapChain stores the same presents, split by swap chain (see
+    // mSwapChainIds), so that when a present is displayed the older presents
+    // on the same swap chain can be visited without visiting all of the
+    // process' presents.
+    //
     // mPresentsBySubmitSequence is used to lookup the active present
     // associated with a present queue packet.
     //
@@ -238,27 +311,62 @@ struct PMTraceConsumer
     // mapping from this token to in-progress present to optimize lookups
     // during Win32K events.
 
-    // Circular buffer of all Presents, older presents will be considered lost if not completed by the next visit.
-    unsigned int mAllPresentsNextIndex = 0;
-    std::vector<std::shared_ptr<PresentEvent>> mAllPresents;
+    // mLostPresents stores all in-progress presents by their QpcTime.  When a
+    // new present is tracked, those that are older than mLostPresentAge are
+    // considered lost.
+    struct GetLostPresentTimer {
+        TimerWheelHandle& operator()(PoolPtr<PresentEvent> const& p) const { return p->mLostPresentTimer; }
+    };
+    TimerWheel<PoolPtr<PresentEvent>, GetLostPresentTimer> mLostPresents;
 
     // [thread id]
-    std::map<uint32_t, std::shared_ptr<PresentEvent>> mPresentByThreadId;
+    FlatHashMap<uint32_t, PoolPtr<PresentEvent>> mPresentByThreadId;
 
     // [process id][qpc time]
-    using OrderedPresents = std::map<uint64_t, std::shared_ptr<PresentEvent>>;
+    using OrderedPresents = std::map<uint64_t, PoolPtr<PresentEvent>>;
     std::map<uint32_t, OrderedPresents> mPresentsByProcess;
 
+    // [(process id, swap chain address)] => swap chain id
+    //
+    // Each (process id, swap chain address) pair is assigned a dense ID when
+    // one of its presents is tracked, and its presents' SwapChainId is set to
+    // it, so that the consumer and the users of completed presents can index
+    // flat arrays by SwapChainId instead of looking up the pair.  Once none
+    // of the swap chain's presents are in progress (e.g., because its process
+    // exited), its ID is released to mFreeSwapChainIds and may be assigned to
+    // another pair, so users of completed presents must check that what they
+    // stored for an ID is for the present's pair.
+    using SwapChainKey = std::tuple<uint32_t, uint64_t>;
+    FlatHashMap<SwapChainKey, uint32_t> mSwapChainIds;
+    std::vector<uint32_t> mFreeSwapChainIds;
+
+    // [swap chain id][qpc time], and the pair each ID is assigned to
+    std::vector<OrderedPresents> mPresentsBySwapChain;
+    std::vector<SwapChainKey> mSwapChainKeys;
+
+    // mUnclassifiedPresentsByProcess stores each process' in-progress presents
+    // that were created with an Unknown PresentMode, in the order they were
+    // created, so FindOrCreatePresent() can find the oldest one that is still
+    // unclassified without searching mPresentsByProcess.
+    //
+    // Presents are not removed when they are classified or stop being
+    // tracked, but are instead popped once they reach the front (see
+    // PopClassifiedPresents()).  The process' queue is cleared when it no
+    // longer has any in-progress presents.
+    //
+    // [process id]
+    std::unordered_map<uint32_t, std::deque<PoolPtr<PresentEvent>>> mUnclassifiedPresentsByProcess;
+
     // Maps from queue packet submit sequence
     // Used for Flip -> MMIOFlip -> VSyncDPC for FS, for PresentHistoryToken -> MMIOFlip -> VSyncDPC for iFlip,
     // and for Blit Submission -> Blit completion for FS Blit
 
     // [submit sequence]
-    std::map<uint32_t, std::shared_ptr<PresentEvent>> mPresentsBySubmitSequence;
+    std::map<uint32_t, PoolPtr<PresentEvent>> mPresentsBySubmitSequence;
 
     // [(composition surface pointer, present count, bind id)]
     using Win32KPresentHistoryTokenKey = std::tuple<uint64_t, uint64_t, uint64_t>;
-    std::map<Win32KPresentHistoryTokenKey, std::shared_ptr<PresentEvent>> mWin32KPresentHistoryTokens;
+    FlatHashMap<Win32KPresentHistoryTokenKey, PoolPtr<PresentEvent>> mWin32KPresentHistoryTokens;
 
 
     // DxgKrnl present history tokens are uniquely identified and used for all
@@ -275,11 +383,11 @@ struct PMTraceConsumer
     // The following events lookup presents based on this token:
     // Dwm_Event_FlipChain_Pending, Dwm_Event_FlipChain_Complete,
     // Dwm_Event_FlipChain_Dirty,
-    std::map<uint64_t, std::shared_ptr<PresentEvent>> mDxgKrnlPresentHistoryTokens;
+    FlatHashMap<uint64_t, PoolPtr<PresentEvent>> mDxgKrnlPresentHistoryTokens;
 
     // For blt presents on Win7, it's not possible to distinguish between DWM-off or fullscreen blts, and the DWM-on blt to redirection bitmaps.
     // The best we can do is make the distinction based on the next packet submitted to the context. If it's not a PHT, it's not going to DWM.
-    std::map<uint64_t, std::shared_ptr<PresentEvent>> mBltsByDxgContext;
+    FlatHashMap<uint64_t, PoolPtr<PresentEvent>> mBltsByDxgContext;
 
     // mLastWindowPresent is used as storage for presents handed off to DWM.
     //
@@ -299,10 +407,24 @@ struct PMTraceConsumer
     // For Win32K-tracked events, Win32K_Event_TokenStateChanged InFrame will
     // set mLastWindowPresent (and set any current present as discarded), and
     // Win32K_Event_TokenStateChanged Confirmed will clear mLastWindowPresent.
-    std::map<uint64_t, std::shared_ptr<PresentEvent>> mLastWindowPresent;
-
-    // Presents that will be completed by DWM's next present
-    std::deque<std::shared_ptr<PresentEvent>> mPresentsWaitingForDWM;
+    //
+    // mLastWindowPresent is unordered, but Dwm_Event_GetPresentHistory moves
+    // the presents in hwnd order (via mLastWindowPresentSorted) so that they
+    // are completed in the same order as when this was an ordered map.
+    FlatHashMap<uint64_t, PoolPtr<PresentEvent>> mLastWindowPresent;
+    std::vector<std::pair<uint64_t, PoolPtr<PresentEvent>>> mLastWindowPresentSorted;
+
+    // Presents that will be completed by DWM's next present, in the order
+    // they were added.
+    //
+    // Each present is given the next sequence number when added, so its
+    // position is (PresentsWaitingForDWMIndex - mPresentsWaitingForDWMFirstIndex)
+    // and it can be removed in O(1) by clearing its entry.  Cleared entries at
+    // the front are popped immediately, and the rest are skipped when DWM
+    // presents (or compacted if they come to outnumber the waiting presents).
+    std::deque<PoolPtr<PresentEvent>> mPresentsWaitingForDWM;
+    uint64_t mPresentsWaitingForDWMFirstIndex = 0;  // Sequence number of mPresentsWaitingForDWM.front()
+    size_t mPresentsWaitingForDWMCount = 0;         // Number of non-null entries in mPresentsWaitingForDWM
 
     // Store the DWM process id, and the last DWM thread id to have started
     // a present.  This is needed to determine if a flip event is coming from
@@ -311,33 +433,49 @@ struct PMTraceConsumer
     uint32_t DwmPresentThreadId = 0;
 
     // Yet another unique way of tracking present history tokens, this time from DxgKrnl -> DWM, only for legacy blit
-    std::map<uint64_t, std::shared_ptr<PresentEvent>> mPresentsByLegacyBlitToken;
+    FlatHashMap<uint64_t, PoolPtr<PresentEvent>> mPresentsByLegacyBlitToken;
 
-    // Limit tracking to specified processes
-    std::set<uint32_t> mTrackedProcessFilter;
-    std::shared_mutex mTrackedProcessFilterMutex;
+    // Limit tracking to specified processes.  The filter is checked by the
+    // consumer thread for most events, but modified by other threads as
+    // target processes start and stop, so it is read without a lock.
+    SnapshotSet<uint32_t> mTrackedProcessFilter;
 
     // Storage for passing present path tracking id to Handle...() functions.
     #ifdef TRACK_PRESENT_PATHS
     uint32_t mAnalysisPathID;
     #endif
 
+    // The Dequeue*() functions append all queued events to the output vector.
+    // They, and HasQueuedEvents(), must only be called by the one dequeuing
+    // thread.
     void DequeueProcessEvents(std::vector<ProcessEvent>& outProcessEvents)
     {
-        std::lock_guard<std::mutex> lock(mProcessEventMutex);
-        outProcessEvents.swap(mProcessEvents);
+        mProcessEvents.PopAll(&outProcessEvents);
+    }
+
+    void DequeuePresentEvents(std::vector<PoolHandoffPtr<PresentEvent>>& outPresentEvents)
+    {
+        mCompletePresentEvents.PopAll(&outPresentEvents);
+    }
+
+    void DequeueLostPresentEvents(std::vector<PoolHandoffPtr<PresentEvent>>& outPresentEvents)
+    {
+        mLostPresentEvents.PopAll(&outPresentEvents);
     }
 
-    void DequeuePresentEvents(std::vector<std::shared_ptr<PresentEvent>>& outPresentEvents)
+    bool HasQueuedEvents()
     {
-        std::lock_guard<std::mutex> lock(mPresentEventMutex);
-        outPresentEvents.swap(mCompletePresentEvents);
+        return !mProcessEvents.Empty() || !mCompletePresentEvents.Empty() || !mLostPresentEvents.Empty();
     }
 
-    void DequeueLostPresentEvents(std::vector<std::shared_ptr<PresentEvent>>& outPresentEvents)
+    // Move any overflowed events into their queues.  Must be called by the
+    // consumer thread.  Returns true if there are no overflowed events left.
+    bool FlushHandoffOverflow()
     {
-        std::lock_guard<std::mutex> lock(mLostPresentEventMutex);
-        outPresentEvents.swap(mLostPresentEvents);
+        auto flushed = FlushOverflow(&mProcessEvents, &mProcessEventOverflow, mHandoffSignal);
+        flushed = FlushOverflow(&mCompletePresentEvents, &mCompletePresentOverflow, mHandoffSignal) && flushed;
+        flushed = FlushOverflow(&mLostPresentEvents, &mLostPresentOverflow, mHandoffSignal) && flushed;
+        return flushed;
     }
 
     void HandleDxgkBlt(EVENT_HEADER const& hdr, uint64_t hwnd, bool redirectedPresent);
@@ -352,16 +490,21 @@ struct PMTraceConsumer
     void HandleDxgkPresentHistory(EVENT_HEADER const& hdr, uint64_t token, uint64_t tokenData, PresentMode knownPresentMode);
     void HandleDxgkPresentHistoryInfo(EVENT_HEADER const& hdr, uint64_t token);
 
-    void CompletePresent(std::shared_ptr<PresentEvent> const& p);
-    void CompletePresentHelper(std::shared_ptr<PresentEvent> const& p, OrderedPresents* completed);
-    void CompleteDeferredCompletion(std::shared_ptr<PresentEvent> const& present);
-    std::shared_ptr<PresentEvent> FindBySubmitSequence(uint32_t submitSequence);
-    std::shared_ptr<PresentEvent> FindOrCreatePresent(EVENT_HEADER const& hdr);
-    void IgnorePresent(std::shared_ptr<PresentEvent> present);
-    void TrackPresentOnThread(std::shared_ptr<PresentEvent> present);
-    void TrackPresent(std::shared_ptr<PresentEvent> present, OrderedPresents* presentsByThisProcess);
-    void RemoveLostPresent(std::shared_ptr<PresentEvent> present);
-    void RemovePresentFromTemporaryTrackingCollections(std::shared_ptr<PresentEvent> present, bool waitForPresentStop);
+    void CompletePresent(PoolPtr<PresentEvent> const& p);
+    void CompletePresentHelper(PoolPtr<PresentEvent> const& p, OrderedPresents* completed);
+    void CompleteDeferredCompletion(PoolPtr<PresentEvent> const& present);
+    PoolPtr<PresentEvent> FindBySubmitSequence(uint32_t submitSequence);
+    PoolPtr<PresentEvent> FindOrCreatePresent(EVENT_HEADER const& hdr);
+    PresentEventExtension* GetExtension(PoolPtr<PresentEvent> const& present);
+    void PopClassifiedPresents(std::deque<PoolPtr<PresentEvent>>* unclassifiedPresents);
+    void IgnorePresent(PoolPtr<PresentEvent> present);
+    void TrackPresentOnThread(PoolPtr<PresentEvent> present);
+    void TrackPresent(PoolPtr<PresentEvent> present, OrderedPresents* presentsByThisProcess);
+    void RemoveLostPresent(PoolPtr<PresentEvent> present);
+    void AddPresentWaitingForDWM(PoolPtr<PresentEvent> const& present);
+    void RemovePresentWaitingForDWM(PoolPtr<PresentEvent> const& present);
+    void MovePresentsWaitingForDWM(std::vector<PoolPtr<PresentEvent>>* dependentPresents);
+    void RemovePresentFromTemporaryTrackingCollections(PoolPtr<PresentEvent> present, bool waitForPresentStop);
     void RuntimePresentStop(EVENT_HEADER const& hdr, bool AllowPresentBatching, ::Runtime runtime);
 
     void HandleNTProcessEvent(EVENT_RECORD* pEventRecord);
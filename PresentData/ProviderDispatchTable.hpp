@@ -0,0 +1,135 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <vector>
+#include <windows.h>
+
+// ProviderDispatchTable maps ETW provider GUIDs to handlers, so that an event
+// can be routed to its handler with a single table lookup instead of
+// comparing its ProviderId against every provider in turn.
+//
+// The table is indexed by a multiplicative hash of the GUID's first 32 bits
+// (Data1), and each slot also stores the full GUID to confirm the match.
+// When a provider is added, the table is rebuilt, searching for a size and
+// multiplier that put every provider in its own slot.  A lookup is then one
+// slot read and one GUID compare, for both known and unknown providers.  If
+// no perfect placement is found (e.g., two providers share a Data1),
+// colliding providers fall back to linear probing.
+//
+// Handler must be a pointer type; Find() returns nullptr for unknown
+// providers.  Providers should all be added before events are dispatched.
+
+template<typename Handler>
+class ProviderDispatchTable {
+    struct Slot {
+        GUID mProviderId;
+        Handler mHandler;       // nullptr if the slot is empty
+    };
+
+    enum {
+        MIN_INDEX_BITS     = 3,
+        MAX_EXTRA_BITS     = 3, // Grow the table at most 8x to avoid collisions
+        MULTIPLIER_RETRIES = 64,
+    };
+
+    std::vector<Slot> mSlots;   // Slots, with an empty slot after the last provider
+    std::vector<Slot> mEntries; // All added providers
+    uint32_t mMultiplier;
+    uint32_t mShift;
+
+    uint32_t GetIndex(uint32_t data1) const
+    {
+        return (data1 * mMultiplier) >> mShift;
+    }
+
+    // Place every entry into a table with 2^indexBits slots, plus one spare
+    // slot per entry so that probing never wraps.  Returns the total number of
+    // probes past each entry's home slot.
+    uint32_t Place(uint32_t indexBits, uint32_t multiplier, std::vector<Slot>* slots)
+    {
+        mMultiplier = multiplier;
+        mShift = 32 - indexBits;
+        slots->assign(((size_t) 1 << indexBits) + mEntries.size(), Slot{ {}, nullptr });
+
+        uint32_t displacement = 0;
+        for (auto const& entry : mEntries) {
+            auto index = GetIndex(entry.mProviderId.Data1);
+            for (; (*slots)[index].mHandler != nullptr; ++index) {
+                displacement += 1;
+            }
+            (*slots)[index] = entry;
+        }
+        return displacement;
+    }
+
+    void Rebuild()
+    {
+        uint32_t indexBits = MIN_INDEX_BITS;
+        while (((size_t) 1 << indexBits) < 2 * mEntries.size()) {
+            indexBits += 1;
+        }
+
+        uint32_t bestIndexBits = indexBits;
+        uint32_t bestMultiplier = 0x9E3779B1u;
+        uint32_t bestDisplacement = UINT32_MAX;
+        for (uint32_t maxIndexBits = indexBits + MAX_EXTRA_BITS; indexBits <= maxIndexBits && bestDisplacement != 0; ++indexBits) {
+            auto multiplier = 0x9E3779B1u;
+            for (uint32_t i = 0; i < MULTIPLIER_RETRIES && bestDisplacement != 0; ++i) {
+                auto displacement = Place(indexBits, multiplier, &mSlots);
+                if (displacement < bestDisplacement) {
+                    bestIndexBits = indexBits;
+                    bestMultiplier = multiplier;
+                    bestDisplacement = displacement;
+                }
+                multiplier = (multiplier * 0x01000193u) | 1;
+            }
+        }
+
+        Place(bestIndexBits, bestMultiplier, &mSlots);
+    }
+
+public:
+    ProviderDispatchTable()
+    {
+        Rebuild();
+    }
+
+    // Routes events from providerId to handler, replacing any handler already
+    // added for that provider.
+    void Add(GUID const& providerId, Handler handler)
+    {
+        assert(handler != nullptr);
+        for (auto& entry : mEntries) {
+            if (entry.mProviderId == providerId) {
+                entry.mHandler = handler;
+                Rebuild();
+                return;
+            }
+        }
+        mEntries.push_back({ providerId, handler });
+        Rebuild();
+    }
+
+    void Clear()
+    {
+        mEntries.clear();
+        Rebuild();
+    }
+
+    size_t Size() const { return mEntries.size(); }
+
+    // Returns the handler for providerId, or nullptr if none was added.
+    Handler Find(GUID const& providerId) const
+    {
+        for (auto slot = &mSlots[GetIndex(providerId.Data1)]; slot->mHandler != nullptr; ++slot) {
+            if (slot->mProviderId == providerId) {
+                return slot->mHandler;
+            }
+        }
+        return nullptr;
+    }
+};
@@ -0,0 +1,250 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <assert.h>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+// SlabPool is a fixed-size object allocator used for objects that are created
+// at a high rate by the consumer thread (e.g., one PresentEvent per present).
+// Objects are carved out of large slabs and recycled through a free list, so
+// steady-state operation doesn't touch the heap at all.
+//
+// Objects are reference counted intrusively, and the reference count is NOT
+// atomic: PoolPtr<T> may only be created, copied, and destroyed on the thread
+// that owns the pool (the consumer thread).
+//
+// To pass an object to another thread, the owner calls Handoff() which takes
+// an extra reference on the owner thread and returns a move-only
+// PoolHandoffPtr<T>.  When a PoolHandoffPtr<T> is destroyed (on any thread),
+// the object is pushed onto a lock-free released list instead of touching the
+// reference count.  The owner thread collects the released list the next time
+// it allocates (or when CollectReleased() is called) and drops the hand-off
+// references there.  An object may be handed off more than once (e.g., a
+// present that is reported lost and later completed), so each object counts
+// its released hand-offs and is only linked into the released list once.
+//
+// Pooled types must derive from PoolObject<T>.
+
+template<typename T> class SlabPool;
+
+template<typename T>
+struct PoolObject {
+    SlabPool<T>* mPool = nullptr;       // Pool that owns this object's storage
+    T* mNextReleased = nullptr;         // Link in the pool's released list
+    uint32_t mRefCount = 0;             // Owner-thread references
+    std::atomic<uint32_t> mReleasedCount { 0 }; // Released hand-off references not yet collected
+
+    PoolObject() = default;
+    PoolObject(PoolObject const&) : mPool(nullptr), mNextReleased(nullptr), mRefCount(0), mReleasedCount(0) {}
+    PoolObject& operator=(PoolObject const&) { return *this; } // Bookkeeping is not copied
+};
+
+template<typename T>
+class PoolPtr {
+    T* mPtr;
+
+    void AddRef() const { if (mPtr != nullptr) { mPtr->mRefCount += 1; } }
+    void Release() const { if (mPtr != nullptr) { SlabPool<T>::Release(mPtr); } }
+
+    template<typename U> friend class SlabPool;
+    struct AdoptTag {};
+    PoolPtr(T* p, AdoptTag) : mPtr(p) { AddRef(); }
+
+public:
+    PoolPtr() : mPtr(nullptr) {}
+    PoolPtr(std::nullptr_t) : mPtr(nullptr) {}
+    PoolPtr(PoolPtr const& other) : mPtr(other.mPtr) { AddRef(); }
+    PoolPtr(PoolPtr&& other) : mPtr(other.mPtr) { other.mPtr = nullptr; }
+    ~PoolPtr() { Release(); }
+
+    PoolPtr& operator=(PoolPtr const& other)
+    {
+        other.AddRef();
+        Release();
+        mPtr = other.mPtr;
+        return *this;
+    }
+
+    PoolPtr& operator=(PoolPtr&& other)
+    {
+        if (this != &other) {
+            Release();
+            mPtr = other.mPtr;
+            other.mPtr = nullptr;
+        }
+        return *this;
+    }
+
+    PoolPtr& operator=(std::nullptr_t)
+    {
+        Release();
+        mPtr = nullptr;
+        return *this;
+    }
+
+    void reset() { *this = nullptr; }
+    void swap(PoolPtr& other) { std::swap(mPtr, other.mPtr); }
+
+    T* get() const { return mPtr; }
+    T* operator->() const { return mPtr; }
+    T& operator*() const { return *mPtr; }
+    explicit operator bool() const { return mPtr != nullptr; }
+
+    bool operator==(PoolPtr const& rhs) const { return mPtr == rhs.mPtr; }
+    bool operator!=(PoolPtr const& rhs) const { return mPtr != rhs.mPtr; }
+    bool operator==(std::nullptr_t) const { return mPtr == nullptr; }
+    bool operator!=(std::nullptr_t) const { return mPtr != nullptr; }
+};
+
+template<typename T>
+struct PoolHandoffDeleter {
+    void operator()(T* p) const { p->mPool->PushReleased(p); }
+};
+
+template<typename T>
+using PoolHandoffPtr = std::unique_ptr<T, PoolHandoffDeleter<T>>;
+
+template<typename T>
+class SlabPool {
+public:
+    enum { OBJECTS_PER_SLAB = 256 };
+
+    SlabPool() = default;
+
+    ~SlabPool()
+    {
+        // Any hand-off references must have been released (i.e., the other
+        // threads must be done with the objects) before the pool is destroyed.
+        CollectReleased();
+        assert(mLiveCount == 0);
+
+        for (auto slab : mSlabs) {
+            ::operator delete(slab);
+        }
+    }
+
+    template<typename... Args>
+    PoolPtr<T> Allocate(Args&&... args)
+    {
+        CollectReleased();
+
+        if (mFreeList == nullptr) {
+            AllocateSlab();
+        }
+
+        auto slot = mFreeList;
+        mFreeList = slot->mNextFree;
+
+        auto p = new (slot->mStorage) T(std::forward<Args>(args)...);
+        p->mPool = this;
+        mLiveCount += 1;
+        mAllocationCount += 1;
+        return PoolPtr<T>(p, typename PoolPtr<T>::AdoptTag());
+    }
+
+    // Take a reference that can be passed to, and released by, another thread.
+    PoolHandoffPtr<T> Handoff(PoolPtr<T> const& p)
+    {
+        assert(p != nullptr);
+        p->mRefCount += 1;
+        return PoolHandoffPtr<T>(p.get());
+    }
+
+    // Drop all hand-off references that have been released by other threads.
+    // Must be called on the owner thread.
+    void CollectReleased()
+    {
+        if (mReleased.load(std::memory_order_relaxed) == nullptr) {
+            return;
+        }
+
+        auto p = mReleased.exchange(nullptr, std::memory_order_acquire);
+        while (p != nullptr) {
+            // Unlink the object before taking its count, so that a hand-off
+            // released after the exchange links it into the list again.
+            auto next = p->mNextReleased;
+            p->mNextReleased = nullptr;
+            for (auto n = p->mReleasedCount.exchange(0, std::memory_order_acq_rel); n > 0; --n) {
+                Release(p);
+            }
+            p = next;
+        }
+    }
+
+    // Statistics
+    size_t GetLiveCount() const { return mLiveCount; }
+    size_t GetAllocationCount() const { return mAllocationCount; }
+    size_t GetSlabCount() const { return mSlabs.size(); }
+
+private:
+    union Slot {
+        Slot* mNextFree;
+        alignas(T) unsigned char mStorage[sizeof(T)];
+    };
+
+    Slot* mFreeList = nullptr;
+    std::vector<Slot*> mSlabs;
+    std::atomic<T*> mReleased { nullptr };
+    size_t mLiveCount = 0;
+    size_t mAllocationCount = 0;
+
+    friend class PoolPtr<T>;
+    friend struct PoolHandoffDeleter<T>;
+
+    SlabPool(SlabPool const&) = delete;
+    SlabPool& operator=(SlabPool const&) = delete;
+
+    void AllocateSlab()
+    {
+        auto slab = static_cast<Slot*>(::operator new(sizeof(Slot) * OBJECTS_PER_SLAB));
+        mSlabs.push_back(slab);
+
+        // Link the slots in address order so that consecutive allocations are
+        // adjacent in memory.
+        for (uint32_t i = 0; i < OBJECTS_PER_SLAB - 1; ++i) {
+            slab[i].mNextFree = &slab[i + 1];
+        }
+        slab[OBJECTS_PER_SLAB - 1].mNextFree = mFreeList;
+        mFreeList = slab;
+    }
+
+    static void Release(T* p)
+    {
+        assert(p->mRefCount > 0);
+        p->mRefCount -= 1;
+        if (p->mRefCount == 0) {
+            p->mPool->Free(p);
+        }
+    }
+
+    void Free(T* p)
+    {
+        p->~T();
+
+        auto slot = reinterpret_cast<Slot*>(p);
+        slot->mNextFree = mFreeList;
+        mFreeList = slot;
+        mLiveCount -= 1;
+    }
+
+    void PushReleased(T* p)
+    {
+        // If the object is already in the released list, just count it.
+        if (p->mReleasedCount.fetch_add(1, std::memory_order_acq_rel) != 0) {
+            return;
+        }
+
+        auto head = mReleased.load(std::memory_order_relaxed);
+        do {
+            p->mNextReleased = head;
+        } while (!mReleased.compare_exchange_weak(head, p, std::memory_order_release, std::memory_order_relaxed));
+    }
+};
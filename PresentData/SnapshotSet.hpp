@@ -0,0 +1,135 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// SnapshotSet is a set that is read on a hot path by a single reader thread
+// and rarely modified by any other thread, e.g., PMTraceConsumer's tracked
+// process filter, which is checked for almost every event but only changes
+// when a target process starts or exits.
+//
+// Modifications copy the set into a new, immutable, sorted array (a
+// snapshot) and publish it through an atomic pointer.  Contains() loads that
+// pointer and binary-searches the snapshot without taking a lock or writing to
+// any memory shared with the writers.
+//
+// Replaced snapshots can't be freed while the reader may still be using
+// them, so they are retired.  When the reader first sees a new snapshot it
+// records it in mReaderSnapshot (a write, but only once per modification),
+// and writers free the retired snapshots that were replaced before it.  At
+// most one retired snapshot is therefore kept alive once the reader has
+// caught up.
+//
+// Contains() must only be called by one thread at a time.  Insert() and
+// Erase() may be called from any thread.
+
+template<typename T>
+class SnapshotSet {
+    using Snapshot = std::vector<T>;
+
+    // The current snapshot, read by the reader on every Contains().
+    alignas(64) std::atomic<Snapshot const*> mCurrent;
+
+    // The latest snapshot that the reader has used, written by the reader
+    // when it sees a new snapshot.
+    alignas(64) std::atomic<Snapshot const*> mReaderSnapshot;
+
+    // Writer state, protected by mWriterMutex.  mRetired is in the order the
+    // snapshots were replaced.
+    alignas(64) std::mutex mWriterMutex;
+    std::vector<std::unique_ptr<Snapshot const>> mRetired;
+
+    // Publish snapshot, retire the one it replaces, and free any retired
+    // snapshots that the reader has moved past.  mWriterMutex must be held.
+    void Publish(std::unique_ptr<Snapshot const> snapshot)
+    {
+        mRetired.emplace_back(mCurrent.exchange(snapshot.release(), std::memory_order_seq_cst));
+
+        // The reader only ever uses mReaderSnapshot or a snapshot published
+        // after it, so every snapshot retired before it can be freed.  If
+        // mReaderSnapshot isn't retired, the reader is using the current
+        // snapshot (or none) and all retired snapshots can be freed.
+        auto readerSnapshot = mReaderSnapshot.load(std::memory_order_seq_cst);
+        auto ii = std::find_if(mRetired.begin(), mRetired.end(), [=](std::unique_ptr<Snapshot const> const& p) { return p.get() == readerSnapshot; });
+        mRetired.erase(mRetired.begin(), ii);
+    }
+
+public:
+    SnapshotSet()
+        : mCurrent(new Snapshot())
+        , mReaderSnapshot(nullptr)
+    {
+    }
+
+    ~SnapshotSet()
+    {
+        delete mCurrent.load(std::memory_order_relaxed);
+    }
+
+    SnapshotSet(SnapshotSet const&) = delete;
+    SnapshotSet& operator=(SnapshotSet const&) = delete;
+
+    // Reader: returns whether value is in the set.
+    bool Contains(T const& value)
+    {
+        auto snapshot = mCurrent.load(std::memory_order_acquire);
+
+        // A new snapshot can only be used once the writers can see that the
+        // reader is using it, so record it and then check that it is still
+        // current.  If it is, any writer that later retires it will see the
+        // record and keep it; if not, a writer may already have freed it so
+        // try again with the newer one.
+        while (snapshot != mReaderSnapshot.load(std::memory_order_relaxed)) {
+            mReaderSnapshot.store(snapshot, std::memory_order_seq_cst);
+            snapshot = mCurrent.load(std::memory_order_seq_cst);
+        }
+
+        return std::binary_search(snapshot->begin(), snapshot->end(), value);
+    }
+
+    // Writer: adds value to the set.  Returns false if it was already in the
+    // set.
+    bool Insert(T const& value)
+    {
+        std::lock_guard<std::mutex> lock(mWriterMutex);
+        auto current = mCurrent.load(std::memory_order_relaxed);
+        auto ii = std::lower_bound(current->begin(), current->end(), value);
+        if (ii != current->end() && *ii == value) {
+            return false;
+        }
+
+        std::unique_ptr<Snapshot> snapshot(new Snapshot());
+        snapshot->reserve(current->size() + 1);
+        snapshot->insert(snapshot->end(), current->begin(), ii);
+        snapshot->push_back(value);
+        snapshot->insert(snapshot->end(), ii, current->end());
+        Publish(std::move(snapshot));
+        return true;
+    }
+
+    // Writer: removes value from the set.  Returns false if it wasn't in the
+    // set.
+    bool Erase(T const& value)
+    {
+        std::lock_guard<std::mutex> lock(mWriterMutex);
+        auto current = mCurrent.load(std::memory_order_relaxed);
+        auto ii = std::lower_bound(current->begin(), current->end(), value);
+        if (ii == current->end() || *ii != value) {
+            return false;
+        }
+
+        std::unique_ptr<Snapshot> snapshot(new Snapshot());
+        snapshot->reserve(current->size() - 1);
+        snapshot->insert(snapshot->end(), current->begin(), ii);
+        snapshot->insert(snapshot->end(), ii + 1, current->end());
+        Publish(std::move(snapshot));
+        return true;
+    }
+};
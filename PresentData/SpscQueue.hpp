@@ -0,0 +1,97 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <assert.h>
+#include <atomic>
+#include <stddef.h>
+#include <utility>
+#include <vector>
+
+// SpscQueue is a bounded, lock-free, single-producer/single-consumer ring
+// buffer.  It's used to hand off completed events from a trace consumer
+// (which runs on the time-critical ETW consumer thread) to the output thread
+// without either thread ever blocking on a lock.
+//
+// TryPush() may only be called by the producer thread, and PopAll()/Empty()
+// may only be called by the consumer thread.  The read and write indices are
+// kept on separate cache lines, and each side keeps a cached copy of the
+// other side's index so that the shared index is only reloaded when the
+// queue appears full (producer) or empty (consumer).
+
+template<typename T>
+class SpscQueue {
+public:
+    // capacity must be a power of two.
+    explicit SpscQueue(size_t capacity)
+        : mItems(capacity)
+        , mMask(capacity - 1)
+    {
+        assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+    }
+
+    SpscQueue(SpscQueue const&) = delete;
+    SpscQueue& operator=(SpscQueue const&) = delete;
+
+    size_t Capacity() const { return mItems.size(); }
+
+    // Producer: move item into the queue.  If the queue is full, item is left
+    // unmodified and false is returned.
+    bool TryPush(T& item)
+    {
+        auto writeIndex = mWriteIndex.load(std::memory_order_relaxed);
+        if (writeIndex - mProducerReadIndex == mItems.size()) {
+            mProducerReadIndex = mReadIndex.load(std::memory_order_acquire);
+            if (writeIndex - mProducerReadIndex == mItems.size()) {
+                return false;
+            }
+        }
+
+        mItems[writeIndex & mMask] = std::move(item);
+        mWriteIndex.store(writeIndex + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: move all items currently in the queue onto the end of out.
+    // Returns the number of items moved.
+    size_t PopAll(std::vector<T>* out)
+    {
+        auto readIndex = mReadIndex.load(std::memory_order_relaxed);
+        mConsumerWriteIndex = mWriteIndex.load(std::memory_order_acquire);
+
+        auto count = (size_t) (mConsumerWriteIndex - readIndex);
+        out->reserve(out->size() + count);
+        for (; readIndex != mConsumerWriteIndex; ++readIndex) {
+            out->emplace_back(std::move(mItems[readIndex & mMask]));
+        }
+
+        mReadIndex.store(readIndex, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer: whether there are any items in the queue.
+    bool Empty()
+    {
+        auto readIndex = mReadIndex.load(std::memory_order_relaxed);
+        if (readIndex != mConsumerWriteIndex) {
+            return false;
+        }
+        mConsumerWriteIndex = mWriteIndex.load(std::memory_order_acquire);
+        return readIndex == mConsumerWriteIndex;
+    }
+
+private:
+    enum { CACHE_LINE_SIZE = 64 };
+
+    std::vector<T> mItems;
+    size_t mMask;
+
+    // Written by the consumer
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> mReadIndex { 0 };
+    size_t mConsumerWriteIndex = 0; // Consumer's cached copy of mWriteIndex
+
+    // Written by the producer
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> mWriteIndex { 0 };
+    size_t mProducerReadIndex = 0;  // Producer's cached copy of mReadIndex
+};
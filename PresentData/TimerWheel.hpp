@@ -0,0 +1,165 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+// TimerWheel expires items once they are older than a timeout, where an
+// item's age is measured from the time it was inserted to the time passed to
+// Advance() (e.g., QPC timestamps).
+//
+// Items are placed into one of SLOT_COUNT slots by their insertion time, with
+// each slot covering timeout / (SLOT_COUNT - 2) ticks, so the wheel never
+// holds more than SLOT_COUNT slots' worth of time.  Advance() expires whole
+// slots at once, so an item expires after between timeout and timeout plus
+// one slot width.  Insert(), Remove(), and the expiry of each item are O(1),
+// and Advance() visits at most SLOT_COUNT slots no matter how far time has
+// moved.
+//
+// If the wheel holds capacity items when another is inserted, the oldest
+// slots are expired early to make room, so the number of items is bounded
+// even if items are inserted faster than they time out.
+//
+// Each item stores its position in the wheel in a TimerWheelHandle, which
+// GetHandle()(item) must return a reference to, so that it can be removed
+// without searching.
+
+struct TimerWheelHandle {
+    enum { NOT_IN_WHEEL = UINT32_MAX };
+
+    uint32_t mSlot = NOT_IN_WHEEL;
+    uint32_t mIndex = 0;
+};
+
+template<typename T, typename GetHandle>
+class TimerWheel {
+    enum { SLOT_COUNT = 64 };
+
+    std::vector<T> mSlots[SLOT_COUNT];
+    uint64_t mTimeout = 0;
+    uint64_t mSlotWidth = 1;
+    uint64_t mNextExpiry = 0;   // Time / mSlotWidth of the oldest slot that may hold items
+    size_t mSize = 0;
+    size_t mCapacity = SIZE_MAX;
+
+    template<typename Fn>
+    void ExpireSlot(uint64_t slotTime, Fn& onExpired)
+    {
+        // onExpired() may Remove() other items, including from this slot, so
+        // pop one item at a time.
+        auto slotIndex = (uint32_t) (slotTime % SLOT_COUNT);
+        auto slot = &mSlots[slotIndex];
+        while (!slot->empty()) {
+            auto item = std::move(slot->back());
+            slot->pop_back();
+            mSize -= 1;
+
+            auto& handle = GetHandle()(item);
+            assert(handle.mSlot == slotIndex && handle.mIndex == slot->size());
+            handle.mSlot = TimerWheelHandle::NOT_IN_WHEEL;
+
+            onExpired(item);
+        }
+    }
+
+public:
+    // Sets the timeout and the maximum number of items.  The wheel must be
+    // empty.
+    void Configure(uint64_t timeout, size_t capacity)
+    {
+        assert(mSize == 0);
+        assert(capacity > 0);
+        mTimeout = timeout;
+        mSlotWidth = timeout / (SLOT_COUNT - 2) + 1;
+        mNextExpiry = 0;
+        mCapacity = capacity;
+    }
+
+    bool Empty() const { return mSize == 0; }
+    size_t Size() const { return mSize; }
+
+    bool Contains(T const& item) const
+    {
+        return GetHandle()(item).mSlot != TimerWheelHandle::NOT_IN_WHEEL;
+    }
+
+    // Expires every item older than timeout at time now, calling
+    // onExpired(item) for each one after removing it from the wheel.
+    template<typename Fn>
+    void Advance(uint64_t now, Fn&& onExpired)
+    {
+        if (now < mTimeout) {
+            return;
+        }
+
+        // Every item in slots older than (now - timeout) / mSlotWidth has
+        // expired.
+        auto end = (now - mTimeout) / mSlotWidth;
+        if (mNextExpiry >= end) {
+            return;
+        }
+
+        // Slots older than end - SLOT_COUNT are already empty.
+        if (mSize != 0) {
+            auto first = end - mNextExpiry > SLOT_COUNT ? end - SLOT_COUNT : mNextExpiry;
+            for (auto slotTime = first; slotTime < end; ++slotTime) {
+                ExpireSlot(slotTime, onExpired);
+            }
+        }
+        mNextExpiry = end;
+    }
+
+    // Inserts item with the given time, which must not be later than the last
+    // Advance() time.  If the wheel is full, the oldest items are expired
+    // first, calling onExpired(item) for each.
+    template<typename Fn>
+    void Insert(T item, uint64_t time, Fn&& onExpired)
+    {
+        assert(!Contains(item));
+
+        for (; mSize >= mCapacity; ++mNextExpiry) {
+            ExpireSlot(mNextExpiry, onExpired);
+        }
+
+        auto slotTime = time / mSlotWidth;
+        if (slotTime < mNextExpiry) {
+            slotTime = mNextExpiry;
+        }
+        assert(slotTime - mNextExpiry < SLOT_COUNT);
+
+        auto slotIndex = (uint32_t) (slotTime % SLOT_COUNT);
+        auto slot = &mSlots[slotIndex];
+        auto& handle = GetHandle()(item);
+        handle.mSlot = slotIndex;
+        handle.mIndex = (uint32_t) slot->size();
+        slot->emplace_back(std::move(item));
+        mSize += 1;
+    }
+
+    // Removes item from the wheel without expiring it.  Does nothing if the
+    // item isn't in the wheel.
+    void Remove(T const& item)
+    {
+        auto& handle = GetHandle()(item);
+        if (handle.mSlot == TimerWheelHandle::NOT_IN_WHEEL) {
+            return;
+        }
+
+        auto slot = &mSlots[handle.mSlot];
+        assert(handle.mIndex < slot->size());
+        auto index = handle.mIndex;
+        handle.mSlot = TimerWheelHandle::NOT_IN_WHEEL;
+
+        if (index + 1 != slot->size()) {
+            (*slot)[index] = std::move(slot->back());
+            GetHandle()((*slot)[index]).mIndex = index;
+        }
+        slot->pop_back();
+        mSize -= 1;
+    }
+};
@@ -142,6 +142,96 @@ uint32_t GetPropertyDataOffset(TRACE_EVENT_INFO const& tei, EVENT_RECORD const&
     return offset;
 }
 
+// Returns the size of one element of the property if it can be determined
+// from the metadata alone, or 0 if it depends on the event data.
+uint32_t GetFixedPropertySize(TRACE_EVENT_INFO const& tei, uint32_t index, bool is64Bit, uint32_t* propStatus)
+{
+    auto const& epi = tei.EventPropertyInfoArray[index];
+
+    if (epi.Flags & PropertyStruct) {
+        uint32_t size = 0;
+        for (USHORT i = 0; i < epi.structType.NumOfStructMembers; ++i) {
+            auto memberIndex = epi.structType.StructStartIndex + i;
+            auto const& memberEpi = tei.EventPropertyInfoArray[memberIndex];
+            uint32_t memberStatus = 0;
+            auto memberSize = GetFixedPropertySize(tei, memberIndex, is64Bit, &memberStatus);
+            if (memberSize == 0 || (memberEpi.Flags & PropertyParamCount) != 0) {
+                return 0;
+            }
+            size += memberSize * memberEpi.count;
+        }
+        return size;
+    }
+
+    switch (epi.nonStructType.InType) {
+    case TDH_INTYPE_UNICODESTRING:
+        *propStatus |= PROP_STATUS_WCHAR_STRING;
+        return (epi.Flags & PropertyParamLength) != 0 ? 0 : epi.length * sizeof(wchar_t);
+    case TDH_INTYPE_ANSISTRING:
+        *propStatus |= PROP_STATUS_CHAR_STRING;
+        return (epi.Flags & PropertyParamLength) != 0 ? 0 : epi.length * sizeof(char);
+    case TDH_INTYPE_POINTER:
+    case TDH_INTYPE_SIZET:
+        *propStatus |= PROP_STATUS_POINTER_SIZE;
+        return is64Bit ? 8 : 4;
+    case TDH_INTYPE_WBEMSID:
+        return 0;
+    }
+
+    return epi.length;
+}
+
+void InitializeEventLayout(TRACE_EVENT_INFO const& tei, bool is64Bit, EventLayout* layout)
+{
+    layout->properties_.resize(tei.TopLevelPropertyCount);
+
+    // Offsets are fixed until the first property whose size or count depends
+    // on the event data.
+    bool fixedOffset = true;
+    uint32_t offset = 0;
+    layout->firstVariableIndex_ = tei.TopLevelPropertyCount;
+    for (uint32_t i = 0; i < tei.TopLevelPropertyCount; ++i) {
+        auto const& epi = tei.EventPropertyInfoArray[i];
+        auto prop = &layout->properties_[i];
+        prop->offset_ = offset;
+        prop->size_   = 0;
+        prop->status_ = PROP_STATUS_FOUND;
+
+        if (fixedOffset) {
+            prop->size_ = GetFixedPropertySize(tei, i, is64Bit, &prop->status_);
+            if (prop->size_ == 0 || (epi.Flags & PropertyParamCount) != 0) {
+                fixedOffset = false;
+                layout->firstVariableIndex_ = i;
+            } else {
+                offset += prop->size_ * epi.count;
+            }
+        }
+    }
+
+    layout->initialized_ = true;
+}
+
+uint32_t GetPropertyIndex(TRACE_EVENT_INFO const& tei, EventLayout* layout, wchar_t const* name)
+{
+    for (auto const& pr : layout->nameCache_) {
+        if (pr.first == name) {
+            return pr.second;
+        }
+    }
+
+    uint32_t index = EventLayout::NAME_NOT_FOUND;
+    for (uint32_t i = 0; i < tei.TopLevelPropertyCount; ++i) {
+        auto propName = TEI_PROPERTY_NAME(&tei, &tei.EventPropertyInfoArray[i]);
+        if (propName != nullptr && wcscmp(propName, name) == 0) {
+            index = i;
+            break;
+        }
+    }
+
+    layout->nameCache_.emplace_back(name, index);
+    return index;
+}
+
 }
 
 size_t EventMetadataKeyHash::operator()(EventMetadataKey const& key) const
@@ -170,44 +260,159 @@ void EventMetadata::AddMetadata(EVENT_RECORD* eventRecord)
             return; // Don't store tracelogging metadata
         }
 
-        // Store metadata (overwriting any previous)
         EventMetadataKey key;
         key.guid_ = tei->ProviderGuid;
         key.desc_ = tei->EventDescriptor;
-        metadata_[key].assign(userData, userData + eventRecord->UserDataLength);
+        AddMetadata(key, userData, eventRecord->UserDataLength);
     }
 }
 
+// Store metadata (overwriting any previous)
+void EventMetadata::AddMetadata(EventMetadataKey const& key, void const* traceEventInfo, uint32_t traceEventInfoSize)
+{
+    auto data = (uint8_t const*) traceEventInfo;
+    auto value = &metadata_[key];
+    value->traceEventInfo_.assign(data, data + traceEventInfoSize);
+    value->layouts_[0] = EventLayout();
+    value->layouts_[1] = EventLayout();
+}
+
 // Look up metadata for this provider/event and use it to look up the property.
 // If the metadata isn't found look it up using TDH.  Then, look up each
 // property in the metadata to obtain it's data pointer and size.
-void EventMetadata::GetEventData(EVENT_RECORD* eventRecord, EventDataDesc* desc, uint32_t descCount, uint32_t optionalCount /*=0*/)
+//
+// Properties at fixed offsets are looked up using the cached EventLayout.  If
+// any requested property comes after a variable-sized property, we walk the
+// event's properties to find it.
+namespace {
+
+// Look up stored metadata.  If not found, look up metadata using TDH and
+// cache it for future events.  Returns the event's layout for its pointer
+// size.
+EventLayout* GetEventLayout(
+    std::unordered_map<EventMetadataKey, EventMetadataValue, EventMetadataKeyHash, EventMetadataKeyEqual>* metadata,
+    EVENT_RECORD* eventRecord,
+    TRACE_EVENT_INFO const** outTei)
 {
-    // Look up stored metadata.  If not found, look up metadata using TDH and
-    // cache it for future events.
     EventMetadataKey key;
     key.guid_ = eventRecord->EventHeader.ProviderId;
     key.desc_ = eventRecord->EventHeader.EventDescriptor;
-    auto ii = metadata_.find(key);
-    if (ii == metadata_.end()) {
+    auto ii = metadata->find(key);
+    if (ii == metadata->end()) {
         ULONG bufferSize = 0;
         auto status = TdhGetEventInformation(eventRecord, 0, nullptr, nullptr, &bufferSize);
         if (status == ERROR_INSUFFICIENT_BUFFER) {
-            ii = metadata_.emplace(key, std::vector<uint8_t>(bufferSize, 0)).first;
+            ii = metadata->emplace(key, EventMetadataValue()).first;
+            ii->second.traceEventInfo_.resize(bufferSize, 0);
 
-            status = TdhGetEventInformation(eventRecord, 0, nullptr, (TRACE_EVENT_INFO*) ii->second.data(), &bufferSize);
+            status = TdhGetEventInformation(eventRecord, 0, nullptr, (TRACE_EVENT_INFO*) ii->second.traceEventInfo_.data(), &bufferSize);
             assert(status == ERROR_SUCCESS);
         } else {
             // No schema registered with system, nor ETL-embedded metadata.
-            ii = metadata_.emplace(key, std::vector<uint8_t>(sizeof(TRACE_EVENT_INFO), 0)).first;
+            ii = metadata->emplace(key, EventMetadataValue()).first;
+            ii->second.traceEventInfo_.resize(sizeof(TRACE_EVENT_INFO), 0);
             assert(false);
         }
     }
 
-    auto tei = (TRACE_EVENT_INFO*) ii->second.data();
+    auto tei = (TRACE_EVENT_INFO const*) ii->second.traceEventInfo_.data();
 
-    // Lookup properties in metadata
+    auto is64Bit = (eventRecord->EventHeader.Flags & EVENT_HEADER_FLAG_64_BIT_HEADER) != 0;
+    auto layout = &ii->second.layouts_[is64Bit ? 1 : 0];
+    if (!layout->initialized_) {
+        InitializeEventLayout(*tei, is64Bit, layout);
+    }
+
+    *outTei = tei;
+    return layout;
+}
+
+// Bind each of the view's fields to the property with the same name.  The
+// fields can be read directly from UserData if every property found is at a
+// fixed offset and has the size that the view expects.
+EventLayout::ViewBinding const& GetViewBinding(TRACE_EVENT_INFO const& tei, EventLayout* layout, EventViewField const* fields, uint32_t fieldCount)
+{
+    for (auto const& binding : layout->viewBindings_) {
+        if (binding.fields_ == fields) {
+            return binding;
+        }
+    }
+
+    EventLayout::ViewBinding binding;
+    binding.fields_ = fields;
+    binding.offsets_.resize(fieldCount, (uint32_t) EventView::FIELD_NOT_FOUND);
+    binding.size_ = 0;
+    binding.direct_ = true;
+    for (uint32_t i = 0; i < fieldCount; ++i) {
+        auto index = GetPropertyIndex(tei, layout, fields[i].name_);
+        if (index == EventLayout::NAME_NOT_FOUND) {
+            continue;
+        }
+
+        auto const& prop = layout->properties_[index];
+        auto sizeMatches = fields[i].size_ == EVENT_VIEW_POINTER_SIZE
+            ? (prop.status_ & PROP_STATUS_POINTER_SIZE) != 0
+            : prop.size_ == fields[i].size_;
+        if (prop.size_ == 0 || !sizeMatches) {
+            binding.direct_ = false;
+        }
+
+        binding.offsets_[i] = prop.offset_;
+        if (binding.size_ < prop.offset_ + prop.size_) {
+            binding.size_ = prop.offset_ + prop.size_;
+        }
+    }
+
+    if (!binding.direct_) {
+        for (uint32_t i = 0; i < fieldCount; ++i) {
+            if (binding.offsets_[i] != EventView::FIELD_NOT_FOUND) {
+                binding.offsets_[i] = i * sizeof(uint64_t);
+            }
+        }
+    }
+
+    layout->viewBindings_.emplace_back(std::move(binding));
+    return layout->viewBindings_.back();
+}
+
+}
+
+void EventMetadata::GetEventData(EVENT_RECORD* eventRecord, EventDataDesc* desc, uint32_t descCount, uint32_t optionalCount /*=0*/)
+{
+    TRACE_EVENT_INFO const* tei = nullptr;
+    auto layout = GetEventLayout(&metadata_, eventRecord, &tei);
+
+    // Lookup properties with fixed offsets using the cached layout.
     uint32_t foundCount = 0;
+    uint32_t variableCount = 0;
+    for (uint32_t j = 0; j < descCount; ++j) {
+        auto index = GetPropertyIndex(*tei, layout, desc[j].name_);
+        if (index == EventLayout::NAME_NOT_FOUND) {
+            continue;
+        }
+
+        auto const& prop = layout->properties_[index];
+        if (prop.size_ == 0) {
+            variableCount += 1;
+            continue;
+        }
+
+        assert(prop.offset_ + (desc[j].arrayIndex_ + 1) * prop.size_ <= eventRecord->UserDataLength);
+
+        desc[j].data_   = (void*) ((uintptr_t) eventRecord->UserData + (prop.offset_ + desc[j].arrayIndex_ * prop.size_));
+        desc[j].size_   = prop.size_;
+        desc[j].status_ = prop.status_;
+        foundCount += 1;
+    }
+
+    if (variableCount == 0) {
+        assert(foundCount >= descCount - optionalCount);
+        (void) optionalCount;
+        return;
+    }
+
+    // Walk the properties to find the remaining ones, starting from the first
+    // property that isn't at a fixed offset.
 
 #if 0 /* Helper to see all property names while debugging */
     std::vector<wchar_t const*> props(tei->TopLevelPropertyCount, nullptr);
@@ -216,7 +421,7 @@ void EventMetadata::GetEventData(EVENT_RECORD* eventRecord, EventDataDesc* desc,
     }
 #endif
 
-    for (uint32_t i = 0, offset = 0; i < tei->TopLevelPropertyCount; ++i) {
+    for (uint32_t i = layout->firstVariableIndex_, offset = layout->properties_[i].offset_; i < tei->TopLevelPropertyCount; ++i) {
         uint32_t size   = 0;
         uint32_t count  = 0;
         uint32_t status = PROP_STATUS_FOUND;
@@ -247,6 +452,66 @@ void EventMetadata::GetEventData(EVENT_RECORD* eventRecord, EventDataDesc* desc,
     (void) optionalCount;
 }
 
+// Point the view at the event's data.  If the view's fields can't be read
+// directly from UserData, look them up by name and copy each one,
+// zero-extended, into an 8-byte slot of viewScratch_.
+void EventMetadata::GetEventView(EVENT_RECORD* eventRecord, EventViewField const* fields, uint32_t fieldCount, EventView* view)
+{
+    TRACE_EVENT_INFO const* tei = nullptr;
+    auto layout = GetEventLayout(&metadata_, eventRecord, &tei);
+    auto const& binding = GetViewBinding(*tei, layout, fields, fieldCount);
+
+    view->offsets_ = binding.offsets_.data();
+
+    if (binding.direct_) {
+        uint32_t pointerSize = (eventRecord->EventHeader.Flags & EVENT_HEADER_FLAG_64_BIT_HEADER) ? 8 : 4;
+        if (binding.size_ <= eventRecord->UserDataLength) {
+            view->data_ = (uint8_t const*) eventRecord->UserData;
+            view->pointerSize_ = pointerSize;
+            return;
+        }
+
+        // The event is shorter than its metadata says, so copy the fields
+        // that it does contain into viewScratch_, leaving the rest 0.
+        viewScratch_.assign(fieldCount, 0);
+        viewScratchOffsets_.assign(fieldCount, (uint32_t) EventView::FIELD_NOT_FOUND);
+        for (uint32_t i = 0; i < fieldCount; ++i) {
+            auto offset = binding.offsets_[i];
+            if (offset != EventView::FIELD_NOT_FOUND) {
+                auto size = fields[i].size_ == EVENT_VIEW_POINTER_SIZE ? pointerSize : fields[i].size_;
+                if (offset + size <= eventRecord->UserDataLength) {
+                    memcpy(&viewScratch_[i], (uint8_t const*) eventRecord->UserData + offset, size < sizeof(uint64_t) ? size : sizeof(uint64_t));
+                }
+                viewScratchOffsets_[i] = i * sizeof(uint64_t);
+            }
+        }
+
+        view->offsets_ = viewScratchOffsets_.data();
+        view->data_ = (uint8_t const*) viewScratch_.data();
+        view->pointerSize_ = sizeof(uint64_t);
+        return;
+    }
+
+    viewScratchDesc_.clear();
+    for (uint32_t i = 0; i < fieldCount; ++i) {
+        if (binding.offsets_[i] != EventView::FIELD_NOT_FOUND) {
+            viewScratchDesc_.push_back({ fields[i].name_, 0, nullptr, 0, PROP_STATUS_NOT_FOUND });
+        }
+    }
+    GetEventData(eventRecord, viewScratchDesc_.data(), (uint32_t) viewScratchDesc_.size());
+
+    viewScratch_.assign(fieldCount, 0);
+    for (uint32_t i = 0, j = 0; i < fieldCount; ++i) {
+        if (binding.offsets_[i] != EventView::FIELD_NOT_FOUND) {
+            auto const& desc = viewScratchDesc_[j++];
+            memcpy(&viewScratch_[i], desc.data_, desc.size_ < sizeof(uint64_t) ? desc.size_ : sizeof(uint64_t));
+        }
+    }
+
+    view->data_ = (uint8_t const*) viewScratch_.data();
+    view->pointerSize_ = sizeof(uint64_t);
+}
+
 namespace {
 
 template <typename T>
@@ -54,11 +54,125 @@ struct EventDataDesc {
 template<> std::string EventDataDesc::GetData<std::string>() const;
 template<> std::wstring EventDataDesc::GetData<std::wstring>() const;
 
+// EventView is the base of the typed event views that etw_list generates
+// (with --event_views) into the ETW provider headers.  A view reads its fields
+// directly from the event's UserData, at offsets that
+// EventMetadata::GetEventView() binds once per event version and pointer size
+// by matching the view's field names and sizes against the event's metadata.
+//
+// If any field isn't at a fixed offset, or its size in the metadata doesn't
+// match the view's, the fields are instead looked up by name for each event
+// and copied into a scratch buffer that the view reads from.  Fields are also
+// copied if the event is shorter than its metadata says, with any that are
+// past its end read as 0.  Either way, a
+// view is only valid until the next GetEventView() call.  Use Has() before
+// reading a field that isn't present in every version of the event.
+enum {
+    EVENT_VIEW_POINTER_SIZE = 0, // EventViewField::size_ of a pointer-sized field
+};
+
+struct EventViewField {
+    wchar_t const* name_;   // Property name
+    uint32_t size_;         // Property size, or EVENT_VIEW_POINTER_SIZE
+};
+
+class EventView {
+    friend struct EventMetadata;
+
+protected:
+    uint8_t const* data_ = nullptr;
+    uint32_t const* offsets_ = nullptr;     // Offset of each field in data_, or FIELD_NOT_FOUND
+    uint32_t pointerSize_ = 0;
+
+    template<typename T> T Get(uint32_t field) const
+    {
+        assert(Has(field));
+        T t;
+        memcpy(&t, data_ + offsets_[field], sizeof(T));
+        return t;
+    }
+
+    // Pointer-sized fields are zero-extended to 64 bits.
+    uint64_t GetPointer(uint32_t field) const
+    {
+        assert(Has(field));
+        uint64_t t = 0;
+        memcpy(&t, data_ + offsets_[field], pointerSize_);
+        return t;
+    }
+
+public:
+    enum { FIELD_NOT_FOUND = UINT32_MAX };
+
+    bool Has(uint32_t field) const { return offsets_[field] != FIELD_NOT_FOUND; }
+};
+
+// EventLayout caches the parts of an event's property layout that don't
+// depend on the event's data, so that GetEventData() can find properties
+// without walking the metadata and comparing property names for every event.
+//
+// properties_[i] holds the offset and element size of top-level property i,
+// which are known for every property up to (and including) the first one
+// whose size depends on the event data (firstVariableIndex_; e.g., a
+// null-terminated string or a count-indexed array).  Otherwise, size_ is 0 and
+// GetEventData() falls back to walking the event from firstVariableIndex_.
+//
+// nameCache_ maps the property name pointers requested by the caller to a
+// property index (or NAME_NOT_FOUND).  It's keyed by pointer rather than by
+// string, so EventDataDesc::name_ must point to a string with static storage
+// duration (i.e., a string literal), which is how all callers use it.
+struct EventLayout {
+    enum { NAME_NOT_FOUND = UINT32_MAX };
+
+    struct Property {
+        uint32_t offset_;
+        uint32_t size_;     // Size of one element, or 0 if the offset or size is not fixed
+        uint32_t status_;   // PropertyStatus flags to report for this property
+    };
+
+    // How an EventView's fields are read from this event, keyed by the view's
+    // field array.  If direct_, offsets_ are UserData offsets, which can be
+    // read directly if the event is at least size_ bytes.  Otherwise, the
+    // fields are looked up by name and offsets_ are offsets into
+    // EventMetadata::viewScratch_.
+    struct ViewBinding {
+        EventViewField const* fields_;
+        std::vector<uint32_t> offsets_;
+        uint32_t size_;
+        bool direct_;
+    };
+
+    std::vector<Property> properties_;
+    std::vector<std::pair<wchar_t const*, uint32_t>> nameCache_;
+    std::vector<ViewBinding> viewBindings_;
+    uint32_t firstVariableIndex_ = 0;
+    bool initialized_ = false;
+};
+
+struct EventMetadataValue {
+    std::vector<uint8_t> traceEventInfo_;   // TRACE_EVENT_INFO buffer
+    EventLayout layouts_[2];                // [0] for 32-bit pointers, [1] for 64-bit pointers
+};
+
 struct EventMetadata {
-    std::unordered_map<EventMetadataKey, std::vector<uint8_t>, EventMetadataKeyHash, EventMetadataKeyEqual> metadata_;
+    std::unordered_map<EventMetadataKey, EventMetadataValue, EventMetadataKeyHash, EventMetadataKeyEqual> metadata_;
+    std::vector<uint64_t> viewScratch_;         // Field values for views that can't read UserData directly
+    std::vector<uint32_t> viewScratchOffsets_;  // Offsets into viewScratch_ for events shorter than a direct binding
+    std::vector<EventDataDesc> viewScratchDesc_;
 
     void AddMetadata(EVENT_RECORD* eventRecord);
+    void AddMetadata(EventMetadataKey const& key, void const* traceEventInfo, uint32_t traceEventInfoSize);
     void GetEventData(EVENT_RECORD* eventRecord, EventDataDesc* desc, uint32_t descCount, uint32_t optionalCount=0);
+    void GetEventView(EVENT_RECORD* eventRecord, EventViewField const* fields, uint32_t fieldCount, EventView* view);
+
+    // View must be an EventView generated by etw_list, e.g.:
+    //     auto view = mMetadata.GetEventView<Microsoft_Windows_DxgKrnl::Flip_Info_View>(pEventRecord);
+    template<typename View> View GetEventView(EVENT_RECORD* eventRecord)
+    {
+        View view;
+        GetEventView(eventRecord, View::GetFields(), View::FieldCount, &view);
+        return view;
+    }
 
     template<typename T> T GetEventData(EVENT_RECORD* eventRecord, wchar_t const* name, uint32_t arrayIndex = 0)
     {
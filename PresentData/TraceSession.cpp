@@ -11,6 +11,7 @@
 #include "TraceSession.hpp"
 
 #include "Debug.hpp"
+#include "EventCapture.hpp"
 #include "PresentMonTraceConsumer.hpp"
 #include "MixedRealityTraceConsumer.hpp"
 
@@ -205,10 +206,93 @@ void DisableProviders(TRACEHANDLE sessionHandle)
     status = EnableTraceEx2(sessionHandle, &SPECTRUMCONTINUOUS_PROVIDER_GUID,       EVENT_CONTROL_CODE_DISABLE_PROVIDER, 0, 0, 0, 0, nullptr);
 }
 
-template<
-    bool SAVE_FIRST_TIMESTAMP,
-    bool TRACK_DISPLAY,
-    bool TRACK_WMR>
+void CaptureEvent(TraceSession* session, EVENT_RECORD* pEventRecord)
+{
+    auto writer = session->mCaptureWriter;
+    auto const& hdr = pEventRecord->EventHeader;
+
+    // The first time an event type is seen, write the metadata needed to
+    // decode it.  If the consumer doesn't already have it (e.g., from ETL
+    // metadata events or a replayed capture), look it up using TDH.
+    // Microsoft_Windows_EventMetadata events contain metadata themselves and
+    // are captured like any other event.
+    EventMetadataKey key;
+    key.guid_ = hdr.ProviderId;
+    key.desc_ = hdr.EventDescriptor;
+    if (hdr.ProviderId != Microsoft_Windows_EventMetadata::GUID && writer->NeedsMetadata(key)) {
+        auto const& metadata = session->mPMConsumer->mMetadata.metadata_;
+        auto ii = metadata.find(key);
+        if (ii != metadata.end()) {
+            auto const& tei = ii->second.traceEventInfo_;
+            writer->WriteMetadata(key, tei.data(), (uint32_t) tei.size());
+        } else {
+            ULONG bufferSize = 0;
+            auto status = TdhGetEventInformation(pEventRecord, 0, nullptr, nullptr, &bufferSize);
+            if (status == ERROR_INSUFFICIENT_BUFFER) {
+                std::vector<uint8_t> tei(bufferSize, 0);
+                status = TdhGetEventInformation(pEventRecord, 0, nullptr, (TRACE_EVENT_INFO*) tei.data(), &bufferSize);
+                if (status == ERROR_SUCCESS) {
+                    writer->WriteMetadata(key, tei.data(), bufferSize);
+                }
+            }
+        }
+    }
+
+    writer->WriteEvent(*pEventRecord);
+}
+
+// Handlers for TraceSession::mEventHandlers.
+template<void (PMTraceConsumer::*Handle)(EVENT_RECORD*)>
+void HandlePMEvent(TraceSession* session, EVENT_RECORD* pEventRecord)
+{
+    (session->mPMConsumer->*Handle)(pEventRecord);
+}
+
+template<void (MRTraceConsumer::*Handle)(EVENT_RECORD*)>
+void HandleMREvent(TraceSession* session, EVENT_RECORD* pEventRecord)
+{
+    (session->mMRConsumer->*Handle)(pEventRecord);
+}
+
+// Route each provider that the consumers handle to its handler.  Providers
+// that are only needed to track the display or WinMR are only added when
+// those are enabled, so any of their events are ignored otherwise.
+void AddEventHandlers(
+    TraceSession* session,
+    bool trackDisplay,
+    bool trackWMR)
+{
+    auto handlers = &session->mEventHandlers;
+    handlers->Clear();
+
+    handlers->Add(Microsoft_Windows_DxgKrnl::GUID, &HandlePMEvent<&PMTraceConsumer::HandleDXGKEvent>);
+    handlers->Add(Microsoft_Windows_DXGI::GUID, &HandlePMEvent<&PMTraceConsumer::HandleDXGIEvent>);
+    handlers->Add(Microsoft_Windows_D3D9::GUID, &HandlePMEvent<&PMTraceConsumer::HandleD3D9Event>);
+    handlers->Add(NT_Process::GUID, &HandlePMEvent<&PMTraceConsumer::HandleNTProcessEvent>);
+    handlers->Add(Microsoft_Windows_DxgKrnl::Win7::PRESENTHISTORY_GUID, &HandlePMEvent<&PMTraceConsumer::HandleWin7DxgkPresentHistory>);
+    handlers->Add(Microsoft_Windows_EventMetadata::GUID, &HandlePMEvent<&PMTraceConsumer::HandleMetadataEvent>);
+
+    if (trackDisplay) {
+        handlers->Add(Microsoft_Windows_Win32k::GUID, &HandlePMEvent<&PMTraceConsumer::HandleWin32kEvent>);
+        handlers->Add(Microsoft_Windows_Dwm_Core::GUID, &HandlePMEvent<&PMTraceConsumer::HandleDWMEvent>);
+        handlers->Add(Microsoft_Windows_Dwm_Core::Win7::GUID, &HandlePMEvent<&PMTraceConsumer::HandleDWMEvent>);
+        handlers->Add(Microsoft_Windows_DxgKrnl::Win7::BLT_GUID, &HandlePMEvent<&PMTraceConsumer::HandleWin7DxgkBlt>);
+        handlers->Add(Microsoft_Windows_DxgKrnl::Win7::FLIP_GUID, &HandlePMEvent<&PMTraceConsumer::HandleWin7DxgkFlip>);
+        handlers->Add(Microsoft_Windows_DxgKrnl::Win7::QUEUEPACKET_GUID, &HandlePMEvent<&PMTraceConsumer::HandleWin7DxgkQueuePacket>);
+        handlers->Add(Microsoft_Windows_DxgKrnl::Win7::VSYNCDPC_GUID, &HandlePMEvent<&PMTraceConsumer::HandleWin7DxgkVSyncDPC>);
+        handlers->Add(Microsoft_Windows_DxgKrnl::Win7::MMIOFLIP_GUID, &HandlePMEvent<&PMTraceConsumer::HandleWin7DxgkMMIOFlip>);
+
+        if (trackWMR) {
+            handlers->Add(SPECTRUMCONTINUOUS_PROVIDER_GUID, &HandleMREvent<&MRTraceConsumer::HandleSpectrumContinuousEvent>);
+        }
+    }
+
+    if (trackWMR) {
+        handlers->Add(DHD_PROVIDER_GUID, &HandleMREvent<&MRTraceConsumer::HandleDHDEvent>);
+    }
+}
+
+template<bool SAVE_FIRST_TIMESTAMP>
 void CALLBACK EventRecordCallback(EVENT_RECORD* pEventRecord)
 {
     auto session = (TraceSession*) pEventRecord->UserContext;
@@ -223,119 +307,43 @@ void CALLBACK EventRecordCallback(EVENT_RECORD* pEventRecord)
         }
     }
 
-    if (hdr.ProviderId == Microsoft_Windows_DxgKrnl::GUID) {
-        session->mPMConsumer->HandleDXGKEvent(pEventRecord);
-        return;
-    }
-    if (hdr.ProviderId == Microsoft_Windows_DXGI::GUID) {
-        session->mPMConsumer->HandleDXGIEvent(pEventRecord);
-        return;
-    }
-    if (hdr.ProviderId == Microsoft_Windows_D3D9::GUID) {
-        session->mPMConsumer->HandleD3D9Event(pEventRecord);
-        return;
-    }
-    if (hdr.ProviderId == NT_Process::GUID) {
-        session->mPMConsumer->HandleNTProcessEvent(pEventRecord);
-        return;
-    }
-    if (hdr.ProviderId == Microsoft_Windows_DxgKrnl::Win7::PRESENTHISTORY_GUID) {
-        session->mPMConsumer->HandleWin7DxgkPresentHistory(pEventRecord);
-        return;
-    }
-    if (hdr.ProviderId == Microsoft_Windows_EventMetadata::GUID) {
-        session->mPMConsumer->HandleMetadataEvent(pEventRecord);
-        return;
-    }
-
-    if constexpr (TRACK_DISPLAY) {
-        if (hdr.ProviderId == Microsoft_Windows_Win32k::GUID) {
-            session->mPMConsumer->HandleWin32kEvent(pEventRecord);
-            return;
-        }
-    }
-
-    if constexpr (TRACK_DISPLAY) {
-        if (hdr.ProviderId == Microsoft_Windows_Dwm_Core::GUID) {
-            session->mPMConsumer->HandleDWMEvent(pEventRecord);
-            return;
-        }
-        if (hdr.ProviderId == Microsoft_Windows_Dwm_Core::Win7::GUID) {
-            session->mPMConsumer->HandleDWMEvent(pEventRecord);
-            return;
-        }
-        if (hdr.ProviderId == Microsoft_Windows_DxgKrnl::Win7::BLT_GUID) {
-            session->mPMConsumer->HandleWin7DxgkBlt(pEventRecord);
-            return;
-        }
-        if (hdr.ProviderId == Microsoft_Windows_DxgKrnl::Win7::FLIP_GUID) {
-            session->mPMConsumer->HandleWin7DxgkFlip(pEventRecord);
-            return;
-        }
-        if (hdr.ProviderId == Microsoft_Windows_DxgKrnl::Win7::QUEUEPACKET_GUID) {
-            session->mPMConsumer->HandleWin7DxgkQueuePacket(pEventRecord);
-            return;
-        }
-        if (hdr.ProviderId == Microsoft_Windows_DxgKrnl::Win7::VSYNCDPC_GUID) {
-            session->mPMConsumer->HandleWin7DxgkVSyncDPC(pEventRecord);
-            return;
-        }
-        if (hdr.ProviderId == Microsoft_Windows_DxgKrnl::Win7::MMIOFLIP_GUID) {
-            session->mPMConsumer->HandleWin7DxgkMMIOFlip(pEventRecord);
-            return;
-        }
+    #pragma warning(pop)
 
-        if constexpr (TRACK_WMR) {
-            if (hdr.ProviderId == SPECTRUMCONTINUOUS_PROVIDER_GUID) {
-                session->mMRConsumer->HandleSpectrumContinuousEvent(pEventRecord);
-                return;
-            }
-        }
+    if (session->mCaptureWriter != nullptr) {
+        CaptureEvent(session, pEventRecord);
     }
 
-    if constexpr (TRACK_WMR) {
-        if (hdr.ProviderId == DHD_PROVIDER_GUID) {
-            session->mMRConsumer->HandleDHDEvent(pEventRecord);
-            return;
-        }
+    auto handler = session->mEventHandlers.Find(hdr.ProviderId);
+    if (handler != nullptr) {
+        handler(session, pEventRecord);
     }
-
-    #pragma warning(pop)
 }
 
-template<bool SAVE_FIRST_TIMESTAMP, bool TRACK_DISPLAY>
-PEVENT_RECORD_CALLBACK GetEventRecordCallback(bool trackWMR)
+PEVENT_RECORD_CALLBACK GetEventRecordCallback(bool saveFirstTimestamp)
 {
-    return trackWMR ? &EventRecordCallback<SAVE_FIRST_TIMESTAMP, TRACK_DISPLAY, true>
-                    : &EventRecordCallback<SAVE_FIRST_TIMESTAMP, TRACK_DISPLAY, false>;
+    return saveFirstTimestamp ? &EventRecordCallback<true>
+                              : &EventRecordCallback<false>;
 }
 
-template<bool SAVE_FIRST_TIMESTAMP, bool TRACK_DISPLAY>
-PEVENT_RECORD_CALLBACK GetEventRecordCallback(bool trackInput, bool trackWMR, bool trackINTC, bool trackPower)
+ULONG CALLBACK BufferCallback(EVENT_TRACE_LOGFILEA* pLogFile)
 {
-    return trackInput ? GetEventRecordCallback<SAVE_FIRST_TIMESTAMP, TRACK_DISPLAY, true>(trackWMR, trackINTC, trackPower)
-                      : GetEventRecordCallback<SAVE_FIRST_TIMESTAMP, TRACK_DISPLAY, false>(trackWMR, trackINTC, trackPower);
-}
+    auto session = (TraceSession*) pLogFile->Context;
 
-template<bool SAVE_FIRST_TIMESTAMP>
-PEVENT_RECORD_CALLBACK GetEventRecordCallback(bool trackDisplay, bool trackWMR)
-{
-    return trackDisplay ? GetEventRecordCallback<SAVE_FIRST_TIMESTAMP, true>(trackWMR)
-                        : GetEventRecordCallback<SAVE_FIRST_TIMESTAMP, false>(trackWMR);
-}
+    // Hand off any events that overflowed the consumers' queues, in case no
+    // further events are completed to push them along.
+    session->mPMConsumer->FlushHandoffOverflow();
+    if (session->mMRConsumer != nullptr) {
+        session->mMRConsumer->FlushHandoffOverflow();
+    }
 
-PEVENT_RECORD_CALLBACK GetEventRecordCallback(bool saveFirstTimestamp, bool trackDisplay, bool trackWMR)
-{
-    return saveFirstTimestamp ? GetEventRecordCallback<true>(trackDisplay, trackWMR)
-                              : GetEventRecordCallback<false>(trackDisplay, trackWMR);
+    return session->mContinueProcessingBuffers; // TRUE = continue processing events, FALSE = return out of ProcessTrace()
 }
 
-ULONG CALLBACK BufferCallback(EVENT_TRACE_LOGFILEA* pLogFile)
-{
-    auto session = (TraceSession*) pLogFile->Context;
-    return session->mContinueProcessingBuffers; // TRUE = continue processing events, FALSE = return out of ProcessTrace()
 }
 
+TraceSession::~TraceSession()
+{
+    delete mCaptureReader;
 }
 
 ULONG TraceSession::Start(
@@ -346,11 +354,38 @@ ULONG TraceSession::Start(
 {
     assert(mSessionHandle == 0);
     assert(mTraceHandle == INVALID_PROCESSTRACE_HANDLE);
+    assert(mCaptureReader == nullptr);
     mStartQpc.QuadPart = 0;
     mPMConsumer = pmConsumer;
     mMRConsumer = mrConsumer;
     mContinueProcessingBuffers = TRUE;
 
+    // -------------------------------------------------------------------------
+    // Event captures are loaded into memory and then replayed by
+    // ProcessReplay(), without using ETW.
+    if (etlPath != nullptr && EventCaptureReader::IsCaptureFile(etlPath)) {
+        mCaptureReader = new EventCaptureReader;
+        auto status = mCaptureReader->Open(etlPath);
+        if (status != ERROR_SUCCESS) {
+            delete mCaptureReader;
+            mCaptureReader = nullptr;
+            return status;
+        }
+
+        // Use the capture's start time if it was recorded from a realtime
+        // session, otherwise use the first event like ETL processing.
+        auto const& header = mCaptureReader->GetHeader();
+        mQpcFrequency.QuadPart = header.QpcFrequency;
+        mStartQpc.QuadPart = header.StartQpc;
+        mEventRecordCallback = GetEventRecordCallback(header.StartQpc == 0);
+        AddEventHandlers(this, pmConsumer->mTrackDisplay, mrConsumer != nullptr);
+
+        pmConsumer->SetQpcFrequency(mQpcFrequency.QuadPart);
+        DebugInitialize(&mStartQpc, mQpcFrequency);
+
+        return ERROR_SUCCESS;
+    }
+
     // -------------------------------------------------------------------------
     // Configure trace properties
     EVENT_TRACE_LOGFILEA traceProps = {};
@@ -367,12 +402,11 @@ ULONG TraceSession::Start(
     traceProps.IsKernelTrace
     */
 
-    // Redirect to a specialized event handler based on the tracking parameters.
+    // Route events to the handlers for the enabled providers.
     auto saveFirstTimestamp = etlPath != nullptr;
-    traceProps.EventRecordCallback = GetEventRecordCallback(
-        saveFirstTimestamp,
-        pmConsumer->mTrackDisplay,
-        mrConsumer != nullptr);
+    traceProps.EventRecordCallback = GetEventRecordCallback(saveFirstTimestamp);
+    mEventRecordCallback = traceProps.EventRecordCallback;
+    AddEventHandlers(this, pmConsumer->mTrackDisplay, mrConsumer != nullptr);
 
     // When processing log files, we need to use the buffer callback in case
     // the user wants to stop processing before the entire log has been parsed.
@@ -459,6 +493,7 @@ ULONG TraceSession::Start(
         QueryPerformanceCounter(&mStartQpc);
     }
 
+    pmConsumer->SetQpcFrequency(mQpcFrequency.QuadPart);
     DebugInitialize(&mStartQpc, mQpcFrequency);
 
     return ERROR_SUCCESS;
@@ -493,6 +528,39 @@ void TraceSession::Stop()
     }
 }
 
+ULONG TraceSession::ProcessReplay()
+{
+    assert(mCaptureReader != nullptr);
+
+    EVENT_RECORD eventRecord = {};
+    eventRecord.UserContext = this;
+
+    // Metadata is added to the consumers directly, so that they never need to
+    // look it up using TDH.
+    EventCaptureRecord record;
+    while (mContinueProcessingBuffers && mCaptureReader->NextRecord(&record)) {
+        switch (record.type_) {
+        case EVENT_CAPTURE_RECORD_METADATA: {
+            EventMetadataKey key;
+            void const* traceEventInfo = nullptr;
+            uint32_t traceEventInfoSize = 0;
+            EventCaptureReader::GetMetadata(record, &key, &traceEventInfo, &traceEventInfoSize);
+            mPMConsumer->mMetadata.AddMetadata(key, traceEventInfo, traceEventInfoSize);
+            if (mMRConsumer != nullptr) {
+                mMRConsumer->mMetadata.AddMetadata(key, traceEventInfo, traceEventInfoSize);
+            }
+            break;
+        }
+        case EVENT_CAPTURE_RECORD_EVENT:
+            EventCaptureReader::GetEventRecord(record, &eventRecord);
+            mEventRecordCallback(&eventRecord);
+            break;
+        }
+    }
+
+    return mContinueProcessingBuffers ? ERROR_SUCCESS : ERROR_CANCELLED;
+}
+
 ULONG TraceSession::StopNamedSession(char const* sessionName)
 {
     TraceProperties sessionProps = {};
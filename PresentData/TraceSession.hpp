@@ -1,8 +1,15 @@
 // Copyright (C) 2020 Intel Corporation
 // SPDX-License-Identifier: MIT
 
+#include "ProviderDispatchTable.hpp"
+
 struct PMTraceConsumer;
 struct MRTraceConsumer;
+class EventCaptureReader;
+class EventCaptureWriter;
+struct TraceSession;
+
+typedef void (*TraceSessionEventHandler)(TraceSession* session, EVENT_RECORD* pEventRecord);
 
 struct TraceSession {
     LARGE_INTEGER mStartQpc = {};
@@ -12,7 +19,16 @@ struct TraceSession {
     TRACEHANDLE mSessionHandle = 0;                         // invalid session handles are 0
     TRACEHANDLE mTraceHandle = INVALID_PROCESSTRACE_HANDLE; // invalid trace handles are INVALID_PROCESSTRACE_HANDLE
     ULONG mContinueProcessingBuffers = TRUE;
+    PEVENT_RECORD_CALLBACK mEventRecordCallback = nullptr;
+    ProviderDispatchTable<TraceSessionEventHandler> mEventHandlers; // Handler for each enabled provider, set by Start()
+    EventCaptureReader* mCaptureReader = nullptr;           // Non-null when replaying an event capture
+    EventCaptureWriter* mCaptureWriter = nullptr;           // If set, all consumed events are also written to this capture
 
+    ~TraceSession();
+
+    // If etlPath is an event capture file (see EventCapture.hpp) rather than
+    // an ETL, the capture is loaded and ProcessReplay() must be used instead of
+    // ProcessTrace(mTraceHandle) to consume the events.
     ULONG Start(
         PMTraceConsumer* pmConsumer, // Required PMTraceConsumer instance
         MRTraceConsumer* mrConsumer, // If nullptr, no WinMR tracing
@@ -21,6 +37,11 @@ struct TraceSession {
 
     void Stop();
 
+    // Dispatch all events in the loaded capture to the consumers, using the
+    // same event routing as ETW.  Like ProcessTrace(), this blocks until all
+    // events are consumed or Stop() is called.
+    ULONG ProcessReplay();
+
     ULONG CheckLostReports(ULONG* eventsLost, ULONG* buffersLost) const;
     static ULONG StopNamedSession(char const* sessionName);
 };
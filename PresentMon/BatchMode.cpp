@@ -0,0 +1,241 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+
+#include "PresentMon.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+// Batch mode analyzes many ETL or event capture files, each with its own CSV
+// output.  The trace session, consumers, and output state are process-wide, so
+// each input is analyzed by a separate PresentMon process launched with
+// -etl_file.  A fixed number of worker threads each run one of those processes
+// at a time, so the analysis of independent inputs scales with the number of
+// cores.
+
+namespace {
+
+struct BatchJob {
+    std::string mInputPath;
+    std::string mOutputPath;
+    uint64_t mInputSize;
+};
+
+std::vector<BatchJob> gJobs;
+std::atomic<size_t> gNextJob;
+std::mutex gPrintMutex;
+size_t gCompletedJobCount;
+size_t gFailedJobCount;
+
+bool HasWildcard(char const* path)
+{
+    return strpbrk(path, "*?") != nullptr;
+}
+
+// Returns the offset of the file name within path.
+size_t FileNameOffset(std::string const& path)
+{
+    auto i = path.find_last_of("\\/:");
+    return i == std::string::npos ? 0 : i + 1;
+}
+
+// Add a job for each file matching pattern.  Returns false if nothing matches.
+bool AddJobs(char const* pattern)
+{
+    WIN32_FIND_DATAA findData = {};
+    auto h = FindFirstFileA(pattern, &findData);
+    if (h == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    std::string dir(pattern, FileNameOffset(pattern));
+    auto added = false;
+    do {
+        if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+            BatchJob job;
+            job.mInputPath = dir + findData.cFileName;
+            job.mInputSize = ((uint64_t) findData.nFileSizeHigh << 32) | findData.nFileSizeLow;
+            gJobs.emplace_back(job);
+            added = true;
+        }
+    } while (FindNextFileA(h, &findData));
+    FindClose(h);
+
+    return added;
+}
+
+// The CSV for each input is written into the -output_file directory if one was
+// provided, or next to the input otherwise, named after the input with a .csv
+// extension (or .pmcf if -columnar is used).  If -compress is used, the child
+// process appends .pmz to this path.
+std::string GetOutputPath(std::string const& inputPath, char const* outputDir)
+{
+    auto nameOffset = FileNameOffset(inputPath);
+    auto extOffset = inputPath.find_last_of('.');
+    if (extOffset == std::string::npos || extOffset < nameOffset) {
+        extOffset = inputPath.size();
+    }
+
+    std::string path;
+    if (outputDir == nullptr) {
+        path = inputPath.substr(0, extOffset);
+    } else {
+        path = outputDir;
+        if (!path.empty() && path.back() != '\\' && path.back() != '/') {
+            path += '\\';
+        }
+        path += inputPath.substr(nameOffset, extOffset - nameOffset);
+    }
+    path += GetCommandLineArgs().mOutputColumnar ? ".pmcf" : ".csv";
+    return path;
+}
+
+// Run PresentMon on one input and wait for it to complete.  The child's stdout
+// is discarded, but its stderr is shared with this process so that errors and
+// warnings are still reported.  Returns the child's exit code.
+DWORD RunJob(char const* exePath, BatchJob const& job)
+{
+    auto const& args = GetCommandLineArgs();
+
+    std::string commandLine;
+    commandLine += '\"';
+    commandLine += exePath;
+    commandLine += "\" ";
+    commandLine += args.mBatchArgs;
+    commandLine += "-no_top -etl_file \"";
+    commandLine += job.mInputPath;
+    commandLine += "\" -output_file \"";
+    commandLine += job.mOutputPath;
+    commandLine += '\"';
+
+    SECURITY_ATTRIBUTES sa = {};
+    sa.nLength = sizeof(sa);
+    sa.bInheritHandle = TRUE;
+    auto nul = CreateFileA("NUL", GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, &sa, OPEN_EXISTING, 0, NULL);
+
+    STARTUPINFOA si = {};
+    si.cb = sizeof(si);
+    si.dwFlags = STARTF_USESTDHANDLES;
+    si.hStdInput = NULL;
+    si.hStdOutput = nul;
+    si.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+
+    DWORD code = 2;
+    PROCESS_INFORMATION pi = {};
+    if (CreateProcessA(exePath, &commandLine[0], NULL, NULL, TRUE, 0, NULL, NULL, &si, &pi)) {
+        WaitForSingleObject(pi.hProcess, INFINITE);
+        GetExitCodeProcess(pi.hProcess, &code);
+        CloseHandle(pi.hThread);
+        CloseHandle(pi.hProcess);
+    } else {
+        std::lock_guard<std::mutex> lock(gPrintMutex);
+        fprintf(stderr, "error: failed to start PresentMon for %s (%lu).\n", job.mInputPath.c_str(), GetLastError());
+    }
+
+    if (nul != INVALID_HANDLE_VALUE) {
+        CloseHandle(nul);
+    }
+
+    return code;
+}
+
+void Worker(char const* exePath)
+{
+    for (;;) {
+        auto jobIndex = gNextJob.fetch_add(1);
+        if (jobIndex >= gJobs.size()) {
+            break;
+        }
+
+        auto const& job = gJobs[jobIndex];
+        auto code = RunJob(exePath, job);
+
+        std::lock_guard<std::mutex> lock(gPrintMutex);
+        gCompletedJobCount += 1;
+        if (code == 0) {
+            printf("[%zu/%zu] %s\n", gCompletedJobCount, gJobs.size(), job.mOutputPath.c_str());
+        } else {
+            gFailedJobCount += 1;
+            printf("[%zu/%zu] %s: failed (exit code %lu)\n", gCompletedJobCount, gJobs.size(), job.mInputPath.c_str(), code);
+        }
+        fflush(stdout);
+    }
+}
+
+}
+
+int RunBatch()
+{
+    auto const& args = GetCommandLineArgs();
+
+    // Expand the inputs.
+    for (auto pattern : args.mBatchInputs) {
+        if (!AddJobs(pattern)) {
+            fprintf(stderr, HasWildcard(pattern)
+                ? "warning: no files match -batch %s\n"
+                : "warning: -batch file not found: %s\n", pattern);
+        }
+    }
+
+    // Remove inputs that were matched more than once.
+    std::sort(gJobs.begin(), gJobs.end(), [](BatchJob const& a, BatchJob const& b) {
+        return _stricmp(a.mInputPath.c_str(), b.mInputPath.c_str()) < 0;
+    });
+    gJobs.erase(std::unique(gJobs.begin(), gJobs.end(), [](BatchJob const& a, BatchJob const& b) {
+        return _stricmp(a.mInputPath.c_str(), b.mInputPath.c_str()) == 0;
+    }), gJobs.end());
+
+    if (gJobs.empty()) {
+        fprintf(stderr, "error: no -batch input files found.\n");
+        return 8;
+    }
+
+    // Make sure no two inputs write to the same CSV, which can happen when
+    // inputs from different directories share a name and are written into the
+    // same -output_file directory.
+    for (auto& job : gJobs) {
+        job.mOutputPath = GetOutputPath(job.mInputPath, args.mOutputCsvFileName);
+    }
+    for (size_t i = 0; i < gJobs.size(); ++i) {
+        for (size_t j = i + 1; j < gJobs.size(); ++j) {
+            if (_stricmp(gJobs[i].mOutputPath.c_str(), gJobs[j].mOutputPath.c_str()) == 0) {
+                fprintf(stderr, "error: -batch inputs %s and %s would both be written to %s.\n",
+                    gJobs[i].mInputPath.c_str(), gJobs[j].mInputPath.c_str(), gJobs[i].mOutputPath.c_str());
+                return 8;
+            }
+        }
+    }
+
+    // Start the largest inputs first so that a large input started last
+    // doesn't leave the other workers idle at the end of the batch.
+    std::stable_sort(gJobs.begin(), gJobs.end(), [](BatchJob const& a, BatchJob const& b) {
+        return a.mInputSize > b.mInputSize;
+    });
+
+    size_t workerCount = args.mBatchJobs != 0 ? args.mBatchJobs : std::thread::hardware_concurrency();
+    workerCount = std::max<size_t>(1, std::min(workerCount, gJobs.size()));
+
+    char exePath[MAX_PATH] = {};
+    GetModuleFileNameA(NULL, exePath, sizeof(exePath));
+
+    printf("Analyzing %zu file(s) using %zu concurrent job(s).\n", gJobs.size(), workerCount);
+    fflush(stdout);
+
+    std::vector<std::thread> workers;
+    workers.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers.emplace_back(Worker, exePath);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    if (gFailedJobCount > 0) {
+        fprintf(stderr, "error: %zu of %zu file(s) failed.\n", gFailedJobCount, gJobs.size());
+        return 8;
+    }
+
+    return 0;
+}
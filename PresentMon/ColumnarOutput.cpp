@@ -0,0 +1,213 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+
+#include "ColumnarOutput.hpp"
+
+#include <assert.h>
+#include <string.h>
+
+namespace {
+
+void AppendBytes(std::vector<uint8_t>* v, void const* data, size_t size)
+{
+    auto p = static_cast<uint8_t const*>(data);
+    v->insert(v->end(), p, p + size);
+}
+
+void AlignTo8(std::vector<uint8_t>* v)
+{
+    v->resize((v->size() + 7) & ~(size_t) 7);
+}
+
+}
+
+ColumnarWriter::~ColumnarWriter()
+{
+    if (mFile != nullptr) {
+        Close();
+    }
+}
+
+void ColumnarWriter::AddColumn(char const* name, ColumnarType type)
+{
+    assert(mFile == nullptr);
+    assert(strlen(name) < COLUMNAR_NAME_SIZE);
+    assert(GetColumnarTypeSize(type) != 0);
+
+    Column column;
+    column.mName = name;
+    column.mType = type;
+    column.mData.reserve(COLUMNAR_CHUNK_ROW_COUNT * GetColumnarTypeSize(type));
+    column.mMin = 0;
+    column.mMax = 0;
+    column.mWrittenCount = 0;
+    mColumns.emplace_back(std::move(column));
+}
+
+void ColumnarWriter::Open(OutputFile* file, int64_t qpcFrequency, int64_t startQpc)
+{
+    assert(mFile == nullptr);
+    mFile = file;
+    mRowCount = 0;
+    mNextColumn = 0;
+
+    ColumnarFileHeader header = {};
+    header.Magic = COLUMNAR_MAGIC;
+    header.Version = COLUMNAR_VERSION;
+    header.QpcFrequency = qpcFrequency;
+    header.StartQpc = startQpc;
+    header.ColumnCount = (uint32_t) mColumns.size();
+    mFile->Write(&header, sizeof(header));
+
+    for (auto const& column : mColumns) {
+        ColumnarColumn desc = {};
+        desc.Type = column.mType;
+        memcpy(desc.Name, column.mName.c_str(), column.mName.size());
+        mFile->Write(&desc, sizeof(desc));
+    }
+}
+
+void ColumnarWriter::Close()
+{
+    if (mFile == nullptr) {
+        return;
+    }
+
+    assert(mNextColumn == 0);
+    if (mRowCount > 0) {
+        WriteDictionaries();
+        WriteChunk();
+    }
+
+    CloseOutputFile(mFile);
+    mFile = nullptr;
+}
+
+void ColumnarWriter::AppendValue(uint32_t column, uint64_t value)
+{
+    assert(column < mColumns.size());
+    auto& c = mColumns[column];
+
+    // Values are stored in their native width; on a little-endian machine
+    // that is the first GetColumnarTypeSize() bytes of the 64-bit value.
+    AppendBytes(&c.mData, &value, GetColumnarTypeSize(c.mType));
+
+    if (mRowCount == 0) {
+        c.mMin = value;
+        c.mMax = value;
+    } else if (IsColumnarTypeSigned(c.mType)) {
+        if ((int64_t) value < (int64_t) c.mMin) c.mMin = value;
+        if ((int64_t) value > (int64_t) c.mMax) c.mMax = value;
+    } else {
+        if (value < c.mMin) c.mMin = value;
+        if (value > c.mMax) c.mMax = value;
+    }
+
+    mNextColumn = column + 1;
+}
+
+void ColumnarWriter::AppendString(std::string const& value)
+{
+    auto& c = mColumns[mNextColumn];
+    assert(c.mType == COLUMNAR_TYPE_DICTIONARY);
+
+    auto ii = c.mDictionary.find(value);
+    if (ii == c.mDictionary.end()) {
+        ii = c.mDictionary.emplace(value, (uint32_t) c.mDictionary.size()).first;
+        c.mEntries.emplace_back(&ii->first);
+    }
+
+    AppendValue(mNextColumn, ii->second);
+}
+
+void ColumnarWriter::EndRow(uint64_t qpc)
+{
+    assert(mNextColumn == mColumns.size());
+    if (mRowCount == 0 || qpc < mMinQpc) {
+        mMinQpc = qpc;
+    }
+    if (mRowCount == 0 || qpc > mMaxQpc) {
+        mMaxQpc = qpc;
+    }
+    mNextColumn = 0;
+    mRowCount += 1;
+
+    if (mRowCount == COLUMNAR_CHUNK_ROW_COUNT) {
+        WriteDictionaries();
+        WriteChunk();
+    }
+}
+
+void ColumnarWriter::WriteRecord(ColumnarRecordType type)
+{
+    ColumnarRecordHeader header = {};
+    header.Type = type;
+    header.Size = (uint32_t) mRecord.size();
+    AlignTo8(&mRecord);
+
+    mFile->Write(&header, sizeof(header));
+    mFile->Write(mRecord.data(), mRecord.size());
+
+    mRecord.clear();
+}
+
+void ColumnarWriter::WriteDictionaries()
+{
+    // A new compressed block needs all of the entries (see
+    // ColumnarOutput.hpp).
+    auto rewriteAll = mFile->IsCompressed() && mFile->IsBufferEmpty();
+
+    for (uint32_t i = 0, n = (uint32_t) mColumns.size(); i < n; ++i) {
+        auto& c = mColumns[i];
+        auto firstIndex = rewriteAll ? 0 : c.mWrittenCount;
+        auto count = (uint32_t) c.mEntries.size() - firstIndex;
+        if (count == 0) {
+            continue;
+        }
+
+        ColumnarDictionary dictionary = {};
+        dictionary.Column = i;
+        dictionary.FirstIndex = firstIndex;
+        dictionary.Count = count;
+        AppendBytes(&mRecord, &dictionary, sizeof(dictionary));
+
+        for (uint32_t j = firstIndex; j < firstIndex + count; ++j) {
+            auto entry = c.mEntries[j];
+            auto length = (uint32_t) entry->size();
+            AppendBytes(&mRecord, &length, sizeof(length));
+            AppendBytes(&mRecord, entry->data(), length);
+        }
+        c.mWrittenCount = (uint32_t) c.mEntries.size();
+
+        WriteRecord(COLUMNAR_RECORD_DICTIONARY);
+    }
+}
+
+void ColumnarWriter::WriteChunk()
+{
+    ColumnarChunk chunk = {};
+    chunk.RowCount = mRowCount;
+    AppendBytes(&mRecord, &chunk, sizeof(chunk));
+
+    auto offset = sizeof(ColumnarChunk) + mColumns.size() * sizeof(ColumnarChunkColumn);
+    for (auto const& c : mColumns) {
+        ColumnarChunkColumn desc = {};
+        desc.Offset = offset;
+        desc.Size = c.mData.size();
+        desc.Min = c.mMin;
+        desc.Max = c.mMax;
+        AppendBytes(&mRecord, &desc, sizeof(desc));
+
+        offset += (c.mData.size() + 7) & ~(size_t) 7;
+    }
+
+    for (auto& c : mColumns) {
+        AppendBytes(&mRecord, c.mData.data(), c.mData.size());
+        AlignTo8(&mRecord);
+        c.mData.clear();
+    }
+
+    WriteRecord(COLUMNAR_RECORD_CHUNK);
+    mFile->EndRows(mRowCount, mMinQpc, mMaxQpc);
+    mRowCount = 0;
+}
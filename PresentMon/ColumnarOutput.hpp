@@ -0,0 +1,452 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "OutputWriter.hpp"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Columnar output is a binary alternative to the CSV output, enabled with
+// -columnar.  Frames are written in chunks of up to COLUMNAR_CHUNK_ROW_COUNT
+// rows, and each chunk stores every column contiguously as an array of fixed
+// size values, so a reader can memory-map the file and scan only the columns
+// it needs without parsing any text.
+//
+// File layout (little-endian):
+//
+//     ColumnarFileHeader
+//     ColumnarColumn[ColumnCount]
+//     Records...
+//
+// Each record is a ColumnarRecordHeader followed by Size bytes of payload,
+// padded with zeros to an 8-byte boundary:
+//
+//     COLUMNAR_RECORD_DICTIONARY: ColumnarDictionary, then Count strings
+//                                 each stored as a uint32_t length followed
+//                                 by that many (not null-terminated) chars
+//     COLUMNAR_RECORD_CHUNK:      ColumnarChunk, ColumnarChunkColumn[ColumnCount],
+//                                 then the column data
+//
+// Times are not converted to seconds or milliseconds: QPCTime is the
+// performance counter value of the Present() call, and the qpc* columns are
+// signed deltas in performance counter ticks.  Divide by
+// ColumnarFileHeader::QpcFrequency to convert them to seconds.
+//
+// String columns (COLUMNAR_TYPE_DICTIONARY) store a uint32_t index into the
+// column's dictionary.  A dictionary record adding the entries [FirstIndex,
+// FirstIndex + Count) is written before the first chunk that uses them.  If
+// the file is compressed (see CompressedOutput.hpp), every compressed block
+// starts with dictionary records that repeat all entries from index 0, so the
+// blocks can be read independently; readers should treat entries that are
+// added again as replacing the (identical) existing ones.
+//
+// In each chunk, ColumnarChunkColumn::Offset is relative to the start of the
+// chunk record's payload and is 8-byte aligned.  Min and Max are the smallest
+// and largest values in the chunk, widened to 64 bits (sign-extended for
+// signed types), so readers can skip chunks without touching their data.
+//
+// Readers must skip records with an unknown type, so new record types can be
+// added without changing COLUMNAR_VERSION.
+
+enum {
+    COLUMNAR_MAGIC           = 0x46434d50, // "PMCF"
+    COLUMNAR_VERSION         = 1,
+    COLUMNAR_CHUNK_ROW_COUNT = 8192,
+    COLUMNAR_NAME_SIZE       = 28,
+};
+
+enum ColumnarType : uint8_t {
+    COLUMNAR_TYPE_UINT8      = 1,
+    COLUMNAR_TYPE_INT32      = 2,
+    COLUMNAR_TYPE_UINT32     = 3,
+    COLUMNAR_TYPE_INT64      = 4,
+    COLUMNAR_TYPE_UINT64     = 5,
+    COLUMNAR_TYPE_DICTIONARY = 6,   // uint32_t dictionary index
+};
+
+enum ColumnarRecordType : uint32_t {
+    COLUMNAR_RECORD_DICTIONARY = 1,
+    COLUMNAR_RECORD_CHUNK      = 2,
+};
+
+struct ColumnarFileHeader {
+    uint32_t Magic;
+    uint32_t Version;
+    int64_t QpcFrequency;       // Timestamp frequency
+    int64_t StartQpc;           // Time that recording started
+    uint32_t ColumnCount;
+    uint32_t Reserved;
+};
+
+struct ColumnarColumn {
+    uint8_t Type;               // ColumnarType
+    uint8_t Reserved[3];
+    char Name[COLUMNAR_NAME_SIZE]; // Null-terminated
+};
+
+struct ColumnarRecordHeader {
+    uint32_t Type;              // ColumnarRecordType
+    uint32_t Size;              // Payload size, not including padding
+};
+
+struct ColumnarDictionary {
+    uint32_t Column;
+    uint32_t FirstIndex;
+    uint32_t Count;
+    uint32_t Reserved;
+};
+
+struct ColumnarChunk {
+    uint32_t RowCount;
+    uint32_t Reserved;
+};
+
+struct ColumnarChunkColumn {
+    uint64_t Offset;
+    uint64_t Size;
+    uint64_t Min;
+    uint64_t Max;
+};
+
+static_assert(sizeof(ColumnarFileHeader) == 32, "ColumnarFileHeader layout changed");
+static_assert(sizeof(ColumnarColumn) == 32, "ColumnarColumn layout changed");
+static_assert(sizeof(ColumnarRecordHeader) == 8, "ColumnarRecordHeader layout changed");
+static_assert(sizeof(ColumnarDictionary) == 16, "ColumnarDictionary layout changed");
+static_assert(sizeof(ColumnarChunk) == 8, "ColumnarChunk layout changed");
+static_assert(sizeof(ColumnarChunkColumn) == 32, "ColumnarChunkColumn layout changed");
+
+// The size of a ColumnarType value, or 0 if the type is unknown.
+inline uint32_t GetColumnarTypeSize(uint8_t type)
+{
+    switch (type) {
+    case COLUMNAR_TYPE_UINT8:      return 1;
+    case COLUMNAR_TYPE_INT32:      return 4;
+    case COLUMNAR_TYPE_UINT32:     return 4;
+    case COLUMNAR_TYPE_INT64:      return 8;
+    case COLUMNAR_TYPE_UINT64:     return 8;
+    case COLUMNAR_TYPE_DICTIONARY: return 4;
+    }
+    return 0;
+}
+
+inline bool IsColumnarTypeSigned(uint8_t type)
+{
+    return type == COLUMNAR_TYPE_INT32 || type == COLUMNAR_TYPE_INT64;
+}
+
+// ColumnarWriter buffers rows into column arrays and writes them out as a
+// chunk record when COLUMNAR_CHUNK_ROW_COUNT rows are buffered, or when the
+// writer is closed.  A row is written by calling Append*() once for every
+// column, in column order.
+class ColumnarWriter {
+    struct Column {
+        std::string mName;
+        ColumnarType mType;
+        std::vector<uint8_t> mData;
+        uint64_t mMin;
+        uint64_t mMax;
+
+        // Dictionary columns only
+        std::unordered_map<std::string, uint32_t> mDictionary;
+        std::vector<std::string const*> mEntries;   // mDictionary's keys, in index order
+        uint32_t mWrittenCount;                     // The number of mEntries written
+    };
+
+    OutputFile* mFile = nullptr;
+    std::vector<Column> mColumns;
+    std::vector<uint8_t> mRecord;
+    uint32_t mRowCount = 0;
+    uint32_t mNextColumn = 0;
+    uint64_t mMinQpc = 0;       // Earliest and latest QPCTime of the chunk's rows
+    uint64_t mMaxQpc = 0;
+
+    void AppendValue(uint32_t column, uint64_t value);
+    void WriteRecord(ColumnarRecordType type);
+    void WriteDictionaries();
+    void WriteChunk();
+
+public:
+    ColumnarWriter() = default;
+    ~ColumnarWriter();
+
+    ColumnarWriter(ColumnarWriter const&) = delete;
+    ColumnarWriter& operator=(ColumnarWriter const&) = delete;
+
+    void AddColumn(char const* name, ColumnarType type);
+
+    // Takes ownership of file, which must have been opened in binary mode,
+    // and writes the file header.  All columns must be added before calling
+    // Open().
+    void Open(OutputFile* file, int64_t qpcFrequency, int64_t startQpc);
+
+    // Writes any buffered rows and closes the file (see CloseOutputFile()).
+    void Close();
+
+    void AppendUInt8(uint8_t value)   { AppendValue(mNextColumn, value); }
+    void AppendInt32(int32_t value)   { AppendValue(mNextColumn, (uint64_t) (int64_t) value); }
+    void AppendUInt32(uint32_t value) { AppendValue(mNextColumn, value); }
+    void AppendInt64(int64_t value)   { AppendValue(mNextColumn, (uint64_t) value); }
+    void AppendUInt64(uint64_t value) { AppendValue(mNextColumn, value); }
+    void AppendString(std::string const& value);
+
+    // Completes the current row, whose QPCTime is qpc.
+    void EndRow(uint64_t qpc);
+};
+
+// ColumnarFileReader reads a columnar output file one chunk at a time,
+// applying the dictionary records that precede each chunk.  A -compress
+// output must be decompressed first (see CompressedFileReader).
+class ColumnarFileReader {
+    std::vector<uint64_t> mData;    // Entire file, as uint64_t so that records are 8-byte aligned
+    size_t mSize = 0;               // File size in bytes
+    size_t mOffset = 0;             // Offset of the next record
+    bool mCorrupt = false;
+    std::vector<std::vector<std::string>> mDictionaries;
+
+    // The current chunk
+    uint8_t const* mChunk = nullptr;
+    uint32_t mRowCount = 0;
+
+    uint8_t const* GetBytes() const { return (uint8_t const*) mData.data(); }
+
+    static size_t PaddedSize(size_t size) { return (size + 7) & ~(size_t) 7; }
+
+    bool ReadDictionary(uint8_t const* payload, uint32_t size)
+    {
+        ColumnarDictionary dictionary = {};
+        if (size < sizeof(dictionary)) {
+            return false;
+        }
+        memcpy(&dictionary, payload, sizeof(dictionary));
+
+        // Entries must be added in order, but may be added again (see
+        // ColumnarOutput.hpp).
+        if (dictionary.Column >= GetHeader().ColumnCount ||
+            GetColumn(dictionary.Column).Type != COLUMNAR_TYPE_DICTIONARY ||
+            dictionary.FirstIndex > mDictionaries[dictionary.Column].size()) {
+            return false;
+        }
+
+        auto& entries = mDictionaries[dictionary.Column];
+        if (entries.size() - dictionary.FirstIndex < dictionary.Count) {
+            entries.resize(dictionary.FirstIndex + dictionary.Count);
+        }
+
+        size_t offset = sizeof(dictionary);
+        for (uint32_t i = 0; i < dictionary.Count; ++i) {
+            uint32_t length = 0;
+            if (size - offset < sizeof(length)) {
+                return false;
+            }
+            memcpy(&length, payload + offset, sizeof(length));
+            offset += sizeof(length);
+            if (size - offset < length) {
+                return false;
+            }
+            entries[dictionary.FirstIndex + i].assign((char const*) payload + offset, length);
+            offset += length;
+        }
+        return true;
+    }
+
+    bool ReadChunk(uint8_t const* payload, uint32_t size)
+    {
+        auto columnCount = GetHeader().ColumnCount;
+        auto headerSize = sizeof(ColumnarChunk) + (size_t) columnCount * sizeof(ColumnarChunkColumn);
+        if (size < headerSize) {
+            return false;
+        }
+
+        auto rowCount = ((ColumnarChunk const*) payload)->RowCount;
+        auto columns = (ColumnarChunkColumn const*) (payload + sizeof(ColumnarChunk));
+        for (uint32_t i = 0; i < columnCount; ++i) {
+            auto const& column = columns[i];
+            if (column.Offset < headerSize ||
+                column.Offset % 8 != 0 ||
+                column.Offset > size ||
+                column.Size > size - column.Offset ||
+                column.Size != (uint64_t) rowCount * GetColumnarTypeSize(GetColumn(i).Type)) {
+                return false;
+            }
+        }
+
+        mChunk = payload;
+        mRowCount = rowCount;
+
+        // Every dictionary index must refer to an entry that has been added.
+        for (uint32_t i = 0; i < columnCount; ++i) {
+            if (GetColumn(i).Type == COLUMNAR_TYPE_DICTIONARY) {
+                for (uint32_t row = 0; row < rowCount; ++row) {
+                    if (GetValue(i, row) >= mDictionaries[i].size()) {
+                        mChunk = nullptr;
+                        mRowCount = 0;
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+public:
+    ColumnarFileReader() = default;
+
+    ColumnarFileReader(ColumnarFileReader const&) = delete;
+    ColumnarFileReader& operator=(ColumnarFileReader const&) = delete;
+
+    // Reads the entire file into memory.  Returns false if the file can't be
+    // read or doesn't start with a valid columnar file header.
+    bool Open(char const* path)
+    {
+        FILE* fp = nullptr;
+#ifdef _WIN32
+        fopen_s(&fp, path, "rb");
+#else
+        fp = fopen(path, "rb");
+#endif
+        if (fp == nullptr) {
+            return false;
+        }
+
+        std::vector<uint8_t> data;
+        uint8_t buffer[64 * 1024];
+        for (size_t n; (n = fread(buffer, 1, sizeof(buffer), fp)) > 0; ) {
+            data.insert(data.end(), buffer, buffer + n);
+        }
+        fclose(fp);
+
+        return Open(data.data(), data.size());
+    }
+
+    // Reads a file from memory (e.g., decompressed by CompressedFileReader),
+    // which is copied.
+    bool Open(void const* data, size_t size)
+    {
+        mData.assign((size + 7) / 8, 0);
+        memcpy(mData.data(), data, size);
+        mSize = size;
+        mCorrupt = false;
+        mChunk = nullptr;
+        mRowCount = 0;
+        mDictionaries.clear();
+
+        if (size < sizeof(ColumnarFileHeader) ||
+            GetHeader().Magic != COLUMNAR_MAGIC ||
+            GetHeader().Version != COLUMNAR_VERSION ||
+            GetHeader().ColumnCount > (size - sizeof(ColumnarFileHeader)) / sizeof(ColumnarColumn)) {
+            mSize = 0;
+            return false;
+        }
+
+        for (uint32_t i = 0, n = GetHeader().ColumnCount; i < n; ++i) {
+            auto const& column = GetColumn(i);
+            if (GetColumnarTypeSize(column.Type) == 0 ||
+                memchr(column.Name, '\0', sizeof(column.Name)) == nullptr) {
+                mSize = 0;
+                return false;
+            }
+        }
+
+        mOffset = sizeof(ColumnarFileHeader) + GetHeader().ColumnCount * sizeof(ColumnarColumn);
+        mDictionaries.resize(GetHeader().ColumnCount);
+        return true;
+    }
+
+    ColumnarFileHeader const& GetHeader() const { return *(ColumnarFileHeader const*) mData.data(); }
+
+    ColumnarColumn const& GetColumn(uint32_t column) const
+    {
+        return ((ColumnarColumn const*) (GetBytes() + sizeof(ColumnarFileHeader)))[column];
+    }
+
+    // Returns the index of the column named name, or UINT32_MAX if there is
+    // no such column.
+    uint32_t FindColumn(char const* name) const
+    {
+        for (uint32_t i = 0, n = GetHeader().ColumnCount; i < n; ++i) {
+            if (strcmp(GetColumn(i).Name, name) == 0) {
+                return i;
+            }
+        }
+        return UINT32_MAX;
+    }
+
+    // Reads up to and including the next chunk record.  Returns false at the
+    // end of the file, or if the rest of the file is corrupt (see
+    // IsCorrupt()).
+    bool NextChunk()
+    {
+        mChunk = nullptr;
+        mRowCount = 0;
+
+        while (!mCorrupt && mOffset < mSize) {
+            ColumnarRecordHeader header = {};
+            if (mSize - mOffset < sizeof(header)) {
+                mCorrupt = true;
+                break;
+            }
+            memcpy(&header, GetBytes() + mOffset, sizeof(header));
+
+            auto payloadOffset = mOffset + sizeof(header);
+            if (PaddedSize(header.Size) > mSize - payloadOffset) {
+                mCorrupt = true;
+                break;
+            }
+            auto payload = GetBytes() + payloadOffset;
+            mOffset = payloadOffset + PaddedSize(header.Size);
+
+            // Records with an unknown type are skipped.
+            switch (header.Type) {
+            case COLUMNAR_RECORD_DICTIONARY:
+                mCorrupt = !ReadDictionary(payload, header.Size);
+                break;
+            case COLUMNAR_RECORD_CHUNK:
+                mCorrupt = !ReadChunk(payload, header.Size);
+                if (!mCorrupt) {
+                    return true;
+                }
+                break;
+            }
+        }
+        return false;
+    }
+
+    // Whether NextChunk() stopped because of a truncated or invalid record.
+    bool IsCorrupt() const { return mCorrupt; }
+
+    // The current chunk's rows and column descriptions.
+    uint32_t GetRowCount() const { return mRowCount; }
+
+    ColumnarChunkColumn const& GetChunkColumn(uint32_t column) const
+    {
+        return ((ColumnarChunkColumn const*) (mChunk + sizeof(ColumnarChunk)))[column];
+    }
+
+    // Returns a value of the current chunk, widened to 64 bits like
+    // ColumnarChunkColumn::Min and Max.  Dictionary columns return the index.
+    uint64_t GetValue(uint32_t column, uint32_t row) const
+    {
+        auto type = GetColumn(column).Type;
+        auto size = GetColumnarTypeSize(type);
+        auto p = mChunk + GetChunkColumn(column).Offset + (size_t) row * size;
+
+        uint64_t value = 0;
+        memcpy(&value, p, size);
+        if (IsColumnarTypeSigned(type) && size < sizeof(value) && (value >> (8 * size - 1)) != 0) {
+            value |= ~0ull << (8 * size);
+        }
+        return value;
+    }
+
+    // Returns the string of a dictionary column in the current chunk.
+    std::string const& GetString(uint32_t column, uint32_t row) const
+    {
+        return mDictionaries[column][(size_t) GetValue(column, row)];
+    }
+};
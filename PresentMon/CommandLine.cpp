@@ -317,12 +317,19 @@ bool ParseCommandLine(int argc, char** argv)
 
     args->mTargetProcessNames.clear();
     args->mExcludeProcessNames.clear();
+    args->mBatchInputs.clear();
+    args->mBatchArgs.clear();
     args->mOutputCsvFileName = nullptr;
     args->mEtlFileName = nullptr;
+    args->mCaptureFileName = nullptr;
     args->mSessionName = "PresentMon";
     args->mTargetPid = 0;
     args->mDelay = 0;
     args->mTimer = 0;
+    args->mOutputLatency = 1;
+    args->mRotateSizeMB = 0;
+    args->mRotateInterval = 0;
+    args->mBatchJobs = 0;
     args->mHotkeyModifiers = MOD_NOREPEAT;
     args->mHotkeyVirtualKeyCode = 0;
     args->mTrackDisplay = true;
@@ -332,6 +339,8 @@ bool ParseCommandLine(int argc, char** argv)
     args->mOutputCsvToStdout = false;
     args->mOutputQpcTime = false;
     args->mOutputQpcTimeInSeconds = false;
+    args->mOutputColumnar = false;
+    args->mOutputCompressed = false;
     args->mScrollLockIndicator = false;
     args->mExcludeDropped = false;
     args->mConsoleOutputType = ConsoleOutput::Full;
@@ -355,15 +364,22 @@ bool ParseCommandLine(int argc, char** argv)
         else if (ParseArg(argv[i], "exclude"))      { if (ParseValue(argv, argc, &i, &args->mExcludeProcessNames)) continue; }
         else if (ParseArg(argv[i], "process_id"))   { if (ParseValue(argv, argc, &i, &args->mTargetPid))           continue; }
         else if (ParseArg(argv[i], "etl_file"))     { if (ParseValue(argv, argc, &i, &args->mEtlFileName))         continue; }
+        else if (ParseArg(argv[i], "batch"))        { if (ParseValue(argv, argc, &i, &args->mBatchInputs))         continue; }
 
         // Output options:
         else if (ParseArg(argv[i], "output_file"))   { if (ParseValue(argv, argc, &i, &args->mOutputCsvFileName)) continue; }
         else if (ParseArg(argv[i], "output_stdout")) { args->mOutputCsvToStdout      = true;                  continue; }
         else if (ParseArg(argv[i], "multi_csv"))     { args->mMultiCsv               = true;                  continue; }
         else if (ParseArg(argv[i], "no_csv"))        { args->mOutputCsvToFile        = false;                 continue; }
+        else if (ParseArg(argv[i], "columnar"))      { args->mOutputColumnar         = true;                  continue; }
+        else if (ParseArg(argv[i], "compress"))      { args->mOutputCompressed       = true;                  continue; }
+        else if (ParseArg(argv[i], "rotate_size"))     { if (ParseValue(argv, argc, &i, &args->mRotateSizeMB))   continue; }
+        else if (ParseArg(argv[i], "rotate_interval")) { if (ParseValue(argv, argc, &i, &args->mRotateInterval)) continue; }
         else if (ParseArg(argv[i], "no_top"))        { args->mConsoleOutputType      = ConsoleOutput::Simple; continue; }
         else if (ParseArg(argv[i], "qpc_time"))      { args->mOutputQpcTime          = true;                  continue; }
         else if (ParseArg(argv[i], "qpc_time_s"))    { args->mOutputQpcTimeInSeconds = true;                  continue; }
+        else if (ParseArg(argv[i], "output_latency")) { if (ParseValue(argv, argc, &i, &args->mOutputLatency)) continue; }
+        else if (ParseArg(argv[i], "capture_file"))   { if (ParseValue(argv, argc, &i, &args->mCaptureFileName)) continue; }
 
         // Recording options:
         else if (ParseArg(argv[i], "hotkey"))           { if (ParseValue(argv, argc, &i) && AssignHotkey(argv[i], args)) continue; }
@@ -384,6 +400,7 @@ bool ParseCommandLine(int argc, char** argv)
         else if (ParseArg(argv[i], "restart_as_admin"))       { args->mTryToElevate        = true; continue; }
         else if (ParseArg(argv[i], "terminate_on_proc_exit")) { args->mTerminateOnProcExit = true; continue; }
         else if (ParseArg(argv[i], "terminate_after_timed"))  { args->mTerminateAfterTimer = true; continue; }
+        else if (ParseArg(argv[i], "batch_jobs"))             { if (ParseValue(argv, argc, &i, &args->mBatchJobs)) continue; }
 
         // Beta options:
         else if (ParseArg(argv[i], "track_mixed_reality"))   { args->mTrackWMR = true; continue; }
@@ -445,7 +462,8 @@ bool ParseCommandLine(int argc, char** argv)
     }
 
     // If -no_csv is used, ignore -qpc_time, -qpc_time_s, -multi_csv,
-    // -output_file, or -output_stdout if they are also used.
+    // -output_file, -output_stdout, -columnar, -compress, -rotate_size, or
+    // -rotate_interval if they are also used.
     if (!args->mOutputCsvToFile) {
         if (args->mOutputQpcTime) {
             fprintf(stderr, "warning: -qpc_time and -qpc_time_s are only relevant for CSV output; ignoring due to -no_csv.\n");
@@ -464,6 +482,34 @@ bool ParseCommandLine(int argc, char** argv)
             fprintf(stderr, "warning: -output_stdout and -no_csv arguments are not compatible; ignoring -output_stdout.\n");
             args->mOutputCsvToStdout = false;
         }
+        if (args->mOutputColumnar) {
+            fprintf(stderr, "warning: -columnar and -no_csv arguments are not compatible; ignoring -columnar.\n");
+            args->mOutputColumnar = false;
+        }
+        if (args->mOutputCompressed) {
+            fprintf(stderr, "warning: -compress and -no_csv arguments are not compatible; ignoring -compress.\n");
+            args->mOutputCompressed = false;
+        }
+        if (args->mRotateSizeMB != 0 || args->mRotateInterval != 0) {
+            fprintf(stderr, "warning: -rotate_size and -rotate_interval are only relevant for CSV output; ignoring due to -no_csv.\n");
+            args->mRotateSizeMB = 0;
+            args->mRotateInterval = 0;
+        }
+    }
+
+    // The columnar output is binary and always contains QPCTime, so it can't
+    // be written to stdout and -qpc_time and -qpc_time_s don't apply.
+    if (args->mOutputColumnar) {
+        if (args->mOutputCsvToStdout) {
+            fprintf(stderr, "error: -columnar and -output_stdout arguments are not compatible.\n");
+            PrintHelp();
+            return false;
+        }
+        if (args->mOutputQpcTime) {
+            fprintf(stderr, "warning: -qpc_time and -qpc_time_s are only relevant for CSV output; ignoring due to -columnar.\n");
+            args->mOutputQpcTime = false;
+            args->mOutputQpcTimeInSeconds = false;
+        }
     }
 
     // If we're outputing CSV to stdout, we can't use it for console output.
@@ -471,7 +517,8 @@ bool ParseCommandLine(int argc, char** argv)
     // Further, we're currently limited to outputing CSV to either file(s) or
     // stdout, so disallow use of both -output_file and -output_stdout.  Also,
     // since -output_stdout redirects all CSV output to stdout ignore
-    // -multi_csv or -track_mixed_reality in this case.
+    // -multi_csv, -track_mixed_reality, -compress, -rotate_size, or
+    // -rotate_interval in this case.
     if (args->mOutputCsvToStdout) {
         args->mConsoleOutputType = ConsoleOutput::None; // No warning needed if user used -no_top, just swap out Simple for None
 
@@ -490,6 +537,57 @@ bool ParseCommandLine(int argc, char** argv)
             fprintf(stderr, "warning: -track_mixed_reality and -output_stdout are not compatible; ignoring -track_mixed_reality.\n");
             args->mTrackWMR = false;
         }
+
+        if (args->mOutputCompressed) {
+            fprintf(stderr, "warning: -compress and -output_stdout are not compatible; ignoring -compress.\n");
+            args->mOutputCompressed = false;
+        }
+
+        if (args->mRotateSizeMB != 0 || args->mRotateInterval != 0) {
+            fprintf(stderr, "warning: -rotate_size and -rotate_interval are not compatible with -output_stdout; ignoring them.\n");
+            args->mRotateSizeMB = 0;
+            args->mRotateInterval = 0;
+        }
+    }
+
+    // In batch mode, each input is analyzed by a separate PresentMon process
+    // (see BatchMode.cpp) which is passed all the arguments that aren't
+    // specific to batch mode.  The batch process itself only reports progress.
+    if (!args->mBatchInputs.empty()) {
+        if (args->mEtlFileName != nullptr ||
+            args->mCaptureFileName != nullptr ||
+            args->mOutputCsvToStdout ||
+            !args->mOutputCsvToFile ||
+            args->mHotkeySupport) {
+            fprintf(stderr, "error: -batch cannot be used with -etl_file, -capture_file, -output_stdout, -no_csv, or -hotkey.\n");
+            PrintHelp();
+            return false;
+        }
+
+        for (int i = 1; i < argc; ++i) {
+            if (ParseArg(argv[i], "batch") ||
+                ParseArg(argv[i], "batch_jobs") ||
+                ParseArg(argv[i], "output_file")) {
+                i += 1;
+                continue;
+            }
+            if (ParseArg(argv[i], "no_top") ||
+                ParseArg(argv[i], "restart_as_admin")) {
+                continue;
+            }
+
+            auto addQuotes = argv[i][0] != '\"' && strchr(argv[i], ' ') != nullptr;
+            if (addQuotes) {
+                args->mBatchArgs += '\"';
+            }
+            args->mBatchArgs += argv[i];
+            if (addQuotes) {
+                args->mBatchArgs += '\"';
+            }
+            args->mBatchArgs += ' ';
+        }
+
+        args->mConsoleOutputType = ConsoleOutput::Simple;
     }
 
     // Try to initialize the console, and warn if we're not going to be able to
@@ -513,12 +611,18 @@ bool ParseCommandLine(int argc, char** argv)
         args->mTargetPid != 0 ||
         args->mEtlFileName != nullptr ||
         args->mOutputCsvFileName != nullptr ||
+        args->mCaptureFileName != nullptr ||
+        !args->mBatchInputs.empty() ||
         args->mOutputCsvToStdout ||
         args->mMultiCsv ||
         args->mOutputCsvToFile == false ||
         args->mConsoleOutputType == ConsoleOutput::Simple ||
         args->mOutputQpcTime ||
         args->mOutputQpcTimeInSeconds ||
+        args->mOutputColumnar ||
+        args->mOutputCompressed ||
+        args->mRotateSizeMB != 0 ||
+        args->mRotateInterval != 0 ||
         args->mHotkeySupport ||
         args->mDelay != 0 ||
         args->mTimer != 0 ||
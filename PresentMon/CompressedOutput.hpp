@@ -0,0 +1,430 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// Compressed output is enabled with -compress, and wraps either the CSV or
+// the columnar output (see ColumnarOutput.hpp).  The output is split into
+// blocks of about COMPRESSED_BLOCK_SIZE uncompressed bytes, always ending at
+// a row boundary, and each block is compressed independently by the writer
+// thread (see OutputWriter.hpp), so a reader can decompress any block without
+// the ones before it.
+//
+// File layout (little-endian):
+//
+//     CompressedFileHeader
+//     Blocks...
+//     CompressedIndexEntry[BlockCount]
+//     CompressedFooter
+//
+// Each block is a CompressedBlockHeader followed by CompressedSize bytes of
+// data.  The data is in the LZ4 block format
+// (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md), or stored
+// uncompressed if COMPRESSED_BLOCK_STORED is set in Flags.
+//
+// Each block header records the number of rows in the block, and the
+// earliest and latest QPCTime of its rows, so a reader can find the blocks
+// covering a time range and only decompress those.  Presents are output when
+// they complete, so the rows are only approximately in QPCTime order and
+// adjacent blocks' time ranges can overlap.  The footer's index repeats the block
+// headers along with their file offsets, so they can be found without reading
+// the whole file.  If the file wasn't closed (e.g., PresentMon was
+// terminated) there is no footer, but the blocks can still be found by
+// reading their headers in sequence.
+//
+// The first block also contains the output's header (the CSV column names, or
+// the columnar file header), and a CSV header doesn't count as a row.  In
+// columnar output, every block contains whole chunk records and the
+// dictionary entries they use.
+
+enum {
+    COMPRESSED_MAGIC         = 0x465a4d50, // "PMZF"
+    COMPRESSED_FOOTER_MAGIC  = 0x585a4d50, // "PMZX"
+    COMPRESSED_VERSION       = 1,
+    COMPRESSED_BLOCK_SIZE    = 256 * 1024,
+    COMPRESSED_BLOCK_STORED  = 0x1,
+};
+
+struct CompressedFileHeader {
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t BlockSize;         // Target uncompressed block size
+    uint32_t Reserved;
+};
+
+struct CompressedBlockHeader {
+    uint32_t CompressedSize;
+    uint32_t UncompressedSize;
+    uint32_t RowCount;
+    uint32_t Flags;
+    uint64_t MinQpc;            // Earliest QPCTime of the block's rows, or 0 if RowCount is 0
+    uint64_t MaxQpc;            // Latest QPCTime of the block's rows, or 0 if RowCount is 0
+};
+
+struct CompressedIndexEntry {
+    uint64_t Offset;            // File offset of the CompressedBlockHeader
+    CompressedBlockHeader Block;
+};
+
+struct CompressedFooter {
+    uint64_t IndexOffset;       // File offset of the first CompressedIndexEntry
+    uint32_t BlockCount;
+    uint32_t Magic;             // COMPRESSED_FOOTER_MAGIC
+};
+
+static_assert(sizeof(CompressedFileHeader) == 16, "CompressedFileHeader layout changed");
+static_assert(sizeof(CompressedBlockHeader) == 32, "CompressedBlockHeader layout changed");
+static_assert(sizeof(CompressedIndexEntry) == 40, "CompressedIndexEntry layout changed");
+static_assert(sizeof(CompressedFooter) == 16, "CompressedFooter layout changed");
+
+namespace BlockCompression {
+
+enum {
+    HASH_BITS     = 14,
+    MIN_MATCH     = 4,
+    MF_LIMIT      = 12,     // A match can't start within this many bytes of the end
+    LAST_LITERALS = 5,      // The last bytes are always literals
+    MAX_OFFSET    = 65535,
+};
+
+// The largest compressed size of size bytes.
+inline size_t GetBound(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+inline uint32_t Read32(uint8_t const* p)
+{
+    uint32_t v = 0;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t Hash(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+inline uint8_t* WriteLength(uint8_t* op, size_t length)
+{
+    for (; length >= 255; length -= 255) {
+        *op++ = 255;
+    }
+    *op++ = (uint8_t) length;
+    return op;
+}
+
+inline uint8_t* WriteSequence(uint8_t* op, uint8_t const* literals, size_t literalCount, uint32_t offset, size_t matchLength)
+{
+    auto token = op++;
+    *token = (uint8_t) ((literalCount < 15 ? literalCount : 15) << 4);
+    if (literalCount >= 15) {
+        op = WriteLength(op, literalCount - 15);
+    }
+    memcpy(op, literals, literalCount);
+    op += literalCount;
+
+    // The last sequence only has literals.
+    if (offset == 0) {
+        return op;
+    }
+
+    *op++ = (uint8_t) offset;
+    *op++ = (uint8_t) (offset >> 8);
+
+    matchLength -= MIN_MATCH;
+    *token |= (uint8_t) (matchLength < 15 ? matchLength : 15);
+    if (matchLength >= 15) {
+        op = WriteLength(op, matchLength - 15);
+    }
+    return op;
+}
+
+// Compresses size bytes of src into dst, which must have room for
+// GetBound(size) bytes, and returns the compressed size.
+//
+// This is a greedy, single-probe compressor: each position is looked up in a
+// hash table of the last position with the same four bytes.  After 64
+// consecutive misses it starts skipping ahead, so incompressible data is
+// passed over quickly.
+inline size_t Compress(void const* src, size_t size, void* dst)
+{
+    auto base = static_cast<uint8_t const*>(src);
+    auto end = base + size;
+    auto ip = base;
+    auto anchor = base;
+    auto op = static_cast<uint8_t*>(dst);
+
+    if (size > MF_LIMIT) {
+        std::vector<uint32_t> table(1u << HASH_BITS, 0);
+        auto matchLimit = end - LAST_LITERALS;
+        auto ipLimit = end - MF_LIMIT;
+        uint32_t misses = 0;
+
+        while (ip < ipLimit) {
+            auto v = Read32(ip);
+            auto& slot = table[Hash(v)];
+            auto ref = base + slot;
+            slot = (uint32_t) (ip - base);
+
+            if (ref >= ip || ip - ref > MAX_OFFSET || Read32(ref) != v) {
+                ip += 1 + (misses++ >> 6);
+                continue;
+            }
+            misses = 0;
+
+            while (ip > anchor && ref > base && ip[-1] == ref[-1]) {
+                --ip;
+                --ref;
+            }
+
+            auto mp = ip + MIN_MATCH;
+            auto rp = ref + MIN_MATCH;
+            while (mp < matchLimit && *mp == *rp) {
+                ++mp;
+                ++rp;
+            }
+
+            op = WriteSequence(op, anchor, (size_t) (ip - anchor), (uint32_t) (ip - ref), (size_t) (mp - ip));
+            ip = mp;
+            anchor = ip;
+
+            if (ip < ipLimit) {
+                table[Hash(Read32(ip - 2))] = (uint32_t) (ip - 2 - base);
+            }
+        }
+    }
+
+    op = WriteSequence(op, anchor, (size_t) (end - anchor), 0, 0);
+    return (size_t) (op - static_cast<uint8_t*>(dst));
+}
+
+// Decompresses srcSize bytes of src into exactly dstSize bytes of dst.
+// Returns false if the data is corrupt or doesn't decompress to dstSize bytes.
+inline bool Decompress(void const* src, size_t srcSize, void* dst, size_t dstSize)
+{
+    auto ip = static_cast<uint8_t const*>(src);
+    auto ipEnd = ip + srcSize;
+    auto op = static_cast<uint8_t*>(dst);
+    auto opBase = op;
+    auto opEnd = op + dstSize;
+
+    auto readLength = [&](size_t* length) {
+        for (;;) {
+            if (ip == ipEnd) {
+                return false;
+            }
+            auto b = *ip++;
+            *length += b;
+            if (b != 255) {
+                return true;
+            }
+        }
+    };
+
+    for (;;) {
+        if (ip == ipEnd) {
+            return false;
+        }
+        auto token = *ip++;
+
+        size_t literalCount = token >> 4;
+        if (literalCount == 15 && !readLength(&literalCount)) {
+            return false;
+        }
+        if (literalCount > (size_t) (ipEnd - ip) || literalCount > (size_t) (opEnd - op)) {
+            return false;
+        }
+        memcpy(op, ip, literalCount);
+        ip += literalCount;
+        op += literalCount;
+
+        if (ip == ipEnd) {
+            return op == opEnd;
+        }
+
+        if (ipEnd - ip < 2) {
+            return false;
+        }
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t) (op - opBase)) {
+            return false;
+        }
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !readLength(&matchLength)) {
+            return false;
+        }
+        matchLength += MIN_MATCH;
+        if (matchLength > (size_t) (opEnd - op)) {
+            return false;
+        }
+
+        // The match can overlap the output (e.g., an offset of 1 repeats one
+        // byte), so it is copied forwards one byte at a time unless it
+        // doesn't.
+        auto match = op - offset;
+        if (offset >= matchLength) {
+            memcpy(op, match, matchLength);
+        } else {
+            for (size_t i = 0; i < matchLength; ++i) {
+                op[i] = match[i];
+            }
+        }
+        op += matchLength;
+    }
+}
+
+inline int Seek(FILE* fp, uint64_t offset)
+{
+#ifdef _WIN32
+    return _fseeki64(fp, (int64_t) offset, SEEK_SET);
+#else
+    return fseeko(fp, (off_t) offset, SEEK_SET);
+#endif
+}
+
+inline uint64_t Tell(FILE* fp)
+{
+#ifdef _WIN32
+    return (uint64_t) _ftelli64(fp);
+#else
+    return (uint64_t) ftello(fp);
+#endif
+}
+
+}
+
+// CompressedFileReader reads the block index of a compressed output file, and
+// decompresses individual blocks.
+class CompressedFileReader {
+    FILE* mFile = nullptr;
+    std::vector<CompressedIndexEntry> mIndex;
+    std::vector<uint8_t> mCompressed;
+
+    bool ReadIndex()
+    {
+        using namespace BlockCompression;
+
+        CompressedFileHeader header = {};
+        if (fread(&header, sizeof(header), 1, mFile) != 1 ||
+            header.Magic != COMPRESSED_MAGIC ||
+            header.Version != COMPRESSED_VERSION) {
+            return false;
+        }
+
+        // Use the footer's index if the file has one.
+        CompressedFooter footer = {};
+        if (fseek(mFile, -(long) sizeof(footer), SEEK_END) == 0 &&
+            fread(&footer, sizeof(footer), 1, mFile) == 1 &&
+            footer.Magic == COMPRESSED_FOOTER_MAGIC &&
+            Seek(mFile, footer.IndexOffset) == 0) {
+            mIndex.resize(footer.BlockCount);
+            if (footer.BlockCount == 0 || fread(mIndex.data(), sizeof(CompressedIndexEntry), footer.BlockCount, mFile) == footer.BlockCount) {
+                return true;
+            }
+            mIndex.clear();
+        }
+
+        // Otherwise, walk the block headers, stopping at the first incomplete
+        // block.
+        fseek(mFile, 0, SEEK_END);
+        auto fileSize = Tell(mFile);
+        uint64_t offset = sizeof(CompressedFileHeader);
+        for (;;) {
+            CompressedIndexEntry entry = {};
+            entry.Offset = offset;
+            if (Seek(mFile, offset) != 0 ||
+                fread(&entry.Block, sizeof(entry.Block), 1, mFile) != 1 ||
+                offset + sizeof(entry.Block) + entry.Block.CompressedSize > fileSize) {
+                break;
+            }
+            mIndex.push_back(entry);
+            offset += sizeof(entry.Block) + entry.Block.CompressedSize;
+        }
+        return true;
+    }
+
+public:
+    CompressedFileReader() = default;
+    ~CompressedFileReader() { Close(); }
+
+    CompressedFileReader(CompressedFileReader const&) = delete;
+    CompressedFileReader& operator=(CompressedFileReader const&) = delete;
+
+    // Returns false if the file can't be opened or isn't a compressed output
+    // file.
+    bool Open(char const* path)
+    {
+        Close();
+#ifdef _WIN32
+        fopen_s(&mFile, path, "rb");
+#else
+        mFile = fopen(path, "rb");
+#endif
+        if (mFile == nullptr) {
+            return false;
+        }
+        if (!ReadIndex()) {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Close()
+    {
+        if (mFile != nullptr) {
+            fclose(mFile);
+            mFile = nullptr;
+        }
+        mIndex.clear();
+    }
+
+    std::vector<CompressedIndexEntry> const& GetIndex() const { return mIndex; }
+
+    // Sets *blocks to the indices of the blocks that may have rows with
+    // QPCTimes in [minQpc, maxQpc], in file order.  Block 0 (which has the
+    // output's header) should also be read if it isn't one of them.
+    void FindBlocks(uint64_t minQpc, uint64_t maxQpc, std::vector<size_t>* blocks) const
+    {
+        blocks->clear();
+        for (size_t i = 0, n = mIndex.size(); i < n; ++i) {
+            auto const& block = mIndex[i].Block;
+            if (block.RowCount > 0 && block.MinQpc <= maxQpc && block.MaxQpc >= minQpc) {
+                blocks->push_back(i);
+            }
+        }
+    }
+
+    // Decompresses block i, appending it to *data.  Returns false if the
+    // block is corrupt.
+    bool ReadBlock(size_t i, std::vector<uint8_t>* data)
+    {
+        auto const& entry = mIndex[i];
+        auto const& block = entry.Block;
+
+        mCompressed.resize(block.CompressedSize);
+        if (BlockCompression::Seek(mFile, entry.Offset + sizeof(CompressedBlockHeader)) != 0 ||
+            fread(mCompressed.data(), 1, block.CompressedSize, mFile) != block.CompressedSize) {
+            return false;
+        }
+
+        auto size = data->size();
+        data->resize(size + block.UncompressedSize);
+        if (block.Flags & COMPRESSED_BLOCK_STORED) {
+            if (block.CompressedSize != block.UncompressedSize) {
+                return false;
+            }
+            memcpy(data->data() + size, mCompressed.data(), block.UncompressedSize);
+            return true;
+        }
+        return BlockCompression::Decompress(mCompressed.data(), block.CompressedSize, data->data() + size, block.UncompressedSize);
+    }
+};
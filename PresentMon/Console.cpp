@@ -3,53 +3,159 @@
 
 #include "PresentMon.hpp"
 
-static HANDLE gConsoleHandle;
-static char gConsoleWriteBuffer[8 * 1024];
-static uint32_t gConsoleWriteBufferIndex;
-static uint32_t gConsolePrevWriteBufferSize;
-static SHORT gConsoleTop;
-static SHORT gConsoleWidth;
-static SHORT gConsoleBufferHeight;
-static bool gConsoleFirstCommit;
+#include "ConsoleScreen.hpp"
+
+// Draws to a Windows console with the console API.
+class Win32ConsoleBackEnd : public ConsoleBackEnd {
+    HANDLE mHandle;
+    SHORT mTop;
+    SHORT mWidth;
+    SHORT mBufferHeight;
+    COORD mCursor;      // Where the cursor was left by the last frame
+    bool mFirstFrame;
+
+public:
+    bool Initialize()
+    {
+        mHandle = GetStdHandle(STD_OUTPUT_HANDLE);
+        if (mHandle == INVALID_HANDLE_VALUE) {
+            return false;
+        }
 
-bool InitializeConsole()
+        CONSOLE_SCREEN_BUFFER_INFO info = {};
+        if (GetConsoleScreenBufferInfo(mHandle, &info) == 0) {
+            return false;
+        }
+
+        mTop = info.dwCursorPosition.Y;
+        mWidth = info.srWindow.Right - info.srWindow.Left + 1;
+        mBufferHeight = info.dwSize.Y;
+        mCursor = info.dwCursorPosition;
+        mFirstFrame = true;
+        return true;
+    }
+
+    uint32_t GetWidth() override
+    {
+        return (uint32_t) mWidth;
+    }
+
+    bool BeginFrame(uint32_t lineCount) override
+    {
+        CONSOLE_SCREEN_BUFFER_INFO info = {};
+        GetConsoleScreenBufferInfo(mHandle, &info);
+
+        // Reset mTop on the first frame so we don't overwrite any warning
+        // messages.  After that, if the cursor isn't where we left it then
+        // something else wrote to the console, possibly over the display.
+        auto redraw = mFirstFrame;
+        if (mFirstFrame) {
+            mFirstFrame = false;
+            mTop = info.dwCursorPosition.Y;
+        } else if (info.dwCursorPosition.X != mCursor.X ||
+                   info.dwCursorPosition.Y != mCursor.Y) {
+            redraw = true;
+        }
+
+        // If we're at the end of the console buffer, issue some new lines to
+        // make some space.
+        auto maxCursorY = (SHORT) (mBufferHeight - (SHORT) lineCount);
+        if (mTop > maxCursorY) {
+            COORD bottom = { 0, (SHORT) (mBufferHeight - 1) };
+            SetConsoleCursorPosition(mHandle, bottom);
+            printf("\n");
+            for (--mTop; mTop > maxCursorY; --mTop) {
+                printf("\n");
+            }
+        }
+
+        return redraw;
+    }
+
+    void WriteLine(uint32_t y, char const* text, uint32_t length) override
+    {
+        DWORD dwCharsWritten = 0;
+        COORD cursor = { 0, (SHORT) (mTop + y) };
+        WriteConsoleOutputCharacterA(mHandle, text, (DWORD) length, cursor, &dwCharsWritten);
+    }
+
+    void EndFrame(uint32_t lineCount) override
+    {
+        // Put the cursor at the end of the written text.
+        mCursor.X = 0;
+        mCursor.Y = (SHORT) (mTop + lineCount);
+        SetConsoleCursorPosition(mHandle, mCursor);
+
+        // Update console info in case it was resized.
+        CONSOLE_SCREEN_BUFFER_INFO info = {};
+        GetConsoleScreenBufferInfo(mHandle, &info);
+        mWidth = info.srWindow.Right - info.srWindow.Left + 1;
+        mBufferHeight = info.dwSize.Y;
+    }
+};
+
+static Win32ConsoleBackEnd gWin32Console;
+static ConsoleBackEnd* gConsoleBackEnd;
+static ConsoleScreen* gConsoleScreen;
+
+// Terminal emulators for msys and cygwin programs (e.g., mintty, used by Git
+// Bash) run them with stdout connected to a pseudo terminal through a named
+// pipe named like \msys-<hash>-pty<N>-to-master or \cygwin-...  Other pipes
+// (e.g., to tee or grep) aren't terminals, even if TERM is set.
+static bool IsPtyPipe(HANDLE handle)
 {
-    gConsoleHandle = GetStdHandle(STD_OUTPUT_HANDLE);
-    if (gConsoleHandle == INVALID_HANDLE_VALUE) {
+    if (GetFileType(handle) != FILE_TYPE_PIPE) {
         return false;
     }
 
-    CONSOLE_SCREEN_BUFFER_INFO info = {};
-    if (GetConsoleScreenBufferInfo(gConsoleHandle, &info) == 0) {
+    // FileName isn't null-terminated, so leave room for one.
+    struct {
+        FILE_NAME_INFO mInfo;
+        WCHAR mBuffer[MAX_PATH];
+    } name = {};
+    if (!GetFileInformationByHandleEx(handle, FileNameInfo, &name, sizeof(name) - sizeof(WCHAR))) {
         return false;
     }
 
-    gConsoleTop = info.dwCursorPosition.Y;
-    gConsoleWidth = info.srWindow.Right - info.srWindow.Left + 1;
-    gConsoleBufferHeight = info.dwSize.Y;
-    gConsoleWriteBufferIndex = 0;
-    gConsolePrevWriteBufferSize = 0;
-    gConsoleFirstCommit = true;
-
-    return true;
+    auto fileName = name.mInfo.FileName;
+    return (wcsncmp(fileName, L"\\msys-", 6) == 0 || wcsncmp(fileName, L"\\cygwin-", 8) == 0) &&
+           wcsstr(fileName, L"-pty") != nullptr;
 }
 
-static void vConsolePrint(char const* format, va_list args)
+bool InitializeConsole()
 {
-    auto s = gConsoleWriteBuffer + gConsoleWriteBufferIndex;
-    auto n = sizeof(gConsoleWriteBuffer) - gConsoleWriteBufferIndex;
+    if (gWin32Console.Initialize()) {
+        gConsoleBackEnd = &gWin32Console;
+    } else {
+        // If stdout isn't a console, but is a pty of a terminal emulator that
+        // sets TERM (e.g., mintty), draw with ANSI escape sequences.  COLUMNS
+        // is used for the width if it is set.
+        auto handle = GetStdHandle(STD_OUTPUT_HANDLE);
+        char term[64] = {};
+        if (handle == INVALID_HANDLE_VALUE ||
+            !IsPtyPipe(handle) ||
+            GetEnvironmentVariableA("TERM", term, _countof(term)) == 0 ||
+            strcmp(term, "dumb") == 0) {
+            return false;
+        }
 
-    int r = vsnprintf(s, n, format, args);
-    if (r > 0) {
-        gConsoleWriteBufferIndex = min((uint32_t) (n - 1), gConsoleWriteBufferIndex + r);
+        char columns[16] = {};
+        uint32_t width = 0;
+        if (GetEnvironmentVariableA("COLUMNS", columns, _countof(columns)) != 0) {
+            width = strtoul(columns, nullptr, 10);
+        }
+        gConsoleBackEnd = new AnsiConsoleBackEnd(stdout, width == 0 ? 80 : width);
     }
+
+    gConsoleScreen = new ConsoleScreen(gConsoleBackEnd->GetWidth());
+    return true;
 }
 
 void ConsolePrint(char const* format, ...)
 {
     va_list args;
     va_start(args, format);
-    vConsolePrint(format, args);
+    gConsoleScreen->vPrint(format, args);
     va_end(args);
 }
 
@@ -57,66 +163,35 @@ void ConsolePrintLn(char const* format, ...)
 {
     va_list args;
     va_start(args, format);
-    vConsolePrint(format, args);
+    gConsoleScreen->vPrint(format, args);
     va_end(args);
 
-    auto x = gConsoleWriteBufferIndex % gConsoleWidth;
-    auto s = gConsoleWidth - x;
-    memset(gConsoleWriteBuffer + gConsoleWriteBufferIndex, ' ', s);
-    gConsoleWriteBufferIndex += s;
+    gConsoleScreen->EndLine();
 }
 
 void CommitConsole()
 {
-    auto sizeWritten = gConsoleWriteBufferIndex;
-    auto linesWritten = (SHORT) (sizeWritten / gConsoleWidth);
-
-    // Reset gConsoleTop on the first commit so we don't overwrite any warning
-    // messages.
-    auto size = sizeWritten;
-    if (gConsoleFirstCommit) {
-        gConsoleFirstCommit = false;
+    gConsoleScreen->Commit(gConsoleBackEnd);
+}
 
-        CONSOLE_SCREEN_BUFFER_INFO info = {};
-        GetConsoleScreenBufferInfo(gConsoleHandle, &info);
-        gConsoleTop = info.dwCursorPosition.Y;
-    } else {
-        // Write some extra empty lines to make sure we clear anything from
-        // last time.
-        if (size < gConsolePrevWriteBufferSize) {
-            memset(gConsoleWriteBuffer + size, ' ', gConsolePrevWriteBufferSize - size);
-            size = gConsolePrevWriteBufferSize;
-        }
-    }
+// The quantiles of the frame statistics shown in the console and summary.
+static double const QUANTILES[] = { 0.5, 0.95, 0.99, 0.999 };
+enum { QUANTILE_COUNT = _countof(QUANTILES) };
 
-    // If we're at the end of the console buffer, issue some new lines to make
-    // some space.
-    auto maxCursorY = gConsoleBufferHeight - linesWritten;
-    if (gConsoleTop > maxCursorY) {
-        COORD bottom = { 0, gConsoleBufferHeight - 1 };
-        SetConsoleCursorPosition(gConsoleHandle, bottom);
-        printf("\n");
-        for (--gConsoleTop; gConsoleTop > maxCursorY; --gConsoleTop) {
-            printf("\n");
-        }
+static void ConsolePrintQuantiles(char const* name, QuantileSketch const& sketch)
+{
+    if (sketch.GetCount() == 0) {
+        return;
     }
 
-    // Write to the console.
-    DWORD dwCharsWritten = 0;
-    COORD cursor = { 0, gConsoleTop };
-    WriteConsoleOutputCharacterA(gConsoleHandle, gConsoleWriteBuffer, (DWORD) size, cursor, &dwCharsWritten);
+    uint64_t values[QUANTILE_COUNT];
+    sketch.GetQuantiles(QUANTILES, values, QUANTILE_COUNT);
 
-    // Put the cursor at the end of the written text.
-    cursor.Y += linesWritten;
-    SetConsoleCursorPosition(gConsoleHandle, cursor);
-
-    // Update console info in case it was resized.
-    CONSOLE_SCREEN_BUFFER_INFO info = {};
-    GetConsoleScreenBufferInfo(gConsoleHandle, &info);
-    gConsoleWidth = info.srWindow.Right - info.srWindow.Left + 1;
-    gConsoleBufferHeight = info.dwSize.Y;
-    gConsoleWriteBufferIndex = 0;
-    gConsolePrevWriteBufferSize = sizeWritten;
+    ConsolePrint(" %s=", name);
+    for (uint32_t i = 0; i < QUANTILE_COUNT; ++i) {
+        ConsolePrint(i == 0 ? "%.2lf" : "/%.2lf", 1000.0 * QpcDeltaToSeconds(values[i]));
+    }
+    ConsolePrint("ms");
 }
 
 void UpdateConsole(uint32_t processId, ProcessInfo const& processInfo)
@@ -125,7 +200,7 @@ void UpdateConsole(uint32_t processId, ProcessInfo const& processInfo)
 
     // Don't display non-target or empty processes
     if (!processInfo.mTargetProcess ||
-        processInfo.mModuleName.empty() ||
+        processInfo.mModuleName->empty() ||
         processInfo.mSwapChain.empty()) {
         return;
     }
@@ -142,48 +217,33 @@ void UpdateConsole(uint32_t processId, ProcessInfo const& processInfo)
             continue;
         }
 
-        auto const& present0 = *chain.mPresentHistory[(chain.mNextPresentIndex - chain.mPresentHistoryCount) % SwapChainData::PRESENT_HISTORY_MAX_COUNT];
-        auto const& presentN = *chain.mPresentHistory[(chain.mNextPresentIndex - 1) % SwapChainData::PRESENT_HISTORY_MAX_COUNT];
-        auto cpuAvg = QpcDeltaToSeconds(presentN.QpcTime - present0.QpcTime) / (chain.mPresentHistoryCount - 1);
+        auto const& present0 = chain.mPresentHistory[(chain.mNextPresentIndex - chain.mPresentHistoryCount) % SwapChainData::PRESENT_HISTORY_MAX_COUNT];
+        auto const& presentN = chain.mPresentHistory[(chain.mNextPresentIndex - 1) % SwapChainData::PRESENT_HISTORY_MAX_COUNT];
+        auto cpuAvg = QpcDeltaToSeconds(presentN.mQpcTime - present0.mQpcTime) / (chain.mPresentHistoryCount - 1);
         auto dspAvg = 0.0;
         auto latAvg = 0.0;
 
-        PresentEvent* displayN = nullptr;
-        if (args.mTrackDisplay) {
-            uint64_t display0ScreenTime = 0;
-            uint64_t latSum = 0;
-            uint32_t displayCount = 0;
-            for (uint32_t i = 0; i < chain.mPresentHistoryCount; ++i) {
-                auto const& p = chain.mPresentHistory[(chain.mNextPresentIndex - chain.mPresentHistoryCount + i) % SwapChainData::PRESENT_HISTORY_MAX_COUNT];
-                if (p->FinalState == PresentResult::Presented) {
-                    if (displayCount == 0) {
-                        display0ScreenTime = p->ScreenTime;
-                    }
-                    displayN = p.get();
-                    latSum += p->ScreenTime - p->QpcTime;
-                    displayCount += 1;
-                }
-            }
+        PresentSummary const* displayN = nullptr;
+        if (args.mTrackDisplay && chain.mDisplayedCount > 0) {
+            displayN = &chain.mPresentHistory[chain.mLastDisplayedPresentIndex % SwapChainData::PRESENT_HISTORY_MAX_COUNT];
 
-            if (displayCount >= 2) {
-                dspAvg = QpcDeltaToSeconds(displayN->ScreenTime - display0ScreenTime) / (displayCount - 1);
+            if (chain.mDisplayedCount >= 2) {
+                dspAvg = QpcDeltaToSeconds(chain.mDisplayDeltaSum) / (chain.mDisplayedCount - 1);
             }
 
-            if (displayCount >= 1) {
-                latAvg = QpcDeltaToSeconds(latSum) / displayCount;
-            }
+            latAvg = QpcDeltaToSeconds(chain.mDisplayLatencySum) / chain.mDisplayedCount;
         }
 
         if (empty) {
             empty = false;
-            ConsolePrintLn("%s[%d]:", processInfo.mModuleName.c_str(), processId);
+            ConsolePrintLn("%s[%d]:", processInfo.mModuleName->c_str(), processId);
         }
 
         ConsolePrint("    %016llX (%s): SyncInterval=%d Flags=%d CPU%s=%.2lf",
             address,
-            RuntimeToString(presentN.Runtime),
-            presentN.SyncInterval,
-            presentN.PresentFlags,
+            RuntimeToString(presentN.mRuntime),
+            presentN.mSyncInterval,
+            presentN.mPresentFlags,
             dspAvg > 0.0 ? "/Display" : "",
             1000.0 * cpuAvg);
 
@@ -198,10 +258,19 @@ void UpdateConsole(uint32_t processId, ProcessInfo const& processInfo)
         }
 
         if (displayN != nullptr) {
-            ConsolePrint(" %s", PresentModeToString(displayN->PresentMode));
+            ConsolePrint(" %s", PresentModeToString(displayN->mPresentMode));
         }
 
         ConsolePrintLn("");
+
+        // Percentiles over the whole capture.
+        if (chain.mPresentIntervals.GetCount() > 0) {
+            ConsolePrint("        p50/p95/p99/p99.9:");
+            ConsolePrintQuantiles("CPU", chain.mPresentIntervals);
+            ConsolePrintQuantiles("Display", chain.mDisplayIntervals);
+            ConsolePrintQuantiles("latency", chain.mDisplayLatencies);
+            ConsolePrintLn("");
+        }
     }
 
     if (!empty) {
@@ -209,3 +278,32 @@ void UpdateConsole(uint32_t processId, ProcessInfo const& processInfo)
     }
 }
 
+
+static void PrintSummaryRow(char const* name, QuantileSketch const& sketch)
+{
+    if (sketch.GetCount() == 0) {
+        return;
+    }
+
+    uint64_t values[QUANTILE_COUNT];
+    sketch.GetQuantiles(QUANTILES, values, QUANTILE_COUNT);
+
+    printf("        %-8s %10llu", name, sketch.GetCount());
+    for (uint32_t i = 0; i < QUANTILE_COUNT; ++i) {
+        printf(" %9.2lf", 1000.0 * QpcDeltaToSeconds(values[i]));
+    }
+    printf(" %9.2lf\n", 1000.0 * QpcDeltaToSeconds(sketch.GetMax()));
+}
+
+void PrintSummary(std::vector<ProcessSummary> const& summaries)
+{
+    printf("\nFrame statistics (ms):\n");
+    for (auto const& summary : summaries) {
+        printf("    %s[%u] (%u swap chain%s):\n", summary.mModuleName.c_str(), summary.mProcessId, summary.mSwapChainCount,
+            summary.mSwapChainCount == 1 ? "" : "s");
+        printf("                      count       p50       p95       p99     p99.9       max\n");
+        PrintSummaryRow("CPU", summary.mPresentIntervals);
+        PrintSummaryRow("Display", summary.mDisplayIntervals);
+        PrintSummaryRow("Latency", summary.mDisplayLatencies);
+    }
+}
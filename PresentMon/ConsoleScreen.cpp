@@ -0,0 +1,154 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+
+#include "ConsoleScreen.hpp"
+
+#include <string.h>
+#include <algorithm>
+
+AnsiConsoleBackEnd::AnsiConsoleBackEnd(FILE* fp, uint32_t width)
+    : mFile(fp)
+    , mWidth(width)
+    , mCursorY(0)
+    , mLineCount(1)
+    , mFirstFrame(true)
+{
+}
+
+void AnsiConsoleBackEnd::MoveTo(uint32_t y)
+{
+    char seq[16];
+    if (y < mCursorY) {
+        snprintf(seq, sizeof(seq), "\x1b[%uA", mCursorY - y);
+        mOutput += seq;
+        mCursorY = y;
+        return;
+    }
+
+    // Lines the cursor hasn't been on yet may be below the bottom of the
+    // terminal, so the cursor is moved to them with new lines, which scroll
+    // the terminal if necessary.
+    auto lastLine = std::min(y, mLineCount - 1);
+    if (lastLine > mCursorY) {
+        snprintf(seq, sizeof(seq), "\x1b[%uB", lastLine - mCursorY);
+        mOutput += seq;
+        mCursorY = lastLine;
+    }
+    for (; mCursorY < y; ++mCursorY) {
+        mOutput += '\n';
+    }
+    mLineCount = std::max(mLineCount, y + 1);
+}
+
+uint32_t AnsiConsoleBackEnd::GetWidth()
+{
+    return mWidth;
+}
+
+bool AnsiConsoleBackEnd::BeginFrame(uint32_t lineCount)
+{
+    (void) lineCount;
+
+    mOutput.clear();
+
+    auto redraw = mFirstFrame;
+    mFirstFrame = false;
+    return redraw;
+}
+
+void AnsiConsoleBackEnd::WriteLine(uint32_t y, char const* text, uint32_t length)
+{
+    MoveTo(y);
+
+    // Trailing spaces are cleared by erasing the rest of the line instead.
+    auto n = length;
+    while (n > 0 && text[n - 1] == ' ') {
+        --n;
+    }
+
+    mOutput += '\r';
+    mOutput.append(text, n);
+    if (n < length) {
+        mOutput += "\x1b[K";
+    }
+}
+
+void AnsiConsoleBackEnd::EndFrame(uint32_t lineCount)
+{
+    MoveTo(lineCount);
+    mOutput += '\r';
+
+    fwrite(mOutput.data(), 1, mOutput.size(), mFile);
+    fflush(mFile);
+}
+
+ConsoleScreen::ConsoleScreen(uint32_t width)
+    : mLines(CONSOLE_SCREEN_MAX_SIZE)
+    , mWidth(std::max(width, 1u))
+    , mSize(0)
+    , mPrevLineCount(0)
+    , mRedraw(true)
+{
+}
+
+void ConsoleScreen::vPrint(char const* format, va_list args)
+{
+    auto n = CONSOLE_SCREEN_MAX_SIZE - mSize;
+    if (n <= 1) {
+        return;
+    }
+
+    int r = vsnprintf(mLines.data() + mSize, n, format, args);
+    if (r > 0) {
+        mSize = std::min(CONSOLE_SCREEN_MAX_SIZE - 1u, mSize + (uint32_t) r);
+    }
+}
+
+void ConsoleScreen::EndLine()
+{
+    auto s = std::min(mWidth - mSize % mWidth, CONSOLE_SCREEN_MAX_SIZE - mSize);
+    memset(mLines.data() + mSize, ' ', s);
+    mSize += s;
+}
+
+void ConsoleScreen::Commit(ConsoleBackEnd* backEnd)
+{
+    auto lineCount = (mSize + mWidth - 1) / mWidth;
+
+    // Pad the frame with spaces to whole lines, adding empty lines to clear
+    // any left over from the previous frame.
+    auto drawCount = std::max(lineCount, mPrevLineCount);
+    auto drawSize = (size_t) drawCount * mWidth;
+    if (mLines.size() < drawSize) {
+        mLines.resize(drawSize);
+    }
+    memset(mLines.data() + mSize, ' ', drawSize - mSize);
+
+    // Lines past the end of the previous frame are always drawn, since they
+    // may contain anything.
+    auto redraw = backEnd->BeginFrame(drawCount) || mRedraw;
+    for (uint32_t y = 0; y < drawCount; ++y) {
+        auto line = mLines.data() + (size_t) y * mWidth;
+        if (redraw || y >= mPrevLineCount || memcmp(line, mPrevLines.data() + (size_t) y * mWidth, mWidth) != 0) {
+            backEnd->WriteLine(y, line, mWidth);
+        }
+    }
+    backEnd->EndFrame(lineCount);
+
+    std::swap(mLines, mPrevLines);
+    if (mLines.size() < CONSOLE_SCREEN_MAX_SIZE) {
+        mLines.resize(CONSOLE_SCREEN_MAX_SIZE);
+    }
+    mSize = 0;
+    mPrevLineCount = lineCount;
+    mRedraw = false;
+
+    // If the console was resized, the previous frame's characters now cover
+    // a different number of lines, none of which can be compared.
+    auto width = std::max(backEnd->GetWidth(), 1u);
+    if (width != mWidth) {
+        mPrevLineCount = (mPrevLineCount * mWidth + width - 1) / width;
+        mWidth = width;
+        mRedraw = true;
+    }
+}
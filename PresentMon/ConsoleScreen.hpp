@@ -0,0 +1,94 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// The console display is drawn into a ConsoleScreen, a virtual screen buffer
+// of lines as wide as the console window.  When a frame is committed, each
+// line is compared with the line drawn at the same position in the previous
+// frame, and only the lines that changed are passed to the ConsoleBackEnd,
+// which draws them to the console.  Lines left over from a longer previous
+// frame are cleared.
+//
+// Line 0 is the top of the display, which starts on the line the cursor was
+// on when the first frame was drawn, so that anything printed before it
+// (e.g., warnings) isn't overwritten.
+
+class ConsoleBackEnd {
+public:
+    virtual ~ConsoleBackEnd() {}
+
+    // The width of the console window, in characters.
+    virtual uint32_t GetWidth() = 0;
+
+    // Starts a frame that draws lineCount lines.  Returns true if the lines
+    // drawn by previous frames may no longer be on the console (e.g., this is
+    // the first frame, or something else wrote to the console), in which case
+    // every line is redrawn.
+    virtual bool BeginFrame(uint32_t lineCount) = 0;
+
+    // Draws text, which is GetWidth() characters, on line y of the display.
+    virtual void WriteLine(uint32_t y, char const* text, uint32_t length) = 0;
+
+    // Ends the frame, leaving the cursor at the start of line lineCount, i.e.
+    // just below the displayed lines.
+    virtual void EndFrame(uint32_t lineCount) = 0;
+};
+
+// Draws to a terminal using ANSI escape sequences written to a FILE.  Since
+// the cursor is only moved relative to its position, the display must fit in
+// the terminal window.
+class AnsiConsoleBackEnd : public ConsoleBackEnd {
+    FILE* mFile;
+    uint32_t mWidth;
+    uint32_t mCursorY;      // The display line the cursor is on
+    uint32_t mLineCount;    // The number of display lines that exist on the terminal
+    bool mFirstFrame;
+    std::string mOutput;    // The current frame's output
+
+    void MoveTo(uint32_t y);
+
+public:
+    AnsiConsoleBackEnd(FILE* fp, uint32_t width);
+
+    uint32_t GetWidth() override;
+    bool BeginFrame(uint32_t lineCount) override;
+    void WriteLine(uint32_t y, char const* text, uint32_t length) override;
+    void EndFrame(uint32_t lineCount) override;
+};
+
+enum {
+    CONSOLE_SCREEN_MAX_SIZE = 8 * 1024,     // Maximum characters per frame; the rest of a frame is dropped
+};
+
+class ConsoleScreen {
+    std::vector<char> mLines;       // The frame being drawn
+    std::vector<char> mPrevLines;   // The last frame committed
+    uint32_t mWidth;
+    uint32_t mSize;                 // The number of characters drawn in mLines
+    uint32_t mPrevLineCount;        // The number of lines in mPrevLines
+    bool mRedraw;                   // Whether every line must be redrawn
+
+public:
+    explicit ConsoleScreen(uint32_t width);
+
+    // Appends printf()-formatted text, which wraps at the end of the line.
+    void vPrint(char const* format, va_list args);
+
+    // Pads the current line with spaces, so the next text starts a new line.
+    void EndLine();
+
+    // Draws the lines that changed since the last commit using backEnd, and
+    // starts a new frame.  If the console's width changed, the new frame uses
+    // the new width and will be redrawn completely.
+    void Commit(ConsoleBackEnd* backEnd);
+
+    // Makes the next commit redraw every line.
+    void Invalidate() { mRedraw = true; }
+};
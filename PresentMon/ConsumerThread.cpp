@@ -3,6 +3,8 @@
 
 #include "PresentMon.hpp"
 
+#include "../PresentData/TraceSession.hpp"
+
 static std::thread gThread;
 
 static void Consume(TRACEHANDLE traceHandle)
@@ -29,6 +31,10 @@ static void Consume(TRACEHANDLE traceHandle)
     auto status = ProcessTrace(&traceHandle, 1, NULL, NULL);
     (void) status;
 
+    // Hand off any events that were held back while the output thread was
+    // falling behind.
+    FlushAnalyzedInfo();
+
     // Signal MainThread to exit.  This is only needed if we are processing an
     // ETL file and ProcessTrace() returned because the ETL is done, but there
     // is no harm in calling ExitMainThread() if MainThread is already exiting
@@ -37,11 +43,31 @@ static void Consume(TRACEHANDLE traceHandle)
     ExitMainThread();
 }
 
+// Replay an event capture instead of ETW events.  Like ProcessTrace(),
+// ProcessReplay() returns once all events are consumed or the session is
+// stopped.
+static void ConsumeReplay(TraceSession* session)
+{
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+
+    auto status = session->ProcessReplay();
+    (void) status;
+
+    FlushAnalyzedInfo();
+
+    ExitMainThread();
+}
+
 void StartConsumerThread(TRACEHANDLE traceHandle)
 {
     gThread = std::thread(Consume, traceHandle);
 }
 
+void StartReplayConsumerThread(TraceSession* session)
+{
+    gThread = std::thread(ConsumeReplay, session);
+}
+
 void WaitForConsumerThreadToExit()
 {
     if (gThread.joinable()) {
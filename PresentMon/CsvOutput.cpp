@@ -2,10 +2,122 @@
 // SPDX-License-Identifier: MIT
 
 #include "PresentMon.hpp"
+#include "ColumnarOutput.hpp"
+#include "CsvRow.hpp"
+#include "OutputWriter.hpp"
+
+#include <map>
+
+// If -rotate_size or -rotate_interval is used, each output is written as a
+// sequence of segments, and a manifest lists each segment's rows once it is
+// complete.  OutputSegments is shared by all copies of the output's
+// OutputCsv.
+struct OutputSegments {
+    std::string mBasePath;              // The output path without its extension
+    std::string mExtension;
+    OutputFile* mManifest;
+    uint32_t mIndex;                    // The current segment's number, starting at 1
+    uint64_t mEndQpc;                   // -rotate_interval ends the segment at the first row at or after this time
+
+    // The current segment's rows
+    uint64_t mRowCount;
+    uint64_t mMinQpc;
+    uint64_t mMaxQpc;
+    std::map<uint32_t, std::string> mProcesses;
+};
 
 static OutputCsv gSingleOutputCsv = {};
 static uint32_t gRecordingCount = 1;
 
+static OutputCsv GetOutputCsv(ProcessInfo* processInfo, bool rotate, uint64_t qpc);
+
+static void GetSegmentPath(OutputSegments const* segments, char* path)
+{
+    _snprintf_s(path, MAX_PATH, _TRUNCATE, "%s-seg%04u%s", segments->mBasePath.c_str(), segments->mIndex, segments->mExtension.c_str());
+}
+
+static void AddSegmentRow(OutputSegments* segments, uint32_t processId, std::string const& processName, uint64_t qpc)
+{
+    auto const& args = GetCommandLineArgs();
+
+    if (segments->mRowCount == 0) {
+        segments->mMinQpc = qpc;
+        segments->mMaxQpc = qpc;
+        if (args.mRotateInterval != 0) {
+            segments->mEndQpc = qpc + SecondsDeltaToQpc(args.mRotateInterval);
+        }
+    } else {
+        if (qpc < segments->mMinQpc) {
+            segments->mMinQpc = qpc;
+        }
+        if (qpc > segments->mMaxQpc) {
+            segments->mMaxQpc = qpc;
+        }
+    }
+    segments->mRowCount += 1;
+
+    if (segments->mProcesses.find(processId) == segments->mProcesses.end()) {
+        segments->mProcesses.emplace(processId, processName);
+    }
+}
+
+// Adds the current segment to the manifest, and flushes it so the manifest
+// is up to date while the capture continues.
+static void WriteManifestRow(OutputSegments* segments)
+{
+    auto const& args = GetCommandLineArgs();
+
+    char path[MAX_PATH];
+    GetSegmentPath(segments, path);
+    std::string fileName(path);
+    auto slash = fileName.find_last_of("\\/");
+    if (slash != std::string::npos) {
+        fileName.erase(0, slash + 1);
+    }
+    if (args.mOutputCompressed) {
+        fileName += ".pmz";
+    }
+
+    std::string processes;
+    for (auto const& pair : segments->mProcesses) {
+        if (!processes.empty()) {
+            processes += ';';
+        }
+        processes += pair.second;
+        processes += ':';
+        processes += std::to_string(pair.first);
+    }
+
+    CsvRow row(segments->mManifest);
+    row.AddInt(segments->mIndex);
+    row.AddString(fileName.c_str(), fileName.size());
+    row.AddUInt64(segments->mRowCount);
+    row.AddUInt64(segments->mMinQpc);
+    row.AddUInt64(segments->mMaxQpc);
+    row.AddDouble(QpcToSeconds(segments->mMinQpc), DBL_DIG - 1);
+    row.AddDouble(QpcToSeconds(segments->mMaxQpc), DBL_DIG - 1);
+    row.AddString(processes.c_str(), processes.size());
+    row.End();
+    segments->mManifest->Flush();
+}
+
+// Adds the current segment to the manifest, unless it has no rows (e.g.,
+// because it couldn't be opened), and closes the manifest.
+static void CloseOutputSegments(OutputCsv* outputCsv)
+{
+    auto segments = outputCsv->mSegments;
+    if (segments != nullptr) {
+        if (segments->mManifest != nullptr) {
+            if (segments->mRowCount > 0) {
+                WriteManifestRow(segments);
+            }
+            CloseOutputFile(segments->mManifest);
+        }
+        delete segments;
+        outputCsv->mSegments = nullptr;
+    }
+}
+
 void IncrementRecordingCount()
 {
     gRecordingCount += 1;
@@ -44,11 +156,11 @@ const char* FinalStateToDroppedString(PresentResult res)
     }
 }
 
-static void WriteCsvHeader(FILE* fp)
+static void WriteCsvHeader(OutputFile* file)
 {
     auto const& args = GetCommandLineArgs();
 
-    fprintf(fp,
+    file->Printf(
         "Application"
         ",ProcessID"
         ",SwapChainAddress"
@@ -60,7 +172,7 @@ static void WriteCsvHeader(FILE* fp)
         ",msInPresentAPI"
         ",msBetweenPresents");
     if (args.mTrackDisplay) {
-        fprintf(fp,
+        file->Printf(
             ",AllowsTearing"
             ",PresentMode"
             ",msUntilRenderComplete"
@@ -68,14 +180,88 @@ static void WriteCsvHeader(FILE* fp)
             ",msBetweenDisplayChange");
     }
     if (args.mTrackDebug) {
-        fprintf(fp,
+        file->Printf(
             ",WasBatched"
             ",DwmNotified");
     }
     if (args.mOutputQpcTime) {
-        fprintf(fp, ",QPCTime");
+        file->Printf(",QPCTime");
+    }
+    file->Printf("\n");
+}
+
+// The columnar output has the same columns as the CSV, except that times are
+// stored as integer performance counter values and deltas (see
+// ColumnarOutput.hpp) and QPCTime is always included.
+static void AddColumnarColumns(ColumnarWriter* writer)
+{
+    auto const& args = GetCommandLineArgs();
+
+    writer->AddColumn("Application",             COLUMNAR_TYPE_DICTIONARY);
+    writer->AddColumn("ProcessID",               COLUMNAR_TYPE_UINT32);
+    writer->AddColumn("SwapChainAddress",        COLUMNAR_TYPE_UINT64);
+    writer->AddColumn("Runtime",                 COLUMNAR_TYPE_DICTIONARY);
+    writer->AddColumn("SyncInterval",            COLUMNAR_TYPE_INT32);
+    writer->AddColumn("PresentFlags",            COLUMNAR_TYPE_UINT32);
+    writer->AddColumn("Dropped",                 COLUMNAR_TYPE_DICTIONARY);
+    writer->AddColumn("QPCTime",                 COLUMNAR_TYPE_UINT64);
+    writer->AddColumn("qpcInPresentAPI",         COLUMNAR_TYPE_INT64);
+    writer->AddColumn("qpcBetweenPresents",      COLUMNAR_TYPE_INT64);
+    if (args.mTrackDisplay) {
+        writer->AddColumn("AllowsTearing",           COLUMNAR_TYPE_UINT8);
+        writer->AddColumn("PresentMode",             COLUMNAR_TYPE_DICTIONARY);
+        writer->AddColumn("qpcUntilRenderComplete",  COLUMNAR_TYPE_INT64);
+        writer->AddColumn("qpcUntilDisplayed",       COLUMNAR_TYPE_INT64);
+        writer->AddColumn("qpcBetweenDisplayChange", COLUMNAR_TYPE_INT64);
+    }
+    if (args.mTrackDebug) {
+        writer->AddColumn("WasBatched",              COLUMNAR_TYPE_UINT8);
+        writer->AddColumn("DwmNotified",             COLUMNAR_TYPE_UINT8);
+    }
+}
+
+static void UpdateColumnar(ColumnarWriter* writer, ProcessInfo* processInfo, SwapChainData const& chain, PresentEvent const& p,
+                           PresentSummary const& lastPresented)
+{
+    auto const& args = GetCommandLineArgs();
+
+    writer->AppendString(*processInfo->mModuleName);
+    writer->AppendUInt32(p.ProcessId);
+    writer->AppendUInt64(p.SwapChainAddress);
+    writer->AppendString(RuntimeToString(p.Runtime));
+    writer->AppendInt32(p.SyncInterval);
+    writer->AppendUInt32(p.PresentFlags);
+    writer->AppendString(FinalStateToDroppedString(p.FinalState));
+    writer->AppendUInt64(p.QpcTime);
+    writer->AppendInt64((int64_t) p.TimeTaken);
+    writer->AppendInt64((int64_t) (p.QpcTime - lastPresented.mQpcTime));
+    if (args.mTrackDisplay) {
+        int64_t qpcUntilRenderComplete = 0;
+        int64_t qpcUntilDisplayed = 0;
+        int64_t qpcBetweenDisplayChange = 0;
+        if (p.ReadyTime != 0) {
+            qpcUntilRenderComplete = (int64_t) (p.ReadyTime - p.QpcTime);
+        }
+        if (p.FinalState == PresentResult::Presented) {
+            qpcUntilDisplayed = (int64_t) (p.ScreenTime - p.QpcTime);
+
+            if (chain.mDisplayedCount > 0) {
+                auto const& lastDisplayed = chain.mPresentHistory[chain.mLastDisplayedPresentIndex % SwapChainData::PRESENT_HISTORY_MAX_COUNT];
+                qpcBetweenDisplayChange = (int64_t) (p.ScreenTime - lastDisplayed.mScreenTime);
+            }
+        }
+
+        writer->AppendUInt8(p.SupportsTearing);
+        writer->AppendString(PresentModeToString(p.PresentMode));
+        writer->AppendInt64(qpcUntilRenderComplete);
+        writer->AppendInt64(qpcUntilDisplayed);
+        writer->AppendInt64(qpcBetweenDisplayChange);
     }
-    fprintf(fp, "\n");
+    if (args.mTrackDebug) {
+        writer->AppendUInt8(p.DriverBatchThreadId != 0);
+        writer->AppendUInt8(p.DwmNotified);
+    }
+    writer->EndRow(p.QpcTime);
 }
 
 void UpdateCsv(ProcessInfo* processInfo, SwapChainData const& chain, PresentEvent const& p)
@@ -89,8 +275,8 @@ void UpdateCsv(ProcessInfo* processInfo, SwapChainData const& chain, PresentEven
     }
 
     // Early return if not outputing to CSV.
-    auto fp = GetOutputCsv(processInfo).mFile;
-    if (fp == nullptr) {
+    auto outputCsv = GetOutputCsv(processInfo, true, p.QpcTime);
+    if (outputCsv.mFile == nullptr) {
         return;
     }
 
@@ -100,10 +286,19 @@ void UpdateCsv(ProcessInfo* processInfo, SwapChainData const& chain, PresentEven
         return;
     }
 
-    auto lastPresented = chain.mPresentHistory[(chain.mNextPresentIndex - 1) % SwapChainData::PRESENT_HISTORY_MAX_COUNT].get();
+    auto const& lastPresented = chain.mPresentHistory[(chain.mNextPresentIndex - 1) % SwapChainData::PRESENT_HISTORY_MAX_COUNT];
+
+    if (outputCsv.mSegments != nullptr) {
+        AddSegmentRow(outputCsv.mSegments, p.ProcessId, *processInfo->mModuleName, p.QpcTime);
+    }
+
+    if (outputCsv.mColumnarWriter != nullptr) {
+        UpdateColumnar(outputCsv.mColumnarWriter, processInfo, chain, p, lastPresented);
+        return;
+    }
 
     // Compute frame statistics.
-    double msBetweenPresents      = 1000.0 * QpcDeltaToSeconds(p.QpcTime - lastPresented->QpcTime);
+    double msBetweenPresents      = 1000.0 * QpcDeltaToSeconds(p.QpcTime - lastPresented.mQpcTime);
     double msInPresentApi         = 1000.0 * QpcDeltaToSeconds(p.TimeTaken);
     double msUntilRenderComplete  = 0.0;
     double msUntilDisplayed       = 0.0;
@@ -120,46 +315,45 @@ void UpdateCsv(ProcessInfo* processInfo, SwapChainData const& chain, PresentEven
         if (presented) {
             msUntilDisplayed = 1000.0 * QpcDeltaToSeconds(p.ScreenTime - p.QpcTime);
 
-            if (chain.mLastDisplayedPresentIndex > 0) {
-                auto lastDisplayed = chain.mPresentHistory[chain.mLastDisplayedPresentIndex % SwapChainData::PRESENT_HISTORY_MAX_COUNT].get();
-                msBetweenDisplayChange = 1000.0 * QpcDeltaToSeconds(p.ScreenTime - lastDisplayed->ScreenTime);
+            if (chain.mDisplayedCount > 0) {
+                auto const& lastDisplayed = chain.mPresentHistory[chain.mLastDisplayedPresentIndex % SwapChainData::PRESENT_HISTORY_MAX_COUNT];
+                msBetweenDisplayChange = 1000.0 * QpcDeltaToSeconds(p.ScreenTime - lastDisplayed.mScreenTime);
             }
         }
     }
 
     // Output in CSV format
-    fprintf(fp, "%s,%d,0x%016llX,%s,%d,%d,%s,%.*lf,%.*lf,%.*lf",
-        processInfo->mModuleName.c_str(),
-        p.ProcessId,
-        p.SwapChainAddress,
-        RuntimeToString(p.Runtime),
-        p.SyncInterval,
-        p.PresentFlags,
-        FinalStateToDroppedString(p.FinalState),
-        DBL_DIG - 1, QpcToSeconds(p.QpcTime),
-        DBL_DIG - 1, msInPresentApi,
-        DBL_DIG - 1, msBetweenPresents);
+    CsvRow row(outputCsv.mFile);
+    row.AddString(processInfo->mModuleName->c_str(), processInfo->mModuleName->size());
+    row.AddInt(p.ProcessId);
+    row.AddHex64(p.SwapChainAddress);
+    row.AddString(RuntimeToString(p.Runtime));
+    row.AddInt(p.SyncInterval);
+    row.AddInt(p.PresentFlags);
+    row.AddString(FinalStateToDroppedString(p.FinalState));
+    row.AddDouble(QpcToSeconds(p.QpcTime), DBL_DIG - 1);
+    row.AddDouble(msInPresentApi, DBL_DIG - 1);
+    row.AddDouble(msBetweenPresents, DBL_DIG - 1);
     if (args.mTrackDisplay) {
-        fprintf(fp, ",%d,%s,%.*lf,%.*lf,%.*lf",
-            p.SupportsTearing,
-            PresentModeToString(p.PresentMode),
-            DBL_DIG - 1, msUntilRenderComplete,
-            DBL_DIG - 1, msUntilDisplayed,
-            DBL_DIG - 1, msBetweenDisplayChange);
+        row.AddInt(p.SupportsTearing);
+        row.AddString(PresentModeToString(p.PresentMode));
+        row.AddDouble(msUntilRenderComplete, DBL_DIG - 1);
+        row.AddDouble(msUntilDisplayed, DBL_DIG - 1);
+        row.AddDouble(msBetweenDisplayChange, DBL_DIG - 1);
     }
     if (args.mTrackDebug) {
-        fprintf(fp, ",%d,%d",
-            p.DriverBatchThreadId != 0,
-            p.DwmNotified);
+        row.AddInt(p.DriverBatchThreadId != 0);
+        row.AddInt(p.DwmNotified);
     }
     if (args.mOutputQpcTime) {
         if (args.mOutputQpcTimeInSeconds) {
-            fprintf(fp, ",%.*lf", DBL_DIG - 1, QpcDeltaToSeconds(p.QpcTime));
+            row.AddDouble(QpcDeltaToSeconds(p.QpcTime), DBL_DIG - 1);
         } else {
-            fprintf(fp, ",%llu", p.QpcTime);
+            row.AddUInt64(p.QpcTime);
         }
     }
-    fprintf(fp, "\n");
+    row.End();
+    outputCsv.mFile->EndRows(1, p.QpcTime, p.QpcTime);
 }
 
 /* This text is reproduced in the readme, modify both if there are changes:
@@ -176,6 +370,16 @@ with `-INDEX` appended to the file name.
 
 If `-include_mixed_reality` is used, a second CSV file will be generated with
 `_WMR` appended to the filename containing the WMR data.
+
+If `-columnar` is used, the frames are written in the columnar format instead,
+with a `.pmcf` extension by default.  The WMR data is still written as CSV.
+
+If `-rotate_size` or `-rotate_interval` is used, each output is split into
+segments with `-segNNNN` appended to the file names, and the segments are
+listed in a manifest named with `-manifest.csv` instead of the extension.
+
+If `-compress` is used, `.pmz` is appended to the names of all output files
+except the segment manifest, which is not compressed.
 */
 static void GenerateFilename(char const* processName, char* path)
 {
@@ -203,7 +407,7 @@ static void GenerateFilename(char const* processName, char* path)
         time_t time_now = time(NULL);
         localtime_s(&tm, &time_now);
         ADD_TO_PATH("PresentMon-%4d-%02d-%02dT%02d%02d%02d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
-        strcpy_s(ext, ".csv");
+        strcpy_s(ext, args.mOutputColumnar ? ".pmcf" : ".csv");
     }
 
     // Append -PROCESSNAME if applicable.
@@ -220,6 +424,102 @@ static void GenerateFilename(char const* processName, char* path)
     ADD_TO_PATH("%s", ext);
 }
 
+// Opens path for writing, or path.pmz if -compress is used.  Returns nullptr
+// if the file can't be opened.
+OutputFile* OpenOutputFile(char const* path, bool binary)
+{
+    auto const& args = GetCommandLineArgs();
+
+    char compressedPath[MAX_PATH] = {};
+    if (args.mOutputCompressed) {
+        _snprintf_s(compressedPath, _TRUNCATE, "%s.pmz", path);
+        path = compressedPath;
+        binary = true;
+    }
+
+    FILE* fp = nullptr;
+    if (fopen_s(&fp, path, binary ? "wb" : "w")) {
+        return nullptr;
+    }
+    return new OutputFile(fp, path, args.mOutputCompressed);
+}
+
+static bool IsRotatingOutput()
+{
+    auto const& args = GetCommandLineArgs();
+    return args.mRotateSizeMB != 0 || args.mRotateInterval != 0;
+}
+
+// Opens the output file at path (or stdout if path is nullptr) and, if
+// -track_mixed_reality is used, the WMR file next to it, and writes their
+// headers.
+static void OpenOutputFiles(OutputCsv* outputCsv, char const* path)
+{
+    auto const& args = GetCommandLineArgs();
+
+    if (path == nullptr) {
+        outputCsv->mFile = new OutputFile(stdout, "stdout", false);
+        outputCsv->mWmrFile = nullptr;      // WMR disallowed if -output_stdout
+    } else {
+        outputCsv->mFile = OpenOutputFile(path, args.mOutputColumnar);
+
+        if (args.mTrackWMR) {
+            outputCsv->mWmrFile = CreateLsrCsvFile(path);
+        }
+    }
+
+    if (outputCsv->mFile != nullptr) {
+        if (args.mOutputColumnar) {
+            int64_t qpcFrequency = 0;
+            int64_t startQpc = 0;
+            GetQpcFrequencyAndStart(&qpcFrequency, &startQpc);
+
+            outputCsv->mColumnarWriter = new ColumnarWriter;
+            AddColumnarColumns(outputCsv->mColumnarWriter);
+            outputCsv->mColumnarWriter->Open(outputCsv->mFile, qpcFrequency, startQpc);
+        } else {
+            WriteCsvHeader(outputCsv->mFile);
+        }
+    }
+}
+
+// Hands the output files to the writer thread to be closed.
+static void CloseOutputFiles(OutputCsv* outputCsv)
+{
+    if (outputCsv->mColumnarWriter != nullptr) {
+        outputCsv->mColumnarWriter->Close();
+        delete outputCsv->mColumnarWriter;
+    } else if (outputCsv->mFile != nullptr) {
+        CloseOutputFile(outputCsv->mFile);
+    }
+    if (outputCsv->mWmrFile != nullptr) {
+        CloseOutputFile(outputCsv->mWmrFile);
+    }
+
+    outputCsv->mFile = nullptr;
+    outputCsv->mWmrFile = nullptr;
+    outputCsv->mColumnarWriter = nullptr;
+}
+
+// Opens the files of the segment after the current one.  If they can't be
+// opened, the segments are kept and the next row tries the segment after that,
+// so the manifest and the earlier segments aren't overwritten by starting
+// over.
+static void OpenNextSegment(OutputCsv* outputCsv)
+{
+    auto segments = outputCsv->mSegments;
+    segments->mIndex += 1;
+    segments->mRowCount = 0;
+    segments->mProcesses.clear();
+
+    char path[MAX_PATH];
+    GetSegmentPath(segments, path);
+    OpenOutputFiles(outputCsv, path);
+    if (outputCsv->mFile == nullptr) {
+        CloseOutputFiles(outputCsv);
+    }
+}
+
 static OutputCsv CreateOutputCsv(char const* processName)
 {
     auto const& args = GetCommandLineArgs();
@@ -227,27 +527,89 @@ static OutputCsv CreateOutputCsv(char const* processName)
     OutputCsv outputCsv = {};
 
     if (args.mOutputCsvToStdout) {
-        outputCsv.mFile = stdout;
-        outputCsv.mWmrFile = nullptr;       // WMR disallowed if -output_stdout
-    } else {
-        char path[MAX_PATH];
-        GenerateFilename(processName, path);
+        OpenOutputFiles(&outputCsv, nullptr);
+        return outputCsv;
+    }
 
-        fopen_s(&outputCsv.mFile, path, "w");
+    char path[MAX_PATH];
+    GenerateFilename(processName, path);
 
-        if (args.mTrackWMR) {
-            outputCsv.mWmrFile = CreateLsrCsvFile(path);
-        }
+    if (!IsRotatingOutput()) {
+        OpenOutputFiles(&outputCsv, path);
+        return outputCsv;
     }
 
-    if (outputCsv.mFile != nullptr) {
-        WriteCsvHeader(outputCsv.mFile);
+    // The segments' names are based on the first one's, so they don't change
+    // if the name includes the time.
+    char drive[_MAX_DRIVE];
+    char dir[_MAX_DIR];
+    char name[_MAX_FNAME];
+    char ext[_MAX_EXT];
+    _splitpath_s(path, drive, dir, name, ext);
+
+    auto segments = new OutputSegments;
+    segments->mBasePath = std::string(drive) + dir + name;
+    segments->mExtension = ext;
+    segments->mManifest = nullptr;
+    segments->mIndex = 0;
+    segments->mEndQpc = 0;
+    segments->mRowCount = 0;
+    segments->mMinQpc = 0;
+    segments->mMaxQpc = 0;
+
+    char manifestPath[MAX_PATH];
+    _snprintf_s(manifestPath, _TRUNCATE, "%s-manifest.csv", segments->mBasePath.c_str());
+    FILE* fp = nullptr;
+    if (fopen_s(&fp, manifestPath, "w") == 0) {
+        segments->mManifest = new OutputFile(fp, manifestPath, false);
+        segments->mManifest->Printf("Segment,File,Rows,MinQPCTime,MaxQPCTime,MinTimeInSeconds,MaxTimeInSeconds,Processes\n");
     }
 
+    outputCsv.mSegments = segments;
+    OpenNextSegment(&outputCsv);
     return outputCsv;
 }
 
-OutputCsv GetOutputCsv(ProcessInfo* processInfo)
+// Starts a new segment if the current one has rows and has reached
+// -rotate_size, or the row at qpc is -rotate_interval after its first row.
+static void RotateOutputCsv(OutputCsv* outputCsv, uint64_t qpc)
+{
+    auto const& args = GetCommandLineArgs();
+
+    auto segments = outputCsv->mSegments;
+    if (segments == nullptr || segments->mRowCount == 0) {
+        return;
+    }
+
+    if (!(args.mRotateInterval != 0 && qpc >= segments->mEndQpc) &&
+        !(args.mRotateSizeMB != 0 && outputCsv->mFile->GetSize() >= (uint64_t) args.mRotateSizeMB * 1024 * 1024)) {
+        return;
+    }
+
+    CloseOutputFiles(outputCsv);
+    if (segments->mManifest != nullptr) {
+        WriteManifestRow(segments);
+    }
+
+    OpenNextSegment(outputCsv);
+}
+
+// CSV files are written whenever a whole buffer has been formatted (see
+// OutputWriter.hpp), but CSV output to stdout is handed to the writer thread
+// after every batch of events so it isn't held back.
+void FlushOutputCsv()
+{
+    auto const& args = GetCommandLineArgs();
+
+    if (args.mOutputCsvToStdout && gSingleOutputCsv.mFile != nullptr) {
+        gSingleOutputCsv.mFile->Flush();
+    }
+}
+
+// Returns processInfo's output files, opening them if necessary.  If rotate
+// is true, a new segment is started first if the row at qpc completes the
+// current one.
+static OutputCsv GetOutputCsv(ProcessInfo* processInfo, bool rotate, uint64_t qpc)
 {
     auto const& args = GetCommandLineArgs();
 
@@ -255,14 +617,20 @@ OutputCsv GetOutputCsv(ProcessInfo* processInfo)
     // every time PresentMon wants to output to the file. We should detect the
     // failure and generate an error instead.
 
-    if (args.mOutputCsvToFile && processInfo->mOutputCsv.mFile == nullptr) {
-        if (args.mMultiCsv) {
-            processInfo->mOutputCsv = CreateOutputCsv(processInfo->mModuleName.c_str());
-        } else {
-            if (gSingleOutputCsv.mFile == nullptr) {
-                gSingleOutputCsv = CreateOutputCsv(nullptr);
+    if (args.mOutputCsvToFile) {
+        auto outputCsv = args.mMultiCsv ? &processInfo->mOutputCsv : &gSingleOutputCsv;
+        if (outputCsv->mFile != nullptr) {
+            if (rotate) {
+                RotateOutputCsv(outputCsv, qpc);
             }
+        } else if (outputCsv->mSegments != nullptr) {
+            OpenNextSegment(outputCsv);
+        } else {
+            *outputCsv = CreateOutputCsv(args.mMultiCsv ? processInfo->mModuleName->c_str() : nullptr);
+        }
 
+        if (!args.mMultiCsv) {
+            // Copied every time, since rotation replaces the files.
             processInfo->mOutputCsv = gSingleOutputCsv;
         }
     }
@@ -270,6 +638,13 @@ OutputCsv GetOutputCsv(ProcessInfo* processInfo)
     return processInfo->mOutputCsv;
 }
 
+// Only frames start new segments, since the manifest only counts frames;
+// WMR rows go to the current segment's WMR file.
+OutputCsv GetOutputCsv(ProcessInfo* processInfo)
+{
+    return GetOutputCsv(processInfo, false, 0);
+}
+
 void CloseOutputCsv(ProcessInfo* processInfo)
 {
     auto const& args = GetCommandLineArgs();
@@ -277,29 +652,28 @@ void CloseOutputCsv(ProcessInfo* processInfo)
     // If processInfo is nullptr, it means we should operate on the global
     // single output CSV.
     //
-    // We only actually close the FILE if we own it (we're operating on the
-    // single global output CSV, or we're writing a CSV per process) and it's
-    // not stdout.
+    // We only actually close the files if we own them (we're operating on the
+    // single global output CSV, or we're writing a CSV per process).  The
+    // writer thread finishes writing them, and closes them unless they are
+    // stdout.
     OutputCsv* csv = nullptr;
     bool closeFile = false;
     if (processInfo == nullptr) {
         csv = &gSingleOutputCsv;
-        closeFile = !args.mOutputCsvToStdout;
+        closeFile = true;
     } else {
         csv = &processInfo->mOutputCsv;
-        closeFile = !args.mOutputCsvToStdout && args.mMultiCsv;
+        closeFile = args.mMultiCsv;
     }
 
     if (closeFile) {
-        if (csv->mFile != nullptr) {
-            fclose(csv->mFile);
-        }
-        if (csv->mWmrFile != nullptr) {
-            fclose(csv->mWmrFile);
-        }
+        CloseOutputFiles(csv);
+        CloseOutputSegments(csv);
     }
 
     csv->mFile = nullptr;
     csv->mWmrFile = nullptr;
+    csv->mColumnarWriter = nullptr;
+    csv->mSegments = nullptr;
 }
 
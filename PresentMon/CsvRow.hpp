@@ -0,0 +1,259 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "OutputWriter.hpp"
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// CsvRow formats one CSV row into a local buffer and writes it to the
+// OutputFile with a single Write(), instead of parsing a format string for
+// every fprintf() call.  The output is identical to the printf() conversions
+// noted on each Add*() function.
+//
+// Fixed-precision doubles are formatted with integer arithmetic (see
+// FormatFixed()) rather than printf()'s general-purpose, locale-aware path,
+// but produce the same digits: the exact binary value correctly rounded
+// (ties to even) to the requested number of decimals.
+
+enum {
+    CSV_ROW_BUFFER_SIZE  = 2048,
+    CSV_MAX_INTEGER_SIZE = 24,          // Largest formatted integer, including sign or 0x prefix
+    CSV_MAX_FIXED_SIZE   = 330,         // Largest FormatFixed() output: sign, 309 integer digits, '.', 15 decimals, and null
+};
+
+namespace CsvFormat {
+
+// Writes the decimal digits of value to p and returns the end.
+inline char* FormatUInt(char* p, uint64_t value)
+{
+    char digits[20];
+    auto d = digits + sizeof(digits);
+    do {
+        *--d = (char) ('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    auto n = (size_t) (digits + sizeof(digits) - d);
+    memcpy(p, d, n);
+    return p + n;
+}
+
+// Writes value to p using exactly digitCount digits (with leading zeros) and
+// returns the end.
+inline char* FormatUIntFixedWidth(char* p, uint64_t value, uint32_t digitCount)
+{
+    for (auto d = p + digitCount; d != p; ) {
+        *--d = (char) ('0' + value % 10);
+        value /= 10;
+    }
+    return p + digitCount;
+}
+
+// Returns the upper 64 bits of a * b, and the lower 64 bits in *lo.
+inline uint64_t Multiply64(uint64_t a, uint64_t b, uint64_t* lo)
+{
+    uint64_t a0 = (uint32_t) a, a1 = a >> 32;
+    uint64_t b0 = (uint32_t) b, b1 = b >> 32;
+    uint64_t p00 = a0 * b0;
+    uint64_t p01 = a0 * b1;
+    uint64_t p10 = a1 * b0;
+    uint64_t p11 = a1 * b1;
+    uint64_t mid = (p00 >> 32) + (uint32_t) p01 + (uint32_t) p10;
+    *lo = (mid << 32) | (uint32_t) p00;
+    return p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+}
+
+// Rounds fraction (0 <= fraction < 1) to decimals digits, ties to even, and
+// returns the digits as an integer (which is 10^decimals if it rounded up to
+// 1).  scale is 10^decimals, and oddInteger is whether the integer part is odd
+// (which decides ties when there are no decimals).
+//
+// The fraction is exactly m * 2^-s, with an integer m < 2^53 and s >= 53, so
+// fraction * 10^decimals = (m * 10^decimals) >> s, which is computed exactly
+// with 128-bit integer arithmetic.
+inline uint64_t RoundFraction(double fraction, uint64_t scale, bool oddInteger)
+{
+    if (fraction == 0.0) {
+        return 0;
+    }
+
+    int e = 0;
+    auto m = (uint64_t) ldexp(frexp(fraction, &e), 53);
+    auto s = (uint32_t) (53 - e);
+
+    uint64_t lo = 0;
+    auto hi = Multiply64(m, scale, &lo);
+
+    // Split the product into the integer result q, the first discarded bit
+    // (round), and whether any other discarded bits are set (sticky).
+    uint64_t q = 0;
+    bool round = false;
+    bool sticky = false;
+    if (s < 64) {
+        q = (hi << (64 - s)) | (lo >> s);
+        round = ((lo >> (s - 1)) & 1) != 0;
+        sticky = (lo & ((1ull << (s - 1)) - 1)) != 0;
+    } else if (s == 64) {
+        q = hi;
+        round = (lo >> 63) != 0;
+        sticky = (lo & ~(1ull << 63)) != 0;
+    } else if (s < 128) {
+        q = hi >> (s - 64);
+        round = ((hi >> (s - 65)) & 1) != 0;
+        sticky = (hi & ((1ull << (s - 65)) - 1)) != 0 || lo != 0;
+    } else {
+        // The product is < 2^103, so the result is < 1/2 and rounds to zero.
+    }
+
+    auto odd = scale == 1 ? oddInteger : (q & 1) != 0;
+    if (round && (sticky || odd)) {
+        q += 1;
+    }
+    return q;
+}
+
+// Writes value to p as printf("%.*f", decimals, value) would, and returns the
+// end.  decimals must be <= 15, and p must have room for CSV_MAX_FIXED_SIZE
+// chars.
+inline char* FormatFixed(char* p, double value, uint32_t decimals)
+{
+    static uint64_t const POW10[] = {
+        1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull,
+        1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull,
+        100000000000000ull, 1000000000000000ull,
+    };
+    assert(decimals < sizeof(POW10) / sizeof(POW10[0]));
+
+    // Values that are not finite, or too large for the integer part to fit
+    // in 53 bits, are rare enough to leave to printf().
+    auto a = fabs(value);
+    if (!(a < 9007199254740992.0)) {
+        return p + snprintf(p, CSV_MAX_FIXED_SIZE, "%.*f", (int) decimals, value);
+    }
+
+    if (signbit(value)) {
+        *p++ = '-';
+    }
+
+    auto integer = floor(a);
+    auto i = (uint64_t) integer;
+    auto f = RoundFraction(a - integer, POW10[decimals], (i & 1) != 0);
+    if (f == POW10[decimals]) {
+        i += 1;
+        f = 0;
+    }
+
+    p = FormatUInt(p, i);
+    if (decimals > 0) {
+        *p++ = '.';
+        p = FormatUIntFixedWidth(p, f, decimals);
+    }
+    return p;
+}
+
+}
+
+class CsvRow {
+    OutputFile* mFile;
+    char* mEnd;
+    bool mFirstField;
+    char mBuffer[CSV_ROW_BUFFER_SIZE];
+
+    void Flush()
+    {
+        mFile->Write(mBuffer, (size_t) (mEnd - mBuffer));
+        mEnd = mBuffer;
+    }
+
+    // Returns a pointer to at least size bytes of buffer space, preceded by a
+    // separator if this isn't the first field.
+    char* BeginField(size_t size)
+    {
+        if (size + 1 > (size_t) (mBuffer + sizeof(mBuffer) - mEnd)) {
+            Flush();
+        }
+        if (!mFirstField) {
+            *mEnd++ = ',';
+        }
+        mFirstField = false;
+        return mEnd;
+    }
+
+public:
+    explicit CsvRow(OutputFile* file)
+        : mFile(file)
+        , mEnd(mBuffer)
+        , mFirstField(true)
+    {
+    }
+
+    CsvRow(CsvRow const&) = delete;
+    CsvRow& operator=(CsvRow const&) = delete;
+
+    // %s
+    void AddString(char const* s, size_t length)
+    {
+        if (length + 1 > sizeof(mBuffer)) {
+            BeginField(0);
+            Flush();
+            mFile->Write(s, length);
+            return;
+        }
+        auto p = BeginField(length);
+        memcpy(p, s, length);
+        mEnd = p + length;
+    }
+
+    void AddString(char const* s) { AddString(s, strlen(s)); }
+
+    // %d
+    void AddInt(int32_t value)
+    {
+        auto p = BeginField(CSV_MAX_INTEGER_SIZE);
+        if (value < 0) {
+            *p++ = '-';
+        }
+        mEnd = CsvFormat::FormatUInt(p, value < 0 ? 0ull - (uint64_t) (int64_t) value : (uint64_t) value);
+    }
+
+    // %llu
+    void AddUInt64(uint64_t value)
+    {
+        mEnd = CsvFormat::FormatUInt(BeginField(CSV_MAX_INTEGER_SIZE), value);
+    }
+
+    // 0x%016llX
+    void AddHex64(uint64_t value)
+    {
+        static char const HEX_DIGITS[] = "0123456789ABCDEF";
+        auto p = BeginField(CSV_MAX_INTEGER_SIZE);
+        *p++ = '0';
+        *p++ = 'x';
+        for (int shift = 60; shift >= 0; shift -= 4) {
+            *p++ = HEX_DIGITS[(value >> shift) & 0xf];
+        }
+        mEnd = p;
+    }
+
+    // %.*lf
+    void AddDouble(double value, uint32_t decimals)
+    {
+        mEnd = CsvFormat::FormatFixed(BeginField(CSV_MAX_FIXED_SIZE), value, decimals);
+    }
+
+    // Ends the row and writes it to the file.
+    void End()
+    {
+        if (mEnd == mBuffer + sizeof(mBuffer)) {
+            Flush();
+        }
+        *mEnd++ = '\n';
+        Flush();
+    }
+};
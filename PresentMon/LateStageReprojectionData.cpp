@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: MIT
 
 #include "PresentMon.hpp"
+#include "CsvRow.hpp"
 
 #include <algorithm>
 
@@ -182,7 +183,7 @@ LateStageReprojectionRuntimeStats LateStageReprojectionData::ComputeRuntimeStats
     return stats;
 }
 
-FILE* CreateLsrCsvFile(char const* path)
+OutputFile* CreateLsrCsvFile(char const* path)
 {
     auto const& args = GetCommandLineArgs();
 
@@ -193,48 +194,50 @@ FILE* CreateLsrCsvFile(char const* path)
     char ext[_MAX_EXT];
     _splitpath_s(path, drive, dir, name, ext);
 
+    // The WMR data is always CSV, even if the frames are written in the
+    // columnar format.
     char outputPath[MAX_PATH] = {};
-    _snprintf_s(outputPath, _TRUNCATE, "%s%s%s_WMR%s", drive, dir, name, ext);
+    _snprintf_s(outputPath, _TRUNCATE, "%s%s%s_WMR%s", drive, dir, name, args.mOutputColumnar ? ".csv" : ext);
 
     // Open output file
-    FILE* fp = nullptr;
-    if (fopen_s(&fp, outputPath, "w")) {
+    auto file = OpenOutputFile(outputPath, false);
+    if (file == nullptr) {
         return nullptr;
     }
 
     // Print CSV header
-    fprintf(fp, "Application,ProcessID,DwmProcessID");
+    file->Printf("Application,ProcessID,DwmProcessID");
     if (args.mTrackDebug) {
-        fprintf(fp, ",HolographicFrameID");
+        file->Printf(",HolographicFrameID");
     }
-    fprintf(fp, ",TimeInSeconds");
+    file->Printf(",TimeInSeconds");
     if (args.mTrackDisplay) {
-        fprintf(fp, ",msBetweenAppPresents,msAppPresentToLsr");
+        file->Printf(",msBetweenAppPresents,msAppPresentToLsr");
     }
-    fprintf(fp, ",msBetweenLsrs,AppMissed,LsrMissed");
+    file->Printf(",msBetweenLsrs,AppMissed,LsrMissed");
     if (args.mTrackDebug) {
-        fprintf(fp, ",msSourceReleaseFromRenderingToLsrAcquire,msAppCpuRenderFrame");
+        file->Printf(",msSourceReleaseFromRenderingToLsrAcquire,msAppCpuRenderFrame");
     }
-    fprintf(fp, ",msAppPoseLatency");
+    file->Printf(",msAppPoseLatency");
     if (args.mTrackDebug) {
-        fprintf(fp, ",msAppMisprediction,msLsrCpuRenderFrame");
+        file->Printf(",msAppMisprediction,msLsrCpuRenderFrame");
     }
-    fprintf(fp, ",msLsrPoseLatency,msActualLsrPoseLatency,msTimeUntilVsync,msLsrThreadWakeupToGpuEnd,msLsrThreadWakeupError");
+    file->Printf(",msLsrPoseLatency,msActualLsrPoseLatency,msTimeUntilVsync,msLsrThreadWakeupToGpuEnd,msLsrThreadWakeupError");
     if (args.mTrackDebug) {
-        fprintf(fp, ",msLsrThreadWakeupToCpuRenderFrameStart,msCpuRenderFrameStartToHeadPoseCallbackStart,msGetHeadPose,msHeadPoseCallbackStopToInputLatch,msInputLatchToGpuSubmission");
+        file->Printf(",msLsrThreadWakeupToCpuRenderFrameStart,msCpuRenderFrameStartToHeadPoseCallbackStart,msGetHeadPose,msHeadPoseCallbackStopToInputLatch,msInputLatchToGpuSubmission");
     }
-    fprintf(fp, ",msLsrPreemption,msLsrExecution,msCopyPreemption,msCopyExecution,msGpuEndToVsync");
-    fprintf(fp, "\n");
+    file->Printf(",msLsrPreemption,msLsrExecution,msCopyPreemption,msCopyExecution,msGpuEndToVsync");
+    file->Printf("\n");
 
-    return fp;
+    return file;
 }
 
 void UpdateLsrCsv(LateStageReprojectionData& lsr, ProcessInfo* proc, LateStageReprojectionEvent& p)
 {
     auto const& args = GetCommandLineArgs();
 
-    auto fp = GetOutputCsv(proc).mWmrFile;
-    if (fp == nullptr) {
+    auto file = GetOutputCsv(proc).mWmrFile;
+    if (file == nullptr) {
         return;
     }
 
@@ -252,11 +255,14 @@ void UpdateLsrCsv(LateStageReprojectionData& lsr, ProcessInfo* proc, LateStageRe
     const double deltaMilliseconds = 1000.0 * QpcDeltaToSeconds(curr.QpcTime - prev.QpcTime);
     const double timeInSeconds = QpcToSeconds(p.QpcTime);
 
-    fprintf(fp, "%s,%d,%d", proc->mModuleName.c_str(), curr.GetAppProcessId(), curr.ProcessId);
+    CsvRow row(file);
+    row.AddString(proc->mModuleName->c_str(), proc->mModuleName->size());
+    row.AddInt(curr.GetAppProcessId());
+    row.AddInt(curr.ProcessId);
     if (args.mTrackDebug) {
-        fprintf(fp, ",%d", curr.GetAppFrameId());
+        row.AddInt(curr.GetAppFrameId());
     }
-    fprintf(fp, ",%.6lf", timeInSeconds);
+    row.AddDouble(timeInSeconds, 6);
     if (args.mTrackDisplay) {
         double appPresentDeltaMilliseconds = 0.0;
         double appPresentToLsrMilliseconds = 0.0;
@@ -269,37 +275,40 @@ void UpdateLsrCsv(LateStageReprojectionData& lsr, ProcessInfo* proc, LateStageRe
                 appPresentDeltaMilliseconds = 1000.0 * QpcDeltaToSeconds(currAppPresentTime - prevAppPresentTime);
             }
         }
-        fprintf(fp, ",%.6lf,%.6lf", appPresentDeltaMilliseconds, appPresentToLsrMilliseconds);
+        row.AddDouble(appPresentDeltaMilliseconds, 6);
+        row.AddDouble(appPresentToLsrMilliseconds, 6);
     }
-    fprintf(fp, ",%.6lf,%d,%d", deltaMilliseconds, !curr.NewSourceLatched, curr.MissedVsyncCount);
+    row.AddDouble(deltaMilliseconds, 6);
+    row.AddInt(!curr.NewSourceLatched);
+    row.AddInt(curr.MissedVsyncCount);
     if (args.mTrackDebug) {
-        fprintf(fp, ",%.6lf,%.6lf", 1000 * QpcDeltaToSeconds(curr.Source.GetReleaseFromRenderingToAcquireForPresentationTime()), 1000.0 * QpcDeltaToSeconds(curr.GetAppCpuRenderFrameTime()));
+        row.AddDouble(1000 * QpcDeltaToSeconds(curr.Source.GetReleaseFromRenderingToAcquireForPresentationTime()), 6);
+        row.AddDouble(1000.0 * QpcDeltaToSeconds(curr.GetAppCpuRenderFrameTime()), 6);
     }
-    fprintf(fp, ",%.6lf", curr.AppPredictionLatencyMs);
+    row.AddDouble(curr.AppPredictionLatencyMs, 6);
     if (args.mTrackDebug) {
-        fprintf(fp, ",%.6lf,%.6lf", curr.AppMispredictionMs, curr.GetLsrCpuRenderFrameMs());
+        row.AddDouble(curr.AppMispredictionMs, 6);
+        row.AddDouble(curr.GetLsrCpuRenderFrameMs(), 6);
     }
-    fprintf(fp, ",%.6lf,%.6lf,%.6lf,%.6lf,%.6lf",
-        curr.LsrPredictionLatencyMs,
-        curr.GetLsrMotionToPhotonLatencyMs(),
-        curr.TimeUntilVsyncMs,
-        curr.GetLsrThreadWakeupStartLatchToGpuEndMs(),
-        curr.TotalWakeupErrorMs);
+    row.AddDouble(curr.LsrPredictionLatencyMs, 6);
+    row.AddDouble(curr.GetLsrMotionToPhotonLatencyMs(), 6);
+    row.AddDouble(curr.TimeUntilVsyncMs, 6);
+    row.AddDouble(curr.GetLsrThreadWakeupStartLatchToGpuEndMs(), 6);
+    row.AddDouble(curr.TotalWakeupErrorMs, 6);
     if (args.mTrackDebug) {
-        fprintf(fp, ",%.6lf,%.6lf,%.6lf,%.6lf,%.6lf",
-            curr.ThreadWakeupStartLatchToCpuRenderFrameStartInMs,
-            curr.CpuRenderFrameStartToHeadPoseCallbackStartInMs,
-            curr.HeadPoseCallbackStartToHeadPoseCallbackStopInMs,
-            curr.HeadPoseCallbackStopToInputLatchInMs,
-            curr.InputLatchToGpuSubmissionInMs);
+        row.AddDouble(curr.ThreadWakeupStartLatchToCpuRenderFrameStartInMs, 6);
+        row.AddDouble(curr.CpuRenderFrameStartToHeadPoseCallbackStartInMs, 6);
+        row.AddDouble(curr.HeadPoseCallbackStartToHeadPoseCallbackStopInMs, 6);
+        row.AddDouble(curr.HeadPoseCallbackStopToInputLatchInMs, 6);
+        row.AddDouble(curr.InputLatchToGpuSubmissionInMs, 6);
     }
-    fprintf(fp, ",%.6lf,%.6lf,%.6lf,%.6lf,%.6lf",
-        curr.GpuSubmissionToGpuStartInMs,
-        curr.GpuStartToGpuStopInMs,
-        curr.GpuStopToCopyStartInMs,
-        curr.CopyStartToCopyStopInMs,
-        curr.CopyStopToVsyncInMs);
-    fprintf(fp, "\n");
+    row.AddDouble(curr.GpuSubmissionToGpuStartInMs, 6);
+    row.AddDouble(curr.GpuStartToGpuStopInMs, 6);
+    row.AddDouble(curr.GpuStopToCopyStartInMs, 6);
+    row.AddDouble(curr.CopyStartToCopyStopInMs, 6);
+    row.AddDouble(curr.CopyStopToVsyncInMs, 6);
+    row.End();
+    file->EndRows(1, p.QpcTime, p.QpcTime);
 }
 
 void UpdateConsole(std::unordered_map<uint32_t, ProcessInfo> const& activeProcesses, LateStageReprojectionData& lsr)
@@ -322,7 +331,7 @@ void UpdateConsole(std::unordered_map<uint32_t, ProcessInfo> const& activeProces
             if (args.mTrackDisplay) {
                 auto processIter = activeProcesses.find(runtimeStats.mAppProcessId);
                 ConsolePrintLn("    App - %s[%d]:",
-                    processIter == activeProcesses.end() ? "<error>" : processIter->second.mModuleName.c_str(),
+                    processIter == activeProcesses.end() ? "<error>" : processIter->second.mModuleName->c_str(),
                     runtimeStats.mAppProcessId);
                 ConsolePrint("        %.2lf ms/frame (%.1lf fps, %.2lf ms CPU", 1000.0 / fps, fps, runtimeStats.mAppSourceCpuRenderTimeInMs);
             } else {
@@ -347,7 +356,7 @@ void UpdateConsole(std::unordered_map<uint32_t, ProcessInfo> const& activeProces
             auto processIter = activeProcesses.find(runtimeStats.mLsrProcessId);
 
             ConsolePrintLn("    Compositor - %s[%d]:",
-                processIter == activeProcesses.end() ? "<error>" : processIter->second.mModuleName.c_str(),
+                processIter == activeProcesses.end() ? "<error>" : processIter->second.mModuleName->c_str(),
                 runtimeStats.mLsrProcessId);
             ConsolePrintLn("        %.2lf ms/frame (%.1lf fps, %.1lf displayed fps, %.2lf ms CPU)",
                 1000.0 / fps,
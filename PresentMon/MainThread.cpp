@@ -203,6 +203,12 @@ int main(int argc, char** argv)
         return 7;
     }
 
+    // Special case handling for -batch, which analyzes each input file in a
+    // separate PresentMon process.
+    if (!args.mBatchInputs.empty()) {
+        return RunBatch();
+    }
+
     // Attempt to elevate process privilege if necessary.
     //
     // If we are processing an ETL file we don't need elevated privilege, but
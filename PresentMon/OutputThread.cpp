@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: MIT
 
 #include "PresentMon.hpp"
+#include "OutputWriter.hpp"
 
 #include <algorithm>
 #include <shlwapi.h>
@@ -10,6 +11,9 @@
 static std::thread gThread;
 static bool gQuit = false;
 
+// The frame statistics of exited processes, for the end-of-run summary.
+static std::vector<ProcessSummary> gProcessSummaries;
+
 // When we collect realtime ETW events, we don't receive the events in real
 // time but rather sometime after they occur.  Since the user might be toggling
 // recording based on realtime cues (e.g., watching the target application) we
@@ -88,6 +92,58 @@ static void UpdateRecordingToggles(size_t nextIndex)
 static std::unordered_map<uint32_t, ProcessInfo> gProcesses;
 static uint32_t gTargetProcessCount = 0;
 
+// The module names of processes found during realtime collection.  The names
+// of processes from NT_Process events are interned by the consumer instead.
+static std::unordered_set<std::string> gModuleNames;
+
+// The process and SwapChainData of each PresentEvent::SwapChainId, so that
+// presents can be added to their swap chain without looking up either one.
+// mSwapChain is nullptr if the process is not a target process, and the
+// entries are cleared when their process is removed from gProcesses.  The
+// consumer reuses the IDs of swap chains that have no presents in progress,
+// so an entry is replaced if it is for a different swap chain than the
+// present's.
+struct SwapChainEntry {
+    ProcessInfo* mProcessInfo;
+    SwapChainData* mSwapChain;
+    uint32_t mProcessId;
+    uint64_t mSwapChainAddress;
+};
+
+static std::vector<SwapChainEntry> gSwapChains;
+
+// The swap chains with presents in their history, in a min-heap ordered by
+// the QPC of their oldest present, so that PruneHistory() only visits the
+// swap chains that have presents to expire.  A swap chain is pushed when a
+// present is added to its empty history, and pushed again by PruneHistory()
+// if presents remain after it is pruned.  Entries are looked up by process
+// and swap chain address when popped, and are skipped if the swap chain no
+// longer exists.  An entry's QPC can be older than its swap chain's oldest
+// present (e.g., if the history was full), in which case it is pushed again
+// with the current one.
+struct HistoryExpiry {
+    uint64_t mOldestQpc;
+    uint32_t mProcessId;
+    uint64_t mSwapChainAddress;
+};
+
+// std::push_heap() etc. keep the largest entry at the front, so order entries
+// in reverse to keep the oldest entry there instead.
+struct ExpiresLater {
+    bool operator()(HistoryExpiry const& a, HistoryExpiry const& b) const
+    {
+        return a.mOldestQpc > b.mOldestQpc;
+    }
+};
+
+static std::vector<HistoryExpiry> gHistoryExpiries;
+
+static void PushHistoryExpiry(uint64_t oldestQpc, uint32_t processId, uint64_t swapChainAddress)
+{
+    gHistoryExpiries.push_back({ oldestQpc, processId, swapChainAddress });
+    std::push_heap(gHistoryExpiries.begin(), gHistoryExpiries.end(), ExpiresLater());
+}
+
 static bool IsTargetProcess(uint32_t processId, std::string const& processName)
 {
     auto const& args = GetCommandLineArgs();
@@ -119,15 +175,17 @@ static bool IsTargetProcess(uint32_t processId, std::string const& processName)
     return false;
 }
 
-static void InitProcessInfo(ProcessInfo* processInfo, uint32_t processId, HANDLE handle, std::string const& processName)
+static void InitProcessInfo(ProcessInfo* processInfo, uint32_t processId, HANDLE handle, std::string const* processName)
 {
-    auto target = IsTargetProcess(processId, processName);
+    auto target = IsTargetProcess(processId, *processName);
 
-    processInfo->mHandle             = handle;
-    processInfo->mModuleName         = processName;
-    processInfo->mOutputCsv.mFile    = nullptr;
-    processInfo->mOutputCsv.mWmrFile = nullptr;
-    processInfo->mTargetProcess      = target;
+    processInfo->mHandle                    = handle;
+    processInfo->mModuleName                = processName;
+    processInfo->mOutputCsv.mFile           = nullptr;
+    processInfo->mOutputCsv.mWmrFile        = nullptr;
+    processInfo->mOutputCsv.mColumnarWriter = nullptr;
+    processInfo->mOutputCsv.mSegments       = nullptr;
+    processInfo->mTargetProcess             = target;
 
     if (target) {
         gTargetProcessCount += 1;
@@ -161,12 +219,55 @@ static ProcessInfo* GetProcessInfo(uint32_t processId)
             }
         }
 
-        InitProcessInfo(processInfo, processId, handle, processName);
+        InitProcessInfo(processInfo, processId, handle, &*gModuleNames.emplace(processName).first);
     }
 
     return processInfo;
 }
 
+static SwapChainEntry const& GetSwapChainEntry(PresentEvent const& p)
+{
+    if (p.SwapChainId >= gSwapChains.size()) {
+        gSwapChains.resize(p.SwapChainId + 1, SwapChainEntry());
+    }
+
+    auto entry = &gSwapChains[p.SwapChainId];
+    if (entry->mProcessInfo == nullptr || entry->mProcessId != p.ProcessId || entry->mSwapChainAddress != p.SwapChainAddress) {
+        auto processInfo = GetProcessInfo(p.ProcessId);
+        if (entry->mProcessInfo != processInfo) {
+            if (entry->mProcessInfo != nullptr) {
+                auto ids = &entry->mProcessInfo->mSwapChainIds;
+                ids->erase(std::find(ids->begin(), ids->end(), p.SwapChainId));
+            }
+            processInfo->mSwapChainIds.push_back(p.SwapChainId);
+        }
+        entry->mProcessInfo = processInfo;
+        entry->mSwapChain = nullptr;
+        entry->mProcessId = p.ProcessId;
+        entry->mSwapChainAddress = p.SwapChainAddress;
+
+        // The swap chain may already have a SwapChainData if its ID was
+        // released and it was given a new one.
+        if (processInfo->mTargetProcess) {
+            auto chainIter = processInfo->mSwapChain.find(p.SwapChainAddress);
+            if (chainIter == processInfo->mSwapChain.end()) {
+                auto chain = &processInfo->mSwapChain[p.SwapChainAddress];
+                chain->mPresentHistoryCount = 0;
+                chain->mNextPresentIndex = 1; // Start at 1 so that mLastDisplayedPresentIndex starts out invalid.
+                chain->mLastDisplayedPresentIndex = 0;
+                chain->mDisplayedCount = 0;
+                chain->mDisplayDeltaSum = 0;
+                chain->mDisplayLatencySum = 0;
+                entry->mSwapChain = chain;
+            } else {
+                entry->mSwapChain = &chainIter->second;
+            }
+        }
+    }
+
+    return *entry;
+}
+
 // Check if any realtime processes terminated and add them to the terminated
 // list.
 //
@@ -190,6 +291,35 @@ static void CheckForTerminatedRealtimeProcesses(std::vector<std::pair<uint32_t,
     }
 }
 
+// Merge the frame statistics of all the process' swap chains into a
+// ProcessSummary for the end-of-run summary.
+static void AddProcessSummary(uint32_t processId, ProcessInfo const& processInfo)
+{
+    auto const& args = GetCommandLineArgs();
+
+    if (args.mConsoleOutputType == ConsoleOutput::None ||
+        !processInfo.mTargetProcess ||
+        processInfo.mSwapChain.empty()) {
+        return;
+    }
+
+    gProcessSummaries.emplace_back();
+    auto summary = &gProcessSummaries.back();
+    summary->mModuleName = *processInfo.mModuleName;
+    summary->mProcessId = processId;
+    summary->mSwapChainCount = (uint32_t) processInfo.mSwapChain.size();
+    for (auto const& pair : processInfo.mSwapChain) {
+        auto const& chain = pair.second;
+        summary->mPresentIntervals.Merge(chain.mPresentIntervals);
+        summary->mDisplayIntervals.Merge(chain.mDisplayIntervals);
+        summary->mDisplayLatencies.Merge(chain.mDisplayLatencies);
+    }
+
+    if (summary->mPresentIntervals.GetCount() == 0) {
+        gProcessSummaries.pop_back();
+    }
+}
+
 static void HandleTerminatedProcess(uint32_t processId)
 {
     auto const& args = GetCommandLineArgs();
@@ -204,6 +334,8 @@ static void HandleTerminatedProcess(uint32_t processId)
         // Close this process' CSV.
         CloseOutputCsv(processInfo);
 
+        AddProcessSummary(processId, *processInfo);
+
         // Quit if this is the last process tracked for -terminate_on_proc_exit.
         gTargetProcessCount -= 1;
         if (args.mTerminateOnProcExit && gTargetProcessCount == 0) {
@@ -211,6 +343,10 @@ static void HandleTerminatedProcess(uint32_t processId)
         }
     }
 
+    for (auto swapChainId : processInfo->mSwapChainIds) {
+        gSwapChains[swapChainId] = SwapChainEntry();
+    }
+
     gProcesses.erase(iter);
 }
 
@@ -234,12 +370,97 @@ static void UpdateProcesses(std::vector<ProcessEvent> const& processEvents, std:
     }
 }
 
-static void AddPresents(std::vector<std::shared_ptr<PresentEvent>> const& presentEvents, size_t* presentEventIndex,
+// Add the present's frame statistics to the swap chain's sketches.  This must
+// be called before the present is added to the swap chain's history.
+static void UpdateStatistics(SwapChainData* chain, PresentEvent const& p)
+{
+    auto const& args = GetCommandLineArgs();
+
+    if (chain->mPresentHistoryCount == 0) {
+        return;
+    }
+
+    auto const& lastPresented = chain->mPresentHistory[(chain->mNextPresentIndex - 1) % SwapChainData::PRESENT_HISTORY_MAX_COUNT];
+    if (p.QpcTime >= lastPresented.mQpcTime) {
+        chain->mPresentIntervals.Add(p.QpcTime - lastPresented.mQpcTime);
+    }
+
+    if (args.mTrackDisplay && p.FinalState == PresentResult::Presented && p.ScreenTime >= p.QpcTime) {
+        chain->mDisplayLatencies.Add(p.ScreenTime - p.QpcTime);
+
+        if (chain->mDisplayedCount > 0) {
+            auto const& lastDisplayed = chain->mPresentHistory[chain->mLastDisplayedPresentIndex % SwapChainData::PRESENT_HISTORY_MAX_COUNT];
+            if (p.ScreenTime >= lastDisplayed.mScreenTime) {
+                chain->mDisplayIntervals.Add(p.ScreenTime - lastDisplayed.mScreenTime);
+            }
+        }
+    }
+}
+
+// Remove the oldest present from the swap chain's history, and from its
+// running sums.  If it was the last displayed present, there are no displayed
+// presents left in the history.
+static void ExpireOldestPresent(SwapChainData* chain)
+{
+    auto index = chain->mNextPresentIndex - chain->mPresentHistoryCount;
+    auto const& oldest = chain->mPresentHistory[index % SwapChainData::PRESENT_HISTORY_MAX_COUNT];
+    if (oldest.mDisplayed) {
+        chain->mDisplayedCount -= 1;
+        chain->mDisplayDeltaSum -= oldest.mNextDisplayDelta;
+        chain->mDisplayLatencySum -= oldest.mScreenTime - oldest.mQpcTime;
+    }
+    if (index == chain->mLastDisplayedPresentIndex) {
+        chain->mLastDisplayedPresentIndex = 0;
+    }
+    chain->mPresentHistoryCount -= 1;
+}
+
+// Add the present to the swap chain's history, replacing the oldest present
+// if the history is full.
+static void AddPresentToHistory(SwapChainData* chain, PresentEvent const& p)
+{
+    if (chain->mPresentHistoryCount == SwapChainData::PRESENT_HISTORY_MAX_COUNT) {
+        ExpireOldestPresent(chain);
+    }
+
+    auto index = chain->mNextPresentIndex;
+    auto summary = &chain->mPresentHistory[index % SwapChainData::PRESENT_HISTORY_MAX_COUNT];
+    summary->mQpcTime = p.QpcTime;
+    summary->mScreenTime = p.ScreenTime;
+    summary->mNextDisplayDelta = 0;
+    summary->mSyncInterval = p.SyncInterval;
+    summary->mPresentFlags = p.PresentFlags;
+    summary->mRuntime = p.Runtime;
+    summary->mPresentMode = p.PresentMode;
+    summary->mDisplayed = p.FinalState == PresentResult::Presented;
+
+    if (summary->mDisplayed) {
+        if (chain->mDisplayedCount > 0) {
+            auto lastDisplayed = &chain->mPresentHistory[chain->mLastDisplayedPresentIndex % SwapChainData::PRESENT_HISTORY_MAX_COUNT];
+            lastDisplayed->mNextDisplayDelta = p.ScreenTime - lastDisplayed->mScreenTime;
+            chain->mDisplayDeltaSum += lastDisplayed->mNextDisplayDelta;
+        }
+        chain->mDisplayedCount += 1;
+        chain->mDisplayLatencySum += p.ScreenTime - p.QpcTime;
+        chain->mLastDisplayedPresentIndex = index;
+    }
+
+    chain->mNextPresentIndex += 1;
+    chain->mPresentHistoryCount += 1;
+
+    // The history is only pruned for the full console display (see
+    // ProcessEvents()).
+    if (chain->mPresentHistoryCount == 1 && GetCommandLineArgs().mConsoleOutputType == ConsoleOutput::Full) {
+        PushHistoryExpiry(p.QpcTime, p.ProcessId, p.SwapChainAddress);
+    }
+}
+
+static void AddPresents(std::vector<PoolHandoffPtr<PresentEvent>>* presentEvents, size_t* presentEventIndex,
                         bool recording, bool checkStopQpc, uint64_t stopQpc, bool* hitStopQpc)
 {
     auto i = *presentEventIndex;
-    for (auto n = presentEvents.size(); i < n; ++i) {
-        auto presentEvent = presentEvents[i];
+    for (auto n = presentEvents->size(); i < n; ++i) {
+        auto presentEvent = (*presentEvents)[i].get();
         assert(presentEvent->IsCompleted);
 
         // Stop processing events if we hit the next stop time.
@@ -249,37 +470,21 @@ static void AddPresents(std::vector<std::shared_ptr<PresentEvent>> const& presen
         }
 
         // Look up the swapchain this present belongs to.
-        auto processInfo = GetProcessInfo(presentEvent->ProcessId);
-        if (!processInfo->mTargetProcess) {
+        auto const& swapChainEntry = GetSwapChainEntry(*presentEvent);
+        if (swapChainEntry.mSwapChain == nullptr) {
             continue;
         }
 
-        auto result = processInfo->mSwapChain.emplace(presentEvent->SwapChainAddress, SwapChainData());
-        auto chain = &result.first->second;
-        if (result.second) {
-            chain->mPresentHistoryCount = 0;
-            chain->mNextPresentIndex = 1; // Start at 1 so that mLastDisplayedPresentIndex starts out invalid.
-            chain->mLastDisplayedPresentIndex = 0;
-        }
+        auto processInfo = swapChainEntry.mProcessInfo;
+        auto chain = swapChainEntry.mSwapChain;
 
         // Output CSV row if recording (need to do this before updating chain).
         if (recording) {
             UpdateCsv(processInfo, *chain, *presentEvent);
         }
 
-        // Add the present to the swapchain history.
-        chain->mPresentHistory[chain->mNextPresentIndex % SwapChainData::PRESENT_HISTORY_MAX_COUNT] = presentEvent;
-
-        if (presentEvent->FinalState == PresentResult::Presented) {
-            chain->mLastDisplayedPresentIndex = chain->mNextPresentIndex;
-        } else if (chain->mLastDisplayedPresentIndex == chain->mNextPresentIndex) {
-            chain->mLastDisplayedPresentIndex = 0;
-        }
-
-        chain->mNextPresentIndex += 1;
-        if (chain->mPresentHistoryCount < SwapChainData::PRESENT_HISTORY_MAX_COUNT) {
-            chain->mPresentHistoryCount += 1;
-        }
+        UpdateStatistics(chain, *presentEvent);
+        AddPresentToHistory(chain, *presentEvent);
     }
 
     *presentEventIndex = i;
@@ -326,14 +531,13 @@ static void AddPresents(LateStageReprojectionData* lsrData,
     *presentEventIndex = i;
 }
 
-// Limit the present history stored in SwapChainData to 2 seconds.
+// Limit the present history stored in SwapChainData to 2 seconds.  Only the
+// swap chains with presents to expire are visited (see gHistoryExpiries).
 static void PruneHistory(
     std::vector<ProcessEvent> const& processEvents,
-    std::vector<std::shared_ptr<PresentEvent>> const& presentEvents,
+    std::vector<PoolHandoffPtr<PresentEvent>> const& presentEvents,
     std::vector<std::shared_ptr<LateStageReprojectionEvent>> const& lsrEvents)
 {
-    assert(processEvents.size() + presentEvents.size() + lsrEvents.size() > 0);
-
     auto latestQpc = max(max(
         processEvents.empty() ? 0ull : processEvents.back().QpcTime,
         presentEvents.empty() ? 0ull : presentEvents.back()->QpcTime),
@@ -341,24 +545,29 @@ static void PruneHistory(
 
     auto minQpc = latestQpc - SecondsDeltaToQpc(2.0);
 
-    for (auto& pair : gProcesses) {
-        auto processInfo = &pair.second;
-        for (auto& pair2 : processInfo->mSwapChain) {
-            auto swapChain = &pair2.second;
-
-            auto count = swapChain->mPresentHistoryCount;
-            for (; count > 0; --count) {
-                auto index = swapChain->mNextPresentIndex - count;
-                auto const& presentEvent = swapChain->mPresentHistory[index % SwapChainData::PRESENT_HISTORY_MAX_COUNT];
-                if (presentEvent->QpcTime >= minQpc) {
-                    break;
-                }
-                if (index == swapChain->mLastDisplayedPresentIndex) {
-                    swapChain->mLastDisplayedPresentIndex = 0;
-                }
-            }
+    while (!gHistoryExpiries.empty() && gHistoryExpiries.front().mOldestQpc < minQpc) {
+        std::pop_heap(gHistoryExpiries.begin(), gHistoryExpiries.end(), ExpiresLater());
+        auto expiry = gHistoryExpiries.back();
+        gHistoryExpiries.pop_back();
 
-            swapChain->mPresentHistoryCount = count;
+        auto processIter = gProcesses.find(expiry.mProcessId);
+        if (processIter == gProcesses.end()) {
+            continue;
+        }
+        auto chainIter = processIter->second.mSwapChain.find(expiry.mSwapChainAddress);
+        if (chainIter == processIter->second.mSwapChain.end()) {
+            continue;
+        }
+        auto swapChain = &chainIter->second;
+
+        while (swapChain->mPresentHistoryCount > 0) {
+            auto index = swapChain->mNextPresentIndex - swapChain->mPresentHistoryCount;
+            auto oldestQpc = swapChain->mPresentHistory[index % SwapChainData::PRESENT_HISTORY_MAX_COUNT].mQpcTime;
+            if (oldestQpc >= minQpc) {
+                PushHistoryExpiry(oldestQpc, expiry.mProcessId, expiry.mSwapChainAddress);
+                break;
+            }
+            ExpireOldestPresent(swapChain);
         }
     }
 }
@@ -366,8 +575,8 @@ static void PruneHistory(
 static void ProcessEvents(
     LateStageReprojectionData* lsrData,
     std::vector<ProcessEvent>* processEvents,
-    std::vector<std::shared_ptr<PresentEvent>>* presentEvents,
-    std::vector<std::shared_ptr<PresentEvent>>* lostPresentEvents,
+    std::vector<PoolHandoffPtr<PresentEvent>>* presentEvents,
+    std::vector<PoolHandoffPtr<PresentEvent>>* lostPresentEvents,
     std::vector<std::shared_ptr<LateStageReprojectionEvent>>* lsrEvents,
     std::vector<uint64_t>* recordingToggleHistory,
     std::vector<std::pair<uint32_t, uint64_t>>* terminatedProcesses)
@@ -378,6 +587,7 @@ static void ProcessEvents(
     // isn't any.
     DequeueAnalyzedInfo(processEvents, presentEvents, lostPresentEvents, lsrEvents);
     if (processEvents->empty() && presentEvents->empty() && lsrEvents->empty()) {
+        lostPresentEvents->clear();
         return;
     }
 
@@ -422,7 +632,7 @@ static void ProcessEvents(
             }
 
             auto hitTerminatedProcess = false;
-            AddPresents(*presentEvents, &presentEventIndex, recording, true, terminatedProcessQpc, &hitTerminatedProcess);
+            AddPresents(presentEvents, &presentEventIndex, recording, true, terminatedProcessQpc, &hitTerminatedProcess);
             AddPresents(lsrData, *lsrEvents, &lsrEventIndex, recording, true, terminatedProcessQpc, &hitTerminatedProcess);
             if (!hitTerminatedProcess) {
                 goto done;
@@ -434,7 +644,7 @@ static void ProcessEvents(
         // reached the toggle, handle it and continue.  Otherwise, we're done
         // handling all the presents and any outstanding toggles will have to
         // wait for next batch of events.
-        AddPresents(*presentEvents, &presentEventIndex, recording, checkRecordingToggle, nextRecordingToggleQpc, &hitNextRecordingToggle);
+        AddPresents(presentEvents, &presentEventIndex, recording, checkRecordingToggle, nextRecordingToggleQpc, &hitNextRecordingToggle);
         AddPresents(lsrData, *lsrEvents, &lsrEventIndex, recording, checkRecordingToggle, nextRecordingToggleQpc, &hitNextRecordingToggle);
         if (!hitNextRecordingToggle) {
             break;
@@ -484,15 +694,13 @@ done:
 
 void Output()
 {
-#if !DEBUG_VERBOSE
     auto const& args = GetCommandLineArgs();
-#endif
 
     // Structures to track processes and statistics from recorded events.
     LateStageReprojectionData lsrData;
     std::vector<ProcessEvent> processEvents;
-    std::vector<std::shared_ptr<PresentEvent>> presentEvents;
-    std::vector<std::shared_ptr<PresentEvent>> lostPresentEvents;
+    std::vector<PoolHandoffPtr<PresentEvent>> presentEvents;
+    std::vector<PoolHandoffPtr<PresentEvent>> lostPresentEvents;
     std::vector<std::shared_ptr<LateStageReprojectionEvent>> lsrEvents;
     std::vector<uint64_t> recordingToggleHistory;
     std::vector<std::pair<uint32_t, uint64_t>> terminatedProcesses;
@@ -502,6 +710,14 @@ void Output()
     recordingToggleHistory.reserve(16);
     terminatedProcesses.reserve(16);
 
+    // The console and process tracking are updated every UPDATE_PERIOD_MS,
+    // independently of how often events are processed.
+    enum { UPDATE_PERIOD_MS = 100 };
+    auto lastUpdateTickCount = GetTickCount64() - UPDATE_PERIOD_MS;
+
+    // The CSV and columnar files are written by the writer thread.
+    StartOutputWriter();
+
     for (;;) {
         // Read gQuit here, but then check it after processing queued events.
         // This ensures that we call DequeueAnalyzedInfo() at least once after
@@ -511,6 +727,21 @@ void Output()
         // Copy and process all the collected events, and update the various
         // tracking and statistics data structures.
         ProcessEvents(&lsrData, &processEvents, &presentEvents, &lostPresentEvents, &lsrEvents, &recordingToggleHistory, &terminatedProcesses);
+        FlushOutputCsv();
+
+        // If we're not quitting and it's not time to update yet, wait for more
+        // events.  When woken, sleep for the output latency budget so that
+        // events completed close together are processed as one batch instead
+        // of waking this thread once per event.
+        auto tickCount = GetTickCount64();
+        if (!quit && tickCount - lastUpdateTickCount < UPDATE_PERIOD_MS) {
+            WaitForAnalyzedInfo((DWORD) (UPDATE_PERIOD_MS - (tickCount - lastUpdateTickCount)));
+            if (args.mOutputLatency > 0 && !gQuit) {
+                Sleep(args.mOutputLatency);
+            }
+            continue;
+        }
+        lastUpdateTickCount = tickCount;
 
         // Display information to console if requested.  If debug build and
         // simple console, print a heartbeat if recording.
@@ -553,9 +784,6 @@ void Output()
 
         // Update tracking information.
         CheckForTerminatedRealtimeProcesses(&terminatedProcesses);
-
-        // Sleep to reduce overhead.
-        Sleep(100);
     }
 
     // Output warning if events were lost.
@@ -576,10 +804,22 @@ void Output()
             CloseHandle(processInfo->mHandle);
         }
         CloseOutputCsv(processInfo);
+        AddProcessSummary(pair.first, *processInfo);
     }
     gProcesses.clear();
+    gSwapChains.clear();
+    gHistoryExpiries.clear();
     CloseOutputCsv(nullptr); // Special case to close single global CSV if not
                              // using per-process CSVs.
+
+    // Wait for the writer thread to finish writing the closed files.
+    StopOutputWriter();
+
+    // Print the frame statistics of every process that presented.
+    if (!gProcessSummaries.empty()) {
+        PrintSummary(gProcessSummaries);
+        gProcessSummaries.clear();
+    }
 }
 
 void StartOutputThread()
@@ -593,6 +833,7 @@ void StopOutputThread()
 {
     if (gThread.joinable()) {
         gQuit = true;
+        NotifyAnalyzedInfoWaiter();
         gThread.join();
 
         DeleteCriticalSection(&gRecordingToggleCS);
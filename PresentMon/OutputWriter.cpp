@@ -0,0 +1,333 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+
+#include "OutputWriter.hpp"
+
+#include <assert.h>
+#include <stdarg.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class OutputWriter {
+    struct Request {
+        OutputFile* mFile;
+        char* mBuffer;
+        size_t mSize;
+        size_t mCapacity;
+        uint32_t mRowCount;
+        uint64_t mMinQpc;
+        uint64_t mMaxQpc;
+        bool mClose;
+    };
+
+    std::thread mThread;
+    std::mutex mMutex;
+    std::condition_variable mRequestAdded;      // Signaled when mRequests becomes non-empty, or mQuit is set
+    std::condition_variable mBufferWritten;     // Signaled when a file's mWriting is cleared
+    std::vector<Request> mRequests;
+    bool mQuit = false;
+
+    void WriteBlock(Request const& request);
+    void WriteIndex(OutputFile* file);
+    void Write(Request const& request);
+    void Run();
+
+public:
+    void Start();
+    void Stop();
+    void Enqueue(OutputFile* file, bool close);
+};
+
+static OutputWriter gOutputWriter;
+
+void OutputWriter::Start()
+{
+    assert(!mThread.joinable());
+    mQuit = false;
+    mThread = std::thread(&OutputWriter::Run, this);
+}
+
+void OutputWriter::Stop()
+{
+    if (mThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mQuit = true;
+        }
+        mRequestAdded.notify_one();
+        mThread.join();
+    }
+}
+
+// Hands the file's buffer to the writer thread, waiting for the file's
+// previous buffer to be written first if necessary.  If close is true the
+// writer thread also closes and deletes the file.
+void OutputWriter::Enqueue(OutputFile* file, bool close)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mBufferWritten.wait(lock, [file]() { return !file->mWriting; });
+
+    Request request;
+    request.mFile = file;
+    request.mBuffer = file->mBuffer;
+    request.mSize = file->mSize;
+    request.mCapacity = file->mCapacity;
+    request.mRowCount = file->mRowCount;
+    request.mMinQpc = file->mMinQpc;
+    request.mMaxQpc = file->mMaxQpc;
+    request.mClose = close;
+    mRequests.push_back(request);
+
+    auto wasEmpty = mRequests.size() == 1;
+
+    if (!close) {
+        file->mWriting = true;
+        file->mBuffer = file->mSpare != nullptr ? file->mSpare : new char [file->mBufferSize];
+        file->mSpare = nullptr;
+        file->mHandedOffSize += file->mSize;
+        file->mSize = 0;
+        file->mCapacity = file->mBufferSize;
+        file->mRowCount = 0;
+    }
+
+    lock.unlock();
+    if (wasEmpty) {
+        mRequestAdded.notify_one();
+    }
+}
+
+// Compresses the buffer and writes it as one block, preceded by the file
+// header if this is the first write.  The block is stored uncompressed if
+// compressing it doesn't make it smaller.
+void OutputWriter::WriteBlock(Request const& request)
+{
+    auto file = request.mFile;
+    if (file->mOffset == 0) {
+        CompressedFileHeader header = {};
+        header.Magic = COMPRESSED_MAGIC;
+        header.Version = COMPRESSED_VERSION;
+        header.BlockSize = COMPRESSED_BLOCK_SIZE;
+        file->mError = fwrite(&header, sizeof(header), 1, file->mFile) != 1;
+        file->mOffset = sizeof(header);
+    }
+
+    if (request.mSize == 0 || file->mError) {
+        return;
+    }
+
+    file->mCompressed.resize(BlockCompression::GetBound(request.mSize));
+    auto data = static_cast<void const*>(file->mCompressed.data());
+    auto size = BlockCompression::Compress(request.mBuffer, request.mSize, file->mCompressed.data());
+
+    CompressedIndexEntry entry = {};
+    entry.Offset = file->mOffset;
+    entry.Block.UncompressedSize = (uint32_t) request.mSize;
+    entry.Block.RowCount = request.mRowCount;
+    if (request.mRowCount > 0) {
+        entry.Block.MinQpc = request.mMinQpc;
+        entry.Block.MaxQpc = request.mMaxQpc;
+    }
+    if (size >= request.mSize) {
+        data = request.mBuffer;
+        size = request.mSize;
+        entry.Block.Flags = COMPRESSED_BLOCK_STORED;
+    }
+    entry.Block.CompressedSize = (uint32_t) size;
+
+    file->mError =
+        fwrite(&entry.Block, sizeof(entry.Block), 1, file->mFile) != 1 ||
+        fwrite(data, 1, size, file->mFile) != size;
+    file->mOffset += sizeof(entry.Block) + size;
+    file->mIndex.push_back(entry);
+}
+
+void OutputWriter::WriteIndex(OutputFile* file)
+{
+    if (file->mError) {
+        return;
+    }
+
+    CompressedFooter footer = {};
+    footer.IndexOffset = file->mOffset;
+    footer.BlockCount = (uint32_t) file->mIndex.size();
+    footer.Magic = COMPRESSED_FOOTER_MAGIC;
+
+    file->mError =
+        fwrite(file->mIndex.data(), sizeof(CompressedIndexEntry), file->mIndex.size(), file->mFile) != file->mIndex.size() ||
+        fwrite(&footer, sizeof(footer), 1, file->mFile) != 1;
+}
+
+void OutputWriter::Write(Request const& request)
+{
+    auto file = request.mFile;
+    if (file->mCompress) {
+        WriteBlock(request);
+    } else if (request.mSize > 0 && !file->mError) {
+        file->mError = fwrite(request.mBuffer, 1, request.mSize, file->mFile) != request.mSize;
+    }
+
+    if (request.mClose) {
+        if (file->mCompress) {
+            WriteIndex(file);
+        }
+        if (file->mFile == stdout) {
+            file->mError = fflush(stdout) != 0 || file->mError;
+        } else {
+            file->mError = fclose(file->mFile) != 0 || file->mError;
+        }
+        if (file->mError) {
+            fprintf(stderr, "warning: failed to write %s.\n", file->mPath.c_str());
+        }
+        delete file;
+        return;
+    }
+
+    // stdout is flushed after every write, since its buffers are handed off
+    // as soon as they have something to show (see OutputFile::Flush()).
+    if (file->mFile == stdout) {
+        fflush(stdout);
+    }
+
+    // Buffers that were grown for a large compressed block are freed, so the
+    // spare is always mBufferSize.
+    auto keep = request.mCapacity == file->mBufferSize;
+    if (!keep) {
+        delete[] request.mBuffer;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        file->mSpare = keep ? request.mBuffer : nullptr;
+        file->mWriting = false;
+    }
+    mBufferWritten.notify_all();
+}
+
+void OutputWriter::Run()
+{
+    std::vector<Request> requests;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mRequestAdded.wait(lock, [this]() { return !mRequests.empty() || mQuit; });
+            if (mRequests.empty()) {
+                break;
+            }
+            requests.swap(mRequests);
+        }
+
+        // Write all the queued buffers before looking for more, so each
+        // wake-up writes as much as has been handed off.
+        for (auto const& request : requests) {
+            Write(request);
+        }
+        requests.clear();
+    }
+}
+
+OutputFile::OutputFile(FILE* fp, char const* path, bool compress)
+    : mFile(fp)
+    , mPath(path)
+    , mBuffer(nullptr)
+    , mSize(0)
+    , mCapacity(compress ? OUTPUT_FILE_COMPRESSED_BUFFER_SIZE : OUTPUT_FILE_BUFFER_SIZE)
+    , mBufferSize(mCapacity)
+    , mHandedOffSize(0)
+    , mSpare(nullptr)
+    , mWriting(false)
+    , mError(false)
+    , mCompress(compress)
+    , mRowCount(0)
+    , mMinQpc(0)
+    , mMaxQpc(0)
+    , mOffset(0)
+{
+    mBuffer = new char [mBufferSize];
+
+    // Our buffers are written with a single fwrite() each, so the FILE's own
+    // buffer would only add a copy.
+    if (fp != stdout) {
+        setvbuf(fp, nullptr, _IONBF, 0);
+    }
+}
+
+OutputFile::~OutputFile()
+{
+    delete[] mBuffer;
+    delete[] mSpare;
+}
+
+void OutputFile::WriteSlow(void const* data, size_t size)
+{
+    // Compressed blocks must end at a row boundary, so the buffer is grown
+    // instead of being handed off (see EndRows()).
+    if (mCompress) {
+        auto capacity = mCapacity * 2;
+        if (capacity < mSize + size) {
+            capacity = mSize + size;
+        }
+        auto buffer = new char [capacity];
+        memcpy(buffer, mBuffer, mSize);
+        memcpy(buffer + mSize, data, size);
+        delete[] mBuffer;
+        mBuffer = buffer;
+        mSize += size;
+        mCapacity = capacity;
+        return;
+    }
+
+    auto p = static_cast<char const*>(data);
+    for (;;) {
+        auto n = mCapacity - mSize;
+        if (size < n) {
+            n = size;
+        }
+        memcpy(mBuffer + mSize, p, n);
+        mSize += n;
+        p += n;
+        size -= n;
+        if (size == 0) {
+            break;
+        }
+        gOutputWriter.Enqueue(this, false);
+    }
+}
+
+void OutputFile::Printf(char const* format, ...)
+{
+    char text[OUTPUT_FILE_PRINTF_SIZE];
+
+    va_list args;
+    va_start(args, format);
+    auto size = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+
+    assert(size >= 0 && size < (int) sizeof(text));
+    if (size > 0) {
+        Write(text, size < (int) sizeof(text) ? (size_t) size : sizeof(text) - 1);
+    }
+}
+
+void OutputFile::Flush()
+{
+    if (mSize > 0) {
+        gOutputWriter.Enqueue(this, false);
+    }
+}
+
+void StartOutputWriter()
+{
+    gOutputWriter.Start();
+}
+
+void StopOutputWriter()
+{
+    gOutputWriter.Stop();
+}
+
+void CloseOutputFile(OutputFile* file)
+{
+    gOutputWriter.Enqueue(file, true);
+}
@@ -0,0 +1,141 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "CompressedOutput.hpp"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// The CSV and columnar output files are written by a background writer
+// thread, so that a slow disk or network share doesn't stall the output
+// thread's analysis and console updates.
+//
+// The output thread formats rows into an OutputFile, which buffers them in
+// memory.  When the buffer is full (or the file is flushed or closed), it is
+// handed to the writer thread, which writes it to the FILE with a single
+// fwrite(), and the output thread continues with the file's other buffer.
+// Each file has at most one buffer being written at a time, so its data is
+// written in order, and the output thread only waits for the writer thread
+// if it fills a file's second buffer before the first one has been written.
+//
+// The buffers are sized for PresentMon's output rates rather than for the
+// largest possible writes: 64KB holds a few hundred CSV rows, so even one file
+// per process for many processes only needs a few MB.
+//
+// If the file is compressed (see CompressedOutput.hpp), the writer thread
+// also compresses each buffer as one block.  The buffers are then handed off
+// by EndRows() once they hold COMPRESSED_BLOCK_SIZE bytes, so that blocks end
+// at row boundaries.  They are large enough for a block and the rows that end
+// it, and grow if necessary rather than being handed off when full.
+//
+// OutputFiles share no state other than the writer thread's queue, so
+// different files can be written to from different threads, but each
+// OutputFile must only be written to by one thread at a time.
+
+enum {
+    OUTPUT_FILE_BUFFER_SIZE            = 64 * 1024,    // Size of each of a file's two buffers, and so of most fwrite()s
+    OUTPUT_FILE_COMPRESSED_BUFFER_SIZE = COMPRESSED_BLOCK_SIZE + OUTPUT_FILE_BUFFER_SIZE,
+    OUTPUT_FILE_PRINTF_SIZE            = 1024,
+};
+
+class OutputFile {
+    friend class OutputWriter;
+
+    FILE* mFile;
+    std::string mPath;          // For warnings
+    char* mBuffer;              // The buffer being filled by the output thread
+    size_t mSize;               // The amount of mBuffer that is used
+    size_t mCapacity;           // The size of mBuffer
+    size_t mBufferSize;         // The size of each buffer, unless grown for a large compressed block
+    uint64_t mHandedOffSize;    // The amount of data handed to the writer thread so far
+    char* mSpare;               // The other buffer, or nullptr if it's being written (or not yet allocated)
+    bool mWriting;              // Whether the writer thread is writing the other buffer
+    bool mError;                // Whether any write failed (writer thread only)
+    bool mCompress;
+
+    // The rows in mBuffer, for the compressed block index
+    uint32_t mRowCount;
+    uint64_t mMinQpc;
+    uint64_t mMaxQpc;
+
+    // Compression state (writer thread only)
+    uint64_t mOffset;           // Bytes written so far
+    std::vector<CompressedIndexEntry> mIndex;
+    std::vector<uint8_t> mCompressed;
+
+    void WriteSlow(void const* data, size_t size);
+
+public:
+    // Takes ownership of fp, unless it is stdout.  path is only used to
+    // identify the file if writing to it fails.  If compress is true, fp must
+    // have been opened in binary mode.
+    OutputFile(FILE* fp, char const* path, bool compress);
+    ~OutputFile();
+
+    OutputFile(OutputFile const&) = delete;
+    OutputFile& operator=(OutputFile const&) = delete;
+
+    void Write(void const* data, size_t size)
+    {
+        if (size > mCapacity - mSize) {
+            WriteSlow(data, size);
+            return;
+        }
+        memcpy(mBuffer + mSize, data, size);
+        mSize += size;
+    }
+
+    // Writes printf()-formatted text, which must be shorter than
+    // OUTPUT_FILE_PRINTF_SIZE after formatting.  For headers and other
+    // infrequent output; rows should be formatted with CsvRow.
+    void Printf(char const* format, ...);
+
+    // Records that rowCount complete rows, with QPCTimes from minQpc to
+    // maxQpc, have been written since the last call.  If the file is
+    // compressed, this is where the current block ends if it is large enough.
+    void EndRows(uint32_t rowCount, uint64_t minQpc, uint64_t maxQpc)
+    {
+        if (mRowCount == 0 || minQpc < mMinQpc) {
+            mMinQpc = minQpc;
+        }
+        if (mRowCount == 0 || maxQpc > mMaxQpc) {
+            mMaxQpc = maxQpc;
+        }
+        mRowCount += rowCount;
+        if (mCompress && mSize >= COMPRESSED_BLOCK_SIZE) {
+            Flush();
+        }
+    }
+
+    bool IsCompressed() const { return mCompress; }
+
+    // The amount of data written to the file so far, including buffered data.
+    // This is before compression.
+    uint64_t GetSize() const { return mHandedOffSize + mSize; }
+
+    // Whether nothing has been written since the last buffer was handed to
+    // the writer thread, i.e., the next write starts a new compressed block.
+    bool IsBufferEmpty() const { return mSize == 0; }
+
+    // Hands any buffered data to the writer thread, e.g., so that stdout
+    // output isn't held back until a whole buffer is filled.
+    void Flush();
+};
+
+// Starts the writer thread.  Files can only be written to while it is
+// running.
+void StartOutputWriter();
+
+// Waits for all handed-off data to be written and stops the writer thread.
+// All files must have been closed first.
+void StopOutputWriter();
+
+// Hands the file's remaining data to the writer thread, which writes it and
+// then closes and deletes the file.  If any write to the file failed, a
+// warning is printed to stderr.  file must not be used after calling this.
+void CloseOutputFile(OutputFile* file);
@@ -28,8 +28,15 @@ which is controlled from MainThread based on user input or timer.
 
 #include "../PresentData/MixedRealityTraceConsumer.hpp"
 #include "../PresentData/PresentMonTraceConsumer.hpp"
+#include "QuantileSketch.hpp"
 
 #include <unordered_map>
+#include <unordered_set>
+
+struct TraceSession;
+class ColumnarWriter;
+class OutputFile;
+struct OutputSegments;
 
 enum class ConsoleOutput {
     None,
@@ -40,12 +47,19 @@ enum class ConsoleOutput {
 struct CommandLineArgs {
     std::vector<const char*> mTargetProcessNames;
     std::vector<const char*> mExcludeProcessNames;
+    std::vector<const char*> mBatchInputs;
+    std::string mBatchArgs;
     const char *mOutputCsvFileName;
     const char *mEtlFileName;
+    const char *mCaptureFileName;
     const char *mSessionName;
     UINT mTargetPid;
     UINT mDelay;
     UINT mTimer;
+    UINT mOutputLatency;
+    UINT mRotateSizeMB;
+    UINT mRotateInterval;
+    UINT mBatchJobs;
     UINT mHotkeyModifiers;
     UINT mHotkeyVirtualKeyCode;
     ConsoleOutput mConsoleOutputType;
@@ -56,6 +70,8 @@ struct CommandLineArgs {
     bool mOutputCsvToStdout;
     bool mOutputQpcTime;
     bool mOutputQpcTimeInSeconds;
+    bool mOutputColumnar;
+    bool mOutputCompressed;
     bool mScrollLockIndicator;
     bool mExcludeDropped;
     bool mTerminateExisting;
@@ -68,26 +84,71 @@ struct CommandLineArgs {
     bool mStopExistingSession;
 };
 
+// The fields of a present that are kept in its swap chain's history, so that
+// the history doesn't keep the PresentEvents themselves alive.
+struct PresentSummary {
+    uint64_t mQpcTime;
+    uint64_t mScreenTime;
+    uint64_t mNextDisplayDelta;     // ScreenTime delta to the next displayed present, or 0 until there is one
+    int32_t mSyncInterval;
+    uint32_t mPresentFlags;
+    Runtime mRuntime;
+    PresentMode mPresentMode;
+    bool mDisplayed;                // FinalState == PresentResult::Presented
+};
+
 // CSV output only requires last presented/displayed event to compute frame
 // information, but if outputing to the console we maintain a longer history of
 // presents to compute averages, limited to 120 events (2 seconds @ 60Hz) to
 // reduce memory/compute overhead.
+//
+// The console averages are computed from running sums over the history's
+// displayed presents, which are updated as presents are added to and expire
+// from the history, so they don't require walking it.
+//
+// The distributions of frame statistics over the whole capture are kept in
+// fixed-size sketches, for the console percentiles and the end-of-run summary.
+// All values are in QPC ticks.
 struct SwapChainData {
     enum { PRESENT_HISTORY_MAX_COUNT = 120 };
-    std::shared_ptr<PresentEvent> mPresentHistory[PRESENT_HISTORY_MAX_COUNT];
+    PresentSummary mPresentHistory[PRESENT_HISTORY_MAX_COUNT];
     uint32_t mPresentHistoryCount;
     uint32_t mNextPresentIndex;
     uint32_t mLastDisplayedPresentIndex;
+
+    // Running sums over the displayed presents in the history.  If there are
+    // any, the last one is at mLastDisplayedPresentIndex.
+    uint32_t mDisplayedCount;
+    uint64_t mDisplayDeltaSum;          // The last one's ScreenTime minus the first one's
+    uint64_t mDisplayLatencySum;        // Sum of ScreenTime - QpcTime
+
+    QuantileSketch mPresentIntervals;   // msBetweenPresents
+    QuantileSketch mDisplayIntervals;   // msBetweenDisplayChange
+    QuantileSketch mDisplayLatencies;   // msUntilDisplayed
+};
+
+// The frame statistics of all of a process' swap chains, kept after the
+// process exits for the end-of-run summary.
+struct ProcessSummary {
+    std::string mModuleName;
+    uint32_t mProcessId;
+    uint32_t mSwapChainCount;
+    QuantileSketch mPresentIntervals;
+    QuantileSketch mDisplayIntervals;
+    QuantileSketch mDisplayLatencies;
 };
 
 struct OutputCsv {
-    FILE* mFile;
-    FILE* mWmrFile;
+    OutputFile* mFile;
+    OutputFile* mWmrFile;
+    ColumnarWriter* mColumnarWriter;    // Writes to (and owns) mFile if -columnar
+    OutputSegments* mSegments;          // If -rotate_size or -rotate_interval
 };
 
 struct ProcessInfo {
-    std::string mModuleName;
+    std::string const* mModuleName;         // Interned (see ProcessEvent::ImageFileName)
     std::unordered_map<uint64_t, SwapChainData> mSwapChain;
+    std::vector<uint32_t> mSwapChainIds;    // The PresentEvent::SwapChainIds of this process' presents
     HANDLE mHandle;
     OutputCsv mOutputCsv;
     bool mTargetProcess;
@@ -95,6 +156,9 @@ struct ProcessInfo {
 
 #include "LateStageReprojectionData.hpp"
 
+// BatchMode.cpp:
+int RunBatch();
+
 // CommandLine.cpp:
 bool ParseCommandLine(int argc, char** argv);
 CommandLineArgs const& GetCommandLineArgs();
@@ -105,15 +169,19 @@ void ConsolePrint(char const* format, ...);
 void ConsolePrintLn(char const* format, ...);
 void CommitConsole();
 void UpdateConsole(uint32_t processId, ProcessInfo const& processInfo);
+void PrintSummary(std::vector<ProcessSummary> const& summaries);
 
 // ConsumerThread.cpp:
 void StartConsumerThread(TRACEHANDLE traceHandle);
+void StartReplayConsumerThread(TraceSession* session);
 void WaitForConsumerThreadToExit();
 
 // CsvOutput.cpp:
 void IncrementRecordingCount();
+OutputFile* OpenOutputFile(char const* path, bool binary);
 OutputCsv GetOutputCsv(ProcessInfo* processInfo);
 void CloseOutputCsv(ProcessInfo* processInfo);
+void FlushOutputCsv();
 void UpdateCsv(ProcessInfo* processInfo, SwapChainData const& chain, PresentEvent const& p);
 const char* FinalStateToDroppedString(PresentResult res);
 const char* PresentModeToString(PresentMode mode);
@@ -138,9 +206,13 @@ void StopTraceSession();
 void CheckLostReports(ULONG* eventsLost, ULONG* buffersLost);
 void DequeueAnalyzedInfo(
     std::vector<ProcessEvent>* processEvents,
-    std::vector<std::shared_ptr<PresentEvent>>* presentEvents,
-    std::vector<std::shared_ptr<PresentEvent>>* lostPresentEvents,
+    std::vector<PoolHandoffPtr<PresentEvent>>* presentEvents,
+    std::vector<PoolHandoffPtr<PresentEvent>>* lostPresentEvents,
     std::vector<std::shared_ptr<LateStageReprojectionEvent>>* lsrs);
+void WaitForAnalyzedInfo(DWORD timeoutMs);
+void NotifyAnalyzedInfoWaiter();
+void FlushAnalyzedInfo();
 double QpcDeltaToSeconds(uint64_t qpcDelta);
 uint64_t SecondsDeltaToQpc(double secondsDelta);
 double QpcToSeconds(uint64_t qpc);
+void GetQpcFrequencyAndStart(int64_t* qpcFrequency, int64_t* startQpc);
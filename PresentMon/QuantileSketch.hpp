@@ -0,0 +1,132 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// QuantileSketch is a fixed-size histogram of unsigned integer values (e.g.,
+// QPC deltas) from which quantiles can be estimated.  Adding a value is O(1)
+// and two sketches can be combined with Merge(), e.g. to summarize all of a
+// process' swap chains.
+//
+// Buckets are log-linear, as in an HDR histogram: values below 2^SUB_BUCKET_BITS
+// each have their own bucket, and every larger power-of-two range is split into
+// 2^(SUB_BUCKET_BITS - 1) equal-width buckets.  A quantile is reported as the
+// midpoint of the bucket it falls in (clamped to the exact minimum and
+// maximum), so its relative error is at most 2^-SUB_BUCKET_BITS (0.8%).
+//
+// Values of 2^MAX_VALUE_BITS and above (30 hours with a 10MHz QPC) are
+// counted in the last bucket.
+
+class QuantileSketch {
+public:
+    enum {
+        SUB_BUCKET_BITS  = 7,
+        SUB_BUCKET_COUNT = 1 << (SUB_BUCKET_BITS - 1),
+        MAX_VALUE_BITS   = 40,
+        BUCKET_COUNT     = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 2) * SUB_BUCKET_COUNT,
+    };
+
+private:
+    uint64_t mCount = 0;
+    uint64_t mMin = UINT64_MAX;
+    uint64_t mMax = 0;
+    uint32_t mBucketCounts[BUCKET_COUNT] = {};
+
+    static uint32_t GetHighestBit(uint64_t value)
+    {
+#ifdef _MSC_VER
+        unsigned long index = 0;
+        if (_BitScanReverse(&index, (unsigned long) (value >> 32))) {
+            return index + 32;
+        }
+        _BitScanReverse(&index, (unsigned long) value);
+        return index;
+#else
+        return 63 - __builtin_clzll(value);
+#endif
+    }
+
+    static uint32_t GetBucketIndex(uint64_t value)
+    {
+        if (value < 2 * SUB_BUCKET_COUNT) {
+            return (uint32_t) value;
+        }
+        if (value >> MAX_VALUE_BITS) {
+            return BUCKET_COUNT - 1;
+        }
+        auto shift = GetHighestBit(value) - (SUB_BUCKET_BITS - 1);
+        return shift * SUB_BUCKET_COUNT + (uint32_t) (value >> shift);
+    }
+
+    // Returns the midpoint of the values counted in bucket index.
+    static uint64_t GetBucketValue(uint32_t index)
+    {
+        if (index < 2 * SUB_BUCKET_COUNT) {
+            return index;
+        }
+        auto shift = index / SUB_BUCKET_COUNT - 1;
+        auto lowest = (uint64_t) (index % SUB_BUCKET_COUNT + SUB_BUCKET_COUNT) << shift;
+        return lowest + ((1ull << shift) >> 1);
+    }
+
+public:
+    uint64_t GetCount() const { return mCount; }
+    uint64_t GetMin() const { return mMin; }
+    uint64_t GetMax() const { return mMax; }
+
+    void Add(uint64_t value)
+    {
+        mBucketCounts[GetBucketIndex(value)] += 1;
+        mCount += 1;
+        if (value < mMin) mMin = value;
+        if (value > mMax) mMax = value;
+    }
+
+    void Merge(QuantileSketch const& other)
+    {
+        for (uint32_t i = 0; i < BUCKET_COUNT; ++i) {
+            mBucketCounts[i] += other.mBucketCounts[i];
+        }
+        mCount += other.mCount;
+        if (other.mMin < mMin) mMin = other.mMin;
+        if (other.mMax > mMax) mMax = other.mMax;
+    }
+
+    // Estimates the value at each of quantileCount quantiles (in [0, 1] and
+    // in increasing order) with a single pass over the buckets.  The value at
+    // quantile q is the ceil(q * count)'th smallest value.  The sketch must
+    // not be empty.
+    void GetQuantiles(double const* quantiles, uint64_t* values, size_t quantileCount) const
+    {
+        uint64_t cumulativeCount = 0;
+        uint32_t bucket = 0;
+        for (size_t i = 0; i < quantileCount; ++i) {
+            // The small bias keeps e.g. 0.95 * 100 from rounding up to 96.
+            auto rank = (uint64_t) ceil(quantiles[i] * (double) mCount - 1e-6);
+            if (rank < 1) rank = 1;
+            if (rank > mCount) rank = mCount;
+
+            for (; cumulativeCount + mBucketCounts[bucket] < rank; ++bucket) {
+                cumulativeCount += mBucketCounts[bucket];
+            }
+
+            // The smallest and largest values are known exactly.
+            if (rank == 1) {
+                values[i] = mMin;
+            } else if (rank == mCount) {
+                values[i] = mMax;
+            } else {
+                auto value = GetBucketValue(bucket);
+                values[i] = value < mMin ? mMin : value > mMax ? mMax : value;
+            }
+        }
+    }
+};
@@ -3,6 +3,7 @@
 
 #include "PresentMon.hpp"
 
+#include "../PresentData/EventCapture.hpp"
 #include "../PresentData/TraceSession.hpp"
 #include <VersionHelpers.h>
 
@@ -11,6 +12,8 @@ namespace {
 TraceSession gSession;
 static PMTraceConsumer* gPMConsumer = nullptr;
 static MRTraceConsumer* gMRConsumer = nullptr;
+static HandoffSignal gHandoffSignal; // Notified by the consumers when they queue analyzed info
+static EventCaptureWriter* gCaptureWriter = nullptr;
 
 }
 
@@ -27,6 +30,7 @@ bool StartTraceSession()
     gPMConsumer->mFilteredEvents = expectFilteredEvents;
     gPMConsumer->mFilteredProcessIds = filterProcessIds;
     gPMConsumer->mTrackDisplay = args.mTrackDisplay;
+    gPMConsumer->mHandoffSignal = &gHandoffSignal;
 
     if (filterProcessIds) {
         gPMConsumer->AddTrackedProcessForFiltering(args.mTargetPid);
@@ -34,6 +38,7 @@ bool StartTraceSession()
 
     if (args.mTrackWMR) {
         gMRConsumer = new MRTraceConsumer(args.mTrackDisplay);
+        gMRConsumer->mHandoffSignal = &gHandoffSignal;
     }
 
     // Start the session;
@@ -93,9 +98,30 @@ bool StartTraceSession()
         return false;
     }
 
+    // If requested, also write the consumed events into an event capture.
+    if (args.mCaptureFileName != nullptr) {
+        gCaptureWriter = new EventCaptureWriter;
+        if (!gCaptureWriter->Open(args.mCaptureFileName, gSession.mQpcFrequency.QuadPart, gSession.mStartQpc.QuadPart)) {
+            fprintf(stderr, "error: failed to create capture file: %s\n", args.mCaptureFileName);
+            gSession.Stop();
+            delete gCaptureWriter;
+            delete gPMConsumer;
+            delete gMRConsumer;
+            gCaptureWriter = nullptr;
+            gPMConsumer = nullptr;
+            gMRConsumer = nullptr;
+            return false;
+        }
+        gSession.mCaptureWriter = gCaptureWriter;
+    }
+
     // -------------------------------------------------------------------------
     // Start the consumer and output threads
-    StartConsumerThread(gSession.mTraceHandle);
+    if (gSession.mCaptureReader != nullptr) {
+        StartReplayConsumerThread(&gSession);
+    } else {
+        StartConsumerThread(gSession.mTraceHandle);
+    }
     StartOutputThread();
 
     return true;
@@ -111,6 +137,16 @@ void StopTraceSession()
     WaitForConsumerThreadToExit();
     StopOutputThread();
 
+    // Close the capture file, if any
+    if (gCaptureWriter != nullptr) {
+        if (!gCaptureWriter->Close()) {
+            fprintf(stderr, "warning: failed to write capture file: %s\n", GetCommandLineArgs().mCaptureFileName);
+        }
+        gSession.mCaptureWriter = nullptr;
+        delete gCaptureWriter;
+        gCaptureWriter = nullptr;
+    }
+
     // Destruct the consumers
     delete gMRConsumer;
     delete gPMConsumer;
@@ -126,8 +162,8 @@ void CheckLostReports(ULONG* eventsLost, ULONG* buffersLost)
 
 void DequeueAnalyzedInfo(
     std::vector<ProcessEvent>* processEvents,
-    std::vector<std::shared_ptr<PresentEvent>>* presentEvents,
-    std::vector<std::shared_ptr<PresentEvent>>* lostPresentEvents,
+    std::vector<PoolHandoffPtr<PresentEvent>>* presentEvents,
+    std::vector<PoolHandoffPtr<PresentEvent>>* lostPresentEvents,
     std::vector<std::shared_ptr<LateStageReprojectionEvent>>* lsrs)
 {
     gPMConsumer->DequeueProcessEvents(*processEvents);
@@ -138,6 +174,40 @@ void DequeueAnalyzedInfo(
     }
 }
 
+// Block until the consumers have queued analyzed info, NotifyAnalyzedInfoWaiter()
+// is called, or timeoutMs elapses.  Must only be called by the thread that
+// calls DequeueAnalyzedInfo().
+void WaitForAnalyzedInfo(DWORD timeoutMs)
+{
+    gHandoffSignal.Wait(timeoutMs, []() {
+        return (gPMConsumer != nullptr && gPMConsumer->HasQueuedEvents()) ||
+               (gMRConsumer != nullptr && gMRConsumer->HasQueuedEvents());
+    });
+}
+
+void NotifyAnalyzedInfoWaiter()
+{
+    gHandoffSignal.Notify();
+}
+
+// Hand off all events still held in the consumers' overflow queues.  Must be
+// called by the consumer thread once it has stopped consuming events; it waits
+// for the output thread to make room, which is safe because the output thread
+// is not stopped until after the consumer thread exits.
+void FlushAnalyzedInfo()
+{
+    for (;;) {
+        auto flushed = gPMConsumer->FlushHandoffOverflow();
+        if (gMRConsumer != nullptr) {
+            flushed = gMRConsumer->FlushHandoffOverflow() && flushed;
+        }
+        if (flushed) {
+            break;
+        }
+        Sleep(1);
+    }
+}
+
 double QpcDeltaToSeconds(uint64_t qpcDelta)
 {
     return (double) qpcDelta / gSession.mQpcFrequency.QuadPart;
@@ -152,3 +222,9 @@ double QpcToSeconds(uint64_t qpc)
 {
     return QpcDeltaToSeconds(qpc - gSession.mStartQpc.QuadPart);
 }
+
+void GetQpcFrequencyAndStart(int64_t* qpcFrequency, int64_t* startQpc)
+{
+    *qpcFrequency = gSession.mQpcFrequency.QuadPart;
+    *startQpc = gSession.mStartQpc.QuadPart;
+}
@@ -2,6 +2,11 @@
 // SPDX-License-Identifier: MIT
 
 #include "PresentMonTests.h"
+#include "../PresentMon/ColumnarOutput.hpp"
+#include "../PresentMon/CompressedOutput.hpp"
+
+#include <algorithm>
+#include <float.h>
 
 namespace {
 
@@ -11,8 +16,202 @@ struct TestArgs {
     std::wstring goldCsv_;
     std::wstring testCsv_;
     bool reportAllCsvDiffs_;
+    bool replayCapture_;    // Record the ETL into an event capture, and test replaying the capture
+    bool compress_;         // Test the -compress output, decompressed to testCsv_
+    bool rotate_;           // Test the -rotate_interval output, joined into testCsv_
+    bool columnar_;         // Test the -columnar output, converted to testCsv_
 };
 
+// Decompresses all the blocks of a -compress output file into path, and
+// checks that the block index accounts for every row.
+bool DecompressCsv(std::wstring const& compressedPath, std::wstring const& path)
+{
+    CompressedFileReader reader;
+    if (!reader.Open(Convert(compressedPath).c_str())) {
+        AddTestFailure(__FILE__, __LINE__, "Failed to open compressed CSV: %s", Convert(compressedPath).c_str());
+        return false;
+    }
+
+    std::vector<uint8_t> data;
+    size_t indexRowCount = 0;
+    for (size_t i = 0, n = reader.GetIndex().size(); i < n; ++i) {
+        if (!reader.ReadBlock(i, &data)) {
+            AddTestFailure(__FILE__, __LINE__, "Compressed CSV block %zu is corrupt", i);
+            return false;
+        }
+        indexRowCount += reader.GetIndex()[i].Block.RowCount;
+    }
+
+    // Every line except the header is a row.
+    auto lineCount = (size_t) std::count(data.begin(), data.end(), (uint8_t) '\n');
+    if (lineCount != indexRowCount + 1) {
+        AddTestFailure(__FILE__, __LINE__, "Compressed CSV index has %zu rows, but the CSV has %zu", indexRowCount, lineCount - 1);
+    }
+
+    FILE* fp = nullptr;
+    if (_wfopen_s(&fp, path.c_str(), L"wb") != 0) {
+        AddTestFailure(__FILE__, __LINE__, "Failed to write decompressed CSV: %s", Convert(path).c_str());
+        return false;
+    }
+    fwrite(data.data(), 1, data.size(), fp);
+    fclose(fp);
+    return true;
+}
+
+// Converts a -columnar output file into a CSV at path, with the columns named
+// and formatted as in the CSV output, and checks that each chunk's column
+// statistics match its values.  The QPCTime column is output as
+// TimeInSeconds, the qpc* columns as ms* columns, and QPCTime is added at the
+// end.
+bool ConvertColumnarCsv(std::wstring const& columnarPath, std::wstring const& path)
+{
+    ColumnarFileReader reader;
+    if (!reader.Open(Convert(columnarPath).c_str())) {
+        AddTestFailure(__FILE__, __LINE__, "Failed to open columnar output: %s", Convert(columnarPath).c_str());
+        return false;
+    }
+
+    auto const& header = reader.GetHeader();
+    auto qpcTimeColumn = reader.FindColumn("QPCTime");
+    if (qpcTimeColumn == UINT32_MAX) {
+        AddTestFailure(__FILE__, __LINE__, "Columnar output has no QPCTime column");
+        return false;
+    }
+
+    FILE* fp = nullptr;
+    if (_wfopen_s(&fp, path.c_str(), L"w") != 0) {
+        AddTestFailure(__FILE__, __LINE__, "Failed to write converted CSV: %s", Convert(path).c_str());
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header.ColumnCount; ++i) {
+        auto name = reader.GetColumn(i).Name;
+        auto separator = i == 0 ? "" : ",";
+        if (i == qpcTimeColumn) {
+            fprintf(fp, "%sTimeInSeconds", separator);
+        } else if (strncmp(name, "qpc", 3) == 0) {
+            fprintf(fp, "%sms%s", separator, name + 3);
+        } else {
+            fprintf(fp, "%s%s", separator, name);
+        }
+    }
+    fprintf(fp, ",QPCTime\n");
+
+    auto frequency = (double) header.QpcFrequency;
+    for (uint32_t chunk = 0; reader.NextChunk(); ++chunk) {
+        auto rowCount = reader.GetRowCount();
+        for (uint32_t i = 0; i < header.ColumnCount && rowCount > 0; ++i) {
+            auto isSigned = IsColumnarTypeSigned(reader.GetColumn(i).Type);
+            auto min = reader.GetValue(i, 0);
+            auto max = min;
+            for (uint32_t row = 1; row < rowCount; ++row) {
+                auto value = reader.GetValue(i, row);
+                if (isSigned ? (int64_t) value < (int64_t) min : value < min) min = value;
+                if (isSigned ? (int64_t) value > (int64_t) max : value > max) max = value;
+            }
+            auto const& column = reader.GetChunkColumn(i);
+            if (column.Min != min || column.Max != max) {
+                AddTestFailure(__FILE__, __LINE__, "Columnar chunk %u has the wrong range for column %s", chunk, reader.GetColumn(i).Name);
+            }
+        }
+
+        for (uint32_t row = 0; row < rowCount; ++row) {
+            for (uint32_t i = 0; i < header.ColumnCount; ++i) {
+                auto const& column = reader.GetColumn(i);
+                auto value = reader.GetValue(i, row);
+                if (i > 0) {
+                    fputc(',', fp);
+                }
+                if (i == qpcTimeColumn) {
+                    fprintf(fp, "%.*lf", DBL_DIG - 1, (double) (int64_t) (value - header.StartQpc) / frequency);
+                } else if (strncmp(column.Name, "qpc", 3) == 0) {
+                    fprintf(fp, "%.*lf", DBL_DIG - 1, 1000.0 * (double) (int64_t) value / frequency);
+                } else if (column.Type == COLUMNAR_TYPE_DICTIONARY) {
+                    fputs(reader.GetString(i, row).c_str(), fp);
+                } else if (strcmp(column.Name, "SwapChainAddress") == 0) {
+                    fprintf(fp, "0x%016llX", value);
+                } else if (IsColumnarTypeSigned(column.Type)) {
+                    fprintf(fp, "%lld", (int64_t) value);
+                } else {
+                    fprintf(fp, "%llu", value);
+                }
+            }
+            fprintf(fp, ",%llu\n", reader.GetValue(qpcTimeColumn, row));
+        }
+    }
+
+    fclose(fp);
+
+    if (reader.IsCorrupt()) {
+        AddTestFailure(__FILE__, __LINE__, "Columnar output is corrupt: %s", Convert(columnarPath).c_str());
+        return false;
+    }
+    return true;
+}
+
+// Joins the segments listed in the manifest of a -rotate_interval output into
+// path, and checks that the manifest's row counts match the segments.
+bool JoinSegments(std::wstring const& path)
+{
+    auto basePath = Convert(path.substr(0, path.size() - 4));
+    auto dir = basePath.substr(0, basePath.find_last_of("/\\") + 1);
+
+    FILE* manifest = nullptr;
+    if (fopen_s(&manifest, (basePath + "-manifest.csv").c_str(), "r") != 0) {
+        AddTestFailure(__FILE__, __LINE__, "Failed to open segment manifest: %s-manifest.csv", basePath.c_str());
+        return false;
+    }
+
+    FILE* fp = nullptr;
+    if (_wfopen_s(&fp, path.c_str(), L"w") != 0) {
+        AddTestFailure(__FILE__, __LINE__, "Failed to write joined CSV: %s", Convert(path).c_str());
+        fclose(manifest);
+        return false;
+    }
+
+    char line[4096];
+    uint32_t segmentCount = 0;
+    fgets(line, sizeof(line), manifest); // Header
+    while (fgets(line, sizeof(line), manifest) != nullptr) {
+        char fileName[MAX_PATH] = {};
+        uint32_t segment = 0;
+        size_t manifestRowCount = 0;
+        if (sscanf_s(line, "%u,%[^,],%zu", &segment, fileName, (unsigned) _countof(fileName), &manifestRowCount) != 3) {
+            AddTestFailure(__FILE__, __LINE__, "Invalid segment manifest line: %s", line);
+            break;
+        }
+        segmentCount += 1;
+        if (segment != segmentCount) {
+            AddTestFailure(__FILE__, __LINE__, "Segment manifest lists segment %u at position %u", segment, segmentCount);
+        }
+
+        FILE* segmentFp = nullptr;
+        if (fopen_s(&segmentFp, (dir + fileName).c_str(), "r") != 0) {
+            AddTestFailure(__FILE__, __LINE__, "Failed to open segment: %s", fileName);
+            break;
+        }
+
+        // Each segment starts with the header, which is only copied from the
+        // first.
+        size_t lineCount = 0;
+        while (fgets(line, sizeof(line), segmentFp) != nullptr) {
+            if (lineCount > 0 || segmentCount == 1) {
+                fputs(line, fp);
+            }
+            lineCount += 1;
+        }
+        fclose(segmentFp);
+
+        if (lineCount != manifestRowCount + 1) {
+            AddTestFailure(__FILE__, __LINE__, "Segment manifest lists %zu rows for %s, but it has %zu", manifestRowCount, fileName, lineCount - 1);
+        }
+    }
+
+    fclose(fp);
+    fclose(manifest);
+    return true;
+}
+
 class Tests : public ::testing::Test, TestArgs {
 public:
     explicit Tests(TestArgs const& args)
@@ -35,18 +234,61 @@ public:
             return;
         }
 
+        // If testing event captures, first record the ETL into a capture.
+        auto inputPath = etl_;
+        if (replayCapture_) {
+            inputPath = testCsv_.substr(0, testCsv_.size() - 4) + L".capture";
+
+            PresentMon pm;
+            pm.Add(L"-stop_existing_session");
+            pm.AddEtlPath(etl_);
+            pm.AddCapturePath(inputPath);
+            pm.PMSTART();
+            pm.PMEXITED();
+        }
+
         // Generate command line, querying gold CSV to try and match expected
         // data.
+        auto columnarPath = testCsv_.substr(0, testCsv_.size() - 4) + L".pmcf";
+
         PresentMon pm;
         pm.Add(L"-stop_existing_session");
-        pm.AddEtlPath(etl_);
-        pm.AddCsvPath(testCsv_);
+        pm.AddEtlPath(inputPath);
+        if (columnar_) {
+            pm.AddCsvPath(columnarPath);
+            pm.Add(L"-columnar");
+        } else {
+            pm.AddCsvPath(testCsv_);
+        }
+        if (compress_) {
+            pm.Add(L"-compress");
+            DeleteFile((testCsv_ + L".pmz").c_str());
+        }
+        if (rotate_) {
+            pm.Add(L"-rotate_interval 1");
+            DeleteFile((testCsv_.substr(0, testCsv_.size() - 4) + L"-manifest.csv").c_str());
+        }
         if (!goldCsv.trackDisplay_) pm.Add(L"-no_track_display");
         if (goldCsv.trackDebug_) pm.Add(L"-track_debug");
-        if (goldCsv.GetColumnIndex("QPCTime") != SIZE_MAX) pm.Add(L"-qpc_time"); // TODO: check if %ull or %.9lf to see if -qpc_time_s
+        if (goldCsv.GetColumnIndex("QPCTime") != SIZE_MAX && !columnar_) pm.Add(L"-qpc_time"); // TODO: check if %ull or %.9lf to see if -qpc_time_s
         pm.PMSTART();
         pm.PMEXITED();
 
+        if (compress_ && !DecompressCsv(testCsv_ + L".pmz", testCsv_)) {
+            goldCsv.Close();
+            return;
+        }
+
+        if (rotate_ && !JoinSegments(testCsv_)) {
+            goldCsv.Close();
+            return;
+        }
+
+        if (columnar_ && !ConvertColumnarCsv(columnarPath, testCsv_)) {
+            goldCsv.Close();
+            return;
+        }
+
         // Open test CSV file and check it has the same columns as gold
         PresentMonCsv testCsv;
         if (!testCsv.CSVOPEN(testCsv_)) {
@@ -167,6 +409,10 @@ void AddGoldEtlCsvTests(
 {
     TestArgs args;
     args.reportAllCsvDiffs_ = reportAllCsvDiffs;
+    args.replayCapture_ = false;
+    args.compress_ = false;
+    args.rotate_ = false;
+    args.columnar_ = false;
 
     WIN32_FIND_DATA ff = {};
     auto h = FindFirstFile((dir + L'*').c_str(), &ff);
@@ -184,6 +430,34 @@ void AddGoldEtlCsvTests(
                 ::testing::RegisterTest(
                     "GoldEtlCsvTests", args.name_.c_str(), nullptr, nullptr, __FILE__, __LINE__,
                     [=]() -> ::testing::Test* { return new Tests(args); });
+
+                auto captureArgs = args;
+                captureArgs.testCsv_.insert(captureArgs.testCsv_.size() - 4, L"_capture");
+                captureArgs.replayCapture_ = true;
+                ::testing::RegisterTest(
+                    "GoldCaptureCsvTests", args.name_.c_str(), nullptr, nullptr, __FILE__, __LINE__,
+                    [=]() -> ::testing::Test* { return new Tests(captureArgs); });
+
+                auto compressArgs = args;
+                compressArgs.testCsv_.insert(compressArgs.testCsv_.size() - 4, L"_compress");
+                compressArgs.compress_ = true;
+                ::testing::RegisterTest(
+                    "GoldCompressedCsvTests", args.name_.c_str(), nullptr, nullptr, __FILE__, __LINE__,
+                    [=]() -> ::testing::Test* { return new Tests(compressArgs); });
+
+                auto rotateArgs = args;
+                rotateArgs.testCsv_.insert(rotateArgs.testCsv_.size() - 4, L"_rotate");
+                rotateArgs.rotate_ = true;
+                ::testing::RegisterTest(
+                    "GoldRotatedCsvTests", args.name_.c_str(), nullptr, nullptr, __FILE__, __LINE__,
+                    [=]() -> ::testing::Test* { return new Tests(rotateArgs); });
+
+                auto columnarArgs = args;
+                columnarArgs.testCsv_.insert(columnarArgs.testCsv_.size() - 4, L"_columnar");
+                columnarArgs.columnar_ = true;
+                ::testing::RegisterTest(
+                    "GoldColumnarCsvTests", args.name_.c_str(), nullptr, nullptr, __FILE__, __LINE__,
+                    [=]() -> ::testing::Test* { return new Tests(columnarArgs); });
             }
         }
     } while (FindNextFile(h, &ff) != 0);
@@ -199,6 +199,15 @@ void PresentMon::AddCsvPath(std::wstring const& csvPath)
     DeleteFile(csvPath.c_str());
 }
 
+void PresentMon::AddCapturePath(std::wstring const& capturePath)
+{
+    cmdline_ += L" -capture_file \"";
+    cmdline_ += capturePath;
+    cmdline_ += L'\"';
+
+    DeleteFile(capturePath.c_str());
+}
+
 void PresentMon::Add(wchar_t const* args)
 {
     cmdline_ += L' ';
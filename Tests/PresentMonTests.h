@@ -104,6 +104,7 @@ struct PresentMon : PROCESS_INFORMATION {
 
     void AddEtlPath(std::wstring const& etlPath);
     void AddCsvPath(std::wstring const& csvPath);
+    void AddCapturePath(std::wstring const& capturePath);
     void Add(wchar_t const* args);
     void Start(char const* file, int line);
 
@@ -0,0 +1,236 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+//
+// Measures how long the output thread is stalled by CSV writes to a slow
+// disk, comparing the previous synchronous writes (one fwrite() per row to a
+// FILE with a 1MB stdio buffer) with OutputFile, which hands full buffers to
+// the writer thread.
+//
+// Each output file (one per process, as with -multi_csv) is a pipe drained by
+// a thread, and together they simulate a disk or network share with periodic
+// hiccups: they read as fast as they can, but all pause for hiccupMs after
+// every 256KB read from any of them.  Every millisecond the output thread
+// writes rowsPerTick CSV rows, spread over the files, which is less than the
+// simulated disk's average throughput, and this reports how long each tick's
+// writes took.
+//
+// Build and run (portable, does not require the Windows SDK):
+//     g++ -O2 -std=c++17 -pthread -I../../PresentMon async_csv_writer.cpp ../../PresentMon/OutputWriter.cpp -o async_csv_writer
+//     ./async_csv_writer [seconds] [rowsPerTick] [hiccupMs]
+
+#include "OutputWriter.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#define pipe(fds) _pipe(fds, 65536, _O_BINARY)
+#define fdopen _fdopen
+#define read _read
+#define close _close
+#else
+#include <unistd.h>
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+enum {
+    HICCUP_INTERVAL = 256 * 1024,
+    FILE_BUFFER_SIZE = 1024 * 1024,     // The stdio buffer size previously used for CSV files
+    SLOW_TICK_MS = 5,
+};
+
+struct SlowDisk {
+    std::mutex mMutex;
+    uint32_t mHiccupMs = 0;
+    uint64_t mBytesRead = 0;
+    uint64_t mNextHiccup = HICCUP_INTERVAL;
+    Clock::time_point mPausedUntil;
+
+    // Drains one file's pipe.
+    void Read(int fd)
+    {
+        std::vector<char> buffer(64 * 1024);
+        for (;;) {
+            auto n = read(fd, buffer.data(), (unsigned) buffer.size());
+            if (n <= 0) {
+                break;
+            }
+
+            Clock::time_point pausedUntil;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mBytesRead += (uint64_t) n;
+                if (mBytesRead >= mNextHiccup) {
+                    mNextHiccup += HICCUP_INTERVAL;
+                    mPausedUntil = Clock::now() + std::chrono::milliseconds(mHiccupMs);
+                }
+                pausedUntil = mPausedUntil;
+            }
+            std::this_thread::sleep_until(pausedUntil);
+        }
+        close(fd);
+    }
+};
+
+struct SyncOutput {
+    std::vector<FILE*> mFiles;
+    std::vector<std::vector<char>> mBuffers;
+
+    // The buffers are passed to setvbuf(), since some C runtimes ignore the
+    // size if they aren't.
+    void Open(std::vector<FILE*> const& files)
+    {
+        mFiles = files;
+        mBuffers.resize(files.size());
+        for (size_t i = 0; i < files.size(); ++i) {
+            mBuffers[i].resize(FILE_BUFFER_SIZE);
+            setvbuf(mFiles[i], mBuffers[i].data(), _IOFBF, FILE_BUFFER_SIZE);
+        }
+    }
+
+    void Write(size_t file, std::string const& row)
+    {
+        fwrite(row.data(), 1, row.size(), mFiles[file]);
+    }
+
+    void Close()
+    {
+        for (auto fp : mFiles) {
+            fclose(fp);
+        }
+    }
+};
+
+struct AsyncOutput {
+    std::vector<OutputFile*> mFiles;
+
+    void Open(std::vector<FILE*> const& files)
+    {
+        StartOutputWriter();
+        for (auto fp : files) {
+            mFiles.push_back(new OutputFile(fp, "pipe", false));
+        }
+    }
+
+    void Write(size_t file, std::string const& row)
+    {
+        mFiles[file]->Write(row.data(), row.size());
+    }
+
+    void Close()
+    {
+        for (auto file : mFiles) {
+            CloseOutputFile(file);
+        }
+        StopOutputWriter();
+    }
+};
+
+struct Result {
+    double mMeanUs;
+    double mMaxMs;
+    uint32_t mSlowTicks;
+    uint32_t mTickCount;
+    uint64_t mBytes;
+};
+
+template<typename Output>
+Result Run(uint32_t fileCount, uint32_t seconds, uint32_t rowsPerTick, uint32_t hiccupMs, std::vector<std::string> const& rows)
+{
+    SlowDisk disk;
+    disk.mHiccupMs = hiccupMs;
+
+    std::vector<std::thread> readers;
+    std::vector<FILE*> files(fileCount);
+    for (uint32_t i = 0; i < fileCount; ++i) {
+        int fds[2] = {};
+        if (pipe(fds) != 0) {
+            fprintf(stderr, "error: failed to create pipe\n");
+            exit(1);
+        }
+        files[i] = fdopen(fds[1], "wb");
+        readers.emplace_back(&SlowDisk::Read, &disk, fds[0]);
+    }
+
+    Output output;
+    output.Open(files);
+
+    std::vector<double> tickMs;
+    uint64_t nextRow = 0;
+    auto start = Clock::now();
+    auto nextTick = start;
+    for (uint32_t tick = 0; tick < seconds * 1000; ++tick) {
+        auto t0 = Clock::now();
+        for (uint32_t r = 0; r < rowsPerTick; ++r) {
+            output.Write(nextRow % fileCount, rows[nextRow % rows.size()]);
+            nextRow += 1;
+        }
+        auto t1 = Clock::now();
+        tickMs.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+
+        nextTick += std::chrono::milliseconds(1);
+        std::this_thread::sleep_until(nextTick);
+    }
+
+    output.Close();
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    Result result = {};
+    result.mBytes = disk.mBytesRead;
+
+    for (auto ms : tickMs) {
+        result.mMeanUs += 1000.0 * ms;
+        result.mMaxMs = std::max(result.mMaxMs, ms);
+        result.mSlowTicks += ms > SLOW_TICK_MS ? 1 : 0;
+    }
+    result.mMeanUs /= tickMs.size();
+    result.mTickCount = (uint32_t) tickMs.size();
+    return result;
+}
+
+void Print(char const* name, Result const& r)
+{
+    printf("  %-6s %8.1f us/tick mean  %8.2f ms max  %5u of %u ticks over %ums  (%.1f MB written)\n",
+        name, r.mMeanUs, r.mMaxMs, r.mSlowTicks, r.mTickCount, SLOW_TICK_MS, r.mBytes / (1024.0 * 1024.0));
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t seconds = argc > 1 ? (uint32_t) atoi(argv[1]) : 5;
+    uint32_t rowsPerTick = argc > 2 ? (uint32_t) atoi(argv[2]) : 40;
+    uint32_t hiccupMs = argc > 3 ? (uint32_t) atoi(argv[3]) : 20;
+
+    // Rows like UpdateCsv()'s, with varying times.
+    std::vector<std::string> rows;
+    for (uint32_t i = 0; i < 1024; ++i) {
+        char row[256];
+        snprintf(row, sizeof(row), "game.exe,%u,0x000001D2C4A3F2A0,DXGI,1,0,0,%.13f,%.13f,%.13f,1,Hardware: Independent Flip,%.13f,%.13f,%.13f\n",
+            1000 + i % 8, 12.5 + i / 60.0, 0.1 + (i % 7) / 100.0, 16.6 + (i % 5) / 10.0, 1.2 + (i % 3) / 10.0, 20.0 + (i % 11) / 10.0, 16.6);
+        rows.emplace_back(row);
+    }
+
+    uint32_t const fileCounts[] = { 1, 4, 16 };
+    for (auto fileCount : fileCounts) {
+        printf("%u file(s), %u rows/ms, disk pauses %ums every %uKB:\n", fileCount, rowsPerTick, hiccupMs, HICCUP_INTERVAL / 1024);
+        Print("sync", Run<SyncOutput>(fileCount, seconds, rowsPerTick, hiccupMs, rows));
+        Print("async", Run<AsyncOutput>(fileCount, seconds, rowsPerTick, hiccupMs, rows));
+    }
+
+    return 0;
+}
@@ -0,0 +1,349 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+//
+// Measures the -compress output on the Gold CSVs: the compression ratio, the
+// writer thread's CPU cost to compress each byte, the cost to decompress, and
+// how much of a long capture has to be read to extract a time range.
+//
+// Each CSV is written through a compressed OutputFile, with EndRows() after
+// every row as UpdateCsv() does, and read back with CompressedFileReader to
+// check that it decompresses to the original.  The compress and decompress
+// costs are measured by repeating BlockCompression::Compress() and
+// Decompress() on the same blocks on one thread.
+//
+// The Gold CSVs are each smaller than one block, so a long capture is also
+// simulated by repeating all of their rows, with increasing times, until it
+// is captureMB long.  For that capture this also reports the writer thread's
+// compression cost per row, the end-to-end throughput of writing it as fast
+// as possible (which is limited by the single writer thread) compared to an
+// uncompressed OutputFile, and the cost of reading one second of rows by
+// seeking to its blocks compared to decompressing the whole file.
+//
+// Build and run from this directory (portable, does not require the Windows
+// SDK):
+//     g++ -O2 -std=c++17 -pthread -I../../PresentMon block_compression.cpp ../../PresentMon/OutputWriter.cpp -o block_compression
+//     ./block_compression [captureMB] [csv...]
+//
+// By default the CSVs are ../../Tests/Gold/test_case_0.csv to test_case_4.csv.
+
+#include "CompressedOutput.hpp"
+#include "OutputWriter.hpp"
+
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define COMPRESSED_PATH   "block_compression.tmp.pmz"
+#define UNCOMPRESSED_PATH "block_compression.tmp.csv"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+enum { QPC_FREQUENCY = 10000000 };
+
+struct Csv {
+    std::string mHeader;                // Including the newline
+    std::vector<std::string> mRows;     // Including the newlines
+    std::vector<uint64_t> mQpcs;        // TimeInSeconds of each row, in QPC_FREQUENCY ticks
+};
+
+double Seconds(Clock::time_point t0, Clock::time_point t1)
+{
+    return std::chrono::duration<double>(t1 - t0).count();
+}
+
+bool ReadFile(char const* path, std::string* data)
+{
+    auto fp = fopen(path, "rb");
+    if (fp == nullptr) {
+        return false;
+    }
+    char buffer[64 * 1024];
+    for (size_t n; (n = fread(buffer, 1, sizeof(buffer), fp)) > 0; ) {
+        data->append(buffer, n);
+    }
+    fclose(fp);
+    return true;
+}
+
+bool ReadCsv(char const* path, Csv* csv)
+{
+    std::string data;
+    if (!ReadFile(path, &data)) {
+        return false;
+    }
+
+    size_t timeColumn = SIZE_MAX;
+    for (size_t lineStart = 0; lineStart < data.size(); ) {
+        auto lineEnd = data.find('\n', lineStart);
+        lineEnd = lineEnd == std::string::npos ? data.size() : lineEnd + 1;
+        std::string line(data, lineStart, lineEnd - lineStart);
+        lineStart = lineEnd;
+
+        // Find the TimeInSeconds column in the header.
+        if (csv->mHeader.empty()) {
+            csv->mHeader = line;
+            size_t column = 0;
+            for (size_t i = 0; i < line.size(); ++column) {
+                auto j = line.find_first_of(",\r\n", i);
+                if (line.compare(i, j - i, "TimeInSeconds") == 0) {
+                    timeColumn = column;
+                }
+                i = j + 1;
+            }
+            if (timeColumn == SIZE_MAX) {
+                return false;
+            }
+            continue;
+        }
+
+        size_t i = 0;
+        for (size_t column = 0; column < timeColumn && i != std::string::npos; ++column) {
+            i = line.find(',', i);
+            i = i == std::string::npos ? i : i + 1;
+        }
+        if (i == std::string::npos) {
+            return false;
+        }
+        csv->mRows.emplace_back(line);
+        csv->mQpcs.push_back((uint64_t) (strtod(line.c_str() + i, nullptr) * QPC_FREQUENCY));
+    }
+    return !csv->mRows.empty();
+}
+
+// Writes the CSV through an OutputFile, and returns the time taken until
+// the writer thread finished writing it.
+double WriteCsv(Csv const& csv, char const* path, bool compress)
+{
+    auto fp = fopen(path, "wb");
+    if (fp == nullptr) {
+        fprintf(stderr, "error: failed to open %s\n", path);
+        exit(1);
+    }
+
+    auto t0 = Clock::now();
+    StartOutputWriter();
+    auto file = new OutputFile(fp, path, compress);
+    file->Write(csv.mHeader.data(), csv.mHeader.size());
+    for (size_t i = 0, n = csv.mRows.size(); i < n; ++i) {
+        file->Write(csv.mRows[i].data(), csv.mRows[i].size());
+        file->EndRows(1, csv.mQpcs[i], csv.mQpcs[i]);
+    }
+    CloseOutputFile(file);
+    StopOutputWriter();
+    auto t1 = Clock::now();
+
+    return Seconds(t0, t1);
+}
+
+uint64_t GetFileSize(char const* path)
+{
+    std::string data;
+    ReadFile(path, &data);
+    return data.size();
+}
+
+// Decompresses the whole file and checks that it matches the CSV.
+void CheckRoundTrip(Csv const& csv, char const* path)
+{
+    std::string expected = csv.mHeader;
+    size_t rowCount = 0;
+    for (auto const& row : csv.mRows) {
+        expected += row;
+    }
+
+    CompressedFileReader reader;
+    std::vector<uint8_t> data;
+    auto ok = reader.Open(path);
+    for (size_t i = 0, n = reader.GetIndex().size(); ok && i < n; ++i) {
+        ok = reader.ReadBlock(i, &data);
+        rowCount += reader.GetIndex()[i].Block.RowCount;
+    }
+    if (!ok || rowCount != csv.mRows.size() || data.size() != expected.size() || memcmp(data.data(), expected.data(), data.size()) != 0) {
+        fprintf(stderr, "error: %s did not decompress to the original CSV\n", path);
+        exit(1);
+    }
+}
+
+// Measures the single-thread compress and decompress cost of the file's
+// blocks, in ns per uncompressed byte.
+void MeasureCodec(char const* path, double* compressNsPerByte, double* decompressNsPerByte)
+{
+    CompressedFileReader reader;
+    reader.Open(path);
+
+    std::vector<std::vector<uint8_t>> blocks;
+    size_t totalSize = 0;
+    for (size_t i = 0, n = reader.GetIndex().size(); i < n; ++i) {
+        blocks.emplace_back();
+        reader.ReadBlock(i, &blocks.back());
+        totalSize += blocks.back().size();
+    }
+
+    std::vector<std::vector<uint8_t>> compressed(blocks.size());
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        compressed[i].resize(BlockCompression::GetBound(blocks[i].size()));
+        compressed[i].resize(BlockCompression::Compress(blocks[i].data(), blocks[i].size(), compressed[i].data()));
+    }
+
+    // Repeat until at least 64MB has been processed.
+    auto repeatCount = (uint32_t) (64 * 1024 * 1024 / totalSize + 1);
+
+    std::vector<uint8_t> scratch;
+    size_t compressedSize = 0;
+    auto t0 = Clock::now();
+    for (uint32_t r = 0; r < repeatCount; ++r) {
+        for (auto const& block : blocks) {
+            scratch.resize(BlockCompression::GetBound(block.size()));
+            compressedSize += BlockCompression::Compress(block.data(), block.size(), scratch.data());
+        }
+    }
+    auto t1 = Clock::now();
+    for (uint32_t r = 0; r < repeatCount; ++r) {
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            scratch.resize(blocks[i].size());
+            if (!BlockCompression::Decompress(compressed[i].data(), compressed[i].size(), scratch.data(), scratch.size())) {
+                fprintf(stderr, "error: failed to decompress block %zu of %s\n", i, path);
+                exit(1);
+            }
+        }
+    }
+    auto t2 = Clock::now();
+
+    if (compressedSize == 0) {
+        fprintf(stderr, "error: nothing was compressed\n");
+        exit(1);
+    }
+
+    *compressNsPerByte = 1e9 * Seconds(t0, t1) / ((double) totalSize * repeatCount);
+    *decompressNsPerByte = 1e9 * Seconds(t1, t2) / ((double) totalSize * repeatCount);
+}
+
+// Returns the compress cost in ns per byte.
+double PrintRatio(char const* name, Csv const& csv)
+{
+    WriteCsv(csv, COMPRESSED_PATH, true);
+    CheckRoundTrip(csv, COMPRESSED_PATH);
+
+    double compressNs = 0.0;
+    double decompressNs = 0.0;
+    MeasureCodec(COMPRESSED_PATH, &compressNs, &decompressNs);
+
+    size_t csvSize = csv.mHeader.size();
+    for (auto const& row : csv.mRows) {
+        csvSize += row.size();
+    }
+    auto compressedSize = GetFileSize(COMPRESSED_PATH);
+
+    printf("  %-16s %10zu %10llu %6.1f%% %7.2f %8.0f %7.2f %8.0f\n",
+        name, csvSize, (unsigned long long) compressedSize, 100.0 * compressedSize / csvSize,
+        compressNs, 1e3 / compressNs, decompressNs, 1e3 / decompressNs);
+    return compressNs;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t captureMB = argc > 1 ? (uint32_t) atoi(argv[1]) : 64;
+
+    std::vector<std::string> paths;
+    for (int i = 2; i < argc; ++i) {
+        paths.emplace_back(argv[i]);
+    }
+    if (paths.empty()) {
+        for (int i = 0; i < 5; ++i) {
+            paths.emplace_back("../../Tests/Gold/test_case_" + std::to_string(i) + ".csv");
+        }
+    }
+
+    std::vector<Csv> csvs(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        if (!ReadCsv(paths[i].c_str(), &csvs[i])) {
+            fprintf(stderr, "error: failed to read CSV with a TimeInSeconds column: %s\n", paths[i].c_str());
+            return 1;
+        }
+    }
+
+    printf("Compression (%uKB blocks; ns/B and MB/s are single-thread compress and decompress):\n", COMPRESSED_BLOCK_SIZE / 1024);
+    printf("  %-16s %10s %10s %7s %7s %8s %7s %8s\n", "file", "CSV bytes", "compressed", "ratio", "ns/B", "MB/s", "ns/B", "MB/s");
+    for (size_t i = 0; i < paths.size(); ++i) {
+        auto name = paths[i].substr(paths[i].find_last_of("/\\") + 1);
+        PrintRatio(name.c_str(), csvs[i]);
+    }
+
+    // Build a long capture from all of the rows, offsetting the times of each
+    // repetition so they keep increasing.
+    Csv capture;
+    capture.mHeader = csvs[0].mHeader;
+    uint64_t captureSize = 0;
+    uint64_t qpcOffset = 0;
+    while (captureSize < (uint64_t) captureMB * 1024 * 1024) {
+        uint64_t lastQpc = 0;
+        for (auto const& csv : csvs) {
+            for (size_t i = 0; i < csv.mRows.size(); ++i) {
+                capture.mRows.push_back(csv.mRows[i]);
+                capture.mQpcs.push_back(qpcOffset + csv.mQpcs[i]);
+                captureSize += csv.mRows[i].size();
+                if (csv.mQpcs[i] > lastQpc) {
+                    lastQpc = csv.mQpcs[i];
+                }
+            }
+        }
+        qpcOffset += lastQpc + QPC_FREQUENCY;
+    }
+    std::string captureName = std::to_string(captureMB) + "MB capture";
+    auto compressNsPerByte = PrintRatio(captureName.c_str(), capture);
+
+    // The rows' times are only increasing within each Gold CSV, which is
+    // enough for the output thread cost but not for seeking, so the seek
+    // test uses evenly spaced times.
+    for (size_t i = 0; i < capture.mQpcs.size(); ++i) {
+        capture.mQpcs[i] = i * (QPC_FREQUENCY / 1000);
+    }
+
+    auto uncompressedSeconds = WriteCsv(capture, UNCOMPRESSED_PATH, false);
+    auto compressedSeconds = WriteCsv(capture, COMPRESSED_PATH, true);
+    auto rowNs = compressNsPerByte * captureSize / capture.mRows.size();
+    printf("\n%s, %zu rows:\n", captureName.c_str(), capture.mRows.size());
+    printf("  writer thread compression: %.0f ns/row, %.2f%% of a core at 10000 rows/s\n", rowNs, rowNs * 1e-3);
+    printf("  write throughput: %.0f MB/s uncompressed, %.0f MB/s compressed\n",
+        captureSize / (1024.0 * 1024.0) / uncompressedSeconds, captureSize / (1024.0 * 1024.0) / compressedSeconds);
+
+    // Read one second of rows from the middle, by seeking to the blocks
+    // covering it, and by decompressing the whole file.
+    CompressedFileReader reader;
+    reader.Open(COMPRESSED_PATH);
+    auto const& index = reader.GetIndex();
+    auto minQpc = capture.mQpcs[capture.mQpcs.size() / 2];
+    auto maxQpc = minQpc + QPC_FREQUENCY;
+
+    enum { SEEK_REPEAT_COUNT = 100 };
+    std::vector<uint8_t> data;
+    std::vector<size_t> blocks;
+    auto t0 = Clock::now();
+    for (uint32_t r = 0; r < SEEK_REPEAT_COUNT; ++r) {
+        data.clear();
+        reader.FindBlocks(minQpc, maxQpc, &blocks);
+        for (auto i : blocks) {
+            reader.ReadBlock(i, &data);
+        }
+    }
+    auto t1 = Clock::now();
+    for (size_t i = 0; i < index.size(); ++i) {
+        reader.ReadBlock(i, &data);
+    }
+    auto t2 = Clock::now();
+
+    printf("  read 1s of rows: %.3f ms seeking to %zu of %zu blocks, %.1f ms decompressing the whole file\n",
+        1e3 * Seconds(t0, t1) / SEEK_REPEAT_COUNT, blocks.size(), index.size(), 1e3 * Seconds(t1, t2));
+
+    remove(COMPRESSED_PATH);
+    remove(UNCOMPRESSED_PATH);
+    return 0;
+}
@@ -0,0 +1,21 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+//
+// Minimal stand-in for <d3d9.h>; see windows.h in this directory.
+
+#pragma once
+
+#include <windows.h>
+
+#define D3DPRESENT_DONOTWAIT                0x00000001L
+#define D3DPRESENT_LINEAR_CONTENT           0x00000002L
+#define D3DPRESENT_DONOTFLIP                0x00000004L
+#define D3DPRESENT_FLIPRESTART              0x00000008L
+#define D3DPRESENT_VIDEO_RESTRICT_TO_MONITOR 0x00000010L
+#define D3DPRESENT_UPDATEOVERLAYONLY        0x00000020L
+#define D3DPRESENT_HIDEOVERLAY              0x00000040L
+#define D3DPRESENT_UPDATECOLORKEY           0x00000080L
+#define D3DPRESENT_FORCEIMMEDIATE           0x00000100L
+
+#define S_PRESENT_MODE_CHANGED              ((HRESULT) 0x08760877L)
+#define S_PRESENT_OCCLUDED                  ((HRESULT) 0x08760878L)
@@ -0,0 +1,21 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+//
+// Minimal stand-in for <dxgi.h>; see windows.h in this directory.
+
+#pragma once
+
+#include <windows.h>
+
+#define DXGI_PRESENT_TEST                   0x00000001UL
+#define DXGI_PRESENT_DO_NOT_SEQUENCE        0x00000002UL
+#define DXGI_PRESENT_RESTART                0x00000004UL
+#define DXGI_PRESENT_DO_NOT_WAIT            0x00000008UL
+
+#define DXGI_STATUS_OCCLUDED                    ((HRESULT) 0x087A0001L)
+#define DXGI_STATUS_CLIPPED                     ((HRESULT) 0x087A0002L)
+#define DXGI_STATUS_NO_REDIRECTION              ((HRESULT) 0x087A0004L)
+#define DXGI_STATUS_NO_DESKTOP_ACCESS           ((HRESULT) 0x087A0005L)
+#define DXGI_STATUS_GRAPHICS_VIDPN_SOURCE_IN_USE ((HRESULT) 0x087A0006L)
+#define DXGI_STATUS_MODE_CHANGED                ((HRESULT) 0x087A0007L)
+#define DXGI_STATUS_MODE_CHANGE_IN_PROGRESS     ((HRESULT) 0x087A0008L)
@@ -0,0 +1,51 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+//
+// Minimal stand-in for <evntcons.h>; see windows.h in this directory.
+
+#pragma once
+
+#include "evntrace.h"
+
+#define EVENT_HEADER_FLAG_32_BIT_HEADER 0x0020
+#define EVENT_HEADER_FLAG_64_BIT_HEADER 0x0040
+
+typedef struct _EVENT_DESCRIPTOR {
+    USHORT    Id;
+    UCHAR     Version;
+    UCHAR     Channel;
+    UCHAR     Level;
+    UCHAR     Opcode;
+    USHORT    Task;
+    ULONGLONG Keyword;
+} EVENT_DESCRIPTOR;
+
+typedef struct _EVENT_HEADER {
+    USHORT           Size;
+    USHORT           HeaderType;
+    USHORT           Flags;
+    USHORT           EventProperty;
+    ULONG            ThreadId;
+    ULONG            ProcessId;
+    LARGE_INTEGER    TimeStamp;
+    GUID             ProviderId;
+    EVENT_DESCRIPTOR EventDescriptor;
+    ULONG64          ProcessorTime;
+    GUID             ActivityId;
+} EVENT_HEADER, *PEVENT_HEADER;
+
+typedef struct _ETW_BUFFER_CONTEXT {
+    UCHAR  ProcessorNumber;
+    UCHAR  Alignment;
+    USHORT LoggerId;
+} ETW_BUFFER_CONTEXT;
+
+typedef struct _EVENT_RECORD {
+    EVENT_HEADER       EventHeader;
+    ETW_BUFFER_CONTEXT BufferContext;
+    USHORT             ExtendedDataCount;
+    USHORT             UserDataLength;
+    void*              ExtendedData;
+    PVOID              UserData;
+    PVOID              UserContext;
+} EVENT_RECORD, *PEVENT_RECORD;
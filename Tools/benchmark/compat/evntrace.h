@@ -0,0 +1,15 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+//
+// Minimal stand-in for <evntrace.h>; see windows.h in this directory.
+
+#pragma once
+
+#include <windows.h>
+
+#define EVENT_TRACE_TYPE_INFO       0x00
+#define EVENT_TRACE_TYPE_START      0x01
+#define EVENT_TRACE_TYPE_END        0x02
+#define EVENT_TRACE_TYPE_STOP       0x02
+#define EVENT_TRACE_TYPE_DC_START   0x03
+#define EVENT_TRACE_TYPE_DC_END     0x04
@@ -0,0 +1,134 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+//
+// Minimal stand-in for <tdh.h>; see windows.h in this directory.  There is no
+// TDH service, so event metadata must be provided with
+// EventMetadata::AddMetadata(key, traceEventInfo, size).
+
+#pragma once
+
+#include <evntcons.h>
+
+enum _TDH_IN_TYPE {
+    TDH_INTYPE_NULL,
+    TDH_INTYPE_UNICODESTRING,
+    TDH_INTYPE_ANSISTRING,
+    TDH_INTYPE_INT8,
+    TDH_INTYPE_UINT8,
+    TDH_INTYPE_INT16,
+    TDH_INTYPE_UINT16,
+    TDH_INTYPE_INT32,
+    TDH_INTYPE_UINT32,
+    TDH_INTYPE_INT64,
+    TDH_INTYPE_UINT64,
+    TDH_INTYPE_FLOAT,
+    TDH_INTYPE_DOUBLE,
+    TDH_INTYPE_BOOLEAN,
+    TDH_INTYPE_BINARY,
+    TDH_INTYPE_GUID,
+    TDH_INTYPE_POINTER,
+    TDH_INTYPE_FILETIME,
+    TDH_INTYPE_SYSTEMTIME,
+    TDH_INTYPE_SID,
+    TDH_INTYPE_HEXINT32,
+    TDH_INTYPE_HEXINT64,
+    TDH_INTYPE_COUNTEDSTRING = 300,
+    TDH_INTYPE_COUNTEDANSISTRING,
+    TDH_INTYPE_REVERSEDCOUNTEDSTRING,
+    TDH_INTYPE_REVERSEDCOUNTEDANSISTRING,
+    TDH_INTYPE_NONNULLTERMINATEDSTRING,
+    TDH_INTYPE_NONNULLTERMINATEDANSISTRING,
+    TDH_INTYPE_UNICODECHAR,
+    TDH_INTYPE_ANSICHAR,
+    TDH_INTYPE_SIZET,
+    TDH_INTYPE_HEXDUMP,
+    TDH_INTYPE_WBEMSID,
+};
+
+typedef enum _PROPERTY_FLAGS {
+    PropertyStruct              = 0x1,
+    PropertyParamLength         = 0x2,
+    PropertyParamCount          = 0x4,
+    PropertyWBEMXmlFragment     = 0x8,
+    PropertyParamFixedLength    = 0x10,
+    PropertyParamFixedCount     = 0x20,
+    PropertyHasTags             = 0x40,
+    PropertyHasCustomSchema     = 0x80,
+} PROPERTY_FLAGS;
+
+typedef enum _DECODING_SOURCE {
+    DecodingSourceXMLFile,
+    DecodingSourceWbem,
+    DecodingSourceWPP,
+    DecodingSourceTlg,
+    DecodingSourceMax,
+} DECODING_SOURCE;
+
+typedef struct _EVENT_PROPERTY_INFO {
+    PROPERTY_FLAGS Flags;
+    ULONG NameOffset;
+    union {
+        struct {
+            USHORT InType;
+            USHORT OutType;
+            ULONG MapNameOffset;
+        } nonStructType;
+        struct {
+            USHORT StructStartIndex;
+            USHORT NumOfStructMembers;
+            ULONG padding;
+        } structType;
+    };
+    union {
+        USHORT count;
+        USHORT countPropertyIndex;
+    };
+    union {
+        USHORT length;
+        USHORT lengthPropertyIndex;
+    };
+    ULONG Reserved;
+} EVENT_PROPERTY_INFO;
+
+typedef struct _TRACE_EVENT_INFO {
+    GUID ProviderGuid;
+    GUID EventGuid;
+    EVENT_DESCRIPTOR EventDescriptor;
+    DECODING_SOURCE DecodingSource;
+    ULONG ProviderNameOffset;
+    ULONG LevelNameOffset;
+    ULONG ChannelNameOffset;
+    ULONG KeywordsNameOffset;
+    ULONG TaskNameOffset;
+    ULONG OpcodeNameOffset;
+    ULONG EventMessageOffset;
+    ULONG ProviderMessageOffset;
+    ULONG BinaryXMLOffset;
+    ULONG BinaryXMLSize;
+    ULONG EventNameOffset;
+    ULONG EventAttributesOffset;
+    ULONG PropertyCount;
+    ULONG TopLevelPropertyCount;
+    ULONG Flags;
+    EVENT_PROPERTY_INFO EventPropertyInfoArray[ANYSIZE_ARRAY];
+} TRACE_EVENT_INFO, *PTRACE_EVENT_INFO;
+
+typedef struct _PROPERTY_DATA_DESCRIPTOR {
+    ULONGLONG PropertyName;
+    ULONG ArrayIndex;
+    ULONG Reserved;
+} PROPERTY_DATA_DESCRIPTOR, *PPROPERTY_DATA_DESCRIPTOR;
+
+typedef struct _TDH_CONTEXT TDH_CONTEXT, *PTDH_CONTEXT;
+
+#define TEI_PROPERTY_NAME(teiPtr, propPtr) ((PWSTR) ((PBYTE) (teiPtr) + (propPtr)->NameOffset))
+
+inline ULONG TdhGetEventInformation(PEVENT_RECORD, ULONG, PTDH_CONTEXT, PTRACE_EVENT_INFO, PULONG)
+{
+    return ERROR_NOT_FOUND;
+}
+
+inline ULONG TdhGetPropertySize(PEVENT_RECORD, ULONG, PTDH_CONTEXT, ULONG, PPROPERTY_DATA_DESCRIPTOR, PULONG)
+{
+    return ERROR_NOT_FOUND;
+}
@@ -0,0 +1,177 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+//
+// Minimal stand-in for the parts of <windows.h> used by PresentData, so that
+// the benchmarks can build the trace consumers on non-Windows platforms.  It
+// is only put on the include path by the non-Windows build commands in the
+// benchmark README; Windows builds use the Windows SDK.
+//
+// Integer types keep their Windows (LLP64) sizes, so DWORD/ULONG/LONG are 32
+// bits even where long is 64 bits.
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <sched.h>
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+#include <wchar.h>
+
+typedef int32_t         BOOL;
+typedef uint8_t         BOOLEAN;
+typedef uint8_t         BYTE;
+typedef uint8_t         UCHAR;
+typedef uint16_t        USHORT;
+typedef uint16_t        WORD;
+typedef int32_t         LONG;
+typedef uint32_t        ULONG;
+typedef uint32_t        DWORD;
+typedef uint32_t        UINT;
+typedef int32_t         INT;
+typedef int64_t         LONGLONG;
+typedef uint64_t        ULONGLONG;
+typedef uint64_t        ULONG64;
+typedef int32_t         HRESULT;
+typedef void*           HANDLE;
+typedef void*           PVOID;
+typedef BYTE*           PBYTE;
+typedef ULONG*          PULONG;
+typedef wchar_t         WCHAR;
+typedef wchar_t*        PWSTR;
+typedef wchar_t const*  LPCWSTR;
+
+typedef union _LARGE_INTEGER {
+    struct { DWORD LowPart; LONG HighPart; } u;
+    LONGLONG QuadPart;
+} LARGE_INTEGER;
+
+typedef union _ULARGE_INTEGER {
+    struct { DWORD LowPart; DWORD HighPart; } u;
+    ULONGLONG QuadPart;
+} ULARGE_INTEGER;
+
+typedef struct tagRECT {
+    LONG left;
+    LONG top;
+    LONG right;
+    LONG bottom;
+} RECT;
+
+typedef struct _GUID {
+    uint32_t Data1;
+    uint16_t Data2;
+    uint16_t Data3;
+    uint8_t  Data4[8];
+} GUID;
+
+inline bool InlineIsEqualGUID(GUID const& a, GUID const& b) { return memcmp(&a, &b, sizeof(GUID)) == 0; }
+inline bool IsEqualGUID(GUID const& a, GUID const& b) { return InlineIsEqualGUID(a, b); }
+inline bool operator==(GUID const& a, GUID const& b) { return InlineIsEqualGUID(a, b); }
+inline bool operator!=(GUID const& a, GUID const& b) { return !InlineIsEqualGUID(a, b); }
+
+// The ETW headers name providers with MSVC's
+// struct __declspec(uuid("...")) X; and __uuidof(X).  Without compiler support
+// for either, derive a GUID that is stable and unique per type from its name
+// instead.  These do not match the Windows provider GUIDs, but the benchmarks
+// only need them to be consistent within the process.
+#define __declspec(x)
+#define __uuidof(T) (::PMCompatUuidOf<T>())
+
+template<typename T>
+GUID PMCompatUuidOf()
+{
+    uint64_t h[2] = { 14695981039346656037ull, 1099511628211ull };
+    for (auto s = __PRETTY_FUNCTION__; *s != '\0'; ++s) {
+        h[0] = (h[0] ^ (uint8_t) *s) * 1099511628211ull;
+        h[1] = (h[1] ^ (uint8_t) *s) * 14695981039346656037ull + h[0];
+    }
+    GUID guid;
+    memcpy(&guid, h, sizeof(guid));
+    return guid;
+}
+
+#define TRUE  1
+#define FALSE 0
+
+#define ANYSIZE_ARRAY 1
+#define INFINITE      0xFFFFFFFF
+#define WAIT_OBJECT_0 0x00000000L
+#define WAIT_TIMEOUT  0x00000102L
+
+#define ERROR_SUCCESS               0L
+#define ERROR_FILE_NOT_FOUND        2L
+#define ERROR_NOT_SUPPORTED         50L
+#define ERROR_INSUFFICIENT_BUFFER   122L
+#define ERROR_NOT_FOUND             1168L
+#define ERROR_FILE_CORRUPT          1392L
+
+#define S_OK            ((HRESULT) 0L)
+#define SUCCEEDED(hr)   (((HRESULT) (hr)) >= 0)
+#define FAILED(hr)      (((HRESULT) (hr)) < 0)
+
+#ifndef _countof
+#define _countof(a) (sizeof(a) / sizeof((a)[0]))
+#endif
+
+// Events are emulated with a mutex and condition variable.  Only the
+// auto-/manual-reset behaviour used by HandoffSignal is supported.
+struct PMCompatEvent {
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    bool mSignaled;
+    bool mManualReset;
+};
+
+inline HANDLE CreateEventW(void*, BOOL manualReset, BOOL initialState, LPCWSTR)
+{
+    auto e = new PMCompatEvent;
+    e->mSignaled = initialState != FALSE;
+    e->mManualReset = manualReset != FALSE;
+    return e;
+}
+
+inline BOOL SetEvent(HANDLE h)
+{
+    auto e = (PMCompatEvent*) h;
+    {
+        std::lock_guard<std::mutex> lock(e->mMutex);
+        e->mSignaled = true;
+    }
+    e->mCondition.notify_all();
+    return TRUE;
+}
+
+inline DWORD WaitForSingleObject(HANDLE h, DWORD timeoutMs)
+{
+    auto e = (PMCompatEvent*) h;
+    std::unique_lock<std::mutex> lock(e->mMutex);
+    auto signaled = [e]() { return e->mSignaled; };
+    if (timeoutMs == INFINITE) {
+        e->mCondition.wait(lock, signaled);
+    } else if (!e->mCondition.wait_for(lock, std::chrono::milliseconds(timeoutMs), signaled)) {
+        return WAIT_TIMEOUT;
+    }
+    if (!e->mManualReset) {
+        e->mSignaled = false;
+    }
+    return WAIT_OBJECT_0;
+}
+
+inline BOOL CloseHandle(HANDLE h)
+{
+    delete (PMCompatEvent*) h;
+    return TRUE;
+}
+
+inline void Sleep(DWORD ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+inline BOOL SwitchToThread()
+{
+    return sched_yield() == 0;
+}
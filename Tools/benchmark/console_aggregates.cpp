@@ -0,0 +1,380 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+//
+// Measures the output thread's cost of the console's per-swap chain averages,
+// comparing the previous swap chain history (the last 120 PresentEvents,
+// walked on every console refresh to sum the display intervals and
+// latencies) with PresentSummary records and running sums that are updated
+// as presents are added and expire.
+//
+// Each swap chain presents at its own rate between 60 and 240Hz, with one in
+// eight presents dropped.  Every 10ms the batch of presents completed since
+// the last one is added to the histories and presents older than 2 seconds
+// are pruned, as ProcessEvents() does, and every 100ms the console averages
+// of every swap chain are computed, as UpdateConsole() does.  This checks that
+// both produce the same averages, and reports the cost per present added and
+// per console refresh.
+//
+// The previous histories point at PresentEvent-sized records allocated in
+// completion order from a ring, like the slab pool, so consecutive presents
+// of a swap chain are far apart in memory.
+//
+// Build and run (portable, does not require the Windows SDK):
+//     g++ -O2 -std=c++17 console_aggregates.cpp -o console_aggregates
+//     ./console_aggregates [seconds]
+
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+enum {
+    QPC_FREQUENCY = 10000000,
+    PRESENT_HISTORY_MAX_COUNT = 120,
+    BATCH_QPC = QPC_FREQUENCY / 100,
+    REFRESH_QPC = QPC_FREQUENCY / 10,
+    HISTORY_QPC = 2 * QPC_FREQUENCY,
+};
+
+// The PresentEvent fields used by the console, padded to PresentEvent's size.
+struct Present {
+    uint64_t QpcTime;
+    uint64_t ScreenTime;
+    int32_t SyncInterval;
+    uint32_t PresentFlags;
+    uint8_t Runtime;
+    uint8_t PresentMode;
+    bool Displayed;
+    uint8_t mPadding[136 - 27];
+};
+
+struct Averages {
+    uint64_t mCpuDelta;
+    uint64_t mDisplayDelta;
+    uint64_t mLatencySum;
+    uint32_t mPresentCount;
+    uint32_t mDisplayedCount;
+    uint8_t mPresentMode;
+
+    bool operator!=(Averages const& a) const
+    {
+        return mCpuDelta != a.mCpuDelta || mDisplayDelta != a.mDisplayDelta || mLatencySum != a.mLatencySum ||
+               mPresentCount != a.mPresentCount || mDisplayedCount != a.mDisplayedCount || mPresentMode != a.mPresentMode;
+    }
+};
+
+// The previous history: pointers to the presents, walked by GetAverages().
+struct PreviousHistory {
+    Present const* mPresentHistory[PRESENT_HISTORY_MAX_COUNT];
+    uint32_t mPresentHistoryCount;
+    uint32_t mNextPresentIndex;
+
+    void Init()
+    {
+        mPresentHistoryCount = 0;
+        mNextPresentIndex = 1;
+    }
+
+    void Add(Present const* p)
+    {
+        mPresentHistory[mNextPresentIndex % PRESENT_HISTORY_MAX_COUNT] = p;
+        mNextPresentIndex += 1;
+        if (mPresentHistoryCount < PRESENT_HISTORY_MAX_COUNT) {
+            mPresentHistoryCount += 1;
+        }
+    }
+
+    void Prune(uint64_t minQpc)
+    {
+        auto count = mPresentHistoryCount;
+        for (; count > 0; --count) {
+            if (mPresentHistory[(mNextPresentIndex - count) % PRESENT_HISTORY_MAX_COUNT]->QpcTime >= minQpc) {
+                break;
+            }
+        }
+        mPresentHistoryCount = count;
+    }
+
+    bool GetAverages(Averages* a) const
+    {
+        if (mPresentHistoryCount < 2) {
+            return false;
+        }
+        auto const& present0 = *mPresentHistory[(mNextPresentIndex - mPresentHistoryCount) % PRESENT_HISTORY_MAX_COUNT];
+        auto const& presentN = *mPresentHistory[(mNextPresentIndex - 1) % PRESENT_HISTORY_MAX_COUNT];
+        *a = Averages();
+        a->mCpuDelta = presentN.QpcTime - present0.QpcTime;
+        a->mPresentCount = mPresentHistoryCount;
+
+        uint64_t display0ScreenTime = 0;
+        Present const* displayN = nullptr;
+        for (uint32_t i = 0; i < mPresentHistoryCount; ++i) {
+            auto p = mPresentHistory[(mNextPresentIndex - mPresentHistoryCount + i) % PRESENT_HISTORY_MAX_COUNT];
+            if (p->Displayed) {
+                if (a->mDisplayedCount == 0) {
+                    display0ScreenTime = p->ScreenTime;
+                }
+                displayN = p;
+                a->mLatencySum += p->ScreenTime - p->QpcTime;
+                a->mDisplayedCount += 1;
+            }
+        }
+        if (displayN != nullptr) {
+            a->mDisplayDelta = displayN->ScreenTime - display0ScreenTime;
+            a->mPresentMode = displayN->PresentMode;
+        }
+        return true;
+    }
+};
+
+// PresentSummary records with running sums, as in SwapChainData.
+struct SummaryHistory {
+    struct PresentSummary {
+        uint64_t mQpcTime;
+        uint64_t mScreenTime;
+        uint64_t mNextDisplayDelta;
+        int32_t mSyncInterval;
+        uint32_t mPresentFlags;
+        uint8_t mRuntime;
+        uint8_t mPresentMode;
+        bool mDisplayed;
+    };
+
+    PresentSummary mPresentHistory[PRESENT_HISTORY_MAX_COUNT];
+    uint32_t mPresentHistoryCount;
+    uint32_t mNextPresentIndex;
+    uint32_t mLastDisplayedPresentIndex;
+    uint32_t mDisplayedCount;
+    uint64_t mDisplayDeltaSum;
+    uint64_t mDisplayLatencySum;
+
+    void Init()
+    {
+        mPresentHistoryCount = 0;
+        mNextPresentIndex = 1;
+        mLastDisplayedPresentIndex = 0;
+        mDisplayedCount = 0;
+        mDisplayDeltaSum = 0;
+        mDisplayLatencySum = 0;
+    }
+
+    void ExpireOldest()
+    {
+        auto const& oldest = mPresentHistory[(mNextPresentIndex - mPresentHistoryCount) % PRESENT_HISTORY_MAX_COUNT];
+        if (oldest.mDisplayed) {
+            mDisplayedCount -= 1;
+            mDisplayDeltaSum -= oldest.mNextDisplayDelta;
+            mDisplayLatencySum -= oldest.mScreenTime - oldest.mQpcTime;
+        }
+        mPresentHistoryCount -= 1;
+    }
+
+    void Add(Present const* p)
+    {
+        if (mPresentHistoryCount == PRESENT_HISTORY_MAX_COUNT) {
+            ExpireOldest();
+        }
+
+        auto index = mNextPresentIndex;
+        auto summary = &mPresentHistory[index % PRESENT_HISTORY_MAX_COUNT];
+        summary->mQpcTime = p->QpcTime;
+        summary->mScreenTime = p->ScreenTime;
+        summary->mNextDisplayDelta = 0;
+        summary->mSyncInterval = p->SyncInterval;
+        summary->mPresentFlags = p->PresentFlags;
+        summary->mRuntime = p->Runtime;
+        summary->mPresentMode = p->PresentMode;
+        summary->mDisplayed = p->Displayed;
+
+        if (p->Displayed) {
+            if (mDisplayedCount > 0) {
+                auto lastDisplayed = &mPresentHistory[mLastDisplayedPresentIndex % PRESENT_HISTORY_MAX_COUNT];
+                lastDisplayed->mNextDisplayDelta = p->ScreenTime - lastDisplayed->mScreenTime;
+                mDisplayDeltaSum += lastDisplayed->mNextDisplayDelta;
+            }
+            mDisplayedCount += 1;
+            mDisplayLatencySum += p->ScreenTime - p->QpcTime;
+            mLastDisplayedPresentIndex = index;
+        }
+
+        mNextPresentIndex += 1;
+        mPresentHistoryCount += 1;
+    }
+
+    void Prune(uint64_t minQpc)
+    {
+        while (mPresentHistoryCount > 0 &&
+               mPresentHistory[(mNextPresentIndex - mPresentHistoryCount) % PRESENT_HISTORY_MAX_COUNT].mQpcTime < minQpc) {
+            ExpireOldest();
+        }
+    }
+
+    bool GetAverages(Averages* a) const
+    {
+        if (mPresentHistoryCount < 2) {
+            return false;
+        }
+        auto const& present0 = mPresentHistory[(mNextPresentIndex - mPresentHistoryCount) % PRESENT_HISTORY_MAX_COUNT];
+        auto const& presentN = mPresentHistory[(mNextPresentIndex - 1) % PRESENT_HISTORY_MAX_COUNT];
+        *a = Averages();
+        a->mCpuDelta = presentN.mQpcTime - present0.mQpcTime;
+        a->mPresentCount = mPresentHistoryCount;
+        a->mDisplayedCount = mDisplayedCount;
+        a->mLatencySum = mDisplayLatencySum;
+        if (mDisplayedCount > 0) {
+            a->mDisplayDelta = mDisplayDeltaSum;
+            a->mPresentMode = mPresentHistory[mLastDisplayedPresentIndex % PRESENT_HISTORY_MAX_COUNT].mPresentMode;
+        }
+        return true;
+    }
+};
+
+struct Result {
+    double mAddNs;          // Per present
+    double mPruneUs;        // Per batch
+    double mConsoleUs;      // Per refresh
+    std::vector<Averages> mAverages;
+};
+
+// Presents in completion order, each with its swap chain.
+struct Stream {
+    std::vector<Present> mPresents;
+    std::vector<uint32_t> mSwapChains;
+};
+
+Stream GenerateStream(uint32_t swapChainCount, uint32_t seconds)
+{
+    // Merge each swap chain's presents by time.
+    std::vector<uint64_t> nextQpc(swapChainCount);
+    std::vector<uint64_t> period(swapChainCount);
+    std::vector<uint32_t> counts(swapChainCount);
+    for (uint32_t i = 0; i < swapChainCount; ++i) {
+        period[i] = QPC_FREQUENCY / (60 + (i * 37) % 181);
+        nextQpc[i] = (i * 7919ull) % period[i];
+    }
+
+    Stream stream;
+    uint64_t endQpc = (uint64_t) seconds * QPC_FREQUENCY;
+    uint64_t seed = 1;
+    for (uint64_t qpc = 0; qpc < endQpc; qpc += BATCH_QPC / 4) {
+        for (uint32_t i = 0; i < swapChainCount; ++i) {
+            for (; nextQpc[i] < qpc + BATCH_QPC / 4; nextQpc[i] += period[i]) {
+                seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+                Present p = {};
+                p.QpcTime = nextQpc[i];
+                p.Displayed = (seed >> 40) % 8 != 0;
+                p.ScreenTime = p.Displayed ? p.QpcTime + period[i] + (seed >> 33) % (period[i] / 2) : 0;
+                p.SyncInterval = 1;
+                p.PresentMode = (uint8_t) (counts[i]++ % 3);
+                stream.mPresents.push_back(p);
+                stream.mSwapChains.push_back(i);
+            }
+        }
+    }
+    return stream;
+}
+
+template<typename History>
+Result Run(Stream const& stream, uint32_t swapChainCount)
+{
+    // The presents referenced by the previous history are copied into a
+    // ring, in completion order, which is large enough to hold the last 4
+    // seconds of presents at 240Hz.
+    std::vector<Present> ring((size_t) swapChainCount * 240 * 4);
+    size_t ringIndex = 0;
+
+    std::vector<History> histories(swapChainCount);
+    for (auto& history : histories) {
+        history.Init();
+    }
+
+    Result result = {};
+    double addSeconds = 0.0;
+    double pruneSeconds = 0.0;
+    double consoleSeconds = 0.0;
+    uint32_t batchCount = 0;
+    uint32_t refreshCount = 0;
+
+    size_t i = 0;
+    auto n = stream.mPresents.size();
+    for (uint64_t batchEnd = BATCH_QPC; i < n; batchEnd += BATCH_QPC) {
+        auto t0 = Clock::now();
+        uint64_t latestQpc = 0;
+        for (; i < n && stream.mPresents[i].QpcTime < batchEnd; ++i) {
+            auto p = &ring[ringIndex];
+            *p = stream.mPresents[i];
+            ringIndex = (ringIndex + 1) % ring.size();
+            histories[stream.mSwapChains[i]].Add(p);
+            latestQpc = p->QpcTime;
+        }
+        auto t1 = Clock::now();
+        if (latestQpc >= HISTORY_QPC) {
+            for (auto& history : histories) {
+                history.Prune(latestQpc - HISTORY_QPC);
+            }
+        }
+        auto t2 = Clock::now();
+        addSeconds += std::chrono::duration<double>(t1 - t0).count();
+        pruneSeconds += std::chrono::duration<double>(t2 - t1).count();
+        batchCount += 1;
+
+        if (batchEnd % REFRESH_QPC == 0) {
+            auto t3 = Clock::now();
+            for (auto const& history : histories) {
+                Averages a;
+                if (history.GetAverages(&a)) {
+                    result.mAverages.push_back(a);
+                }
+            }
+            auto t4 = Clock::now();
+            consoleSeconds += std::chrono::duration<double>(t4 - t3).count();
+            refreshCount += 1;
+        }
+    }
+
+    result.mAddNs = 1e9 * addSeconds / n;
+    result.mPruneUs = 1e6 * pruneSeconds / batchCount;
+    result.mConsoleUs = 1e6 * consoleSeconds / refreshCount;
+    return result;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t seconds = argc > 1 ? (uint32_t) atoi(argv[1]) : 10;
+
+    printf("%5s %10s  %24s  %24s  %26s\n", "swap", "", "add (ns/present)", "prune (us/batch)", "console (us/refresh)");
+    printf("%5s %10s  %11s %12s  %11s %12s  %12s %13s\n", "chains", "presents", "previous", "running sums", "previous", "running sums", "previous", "running sums");
+
+    uint32_t const swapChainCounts[] = { 1, 16, 256, 1024 };
+    for (auto swapChainCount : swapChainCounts) {
+        auto stream = GenerateStream(swapChainCount, seconds);
+        auto previous = Run<PreviousHistory>(stream, swapChainCount);
+        auto sums = Run<SummaryHistory>(stream, swapChainCount);
+
+        if (previous.mAverages.size() != sums.mAverages.size()) {
+            fprintf(stderr, "error: the histories produced a different number of averages\n");
+            return 1;
+        }
+        for (size_t i = 0; i < previous.mAverages.size(); ++i) {
+            if (previous.mAverages[i] != sums.mAverages[i]) {
+                fprintf(stderr, "error: the histories produced different averages\n");
+                return 1;
+            }
+        }
+
+        printf("%5u %10zu  %11.1f %12.1f  %11.2f %12.2f  %12.2f %13.2f\n",
+            swapChainCount, stream.mPresents.size(),
+            previous.mAddNs, sums.mAddNs,
+            previous.mPruneUs, sums.mPruneUs,
+            previous.mConsoleUs, sums.mConsoleUs);
+    }
+
+    return 0;
+}
@@ -0,0 +1,319 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+//
+// Measures how much is written to the console per refresh, comparing the
+// previous full rewrite of the display (every line, every 100ms) with
+// ConsoleScreen, which only draws the lines that changed since the last
+// refresh.
+//
+// The frames are like UpdateConsole()'s: for each process a header line, an
+// averages line and a percentiles line per swap chain, and an empty line.
+// The averages are the swap chain's frame time plus up to +/-jitterMs of noise
+// per refresh, so they change every refresh unless the swap chain is steady
+// (e.g., synced to a 60Hz display), and the percentiles change on about one
+// refresh in 20.  A process starts or exits every 10 seconds, so the display
+// grows and shrinks.
+//
+// Each frame is drawn with the ANSI back end to a simulated terminal, which
+// starts with its cursor near the bottom so that the display has to scroll it,
+// and this checks that the terminal shows the frame after every refresh.  This
+// reports the bytes of ANSI output and the characters that the Win32 back end
+// would pass to WriteConsoleOutputCharacterA() per refresh.
+//
+// Build and run (portable, does not require the Windows SDK):
+//     g++ -O2 -std=c++17 -I../../PresentMon console_renderer.cpp ../../PresentMon/ConsoleScreen.cpp -o console_renderer
+//     ./console_renderer [seconds] [jitterMs]
+
+#include "ConsoleScreen.hpp"
+
+#include <random>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+enum {
+    TERMINAL_WIDTH = 120,
+    TERMINAL_HEIGHT = 80,
+    REFRESHES_PER_SECOND = 10,
+    SWAP_CHAINS_PER_PROCESS = 2,
+};
+
+// A terminal that interprets the subset of ANSI escape sequences used by
+// AnsiConsoleBackEnd, and scrolls when a new line is written on the bottom
+// line.
+struct Terminal {
+    std::vector<std::string> mLines;
+    uint32_t mX = 0;
+    uint32_t mY = 0;
+    bool mPendingWrap = false;
+
+    Terminal() : mLines(TERMINAL_HEIGHT, std::string(TERMINAL_WIDTH, ' ')) {}
+
+    void NewLine()
+    {
+        if (mY + 1 < TERMINAL_HEIGHT) {
+            mY += 1;
+        } else {
+            mLines.erase(mLines.begin());
+            mLines.emplace_back(TERMINAL_WIDTH, ' ');
+        }
+    }
+
+    void Write(char const* data, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i) {
+            auto c = data[i];
+            if (c == '\x1b') {
+                uint32_t n = 0;
+                bool hasN = false;
+                for (i += 2; data[i] >= '0' && data[i] <= '9'; ++i) {
+                    n = n * 10 + (data[i] - '0');
+                    hasN = true;
+                }
+                n = hasN ? n : 1;
+                switch (data[i]) {
+                case 'A': mY = n > mY ? 0 : mY - n; break;
+                case 'B': mY = mY + n >= TERMINAL_HEIGHT ? TERMINAL_HEIGHT - 1 : mY + n; break;
+                case 'K': memset(&mLines[mY][mX], ' ', TERMINAL_WIDTH - mX); break;
+                default:
+                    fprintf(stderr, "error: unexpected escape sequence\n");
+                    exit(1);
+                }
+                mPendingWrap = false;
+            } else if (c == '\r') {
+                mX = 0;
+                mPendingWrap = false;
+            } else if (c == '\n') {
+                NewLine();
+                mPendingWrap = false;
+            } else {
+                if (mPendingWrap) {
+                    mX = 0;
+                    NewLine();
+                    mPendingWrap = false;
+                }
+                mLines[mY][mX] = c;
+                if (mX + 1 < TERMINAL_WIDTH) {
+                    mX += 1;
+                } else {
+                    mPendingWrap = true;
+                }
+            }
+        }
+    }
+};
+
+// Counts the characters the Win32 back end would write.
+class CountingBackEnd : public ConsoleBackEnd {
+public:
+    uint64_t mChars = 0;
+
+    uint32_t GetWidth() override { return TERMINAL_WIDTH; }
+    bool BeginFrame(uint32_t) override { return false; }
+    void WriteLine(uint32_t, char const*, uint32_t length) override { mChars += length; }
+    void EndFrame(uint32_t) override {}
+};
+
+struct SwapChain {
+    double mFrameMs;
+    double mCpuMs;
+    double mDisplayMs;
+    double mPercentiles[4];
+};
+
+struct Process {
+    uint32_t mProcessId;
+    std::vector<SwapChain> mSwapChains;
+};
+
+struct Result {
+    uint64_t mAnsiBytes;
+    uint64_t mWin32Chars;
+    uint32_t mRefreshCount;
+};
+
+void Print(ConsoleScreen* screen, std::string* expected, char const* format, ...)
+{
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+
+    va_start(args, format);
+    screen->vPrint(format, args);
+    va_end(args);
+
+    *expected += text;
+}
+
+void PrintLn(ConsoleScreen* screen, std::string* expected, char const* format, ...)
+{
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+
+    va_start(args, format);
+    screen->vPrint(format, args);
+    va_end(args);
+    screen->EndLine();
+
+    *expected += text;
+    expected->append(TERMINAL_WIDTH - expected->size() % TERMINAL_WIDTH, ' ');
+}
+
+// Draws the same frames into two screens, one with the ANSI back end and one
+// with the counting back end, with every line redrawn on every refresh if
+// fullRewrite is true.
+Result Run(uint32_t seconds, double jitterMs, bool fullRewrite)
+{
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> noise(-jitterMs, jitterMs);
+    std::uniform_int_distribution<uint32_t> percentileChange(0, 19);
+
+    std::vector<Process> processes;
+    auto AddProcess = [&]() {
+        Process process;
+        process.mProcessId = 1000 + 4 * (uint32_t) processes.size();
+        for (uint32_t i = 0; i < SWAP_CHAINS_PER_PROCESS; ++i) {
+            SwapChain chain = {};
+            chain.mFrameMs = 1000.0 / (30 + (rng() % 8) * 30);
+            for (uint32_t j = 0; j < 4; ++j) {
+                chain.mPercentiles[j] = chain.mFrameMs * (1.0 + 0.1 * j);
+            }
+            process.mSwapChains.push_back(chain);
+        }
+        processes.push_back(process);
+    };
+    for (uint32_t i = 0; i < 8; ++i) {
+        AddProcess();
+    }
+
+    // Fill the terminal with earlier output, leaving the cursor near the
+    // bottom.
+    Terminal terminal;
+    for (uint32_t i = 0; i < TERMINAL_HEIGHT - 4; ++i) {
+        char line[64];
+        auto n = snprintf(line, sizeof(line), "warning: earlier output %u\r\n", i);
+        terminal.Write(line, n);
+    }
+
+    auto fp = tmpfile();
+    AnsiConsoleBackEnd ansi(fp, TERMINAL_WIDTH);
+    CountingBackEnd win32;
+    ConsoleScreen ansiScreen(TERMINAL_WIDTH);
+    ConsoleScreen win32Screen(TERMINAL_WIDTH);
+    long readOffset = 0;
+    std::vector<char> output;
+
+    Result result = {};
+    for (uint32_t refresh = 0; refresh < seconds * REFRESHES_PER_SECOND; ++refresh) {
+        if (refresh > 0 && refresh % (10 * REFRESHES_PER_SECOND) == 0) {
+            if ((refresh / (10 * REFRESHES_PER_SECOND)) % 2 == 0) {
+                AddProcess();
+            } else {
+                processes.erase(processes.begin() + (rng() % processes.size()));
+            }
+        }
+
+        for (auto& process : processes) {
+            for (auto& chain : process.mSwapChains) {
+                chain.mCpuMs = chain.mFrameMs + noise(rng);
+                chain.mDisplayMs = chain.mFrameMs + noise(rng);
+                if (percentileChange(rng) == 0) {
+                    chain.mPercentiles[rng() % 4] += 0.01;
+                }
+            }
+        }
+
+        std::string expected;
+        for (auto screen : { &ansiScreen, &win32Screen }) {
+            expected.clear();
+            for (auto const& process : processes) {
+                PrintLn(screen, &expected, "game%u.exe[%u]:", process.mProcessId % 7, process.mProcessId);
+                for (size_t i = 0; i < process.mSwapChains.size(); ++i) {
+                    auto const& chain = process.mSwapChains[i];
+                    Print(screen, &expected, "    %016llX (DXGI): SyncInterval=0 Flags=0 CPU/Display=%.2lf/%.2lfms (%.1lf/%.1lf fps) latency=%.2lfms",
+                        0x1D2C4A3F2A0ull + 0x100 * i, chain.mCpuMs, chain.mDisplayMs, 1000.0 / chain.mCpuMs, 1000.0 / chain.mDisplayMs, 2.0 * chain.mFrameMs);
+                    PrintLn(screen, &expected, " Hardware: Independent Flip");
+                    PrintLn(screen, &expected, "        p50/p95/p99/p99.9: CPU=%.2lf/%.2lf/%.2lf/%.2lfms",
+                        chain.mPercentiles[0], chain.mPercentiles[1], chain.mPercentiles[2], chain.mPercentiles[3]);
+                }
+                PrintLn(screen, &expected, "");
+            }
+            PrintLn(screen, &expected, "** RECORDING **");
+
+            if (fullRewrite) {
+                screen->Invalidate();
+            }
+        }
+
+        ansiScreen.Commit(&ansi);
+        win32Screen.Commit(&win32);
+
+        // Pass the new output to the terminal.
+        auto size = ftell(fp) - readOffset;
+        output.resize((size_t) size);
+        fseek(fp, readOffset, SEEK_SET);
+        if (fread(output.data(), 1, output.size(), fp) != output.size()) {
+            fprintf(stderr, "error: failed to read output\n");
+            exit(1);
+        }
+        readOffset += size;
+        terminal.Write(output.data(), output.size());
+
+        // Check the lines above the cursor, and that nothing is left below
+        // them.
+        auto lineCount = (uint32_t) (expected.size() / TERMINAL_WIDTH);
+        auto ok = terminal.mX == 0 && terminal.mY >= lineCount;
+        for (uint32_t y = 0; ok && y < lineCount; ++y) {
+            ok = terminal.mLines[terminal.mY - lineCount + y] == expected.substr((size_t) y * TERMINAL_WIDTH, TERMINAL_WIDTH);
+        }
+        for (auto y = terminal.mY; ok && y < TERMINAL_HEIGHT; ++y) {
+            ok = terminal.mLines[y] == std::string(TERMINAL_WIDTH, ' ');
+        }
+        if (!ok) {
+            fprintf(stderr, "error: terminal doesn't match frame %u\n", refresh);
+            exit(1);
+        }
+
+        result.mRefreshCount += 1;
+    }
+
+    fclose(fp);
+
+    result.mAnsiBytes = (uint64_t) readOffset;
+    result.mWin32Chars = win32.mChars;
+    return result;
+}
+
+void Print(char const* name, Result const& r)
+{
+    printf("  %-8s %8.0f ANSI bytes/refresh  %8.0f Win32 chars/refresh\n",
+        name, (double) r.mAnsiBytes / r.mRefreshCount, (double) r.mWin32Chars / r.mRefreshCount);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t seconds = argc > 1 ? (uint32_t) atoi(argv[1]) : 60;
+    double jitterMs = argc > 2 ? atof(argv[2]) : 0.2;
+
+    double const jitters[] = { jitterMs, 0.002 };
+    for (auto jitter : jitters) {
+        printf("%u refreshes, %u swap chains per process, averages jitter +/-%.3fms:\n",
+            seconds * REFRESHES_PER_SECOND, SWAP_CHAINS_PER_PROCESS, jitter);
+        Print("rewrite", Run(seconds, jitter, true));
+        Print("diff", Run(seconds, jitter, false));
+    }
+
+    return 0;
+}
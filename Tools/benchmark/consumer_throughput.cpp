@@ -0,0 +1,215 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+//
+// Measures end-to-end PMTraceConsumer throughput on a synthetic event stream
+// (see synthetic_present_events.hpp) for a number of processes, swap chains
+// per process, and presents per second per swap chain, using every generated
+// PresentMode.
+//
+// The events are generated in batches of 100ms of simulated time, and only
+// the dispatch of those events to the consumer is timed.  As in PresentMon,
+// an output thread waits on the consumer's HandoffSignal and dequeues the
+// completed and lost presents, which it tallies by PresentMode.  The
+// benchmark reports events/sec, presents/sec, the number of completed and
+// lost presents, and the peak memory use of the process.
+//
+// Build and run on Windows:
+//     cl /O2 /EHsc /std:c++17 /I..\..\PresentData consumer_throughput.cpp ..\..\PresentData\PresentMonTraceConsumer.cpp ..\..\PresentData\TraceConsumer.cpp tdh.lib
+//     consumer_throughput [seconds] [processCount] [swapChainsPerProcess] [presentsPerSecond] [dropEventsPerMillion]
+//
+// Build and run elsewhere, using the minimal Windows headers in compat/:
+//     g++ -O2 -std=c++17 -pthread -Icompat -I../../PresentData consumer_throughput.cpp ../../PresentData/PresentMonTraceConsumer.cpp ../../PresentData/TraceConsumer.cpp -o consumer_throughput
+//     ./consumer_throughput [seconds] [processCount] [swapChainsPerProcess] [presentsPerSecond] [dropEventsPerMillion]
+
+#include "synthetic_present_events.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+#ifdef _WIN32
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+enum { PRESENT_MODE_COUNT = (uint32_t) PresentMode::Hardware_Composed_Independent_Flip + 1 };
+
+char const* PresentModeToString(PresentMode mode)
+{
+    switch (mode) {
+    case PresentMode::Hardware_Legacy_Flip:                 return "Hardware: Legacy Flip";
+    case PresentMode::Hardware_Legacy_Copy_To_Front_Buffer: return "Hardware: Legacy Copy to front buffer";
+    case PresentMode::Hardware_Independent_Flip:            return "Hardware: Independent Flip";
+    case PresentMode::Composed_Flip:                        return "Composed: Flip";
+    case PresentMode::Composed_Copy_GPU_GDI:                return "Composed: Copy with GPU GDI";
+    case PresentMode::Composed_Copy_CPU_GDI:                return "Composed: Copy with CPU GDI";
+    case PresentMode::Composed_Composition_Atlas:           return "Composed: Composition Atlas";
+    case PresentMode::Hardware_Composed_Independent_Flip:   return "Hardware Composed: Independent Flip";
+    default:                                                return "Other";
+    }
+}
+
+// Dispatch the event to the consumer by provider, as TraceSession does.
+void DispatchEvent(PMTraceConsumer* consumer, EVENT_RECORD* eventRecord)
+{
+    auto const& hdr = eventRecord->EventHeader;
+    if (hdr.ProviderId == Microsoft_Windows_DxgKrnl::GUID)   { consumer->HandleDXGKEvent(eventRecord); return; }
+    if (hdr.ProviderId == Microsoft_Windows_DXGI::GUID)      { consumer->HandleDXGIEvent(eventRecord); return; }
+    if (hdr.ProviderId == Microsoft_Windows_D3D9::GUID)      { consumer->HandleD3D9Event(eventRecord); return; }
+    if (hdr.ProviderId == NT_Process::GUID)                  { consumer->HandleNTProcessEvent(eventRecord); return; }
+    if (hdr.ProviderId == Microsoft_Windows_Win32k::GUID)    { consumer->HandleWin32kEvent(eventRecord); return; }
+    if (hdr.ProviderId == Microsoft_Windows_Dwm_Core::GUID)  { consumer->HandleDWMEvent(eventRecord); return; }
+}
+
+struct OutputStats {
+    uint64_t mPresented[PRESENT_MODE_COUNT];
+    uint64_t mDiscarded[PRESENT_MODE_COUNT];
+    uint64_t mLost;
+    uint64_t mProcesses;
+};
+
+void OutputThread(PMTraceConsumer* consumer, HandoffSignal* signal, std::atomic<bool>* quit, OutputStats* stats)
+{
+    std::vector<ProcessEvent> processEvents;
+    std::vector<PoolHandoffPtr<PresentEvent>> presentEvents;
+    std::vector<PoolHandoffPtr<PresentEvent>> lostPresentEvents;
+
+    for (;;) {
+        // Read quit before dequeuing, so that nothing queued before the
+        // consumer finished is missed.
+        auto done = quit->load();
+
+        consumer->DequeueProcessEvents(processEvents);
+        consumer->DequeuePresentEvents(presentEvents);
+        consumer->DequeueLostPresentEvents(lostPresentEvents);
+
+        stats->mProcesses += processEvents.size();
+        for (auto const& p : presentEvents) {
+            auto mode = (uint32_t) p->PresentMode;
+            if (p->FinalState == PresentResult::Presented) {
+                stats->mPresented[mode] += 1;
+            } else {
+                stats->mDiscarded[mode] += 1;
+            }
+        }
+        stats->mLost += lostPresentEvents.size();
+
+        processEvents.clear();
+        presentEvents.clear();
+        lostPresentEvents.clear();
+
+        if (done) {
+            break;
+        }
+
+        signal->Wait(100, [=]() { return consumer->HasQueuedEvents() || quit->load(); });
+    }
+}
+
+uint64_t GetPeakMemoryBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters = {};
+    counters.cb = sizeof(counters);
+    return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.PeakWorkingSetSize : 0;
+#else
+    struct rusage usage = {};
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? (uint64_t) usage.ru_maxrss * 1024 : 0; // ru_maxrss is in KB
+#endif
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t seconds = argc > 1 ? (uint32_t) atoi(argv[1]) : 120;
+
+    SyntheticPresentEvents::Config config;
+    if (argc > 2) config.mProcessCount         = (uint32_t) atoi(argv[2]);
+    if (argc > 3) config.mSwapChainsPerProcess = (uint32_t) atoi(argv[3]);
+    if (argc > 4) config.mPresentsPerSecond    = (uint32_t) atoi(argv[4]);
+    if (argc > 5) config.mDropEventsPerMillion = (uint32_t) atoi(argv[5]);
+
+    printf("%u s of %u process(es) x %u swap chain(s) at %u presents/s, %u Hz refresh, %u dropped events per million\n",
+        seconds, config.mProcessCount, config.mSwapChainsPerProcess, config.mPresentsPerSecond, config.mRefreshRate,
+        config.mDropEventsPerMillion);
+
+    SyntheticPresentEvents::Generator generator(config);
+    SyntheticPresentEvents::EventBuffer events;
+
+    HandoffSignal signal;
+    std::atomic<bool> quit(false);
+    OutputStats stats = {};
+
+    auto consumer = new PMTraceConsumer;
+    consumer->mHandoffSignal = &signal;
+    consumer->SetQpcFrequency(SyntheticPresentEvents::QPC_FREQUENCY);
+    generator.AddMetadata(&consumer->mMetadata);
+
+    std::thread outputThread(OutputThread, consumer, &signal, &quit, &stats);
+
+    std::chrono::steady_clock::duration consumerTime {};
+    uint64_t const batchQpc = SyntheticPresentEvents::QPC_FREQUENCY / 10;
+    for (uint64_t endQpc = batchQpc; endQpc <= (uint64_t) seconds * SyntheticPresentEvents::QPC_FREQUENCY; endQpc += batchQpc) {
+        generator.Generate(endQpc, &events);
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (auto& eventRecord : events.mRecords) {
+            DispatchEvent(consumer, &eventRecord);
+        }
+        consumerTime += std::chrono::steady_clock::now() - t0;
+    }
+
+    while (!consumer->FlushHandoffOverflow()) {
+        Sleep(1);
+    }
+
+    quit = true;
+    signal.Notify();
+    outputThread.join();
+
+    auto peakMemory = GetPeakMemoryBytes();
+    delete consumer;
+
+    // Report
+    uint64_t generatedPresents = generator.GetDwmPresentCount();
+    uint64_t presented = 0;
+    uint64_t discarded = 0;
+    for (uint32_t i = 0; i < PRESENT_MODE_COUNT; ++i) {
+        generatedPresents += generator.GetPresentCount((PresentMode) i);
+        presented += stats.mPresented[i];
+        discarded += stats.mDiscarded[i];
+    }
+
+    auto consumerSeconds = std::chrono::duration<double>(consumerTime).count();
+    auto eventCount = generator.GetEventCount();
+    auto completed = presented + discarded;
+
+    printf("\n%-38s %12s %12s %12s\n", "PresentMode", "Generated", "Presented", "Discarded");
+    for (uint32_t i = 0; i < PRESENT_MODE_COUNT; ++i) {
+        auto mode = (PresentMode) i;
+        auto generated = generator.GetPresentCount(mode) + (mode == PresentMode::Hardware_Legacy_Flip ? generator.GetDwmPresentCount() : 0);
+        if (generated + stats.mPresented[i] + stats.mDiscarded[i] > 0) {
+            printf("%-38s %12llu %12llu %12llu\n", PresentModeToString(mode), (unsigned long long) generated,
+                (unsigned long long) stats.mPresented[i], (unsigned long long) stats.mDiscarded[i]);
+        }
+    }
+    printf("(Hardware: Legacy Flip includes %llu DWM presents; %llu windowed presents were superseded before DWM composed them)\n",
+        (unsigned long long) generator.GetDwmPresentCount(), (unsigned long long) generator.GetSupersededPresentCount());
+
+    printf("\nevents:          %llu (%llu dropped)\n", (unsigned long long) eventCount, (unsigned long long) generator.GetDroppedEventCount());
+    printf("presents:        %llu generated, %llu completed, %llu lost\n", (unsigned long long) generatedPresents,
+        (unsigned long long) completed, (unsigned long long) stats.mLost);
+    printf("processes:       %llu\n", (unsigned long long) stats.mProcesses);
+    printf("consumer time:   %.3f s\n", consumerSeconds);
+    printf("events/sec:      %.0f\n", eventCount / consumerSeconds);
+    printf("presents/sec:    %.0f\n", completed / consumerSeconds);
+    printf("peak memory:     %.1f MB\n", peakMemory / (1024.0 * 1024.0));
+
+    return 0;
+}
@@ -0,0 +1,339 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+//
+// Measures the cost of formatting PresentMon's CSV rows, comparing the
+// per-column fprintf() calls previously used by UpdateCsv() with CsvRow
+// writing to an OutputFile.
+//
+// Rows are generated the way UpdateCsv() computes them (with -track_debug and
+// -qpc_time, so every column is included) from a synthetic 10MHz QPC
+// timeline, and written to the null device so that only the formatting and
+// buffering costs are measured.  The CsvRow time includes waiting for the
+// writer thread to finish writing.
+//
+// Before timing, CsvFormat::FormatFixed() is compared against snprintf() for
+// many values (random bit patterns, QPC-derived times, and exact ties) and
+// both methods' rows are compared, as a correctness check.
+//
+// Build and run (portable, does not require the Windows SDK):
+//     g++ -O2 -std=c++17 -pthread -I../../PresentMon csv_formatting.cpp ../../PresentMon/OutputWriter.cpp -o csv_formatting
+//     ./csv_formatting [rowCount]
+
+#include "CsvRow.hpp"
+#include "OutputWriter.hpp"
+
+#include <chrono>
+#include <float.h>
+#include <random>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define NULL_DEVICE "NUL"
+#else
+#define NULL_DEVICE "/dev/null"
+#endif
+
+#define FPRINTF_PATH "csv_formatting_fprintf.tmp"
+#define CSVROW_PATH  "csv_formatting_csvrow.tmp"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+enum { QPC_FREQUENCY = 10000000 };
+
+struct Row {
+    char const* mApplication;
+    uint32_t mProcessId;
+    uint64_t mSwapChainAddress;
+    char const* mRuntime;
+    int32_t mSyncInterval;
+    uint32_t mPresentFlags;
+    char const* mDropped;
+    double mTimeInSeconds;
+    double mMsInPresentApi;
+    double mMsBetweenPresents;
+    bool mAllowsTearing;
+    char const* mPresentMode;
+    double mMsUntilRenderComplete;
+    double mMsUntilDisplayed;
+    double mMsBetweenDisplayChange;
+    bool mWasBatched;
+    bool mDwmNotified;
+    uint64_t mQpcTime;
+};
+
+double QpcDeltaToSeconds(uint64_t qpcDelta)
+{
+    return (double) qpcDelta / QPC_FREQUENCY;
+}
+
+std::vector<Row> GenerateRows(size_t rowCount)
+{
+    static char const* const APPLICATIONS[] = { "dwm.exe", "Game.exe", "chrome.exe", "Presenter.exe" };
+    static char const* const PRESENT_MODES[] = { "Hardware: Legacy Flip", "Hardware: Independent Flip", "Composed: Flip" };
+
+    std::mt19937_64 rng(1);
+    std::vector<Row> rows(rowCount);
+
+    uint64_t startQpc = 123456789012ull;
+    uint64_t qpc = startQpc;
+    uint64_t lastScreenTime = qpc;
+    for (auto& r : rows) {
+        auto presentDelta = 40000 + rng() % 300000;  // 4-34ms
+        auto timeTaken = 500 + rng() % 20000;
+        auto readyDelta = rng() % 200000;
+        auto screenDelta = readyDelta + rng() % 100000;
+        auto app = rng() % 4;
+
+        qpc += presentDelta;
+        auto dropped = rng() % 10 == 0;
+        auto screenTime = qpc + screenDelta;
+
+        r.mApplication = APPLICATIONS[app];
+        r.mProcessId = 1000 + (uint32_t) app * 4;
+        r.mSwapChainAddress = 0x224B280A1C0ull + app * 0x1000;
+        r.mRuntime = "DXGI";
+        r.mSyncInterval = (int32_t) (rng() % 2);
+        r.mPresentFlags = rng() % 8 == 0 ? 0x200 : 0;
+        r.mDropped = dropped ? "1" : "0";
+        r.mTimeInSeconds = QpcDeltaToSeconds(qpc - startQpc);
+        r.mMsInPresentApi = 1000.0 * QpcDeltaToSeconds(timeTaken);
+        r.mMsBetweenPresents = 1000.0 * QpcDeltaToSeconds(presentDelta);
+        r.mAllowsTearing = app == 1;
+        r.mPresentMode = PRESENT_MODES[app % 3];
+        r.mMsUntilRenderComplete = 1000.0 * QpcDeltaToSeconds(readyDelta);
+        r.mMsUntilDisplayed = dropped ? 0.0 : 1000.0 * QpcDeltaToSeconds(screenDelta);
+        r.mMsBetweenDisplayChange = dropped ? 0.0 : 1000.0 * QpcDeltaToSeconds(screenTime - lastScreenTime);
+        r.mWasBatched = false;
+        r.mDwmNotified = app != 1;
+        r.mQpcTime = qpc;
+
+        if (!dropped) {
+            lastScreenTime = screenTime;
+        }
+    }
+
+    return rows;
+}
+
+// The formatting UpdateCsv() used before CsvRow.
+void WriteRowFprintf(FILE* fp, Row const& r)
+{
+    fprintf(fp, "%s,%d,0x%016llX,%s,%d,%d,%s,%.*lf,%.*lf,%.*lf",
+        r.mApplication,
+        r.mProcessId,
+        (unsigned long long) r.mSwapChainAddress,
+        r.mRuntime,
+        r.mSyncInterval,
+        r.mPresentFlags,
+        r.mDropped,
+        DBL_DIG - 1, r.mTimeInSeconds,
+        DBL_DIG - 1, r.mMsInPresentApi,
+        DBL_DIG - 1, r.mMsBetweenPresents);
+    fprintf(fp, ",%d,%s,%.*lf,%.*lf,%.*lf",
+        r.mAllowsTearing,
+        r.mPresentMode,
+        DBL_DIG - 1, r.mMsUntilRenderComplete,
+        DBL_DIG - 1, r.mMsUntilDisplayed,
+        DBL_DIG - 1, r.mMsBetweenDisplayChange);
+    fprintf(fp, ",%d,%d",
+        r.mWasBatched,
+        r.mDwmNotified);
+    fprintf(fp, ",%llu", (unsigned long long) r.mQpcTime);
+    fprintf(fp, "\n");
+}
+
+void WriteRowCsvRow(OutputFile* file, Row const& r)
+{
+    CsvRow row(file);
+    row.AddString(r.mApplication);
+    row.AddInt(r.mProcessId);
+    row.AddHex64(r.mSwapChainAddress);
+    row.AddString(r.mRuntime);
+    row.AddInt(r.mSyncInterval);
+    row.AddInt(r.mPresentFlags);
+    row.AddString(r.mDropped);
+    row.AddDouble(r.mTimeInSeconds, DBL_DIG - 1);
+    row.AddDouble(r.mMsInPresentApi, DBL_DIG - 1);
+    row.AddDouble(r.mMsBetweenPresents, DBL_DIG - 1);
+    row.AddInt(r.mAllowsTearing);
+    row.AddString(r.mPresentMode);
+    row.AddDouble(r.mMsUntilRenderComplete, DBL_DIG - 1);
+    row.AddDouble(r.mMsUntilDisplayed, DBL_DIG - 1);
+    row.AddDouble(r.mMsBetweenDisplayChange, DBL_DIG - 1);
+    row.AddInt(r.mWasBatched);
+    row.AddInt(r.mDwmNotified);
+    row.AddUInt64(r.mQpcTime);
+    row.End();
+}
+
+std::vector<std::string> ReadLines(char const* path)
+{
+    std::vector<std::string> lines;
+    if (auto fp = fopen(path, "rb")) {
+        std::string line;
+        for (int c; (c = fgetc(fp)) != EOF; ) {
+            if (c == '\n') {
+                lines.emplace_back(std::move(line));
+                line.clear();
+            } else {
+                line += (char) c;
+            }
+        }
+        fclose(fp);
+    }
+    return lines;
+}
+
+bool CheckFormatFixed(double value, uint32_t decimals)
+{
+    char expected[CSV_MAX_FIXED_SIZE];
+    char actual[CSV_MAX_FIXED_SIZE];
+    snprintf(expected, sizeof(expected), "%.*f", (int) decimals, value);
+    *CsvFormat::FormatFixed(actual, value, decimals) = '\0';
+    if (strcmp(expected, actual) == 0) {
+        return true;
+    }
+    fprintf(stderr, "error: FormatFixed(%a, %u) = %s, printf() = %s\n", value, decimals, actual, expected);
+    return false;
+}
+
+bool CheckCorrectness(std::vector<Row> const& rows)
+{
+    std::mt19937_64 rng(2);
+    uint32_t failures = 0;
+
+    // Random bit patterns across the full range of exponents, and doubles
+    // with few significant bits (which are exact ties at many precisions).
+    for (uint32_t i = 0; i < 1000000 && failures < 10; ++i) {
+        uint64_t bits = rng();
+        double value = 0.0;
+        memcpy(&value, &bits, sizeof(value));
+        failures += CheckFormatFixed(value, DBL_DIG - 1) ? 0 : 1;
+        failures += CheckFormatFixed(value, 6) ? 0 : 1;
+
+        value = ldexp((double) (rng() % 4096), -(int) (rng() % 80)) * (rng() % 2 ? 1.0 : -1.0);
+        failures += CheckFormatFixed(value, (uint32_t) (rng() % 16)) ? 0 : 1;
+    }
+
+    // Values computed from QPC deltas, as UpdateCsv() does.
+    for (uint32_t i = 0; i < 1000000 && failures < 10; ++i) {
+        auto qpcDelta = rng() % (1ull << (rng() % 48));
+        failures += CheckFormatFixed(QpcDeltaToSeconds(qpcDelta), DBL_DIG - 1) ? 0 : 1;
+        failures += CheckFormatFixed(1000.0 * QpcDeltaToSeconds(qpcDelta), DBL_DIG - 1) ? 0 : 1;
+        failures += CheckFormatFixed(-1000.0 * QpcDeltaToSeconds(qpcDelta), DBL_DIG - 1) ? 0 : 1;
+        failures += CheckFormatFixed(1000.0 * QpcDeltaToSeconds(qpcDelta), 6) ? 0 : 1;
+    }
+
+    // Whole rows, including a row that is longer than CsvRow's buffer.  The
+    // OutputFile is closed, so its rows have been written, before the files
+    // are compared.
+    if (failures == 0) {
+        std::string longName(CSV_ROW_BUFFER_SIZE + 100, 'x');
+        auto a = fopen(FPRINTF_PATH, "wb");
+        auto b = fopen(CSVROW_PATH, "wb");
+        if (a == nullptr || b == nullptr) {
+            fprintf(stderr, "error: failed to create %s and %s\n", FPRINTF_PATH, CSVROW_PATH);
+            exit(1);
+        }
+
+        StartOutputWriter();
+        auto file = new OutputFile(b, CSVROW_PATH, false);
+        for (size_t i = 0; i < rows.size() && i < 1000; ++i) {
+            auto r = rows[i];
+            if (i == 0) {
+                r.mApplication = longName.c_str();
+            }
+            WriteRowFprintf(a, r);
+            WriteRowCsvRow(file, r);
+        }
+        fclose(a);
+        CloseOutputFile(file);
+        StopOutputWriter();
+
+        auto linesA = ReadLines(FPRINTF_PATH);
+        auto linesB = ReadLines(CSVROW_PATH);
+        remove(FPRINTF_PATH);
+        remove(CSVROW_PATH);
+
+        for (size_t i = 0; (i < linesA.size() || i < linesB.size()) && failures < 10; ++i) {
+            auto lineA = i < linesA.size() ? linesA[i] : std::string();
+            auto lineB = i < linesB.size() ? linesB[i] : std::string();
+            if (lineA != lineB) {
+                fprintf(stderr, "error: row %zu differs:\n    fprintf(): %s\n    CsvRow:    %s\n", i, lineA.c_str(), lineB.c_str());
+                failures += 1;
+            }
+        }
+    }
+
+    return failures == 0;
+}
+
+double MeasureFprintf(std::vector<Row> const& rows)
+{
+    auto fp = fopen(NULL_DEVICE, "w");
+    if (fp == nullptr) {
+        fprintf(stderr, "error: failed to open %s\n", NULL_DEVICE);
+        exit(1);
+    }
+
+    auto t0 = Clock::now();
+    for (auto const& r : rows) {
+        WriteRowFprintf(fp, r);
+    }
+    fflush(fp);
+    auto t1 = Clock::now();
+    fclose(fp);
+
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / rows.size();
+}
+
+double MeasureCsvRow(std::vector<Row> const& rows)
+{
+    auto fp = fopen(NULL_DEVICE, "w");
+    if (fp == nullptr) {
+        fprintf(stderr, "error: failed to open %s\n", NULL_DEVICE);
+        exit(1);
+    }
+
+    StartOutputWriter();
+    auto file = new OutputFile(fp, NULL_DEVICE, false);
+
+    auto t0 = Clock::now();
+    for (auto const& r : rows) {
+        WriteRowCsvRow(file, r);
+    }
+    CloseOutputFile(file);
+    StopOutputWriter();
+    auto t1 = Clock::now();
+
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / rows.size();
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    size_t rowCount = argc > 1 ? (size_t) atoll(argv[1]) : 1000000;
+    auto rows = GenerateRows(rowCount);
+
+    if (!CheckCorrectness(rows)) {
+        return 1;
+    }
+
+    auto fprintfNs = MeasureFprintf(rows);
+    auto csvRowNs  = MeasureCsvRow(rows);
+
+    printf("%zu rows (output matches printf())\n", rowCount);
+    printf("fprintf   %8.1f ns/row\n", fprintfNs);
+    printf("CsvRow    %8.1f ns/row\n", csvRowNs);
+    printf("speedup: %.2fx\n", fprintfNs / csvRowNs);
+
+    return 0;
+}
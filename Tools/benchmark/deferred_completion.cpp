@@ -0,0 +1,127 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+//
+// Measures the per-Present_Stop cost of PMTraceConsumer's deferred
+// completions with many completions pending, comparing the previous
+// std::vector of wait counts (decremented for every pending completion on
+// every Present_Stop, and erased from the middle when they expire) with
+// DeferredCompletionQueue.
+//
+// For each pending count N, the queue is first filled with N completions
+// with random waits of up to N Present_Stops.  Then, for every Present_Stop,
+// one new completion is deferred with a random wait of up to 2N, so about N
+// completions stay pending.  Both methods must expire the same completions in
+// the same order.
+//
+// Build and run (portable, does not require the Windows SDK):
+//     g++ -O2 -std=c++17 -I../../PresentData deferred_completion.cpp -o deferred_completion
+//     ./deferred_completion [presentStopCount]
+
+#include "DeferredCompletionQueue.hpp"
+
+#include <chrono>
+#include <random>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <utility>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+// The deferred completions as previously stored in PMTraceConsumer:
+// (item, NumPresentStopsToWaitFor)
+class CountdownVector {
+    std::vector<std::pair<uint64_t, uint32_t>> mItems;
+
+public:
+    size_t Size() const { return mItems.size(); }
+
+    void Push(uint64_t item, uint32_t waitCount)
+    {
+        mItems.emplace_back(item, waitCount);
+    }
+
+    template<typename Fn>
+    void PresentStop(Fn&& onExpired)
+    {
+        for (auto ii = mItems.begin(); ii != mItems.end(); ) {
+            auto waitCount = &ii->second;
+            if (*waitCount == 1) {
+                onExpired(ii->first);
+                ii = mItems.erase(ii);
+            } else {
+                --*waitCount;
+                ++ii;
+            }
+        }
+    }
+};
+
+struct QueueAdapter {
+    DeferredCompletionQueue<uint64_t> mQueue;
+
+    size_t Size() const { return mQueue.Size(); }
+    void Push(uint64_t item, uint32_t waitCount) { mQueue.Push(item, waitCount); }
+    template<typename Fn> void PresentStop(Fn&& onExpired) { mQueue.AdvanceEpoch(onExpired); }
+};
+
+struct Result {
+    double mNsPerPresentStop;
+    double mAveragePending;
+    std::vector<uint64_t> mExpired;
+};
+
+template<typename Container>
+Result Run(uint32_t pendingCount, uint32_t presentStopCount)
+{
+    std::mt19937 rng(pendingCount);
+    Container container;
+    Result result = {};
+    result.mExpired.reserve(presentStopCount + pendingCount);
+
+    uint64_t nextItem = 0;
+    for (uint32_t i = 0; i < pendingCount; ++i) {
+        container.Push(nextItem++, 1 + rng() % pendingCount);
+    }
+
+    uint64_t pendingSum = 0;
+    auto t0 = Clock::now();
+    for (uint32_t i = 0; i < presentStopCount; ++i) {
+        container.Push(nextItem++, 1 + rng() % (2 * pendingCount));
+        container.PresentStop([&](uint64_t item) { result.mExpired.push_back(item); });
+        pendingSum += container.Size();
+    }
+    auto t1 = Clock::now();
+
+    result.mNsPerPresentStop = std::chrono::duration<double, std::nano>(t1 - t0).count() / presentStopCount;
+    result.mAveragePending = (double) pendingSum / presentStopCount;
+    return result;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t presentStopCount = argc > 1 ? (uint32_t) atoi(argv[1]) : 100000;
+
+    printf("%u Present_Stops per run\n\n", presentStopCount);
+    printf("%8s %12s %18s %18s %9s\n", "pending", "avg pending", "vector (ns/stop)", "queue (ns/stop)", "speedup");
+
+    for (uint32_t pendingCount : { 1u, 16u, 256u, 1024u, 4096u, 16384u }) {
+        auto countdown = Run<CountdownVector>(pendingCount, presentStopCount);
+        auto queue = Run<QueueAdapter>(pendingCount, presentStopCount);
+
+        if (countdown.mExpired != queue.mExpired) {
+            fprintf(stderr, "error: completions expired in a different order with %u pending\n", pendingCount);
+            return 1;
+        }
+
+        printf("%8u %12.0f %18.1f %18.1f %8.1fx\n", pendingCount, queue.mAveragePending,
+            countdown.mNsPerPresentStop, queue.mNsPerPresentStop, countdown.mNsPerPresentStop / queue.mNsPerPresentStop);
+    }
+
+    return 0;
+}
@@ -0,0 +1,192 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+//
+// Measures the per-event cost of reading event properties in the consumer's
+// handlers, comparing name-based lookups with EventMetadata::GetEventData()
+// and typed views with EventMetadata::GetEventView().  The events are the
+// QueuePacket_Start, PresentHistory_Start, and TokenStateChanged_Info events
+// of the synthetic event stream in synthetic_present_events.hpp, and the same
+// properties are read as in PMTraceConsumer's handlers.  Both methods must
+// read the same values, and views of events truncated to no data must read 0.
+//
+// Build and run (portable, does not require the Windows SDK):
+//     g++ -O2 -std=c++17 -Icompat -I../../PresentData event_views.cpp ../../PresentData/TraceConsumer.cpp -o event_views
+//     ./event_views [iterations]
+
+#include "synthetic_present_events.hpp"
+
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+enum EventKind {
+    QUEUE_PACKET_START,
+    PRESENT_HISTORY_START,
+    TOKEN_STATE_CHANGED,
+    OTHER_EVENT,
+};
+
+EventKind GetEventKind(EVENT_RECORD const& eventRecord)
+{
+    auto const& hdr = eventRecord.EventHeader;
+    if (hdr.ProviderId == Microsoft_Windows_DxgKrnl::GUID) {
+        switch (hdr.EventDescriptor.Id) {
+        case Microsoft_Windows_DxgKrnl::QueuePacket_Start::Id:    return QUEUE_PACKET_START;
+        case Microsoft_Windows_DxgKrnl::PresentHistory_Start::Id: return PRESENT_HISTORY_START;
+        }
+    } else if (hdr.ProviderId == Microsoft_Windows_Win32k::GUID) {
+        if (hdr.EventDescriptor.Id == Microsoft_Windows_Win32k::TokenStateChanged_Info::Id) {
+            return TOKEN_STATE_CHANGED;
+        }
+    }
+    return OTHER_EVENT;
+}
+
+__attribute__((noinline)) uint64_t ReadByName(EventMetadata* metadata, EVENT_RECORD* eventRecord, EventKind kind)
+{
+    switch (kind) {
+    case QUEUE_PACKET_START: {
+        EventDataDesc desc[] = {
+            { L"PacketType" },
+            { L"SubmitSequence" },
+            { L"hContext" },
+            { L"bPresent" },
+        };
+        metadata->GetEventData(eventRecord, desc, _countof(desc));
+        return desc[0].GetData<uint32_t>() + desc[1].GetData<uint32_t>() + desc[2].GetData<uint64_t>() + desc[3].GetData<BOOL>();
+    }
+    case PRESENT_HISTORY_START: {
+        EventDataDesc desc[] = {
+            { L"Token" },
+            { L"Model" },
+            { L"TokenData" },
+        };
+        metadata->GetEventData(eventRecord, desc, _countof(desc));
+        return desc[0].GetData<uint64_t>() + desc[1].GetData<uint32_t>() + desc[2].GetData<uint64_t>();
+    }
+    case TOKEN_STATE_CHANGED: {
+        EventDataDesc desc[] = {
+            { L"CompositionSurfaceLuid" },
+            { L"PresentCount" },
+            { L"BindId" },
+            { L"NewState" },
+        };
+        metadata->GetEventData(eventRecord, desc, _countof(desc));
+        return desc[0].GetData<uint64_t>() + desc[1].GetData<uint32_t>() + desc[2].GetData<uint64_t>() + desc[3].GetData<uint32_t>();
+    }
+    default:
+        return 0;
+    }
+}
+
+__attribute__((noinline)) uint64_t ReadByView(EventMetadata* metadata, EVENT_RECORD* eventRecord, EventKind kind)
+{
+    switch (kind) {
+    case QUEUE_PACKET_START: {
+        auto view = metadata->GetEventView<Microsoft_Windows_DxgKrnl::QueuePacket_Start_View>(eventRecord);
+        return (uint32_t) view.PacketType() + view.SubmitSequence() + view.hContext() + view.bPresent();
+    }
+    case PRESENT_HISTORY_START: {
+        auto view = metadata->GetEventView<Microsoft_Windows_DxgKrnl::PresentHistory_Start_View>(eventRecord);
+        return view.Token() + (uint32_t) view.Model() + view.TokenData();
+    }
+    case TOKEN_STATE_CHANGED: {
+        auto view = metadata->GetEventView<Microsoft_Windows_Win32k::TokenStateChanged_Info_View>(eventRecord);
+        return view.CompositionSurfaceLuid() + view.PresentCount() + view.BindId() + (uint32_t) view.NewState();
+    }
+    default:
+        return 0;
+    }
+}
+
+// A view of an event that is shorter than its metadata says must read 0 for
+// the fields past its end, instead of reading past the end of UserData.
+bool CheckTruncatedEvents(EventMetadata* metadata, std::vector<EVENT_RECORD*> const& records, std::vector<EventKind> const& kinds)
+{
+    for (size_t i = 0, n = records.size(); i < n; ++i) {
+        auto eventRecord = *records[i];
+        eventRecord.UserData = nullptr;
+        eventRecord.UserDataLength = 0;
+        if (ReadByView(metadata, &eventRecord, kinds[i]) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t iterations = argc > 1 ? (uint32_t) atoi(argv[1]) : 20;
+
+    SyntheticPresentEvents::Config config;
+    SyntheticPresentEvents::Generator generator(config);
+    SyntheticPresentEvents::EventBuffer events;
+    generator.Generate(SyntheticPresentEvents::QPC_FREQUENCY, &events);
+
+    EventMetadata metadata;
+    generator.AddMetadata(&metadata);
+
+    std::vector<EVENT_RECORD*> records;
+    std::vector<EventKind> kinds;
+    uint64_t kindCounts[OTHER_EVENT] = {};
+    for (auto& eventRecord : events.mRecords) {
+        auto kind = GetEventKind(eventRecord);
+        if (kind != OTHER_EVENT) {
+            records.push_back(&eventRecord);
+            kinds.push_back(kind);
+            kindCounts[kind] += 1;
+        }
+    }
+    if (records.empty()) {
+        fprintf(stderr, "error: no events\n");
+        return 1;
+    }
+
+    if (!CheckTruncatedEvents(&metadata, records, kinds)) {
+        fprintf(stderr, "error: views of truncated events read non-zero values\n");
+        return 1;
+    }
+
+    uint64_t nameSum = 0;
+    uint64_t viewSum = 0;
+    auto t0 = Clock::now();
+    for (uint32_t i = 0; i < iterations; ++i) {
+        for (size_t j = 0, n = records.size(); j < n; ++j) {
+            nameSum += ReadByName(&metadata, records[j], kinds[j]);
+        }
+    }
+    auto t1 = Clock::now();
+    for (uint32_t i = 0; i < iterations; ++i) {
+        for (size_t j = 0, n = records.size(); j < n; ++j) {
+            viewSum += ReadByView(&metadata, records[j], kinds[j]);
+        }
+    }
+    auto t2 = Clock::now();
+
+    if (nameSum != viewSum) {
+        fprintf(stderr, "error: views read different values than GetEventData()\n");
+        return 1;
+    }
+
+    auto eventCount = (double) records.size() * iterations;
+    printf("%zu events x %u iterations (QueuePacket_Start: %llu, PresentHistory_Start: %llu, TokenStateChanged_Info: %llu)\n\n",
+        records.size(), iterations,
+        (unsigned long long) kindCounts[QUEUE_PACKET_START],
+        (unsigned long long) kindCounts[PRESENT_HISTORY_START],
+        (unsigned long long) kindCounts[TOKEN_STATE_CHANGED]);
+
+    auto nameNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / eventCount;
+    auto viewNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / eventCount;
+    printf("GetEventData: %.2f ns/event\n", nameNs);
+    printf("GetEventView: %.2f ns/event (%.1fx)\n", viewNs, nameNs / viewNs);
+
+    return 0;
+}
@@ -0,0 +1,176 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+//
+// Measures how PMTraceConsumer's lost present detection behaves at different
+// present rates, comparing the previous 8192-entry circular buffer of all
+// presents, where a present is lost once the buffer wraps around to it, with
+// TimerWheel, where a present is lost once it is older than a timeout (10
+// seconds, the default mLostPresentAge).
+//
+// Presents are created at the given rate and complete 50ms later, except for
+// one in every 100 which never completes.  For each method, this reports the
+// cost per present, how old the lost presents were when they were detected,
+// and the most lost presents that were being tracked at once.
+//
+// Build and run (portable, does not require the Windows SDK):
+//     g++ -O2 -std=c++17 -I../../PresentData lost_present_aging.cpp -o lost_present_aging
+//     ./lost_present_aging [seconds]
+
+#include "TimerWheel.hpp"
+
+#include <chrono>
+#include <deque>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+enum {
+    QPC_FREQUENCY = 10000000,
+    RING_SIZE = 8192,
+    LOST_PRESENT_AGE = 10 * QPC_FREQUENCY,
+    COMPLETION_LATENCY = QPC_FREQUENCY / 20,
+    LOST_PRESENT_INTERVAL = 100,
+};
+
+struct Present {
+    uint64_t mQpcTime;
+    bool mLost;
+    uint32_t mRingIndex;
+    TimerWheelHandle mTimer;
+};
+
+struct GetTimer {
+    TimerWheelHandle& operator()(Present* p) const { return p->mTimer; }
+};
+
+struct Stats {
+    double mNsPerPresent;
+    uint64_t mLostCount;
+    uint64_t mLostAgeSum;
+    uint64_t mMaxLostAge;
+    uint64_t mTrackedLostCount;
+    uint64_t mMaxTrackedLostCount;
+
+    void OnLost(Present* p, uint64_t now)
+    {
+        auto age = now - p->mQpcTime;
+        mLostCount += 1;
+        mLostAgeSum += age;
+        if (mMaxLostAge < age) mMaxLostAge = age;
+        mTrackedLostCount -= 1;
+    }
+};
+
+// The previous PMTraceConsumer implementation.
+struct Ring {
+    std::vector<Present*> mPresents;
+    uint32_t mNextIndex = 0;
+
+    Ring() : mPresents(RING_SIZE) {}
+
+    void Track(Present* p, Stats* stats)
+    {
+        auto old = mPresents[mNextIndex];
+        if (old != nullptr) {
+            stats->OnLost(old, p->mQpcTime);
+        }
+        p->mRingIndex = mNextIndex;
+        mPresents[mNextIndex] = p;
+        mNextIndex = (mNextIndex + 1) % RING_SIZE;
+    }
+
+    void Complete(Present* p)
+    {
+        mPresents[p->mRingIndex] = nullptr;
+    }
+};
+
+struct Wheel {
+    TimerWheel<Present*, GetTimer> mPresents;
+
+    Wheel() { mPresents.Configure(LOST_PRESENT_AGE, RING_SIZE); }
+
+    void Track(Present* p, Stats* stats)
+    {
+        auto onLost = [=](Present* lost) { stats->OnLost(lost, p->mQpcTime); };
+        mPresents.Advance(p->mQpcTime, onLost);
+        mPresents.Insert(p, p->mQpcTime, onLost);
+    }
+
+    void Complete(Present* p)
+    {
+        mPresents.Remove(p);
+    }
+};
+
+template<typename Tracker>
+__attribute__((noinline)) Stats Run(uint32_t presentsPerSecond, uint32_t seconds)
+{
+    // Presents are recycled once they are completed or lost, so that the
+    // present allocation doesn't dominate the measurement.
+    auto presentCount = (size_t) presentsPerSecond * seconds;
+    std::vector<Present> presents(presentCount);
+
+    Tracker tracker;
+    Stats stats = {};
+    std::deque<Present*> pending;
+    auto interval = (uint64_t) QPC_FREQUENCY / presentsPerSecond;
+
+    auto t0 = Clock::now();
+    for (size_t i = 0; i < presentCount; ++i) {
+        auto now = i * interval;
+
+        while (!pending.empty() && pending.front()->mQpcTime + COMPLETION_LATENCY <= now) {
+            tracker.Complete(pending.front());
+            pending.pop_front();
+        }
+
+        auto p = &presents[i];
+        p->mQpcTime = now;
+        p->mLost = i % LOST_PRESENT_INTERVAL == LOST_PRESENT_INTERVAL - 1;
+        tracker.Track(p, &stats);
+
+        if (p->mLost) {
+            stats.mTrackedLostCount += 1;
+            if (stats.mMaxTrackedLostCount < stats.mTrackedLostCount) stats.mMaxTrackedLostCount = stats.mTrackedLostCount;
+        } else {
+            pending.push_back(p);
+        }
+    }
+    auto t1 = Clock::now();
+
+    stats.mNsPerPresent = std::chrono::duration<double, std::nano>(t1 - t0).count() / presentCount;
+    return stats;
+}
+
+void Print(char const* name, Stats const& stats)
+{
+    printf("  %-8s %8.2f ns/present %8llu detected  age avg %7.2f s, max %7.2f s  %6llu tracked at once\n",
+        name, stats.mNsPerPresent, (unsigned long long) stats.mLostCount,
+        stats.mLostCount == 0 ? 0.0 : (double) stats.mLostAgeSum / stats.mLostCount / QPC_FREQUENCY,
+        (double) stats.mMaxLostAge / QPC_FREQUENCY,
+        (unsigned long long) stats.mMaxTrackedLostCount);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t seconds = argc > 1 ? (uint32_t) atoi(argv[1]) : 600;
+
+    uint32_t const rates[] = { 30, 60, 144, 1000, 5000 };
+    for (auto rate : rates) {
+        printf("%u presents/s for %u s, 1 in %u lost:\n", rate, seconds, LOST_PRESENT_INTERVAL);
+        auto ring = Run<Ring>(rate, seconds);
+        auto wheel = Run<Wheel>(rate, seconds);
+        Print("ring", ring);
+        Print("wheel", wheel);
+    }
+
+    return 0;
+}
@@ -0,0 +1,337 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+//
+// Measures -rotate_interval output: the output thread's cost per row of
+// writing a long capture as one file compared to rotated segments with a
+// manifest, and the cost of extracting a short time range from the capture
+// by scanning the whole file compared to scanning only the segments whose
+// manifest entries overlap it.
+//
+// The capture is hours long at rowsPerSecond rows per second, with rows like
+// UpdateCsv()'s.  As in a real capture, rows are written in completion order,
+// so their times are jittered by up to a few frames.  Rotation follows
+// CsvOutput.cpp: a segment ends at the first row that is intervalSeconds
+// after its first row, and its row count, time range, and processes are then
+// added to the manifest.  Both the unrotated file and the segments are
+// written through OutputFile and the writer thread.
+//
+// The extraction parses the TimeInSeconds of every row it reads, and checks
+// that both methods find the same rows.
+//
+// Build and run from this directory (portable, does not require the Windows
+// SDK):
+//     g++ -O2 -std=c++17 -pthread -I../../PresentMon output_rotation.cpp ../../PresentMon/OutputWriter.cpp -o output_rotation
+//     ./output_rotation [hours] [rowsPerSecond] [intervalSeconds] [windowSeconds]
+
+#include "OutputWriter.hpp"
+
+#include <chrono>
+#include <map>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define UNROTATED_PATH "output_rotation.tmp.csv"
+#define SEGMENT_BASE   "output_rotation.tmp"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+enum {
+    QPC_FREQUENCY = 10000000,
+    PROCESS_COUNT = 4,
+    TIME_COLUMN = 7,                    // TimeInSeconds
+};
+
+char const HEADER[] = "Application,ProcessID,SwapChainAddress,Runtime,SyncInterval,PresentFlags,AllowsTearing,TimeInSeconds,msInPresentAPI,msBetweenPresents,PresentMode,msUntilRenderComplete,msUntilDisplayed,msBetweenDisplayChange\n";
+
+struct Segment {
+    std::string mFileName;
+    uint64_t mRowCount;
+    double mMinTime;
+    double mMaxTime;
+};
+
+double Seconds(Clock::time_point t0, Clock::time_point t1)
+{
+    return std::chrono::duration<double>(t1 - t0).count();
+}
+
+// The time of each row, in completion order: presents are completed up to a
+// few frames late, and out of order with respect to their present times.
+std::vector<uint64_t> GenerateRowQpcs(uint64_t rowCount, uint32_t rowsPerSecond)
+{
+    std::vector<uint64_t> qpcs(rowCount);
+    auto frameQpc = QPC_FREQUENCY / rowsPerSecond;
+    uint64_t seed = 1;
+    for (uint64_t i = 0; i < rowCount; ++i) {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        auto jitter = (seed >> 33) % (3 * frameQpc);
+        qpcs[i] = i * frameQpc + 3 * frameQpc - jitter;
+    }
+    return qpcs;
+}
+
+// Formats the row for the present at qpc, and returns the process it's from.
+uint32_t FormatRow(uint64_t i, uint64_t qpc, char* row, size_t size)
+{
+    auto processId = 1000 + (uint32_t) (i % PROCESS_COUNT);
+    snprintf(row, size, "game%u.exe,%u,0x000001D2C4A3F2A0,DXGI,1,0,0,%.14f,%.13f,%.13f,Hardware: Independent Flip,%.13f,%.13f,%.13f\n",
+        processId - 1000, processId, (double) qpc / QPC_FREQUENCY, 0.1 + (i % 7) / 100.0, 16.6 + (i % 5) / 10.0,
+        1.2 + (i % 3) / 10.0, 20.0 + (i % 11) / 10.0, 16.6);
+    return processId;
+}
+
+OutputFile* OpenFile(char const* path)
+{
+    auto fp = fopen(path, "wb");
+    if (fp == nullptr) {
+        fprintf(stderr, "error: failed to open %s\n", path);
+        exit(1);
+    }
+    auto file = new OutputFile(fp, path, false);
+    file->Write(HEADER, sizeof(HEADER) - 1);
+    return file;
+}
+
+std::string GetSegmentFileName(uint32_t index)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "%s-seg%04u.csv", SEGMENT_BASE, index);
+    return name;
+}
+
+// Writes all rows to one file, and returns the output thread's time per row.
+double WriteUnrotated(std::vector<uint64_t> const& qpcs)
+{
+    StartOutputWriter();
+    auto t0 = Clock::now();
+    auto file = OpenFile(UNROTATED_PATH);
+    char row[512];
+    for (uint64_t i = 0; i < qpcs.size(); ++i) {
+        FormatRow(i, qpcs[i], row, sizeof(row));
+        file->Write(row, strlen(row));
+    }
+    CloseOutputFile(file);
+    auto t1 = Clock::now();
+    StopOutputWriter();
+    return Seconds(t0, t1) / qpcs.size();
+}
+
+// Writes the rows as segments of intervalSeconds, with a manifest, and
+// returns the output thread's time per row.
+double WriteRotated(std::vector<uint64_t> const& qpcs, uint32_t intervalSeconds)
+{
+    StartOutputWriter();
+    auto t0 = Clock::now();
+
+    auto manifest = OpenFile(SEGMENT_BASE "-manifest.csv");
+    uint32_t index = 1;
+    auto file = OpenFile(GetSegmentFileName(index).c_str());
+    uint64_t rowCount = 0;
+    uint64_t minQpc = 0;
+    uint64_t maxQpc = 0;
+    uint64_t endQpc = 0;
+    std::map<uint32_t, std::string> processes;
+
+    auto endSegment = [&]() {
+        CloseOutputFile(file);
+
+        std::string processList;
+        for (auto const& pair : processes) {
+            processList += (processList.empty() ? "" : ";") + pair.second + ':' + std::to_string(pair.first);
+        }
+        char line[1024];
+        snprintf(line, sizeof(line), "%u,%s,%llu,%llu,%llu,%.14f,%.14f,%s\n", index, GetSegmentFileName(index).c_str(),
+            (unsigned long long) rowCount, (unsigned long long) minQpc, (unsigned long long) maxQpc,
+            (double) minQpc / QPC_FREQUENCY, (double) maxQpc / QPC_FREQUENCY, processList.c_str());
+        manifest->Write(line, strlen(line));
+        manifest->Flush();
+    };
+
+    char row[512];
+    for (uint64_t i = 0; i < qpcs.size(); ++i) {
+        auto qpc = qpcs[i];
+        if (rowCount > 0 && qpc >= endQpc) {
+            endSegment();
+            index += 1;
+            file = OpenFile(GetSegmentFileName(index).c_str());
+            rowCount = 0;
+            processes.clear();
+        }
+
+        auto processId = FormatRow(i, qpc, row, sizeof(row));
+        file->Write(row, strlen(row));
+
+        if (rowCount == 0) {
+            minQpc = qpc;
+            maxQpc = qpc;
+            endQpc = qpc + (uint64_t) intervalSeconds * QPC_FREQUENCY;
+        } else {
+            minQpc = qpc < minQpc ? qpc : minQpc;
+            maxQpc = qpc > maxQpc ? qpc : maxQpc;
+        }
+        rowCount += 1;
+        if (processes.find(processId) == processes.end()) {
+            processes.emplace(processId, "game" + std::to_string(processId - 1000) + ".exe");
+        }
+    }
+    endSegment();
+    CloseOutputFile(manifest);
+
+    auto t1 = Clock::now();
+    StopOutputWriter();
+    return Seconds(t0, t1) / qpcs.size();
+}
+
+// Reads the manifest's File, Rows, MinTimeInSeconds, and MaxTimeInSeconds
+// columns.
+std::vector<Segment> ReadManifest(char const* path)
+{
+    std::vector<Segment> segments;
+    auto fp = fopen(path, "rb");
+    if (fp == nullptr) {
+        return segments;
+    }
+    char line[4096];
+    if (fgets(line, sizeof(line), fp) != nullptr) {
+        while (fgets(line, sizeof(line), fp) != nullptr) {
+            char fileName[256] = {};
+            unsigned index = 0;
+            unsigned long long rowCount = 0, minQpc = 0, maxQpc = 0;
+            Segment segment = {};
+            if (sscanf(line, "%u,%255[^,],%llu,%llu,%llu,%lf,%lf", &index, fileName, &rowCount, &minQpc, &maxQpc,
+                       &segment.mMinTime, &segment.mMaxTime) == 7) {
+                segment.mFileName = fileName;
+                segment.mRowCount = rowCount;
+                segments.push_back(segment);
+            }
+        }
+    }
+    fclose(fp);
+    return segments;
+}
+
+// Reads the whole CSV, and returns the number of rows whose TimeInSeconds is
+// in [minTime, maxTime].  *bytesRead is increased by the file's size.
+uint64_t ScanFile(char const* path, double minTime, double maxTime, uint64_t* bytesRead)
+{
+    auto fp = fopen(path, "rb");
+    if (fp == nullptr) {
+        fprintf(stderr, "error: failed to open %s\n", path);
+        exit(1);
+    }
+
+    std::vector<char> buffer(1024 * 1024 + 1);
+    size_t carry = 0;
+    bool header = true;
+    uint64_t count = 0;
+    for (;;) {
+        auto n = fread(buffer.data() + carry, 1, buffer.size() - 1 - carry, fp);
+        *bytesRead += n;
+        auto end = buffer.data() + carry + n;
+        auto line = buffer.data();
+        for (;;) {
+            auto newline = (char*) memchr(line, '\n', (size_t) (end - line));
+            if (newline == nullptr) {
+                break;
+            }
+            if (header) {
+                header = false;
+            } else {
+                auto p = line;
+                for (uint32_t column = 0; column < TIME_COLUMN; ++column) {
+                    p = (char*) memchr(p, ',', (size_t) (newline - p)) + 1;
+                }
+                auto t = strtod(p, nullptr);
+                count += t >= minTime && t <= maxTime ? 1 : 0;
+            }
+            line = newline + 1;
+        }
+        carry = (size_t) (end - line);
+        memmove(buffer.data(), line, carry);
+        if (n == 0) {
+            break;
+        }
+    }
+    fclose(fp);
+    return count;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    double hours = argc > 1 ? atof(argv[1]) : 1.0;
+    uint32_t rowsPerSecond = argc > 2 ? (uint32_t) atoi(argv[2]) : 240;
+    uint32_t intervalSeconds = argc > 3 ? (uint32_t) atoi(argv[3]) : 60;
+    uint32_t windowSeconds = argc > 4 ? (uint32_t) atoi(argv[4]) : 30;
+    if (rowsPerSecond == 0 || intervalSeconds == 0) {
+        fprintf(stderr, "usage: output_rotation [hours] [rowsPerSecond] [intervalSeconds] [windowSeconds]\n");
+        return 1;
+    }
+
+    auto rowCount = (uint64_t) (hours * 3600 * rowsPerSecond);
+    auto qpcs = GenerateRowQpcs(rowCount, rowsPerSecond);
+
+    auto unrotatedSeconds = WriteUnrotated(qpcs);
+    auto rotatedSeconds = WriteRotated(qpcs, intervalSeconds);
+    auto segments = ReadManifest(SEGMENT_BASE "-manifest.csv");
+
+    uint64_t manifestRowCount = 0;
+    for (auto const& segment : segments) {
+        manifestRowCount += segment.mRowCount;
+    }
+    if (manifestRowCount != rowCount) {
+        fprintf(stderr, "error: the manifest lists %llu rows, but %llu were written\n", (unsigned long long) manifestRowCount, (unsigned long long) rowCount);
+        return 1;
+    }
+
+    printf("%.2f hour capture, %llu rows at %u rows/s, %u s segments:\n", hours, (unsigned long long) rowCount, rowsPerSecond, intervalSeconds);
+    printf("  output thread: %.0f ns/row unrotated, %.0f ns/row rotated into %zu segments\n",
+        1e9 * unrotatedSeconds, 1e9 * rotatedSeconds, segments.size());
+
+    // Extract a window from the middle of the capture.
+    auto minTime = hours * 3600 / 2;
+    auto maxTime = minTime + windowSeconds;
+
+    uint64_t fullBytes = 0;
+    auto t0 = Clock::now();
+    auto fullCount = ScanFile(UNROTATED_PATH, minTime, maxTime, &fullBytes);
+    auto t1 = Clock::now();
+
+    uint64_t segmentBytes = 0;
+    uint64_t segmentCount = 0;
+    size_t segmentsRead = 0;
+    auto t2 = Clock::now();
+    auto manifest = ReadManifest(SEGMENT_BASE "-manifest.csv");
+    for (auto const& segment : manifest) {
+        if (segment.mMaxTime >= minTime && segment.mMinTime <= maxTime) {
+            segmentCount += ScanFile(segment.mFileName.c_str(), minTime, maxTime, &segmentBytes);
+            segmentsRead += 1;
+        }
+    }
+    auto t3 = Clock::now();
+
+    if (fullCount != segmentCount) {
+        fprintf(stderr, "error: the segments have %llu rows in the window, but the whole file has %llu\n",
+            (unsigned long long) segmentCount, (unsigned long long) fullCount);
+        return 1;
+    }
+
+    printf("  extract %u s (%llu rows): %.1f ms scanning the whole file (%.0f MB), %.2f ms scanning %zu of %zu segments (%.1f MB)\n",
+        windowSeconds, (unsigned long long) fullCount,
+        1e3 * Seconds(t0, t1), fullBytes / (1024.0 * 1024.0),
+        1e3 * Seconds(t2, t3), segmentsRead, manifest.size(), segmentBytes / (1024.0 * 1024.0));
+
+    remove(UNROTATED_PATH);
+    remove(SEGMENT_BASE "-manifest.csv");
+    for (uint32_t i = 1; i <= (uint32_t) segments.size(); ++i) {
+        remove(GetSegmentFileName(i).c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,329 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+//
+// Measures the memory used per in-flight present and the cost of the field
+// accesses made by the consumer's event handlers, comparing the previous
+// PresentEvent layout (every member inline, including a std::deque of
+// DependentPresents) with the current PresentEvent and its lazily allocated
+// PresentEventExtension.
+//
+// A window of presents is kept in flight: each step creates a present,
+// replacing the oldest, and then handles a number of events that each update
+// a random in-flight present, as the DxgKrnl/Win32K handlers do after looking
+// a present up in a tracking map.  flipPercent of the presents are flip
+// model presents, which set the Win32K keys (and so allocate an extension).
+//
+// Bytes per in-flight present include the pool slabs and any other heap
+// allocations.  Cache misses are read from the CPU's performance counters
+// when they are available (Linux perf events), and otherwise not reported.
+//
+// Build and run (portable, does not require the Windows SDK):
+//     g++ -O2 -std=c++17 -Icompat -I../../PresentData present_event_layout.cpp ../../PresentData/PresentMonTraceConsumer.cpp ../../PresentData/TraceConsumer.cpp -o present_event_layout
+//     ./present_event_layout [presentCount] [flipPercent]
+
+#include "PresentMonTraceConsumer.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+// Track the heap bytes in use by the process.
+static std::atomic<int64_t> gHeapBytes(0);
+
+void* operator new(size_t size)
+{
+    if (auto p = (uint64_t*) malloc(size + 16)) {
+        p[0] = size;
+        gHeapBytes.fetch_add((int64_t) size, std::memory_order_relaxed);
+        return p + 2;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    if (p != nullptr) {
+        auto h = (uint64_t*) p - 2;
+        gHeapBytes.fetch_sub((int64_t) h[0], std::memory_order_relaxed);
+        free(h);
+    }
+}
+
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+
+namespace {
+
+enum {
+    EVENTS_PER_PRESENT = 8,
+};
+
+// The previous PresentEvent layout.
+struct PreviousPresentEvent : PoolObject<PreviousPresentEvent> {
+    uint64_t QpcTime;
+    uint32_t ProcessId;
+    uint32_t ThreadId;
+    uint64_t TimeTaken;
+    uint64_t ReadyTime;
+    uint64_t ScreenTime;
+    uint64_t SwapChainAddress;
+    int32_t SyncInterval;
+    uint32_t PresentFlags;
+    uint64_t DxgKrnlHContext;
+    uint64_t Win32KPresentCount;
+    uint64_t Win32KBindId;
+    uint64_t LegacyBlitTokenData;
+    uint64_t Hwnd;
+    uint64_t TokenPtr;
+    uint64_t CompositionSurfaceLuid;
+    uint64_t PresentsWaitingForDWMIndex;
+    TimerWheelHandle mLostPresentTimer;
+    uint32_t QueueSubmitSequence;
+    uint32_t DestWidth;
+    uint32_t DestHeight;
+    uint32_t DriverBatchThreadId;
+    uint32_t Runtime;       // The enums were int-sized
+    uint32_t PresentMode;
+    uint32_t FinalState;
+    bool SupportsTearing;
+    bool MMIO;
+    bool SeenDxgkPresent;
+    bool SeenWin32KEvents;
+    bool DwmNotified;
+    bool SeenInFrameEvent;
+    bool CompletionIsDeferred;
+    bool IsCompleted;
+    bool IsLost;
+    bool PresentInDwmWaitingStruct;
+    std::deque<PoolPtr<PreviousPresentEvent>> DependentPresents;
+
+    PreviousPresentEvent(EVENT_HEADER const& hdr, ::Runtime runtime)
+        : QpcTime(*(uint64_t*) &hdr.TimeStamp), ProcessId(hdr.ProcessId), ThreadId(hdr.ThreadId)
+        , TimeTaken(0), ReadyTime(0), ScreenTime(0), SwapChainAddress(0), SyncInterval(-1), PresentFlags(0)
+        , DxgKrnlHContext(0), Win32KPresentCount(0), Win32KBindId(0), LegacyBlitTokenData(0), Hwnd(0), TokenPtr(0)
+        , CompositionSurfaceLuid(0), PresentsWaitingForDWMIndex(0), QueueSubmitSequence(0), DestWidth(0), DestHeight(0)
+        , DriverBatchThreadId(0), Runtime((uint32_t) runtime), PresentMode(0), FinalState(0), SupportsTearing(false)
+        , MMIO(false), SeenDxgkPresent(false), SeenWin32KEvents(false), DwmNotified(false), SeenInFrameEvent(false)
+        , CompletionIsDeferred(false), IsCompleted(false), IsLost(false), PresentInDwmWaitingStruct(false)
+    {
+    }
+};
+
+struct PreviousLayout {
+    using Present = PreviousPresentEvent;
+
+    SlabPool<Present> mPool;
+
+    void SetWin32KKeys(PoolPtr<Present> const& p, uint64_t luid, uint64_t presentCount, uint64_t bindId)
+    {
+        p->CompositionSurfaceLuid = luid;
+        p->Win32KPresentCount = presentCount;
+        p->Win32KBindId = bindId;
+    }
+};
+
+struct CurrentLayout {
+    using Present = PresentEvent;
+
+    SlabPool<PresentEventExtension> mExtensionPool;
+    SlabPool<Present> mPool;
+
+    void SetWin32KKeys(PoolPtr<Present> const& p, uint64_t luid, uint64_t presentCount, uint64_t bindId)
+    {
+        p->Extension = mExtensionPool.Allocate();
+        p->Extension->CompositionSurfaceLuid = luid;
+        p->Extension->Win32KPresentCount = presentCount;
+        p->Extension->Win32KBindId = bindId;
+    }
+};
+
+class CacheMissCounter {
+    int mFd = -1;
+
+public:
+    CacheMissCounter()
+    {
+#ifdef __linux__
+        perf_event_attr attr = {};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        mFd = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+
+    ~CacheMissCounter()
+    {
+#ifdef __linux__
+        if (mFd >= 0) close(mFd);
+#endif
+    }
+
+    bool Available() const { return mFd >= 0; }
+
+    void Start()
+    {
+#ifdef __linux__
+        if (mFd >= 0) {
+            ioctl(mFd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(mFd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    uint64_t Stop()
+    {
+        uint64_t count = 0;
+#ifdef __linux__
+        if (mFd >= 0) {
+            ioctl(mFd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(mFd, &count, sizeof(count)) != sizeof(count)) {
+                count = 0;
+            }
+        }
+#endif
+        return count;
+    }
+};
+
+struct Result {
+    size_t mPresentSize;
+    double mBytesPerPresent;
+    double mNsPerEvent;
+    double mMissesPerEvent;
+    uint64_t mChecksum;
+};
+
+template<typename Layout>
+__attribute__((noinline)) Result Run(uint32_t inFlightCount, uint32_t presentCount, uint32_t flipPercent, CacheMissCounter* counter)
+{
+    using Present = typename Layout::Present;
+
+    auto heapBytes0 = gHeapBytes.load();
+    Result result = {};
+    {
+        Layout layout;
+        std::vector<PoolPtr<Present>> inFlight(inFlightCount);
+        uint64_t checksum = 0;
+        uint64_t rng = 0x9E3779B97F4A7C15ull;
+
+        EVENT_HEADER hdr = {};
+        auto step = [&](uint32_t i) {
+            hdr.TimeStamp.QuadPart = 1000 * (int64_t) i;
+            hdr.ProcessId = 1000 + i % 8;
+            hdr.ThreadId = 2000 + i % 16;
+
+            // Create a present, replacing the oldest one.
+            auto p = layout.mPool.Allocate(hdr, Runtime::DXGI);
+            p->SwapChainAddress = hdr.ProcessId;
+            if (i % 100 < flipPercent) {
+                layout.SetWin32KKeys(p, 0x10000 + hdr.ProcessId, i, 1);
+            }
+            inFlight[i % inFlightCount] = std::move(p);
+
+            // Handle events for random in-flight presents.
+            for (uint32_t e = 0; e < EVENTS_PER_PRESENT; ++e) {
+                rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+                auto const& p2 = inFlight[(size_t) (rng % inFlightCount)];
+                if (p2 == nullptr) continue;
+
+                switch (e & 3) {
+                case 0:
+                    p2->QueueSubmitSequence = (uint32_t) rng;
+                    p2->SeenDxgkPresent = true;
+                    break;
+                case 1:
+                    p2->ReadyTime = p2->QpcTime + 10;
+                    p2->MMIO = (rng & 1) != 0;
+                    break;
+                case 2:
+                    p2->Hwnd = rng;
+                    p2->SeenWin32KEvents = true;
+                    break;
+                case 3:
+                    if (!p2->IsLost && p2->ThreadId != 0) {
+                        p2->ScreenTime = p2->ReadyTime + 100;
+                        p2->DwmNotified = true;
+                    }
+                    break;
+                }
+                checksum += p2->ProcessId + p2->TimeTaken + (p2->SeenDxgkPresent ? 1 : 0);
+            }
+        };
+
+        // Fill the window, then measure.
+        for (uint32_t i = 0; i < inFlightCount; ++i) {
+            step(i);
+        }
+        result.mBytesPerPresent = (double) (gHeapBytes.load() - heapBytes0) / inFlightCount;
+
+        counter->Start();
+        auto t0 = Clock::now();
+        for (uint32_t i = inFlightCount; i < inFlightCount + presentCount; ++i) {
+            step(i);
+        }
+        auto t1 = Clock::now();
+        auto misses = counter->Stop();
+
+        auto eventCount = (double) presentCount * (1 + EVENTS_PER_PRESENT);
+        result.mPresentSize = sizeof(Present);
+        result.mNsPerEvent = std::chrono::duration<double, std::nano>(t1 - t0).count() / eventCount;
+        result.mMissesPerEvent = misses / eventCount;
+        result.mChecksum = checksum;
+    }
+    return result;
+}
+
+void Print(char const* name, Result const& r, bool countersAvailable)
+{
+    printf("  %-8s %4zu B/PresentEvent  %7.1f B/in-flight present  %6.2f ns/event", name,
+        r.mPresentSize, r.mBytesPerPresent, r.mNsPerEvent);
+    if (countersAvailable) {
+        printf("  %6.3f cache misses/event", r.mMissesPerEvent);
+    }
+    printf("\n");
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t presentCount = argc > 1 ? (uint32_t) atoi(argv[1]) : 2000000;
+    uint32_t flipPercent = argc > 2 ? (uint32_t) atoi(argv[2]) : 50;
+    if (flipPercent > 100) flipPercent = 100;
+
+    CacheMissCounter counter;
+    if (!counter.Available()) {
+        printf("(cache miss counters are not available)\n");
+    }
+
+    uint32_t const inFlightCounts[] = { 256, 4096, 65536 };
+    for (auto inFlightCount : inFlightCounts) {
+        printf("%u presents in flight, %u%% flip model, %u events per present:\n", inFlightCount, flipPercent, EVENTS_PER_PRESENT);
+        auto previous = Run<PreviousLayout>(inFlightCount, presentCount, flipPercent, &counter);
+        auto current = Run<CurrentLayout>(inFlightCount, presentCount, flipPercent, &counter);
+        if (previous.mChecksum != current.mChecksum) {
+            fprintf(stderr, "error: layouts produced different results\n");
+            return 1;
+        }
+        Print("previous", previous, counter.Available());
+        Print("current", current, counter.Available());
+    }
+
+    return 0;
+}
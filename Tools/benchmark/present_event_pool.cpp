@@ -0,0 +1,268 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+//
+// Measures the per-present cost of PresentEvent allocation and reference
+// counting, comparing std::make_shared/std::shared_ptr with SlabPool/PoolPtr.
+//
+// A synthetic event stream is generated for a number of processes presenting
+// round-robin.  Each present follows the lifetime it has in PMTraceConsumer:
+// it is created on a runtime Present_Start, referenced from several tracking
+// maps as DxgKrnl/Win32K events arrive, removed from all of them on
+// completion, handed off to the output thread, and finally kept in a
+// 120-entry swap chain history.
+//
+// Build and run (portable, does not require the Windows SDK):
+//     g++ -O2 -std=c++17 -pthread -I../../PresentData present_event_pool.cpp -o present_event_pool
+//     ./present_event_pool [presentCount] [processCount]
+
+#include "SlabPool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+// Count all heap allocations made by the process.
+static std::atomic<uint64_t> gHeapAllocationCount(0);
+
+void* operator new(size_t size)
+{
+    gHeapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (auto p = malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// Stand-in for PresentEvent with the same size class.
+struct Present : PoolObject<Present> {
+    uint64_t QpcTime;
+    uint32_t ProcessId;
+    uint32_t ThreadId;
+    uint64_t Fields[24];
+    std::deque<PoolPtr<Present>> DependentPresents;
+
+    Present(uint64_t qpcTime, uint32_t processId, uint32_t threadId)
+        : QpcTime(qpcTime)
+        , ProcessId(processId)
+        , ThreadId(threadId)
+        , Fields()
+    {
+    }
+};
+
+struct SharedPresent {
+    uint64_t QpcTime;
+    uint32_t ProcessId;
+    uint32_t ThreadId;
+    uint64_t Fields[24];
+    std::deque<std::shared_ptr<SharedPresent>> DependentPresents;
+
+    SharedPresent(uint64_t qpcTime, uint32_t processId, uint32_t threadId)
+        : QpcTime(qpcTime)
+        , ProcessId(processId)
+        , ThreadId(threadId)
+        , Fields()
+    {
+    }
+};
+
+struct SharedPolicy {
+    using Ref     = std::shared_ptr<SharedPresent>;
+    using Handoff = std::shared_ptr<SharedPresent>;
+
+    Ref Allocate(uint64_t qpc, uint32_t pid, uint32_t tid) { return std::make_shared<SharedPresent>(qpc, pid, tid); }
+    Handoff MakeHandoff(Ref const& p) { return p; }
+};
+
+struct PoolPolicy {
+    using Ref     = PoolPtr<Present>;
+    using Handoff = PoolHandoffPtr<Present>;
+
+    SlabPool<Present> mPool;
+
+    Ref Allocate(uint64_t qpc, uint32_t pid, uint32_t tid) { return mPool.Allocate(qpc, pid, tid); }
+    Handoff MakeHandoff(Ref const& p) { return mPool.Handoff(p); }
+};
+
+template<typename Policy>
+static double Run(char const* name, uint32_t presentCount, uint32_t processCount)
+{
+    using Ref = typename Policy::Ref;
+    using Handoff = typename Policy::Handoff;
+
+    enum { IN_FLIGHT_PER_PROCESS = 3, HISTORY_COUNT = 120, RING_COUNT = 8192 };
+
+    Policy policy;
+
+    // Consumer tracking structures, with the same shapes as PMTraceConsumer's.
+    std::vector<Ref> allPresents(RING_COUNT);
+    std::map<uint32_t, Ref> byThreadId;
+    std::map<uint32_t, std::map<uint64_t, Ref>> byProcess;
+    std::map<uint32_t, Ref> bySubmitSequence;
+    std::map<uint64_t, Ref> byToken;
+    std::map<uint64_t, Ref> lastWindowPresent;
+    std::deque<Ref> inFlight;
+
+    // Consumer -> output hand-off.
+    std::mutex handoffMutex;
+    std::vector<Handoff> handoffQueue;
+    std::atomic<bool> done(false);
+
+    std::thread output([&]() {
+        std::vector<Handoff> batch;
+        std::vector<std::vector<Handoff>> history(processCount);
+        for (auto& h : history) {
+            h.resize(HISTORY_COUNT);
+        }
+        std::vector<uint32_t> historyIndex(processCount);
+        for (;;) {
+            auto quit = done.load();
+            {
+                std::lock_guard<std::mutex> lock(handoffMutex);
+                batch.swap(handoffQueue);
+            }
+            for (auto& p : batch) {
+                auto pid = p->ProcessId;
+                history[pid][historyIndex[pid]++ % HISTORY_COUNT] = std::move(p);
+            }
+            batch.clear();
+            if (quit) break;
+            std::this_thread::yield();
+        }
+    });
+
+    auto heapAllocationCount0 = gHeapAllocationCount.load();
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    uint32_t ringIndex = 0;
+    for (uint32_t i = 0; i < presentCount; ++i) {
+        auto pid = i % processCount;
+        auto tid = 1000 + pid;
+        auto qpc = (uint64_t) i * 1000;
+
+        // Runtime Present_Start
+        auto p = policy.Allocate(qpc, pid, tid);
+        if (allPresents[ringIndex] != nullptr) {
+            allPresents[ringIndex] = nullptr;
+        }
+        allPresents[ringIndex] = p;
+        ringIndex = (ringIndex + 1) % RING_COUNT;
+        byProcess[pid].emplace(qpc, p);
+        byThreadId[tid] = p;
+
+        // DxgKrnl PresentHistory / QueuePacket_Start / Win32K TokenStateChanged
+        bySubmitSequence.emplace(i, p);
+        byToken.emplace(i, p);
+        lastWindowPresent[pid] = p;
+
+        // Runtime Present_Stop
+        byThreadId.erase(tid);
+        inFlight.push_back(std::move(p));
+
+        // VSyncDPC: complete the oldest in-flight present.
+        if (inFlight.size() > IN_FLIGHT_PER_PROCESS * processCount) {
+            auto c = std::move(inFlight.front());
+            inFlight.pop_front();
+
+            auto cpid = c->ProcessId;
+            auto cseq = (uint32_t) (c->QpcTime / 1000);
+            byProcess[cpid].erase(c->QpcTime);
+            bySubmitSequence.erase(cseq);
+            byToken.erase(cseq);
+            auto ii = lastWindowPresent.find(cpid);
+            if (ii != lastWindowPresent.end() && ii->second == c) {
+                lastWindowPresent.erase(ii);
+            }
+            allPresents[cseq % RING_COUNT] = nullptr;
+
+            auto handoff = policy.MakeHandoff(c);
+            std::lock_guard<std::mutex> lock(handoffMutex);
+            handoffQueue.emplace_back(std::move(handoff));
+        }
+    }
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    auto heapAllocationCount1 = gHeapAllocationCount.load();
+
+    done = true;
+    output.join();
+
+    // Release consumer references before the policy (pool) is destroyed.
+    allPresents.clear();
+    byProcess.clear();
+    bySubmitSequence.clear();
+    byToken.clear();
+    lastWindowPresent.clear();
+    inFlight.clear();
+
+    auto ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / presentCount;
+    auto allocs = (double) (heapAllocationCount1 - heapAllocationCount0) / presentCount;
+    printf("%-12s %10.1f ns/present %8.3f heap allocations/present\n", name, ns, allocs);
+    return ns;
+}
+
+// Checks that SlabPool frees presents that are handed off more than once, as
+// PMTraceConsumer does with a present that is reported lost and then completed
+// as a DWM dependency.  Each object is linked into the released list once, so
+// releasing a second hand-off while the first is still in the list must not
+// relink it (which would drop the entries behind it, or make it point to
+// itself).
+static bool CheckRepeatedHandoff()
+{
+    SlabPool<Present> pool;
+    {
+        std::vector<PoolHandoffPtr<Present>> handoffs;
+        for (uint32_t i = 0; i < 64; ++i) {
+            auto p = pool.Allocate(i, 0, 0);
+            handoffs.emplace_back(pool.Handoff(p));
+            if (i % 4 == 0) {
+                handoffs.emplace_back(pool.Handoff(p));
+            }
+        }
+
+        // Release them on another thread, with the repeated hand-offs of an
+        // object adjacent in the released list.
+        std::thread output([&]() { handoffs.clear(); });
+        output.join();
+    }
+    pool.CollectReleased();
+
+    if (pool.GetLiveCount() != 0) {
+        fprintf(stderr, "error: %zu presents handed off more than once were not freed\n", pool.GetLiveCount());
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t presentCount = argc > 1 ? (uint32_t) strtoul(argv[1], nullptr, 10) : 2000000;
+    uint32_t processCount = argc > 2 ? (uint32_t) strtoul(argv[2], nullptr, 10) : 24;
+    if (presentCount == 0 || processCount == 0) {
+        fprintf(stderr, "usage: present_event_pool [presentCount] [processCount]\n");
+        return 1;
+    }
+
+    if (!CheckRepeatedHandoff()) {
+        return 1;
+    }
+
+    printf("%u presents from %u processes\n", presentCount, processCount);
+
+    // Heap allocations/present include the std::map node allocations made by
+    // the tracking structures, which are the same for both.
+    auto sharedNs = Run<SharedPolicy>("make_shared", presentCount, processCount);
+    auto poolNs   = Run<PoolPolicy>("SlabPool", presentCount, processCount);
+    printf("speedup: %.2fx\n", sharedNs / poolNs);
+    return 0;
+}
@@ -0,0 +1,152 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+//
+// Measures the per-event cost of PMTraceConsumer's tracked process filter
+// check, comparing the previous std::set protected by a std::shared_mutex
+// with SnapshotSet.
+//
+// A reader thread, standing in for the consumer thread, checks a random
+// process id for every event.  Half of the ids are tracked, and the reader
+// checks that the result is correct.  Optionally, a writer thread, standing
+// in for a thread that tracks new target processes, repeatedly adds and
+// removes another id every writerPeriodUs microseconds (0 disables the
+// writer).
+//
+// Build and run (portable, does not require the Windows SDK):
+//     g++ -O2 -std=c++17 -pthread -I../../PresentData process_filter.cpp -o process_filter
+//     ./process_filter [eventCount] [writerPeriodUs]
+
+#include "SnapshotSet.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <set>
+#include <shared_mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+// The tracked process filter as previously stored in PMTraceConsumer.
+class LockedSet {
+    std::set<uint32_t> mSet;
+    std::shared_mutex mMutex;
+
+public:
+    bool Contains(uint32_t value)
+    {
+        std::shared_lock<std::shared_mutex> lock(mMutex);
+        return mSet.find(value) != mSet.end();
+    }
+
+    bool Insert(uint32_t value)
+    {
+        std::unique_lock<std::shared_mutex> lock(mMutex);
+        return mSet.insert(value).second;
+    }
+
+    bool Erase(uint32_t value)
+    {
+        std::unique_lock<std::shared_mutex> lock(mMutex);
+        return mSet.erase(value) != 0;
+    }
+};
+
+// Process ids are multiples of 4.  Even multiples of 8 are tracked; the
+// writer toggles WRITER_ID, which the reader never checks.
+enum { WRITER_ID = 1 };
+
+struct Result {
+    double mNsPerEvent;
+    uint64_t mWriteCount;
+    bool mCorrect;
+};
+
+template<typename Set>
+Result Run(uint32_t trackedCount, uint32_t eventCount, uint32_t writerPeriodUs)
+{
+    Set set;
+    for (uint32_t i = 0; i < trackedCount; ++i) {
+        set.Insert(i * 8);
+    }
+
+    std::mt19937 rng(trackedCount);
+    std::vector<uint32_t> ids(eventCount);
+    for (auto& id : ids) {
+        id = (rng() % (2 * trackedCount)) * 4;
+    }
+
+    std::atomic<bool> quit(false);
+    uint64_t writeCount = 0;
+    std::thread writer;
+    if (writerPeriodUs != 0) {
+        writer = std::thread([&]() {
+            while (!quit.load(std::memory_order_relaxed)) {
+                set.Insert(WRITER_ID);
+                set.Erase(WRITER_ID);
+                writeCount += 2;
+                std::this_thread::sleep_for(std::chrono::microseconds(writerPeriodUs));
+            }
+        });
+    }
+
+    uint32_t trackedSeen = 0;
+    uint32_t expectedTracked = 0;
+    auto t0 = Clock::now();
+    for (auto id : ids) {
+        trackedSeen += set.Contains(id) ? 1 : 0;
+    }
+    auto t1 = Clock::now();
+    for (auto id : ids) {
+        expectedTracked += id % 8 == 0 ? 1 : 0;
+    }
+
+    quit.store(true);
+    if (writer.joinable()) {
+        writer.join();
+    }
+
+    Result result = {};
+    result.mNsPerEvent = std::chrono::duration<double, std::nano>(t1 - t0).count() / eventCount;
+    result.mWriteCount = writeCount;
+    result.mCorrect = trackedSeen == expectedTracked;
+    return result;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t eventCount = argc > 1 ? (uint32_t) atoi(argv[1]) : 10000000;
+    uint32_t writerPeriodUs = argc > 2 ? (uint32_t) atoi(argv[2]) : 100;
+
+    printf("%u events per run, ", eventCount);
+    if (writerPeriodUs == 0) {
+        printf("no writer\n\n");
+    } else {
+        printf("writer every %u us\n\n", writerPeriodUs);
+    }
+    printf("%8s %20s %20s %9s %16s\n", "tracked", "locked (ns/event)", "snapshot (ns/event)", "speedup", "snapshot writes");
+
+    for (uint32_t trackedCount : { 1u, 4u, 16u, 64u, 256u }) {
+        auto locked = Run<LockedSet>(trackedCount, eventCount, writerPeriodUs);
+        auto snapshot = Run<SnapshotSet<uint32_t>>(trackedCount, eventCount, writerPeriodUs);
+
+        if (!locked.mCorrect || !snapshot.mCorrect) {
+            fprintf(stderr, "error: wrong filter result with %u tracked\n", trackedCount);
+            return 1;
+        }
+
+        printf("%8u %20.2f %20.2f %8.1fx %16llu\n", trackedCount, locked.mNsPerEvent, snapshot.mNsPerEvent,
+            locked.mNsPerEvent / snapshot.mNsPerEvent, (unsigned long long) snapshot.mWriteCount);
+    }
+
+    return 0;
+}
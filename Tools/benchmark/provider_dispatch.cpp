@@ -0,0 +1,224 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+//
+// Measures the per-event cost of routing events to their provider's handler,
+// comparing the previous chain of ProviderId comparisons in
+// EventRecordCallback (with display and WinMR tracking enabled, i.e., all 16
+// providers) with ProviderDispatchTable.
+//
+// The events' providers are taken from an event capture if one is given,
+// e.g., one recorded while processing a Gold ETL:
+//     PresentMon -etl_file Tests/Gold/test_case_0.etl -capture_file test_case_0.pmec -no_csv
+// Otherwise, they are taken from the synthetic event stream in
+// synthetic_present_events.hpp.  The capture is only used for its mix of
+// providers, so it may be replayed many times.  Both methods must route every
+// event to the same handler.
+//
+// Build and run (portable, does not require the Windows SDK):
+//     g++ -O2 -std=c++17 -Icompat -I../../PresentData provider_dispatch.cpp ../../PresentData/EventCapture.cpp ../../PresentData/PresentMonTraceConsumer.cpp ../../PresentData/TraceConsumer.cpp -o provider_dispatch
+//     ./provider_dispatch [eventCount] [capturePath]
+
+#include "synthetic_present_events.hpp"
+
+#include "EventCapture.hpp"
+#include "ProviderDispatchTable.hpp"
+#include "ETW/Microsoft_Windows_EventMetadata.h"
+
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+// The providers routed by EventRecordCallback, in the order they were
+// previously compared.  The GUIDs are the Windows provider GUIDs, so that
+// they match captures even where the ETW headers' GUIDs are synthesized (see
+// compat/windows.h).  synthetic_present_events.hpp uses the ETW headers'
+// GUIDs, which mHeaderGuid maps back to the provider.
+struct Provider {
+    char const* mName;
+    GUID mGuid;
+    GUID const* mHeaderGuid;
+};
+
+Provider const PROVIDERS[] = {
+    { "DxgKrnl",              { 0x802EC45A, 0x1E99, 0x4B83, { 0x99, 0x20, 0x87, 0xC9, 0x82, 0x77, 0xBA, 0x9D } }, &Microsoft_Windows_DxgKrnl::GUID },
+    { "DXGI",                 { 0xCA11C036, 0x0102, 0x4A2D, { 0xA6, 0xAD, 0xF0, 0x3C, 0xFE, 0xD5, 0xD3, 0xC9 } }, &Microsoft_Windows_DXGI::GUID },
+    { "D3D9",                 { 0x783ACA0A, 0x790E, 0x4D7F, { 0x84, 0x51, 0xAA, 0x85, 0x05, 0x11, 0xC6, 0xB9 } }, &Microsoft_Windows_D3D9::GUID },
+    { "NT_Process",           { 0x3d6fa8d0, 0xfe05, 0x11d0, { 0x9d, 0xda, 0x00, 0xc0, 0x4f, 0xd7, 0xba, 0x7c } }, &NT_Process::GUID },
+    { "Win7 PresentHistory",  { 0xc19f763a, 0xc0c1, 0x479d, { 0x9f, 0x74, 0x22, 0xab, 0xfc, 0x3a, 0x5f, 0x0a } }, &Microsoft_Windows_DxgKrnl::Win7::PRESENTHISTORY_GUID },
+    { "EventMetadata",        { 0xbbccf6c1, 0x6cd1, 0x48c4, { 0x80, 0xff, 0x83, 0x94, 0x82, 0xe3, 0x76, 0x71 } }, &Microsoft_Windows_EventMetadata::GUID },
+    { "Win32k",               { 0x8C416C79, 0xD49B, 0x4F01, { 0xA4, 0x67, 0xE5, 0x6D, 0x3A, 0xA8, 0x23, 0x4C } }, &Microsoft_Windows_Win32k::GUID },
+    { "Dwm_Core",             { 0x9E9BBA3C, 0x2E38, 0x40CB, { 0x99, 0xF4, 0x9E, 0x82, 0x81, 0x42, 0x51, 0x64 } }, &Microsoft_Windows_Dwm_Core::GUID },
+    { "Dwm_Core Win7",        { 0x8c9dd1ad, 0xe6e5, 0x4b07, { 0xb4, 0x55, 0x68, 0x4a, 0x9d, 0x87, 0x99, 0x00 } }, &Microsoft_Windows_Dwm_Core::Win7::GUID },
+    { "Win7 Blt",             { 0x069f67f2, 0xc380, 0x4a65, { 0x8a, 0x61, 0x07, 0x1c, 0xd4, 0xa8, 0x72, 0x75 } }, &Microsoft_Windows_DxgKrnl::Win7::BLT_GUID },
+    { "Win7 Flip",            { 0x22412531, 0x670b, 0x4cd3, { 0x81, 0xd1, 0xe7, 0x09, 0xc1, 0x54, 0xae, 0x3d } }, &Microsoft_Windows_DxgKrnl::Win7::FLIP_GUID },
+    { "Win7 QueuePacket",     { 0x295e0d8e, 0x51ec, 0x43b8, { 0x9c, 0xc6, 0x9f, 0x79, 0x33, 0x1d, 0x27, 0xd6 } }, &Microsoft_Windows_DxgKrnl::Win7::QUEUEPACKET_GUID },
+    { "Win7 VSyncDPC",        { 0x5ccf1378, 0x6b2c, 0x4c0f, { 0xbd, 0x56, 0x8e, 0xeb, 0x9e, 0x4c, 0x5c, 0x77 } }, &Microsoft_Windows_DxgKrnl::Win7::VSYNCDPC_GUID },
+    { "Win7 MMIOFlip",        { 0x547820fe, 0x5666, 0x4b41, { 0x93, 0xdc, 0x6c, 0xfd, 0x5d, 0xea, 0x28, 0xcc } }, &Microsoft_Windows_DxgKrnl::Win7::MMIOFLIP_GUID },
+    { "SpectrumContinuous",   { 0x356e1338, 0x04ad, 0x420e, { 0x8b, 0x8a, 0xa2, 0xeb, 0x67, 0x85, 0x41, 0xcf } }, nullptr },
+    { "DHD",                  { 0x19d9d739, 0xda0a, 0x41a0, { 0xb9, 0x7f, 0x24, 0xed, 0x27, 0xab, 0xc9, 0xfb } }, nullptr },
+};
+
+enum {
+    PROVIDER_COUNT = sizeof(PROVIDERS) / sizeof(PROVIDERS[0]),
+    UNKNOWN_PROVIDER = PROVIDER_COUNT,
+};
+
+// Handlers count the events routed to them.  They are not inlined, like the
+// consumers' handlers.
+typedef void (*Handler)(uint64_t* counts);
+
+template<uint32_t I>
+__attribute__((noinline)) void Count(uint64_t* counts)
+{
+    counts[I] += 1;
+}
+
+template<uint32_t... I>
+void GetHandlers(Handler* handlers, std::integer_sequence<uint32_t, I...>)
+{
+    Handler h[] = { &Count<I>... };
+    for (uint32_t i = 0; i < sizeof...(I); ++i) {
+        handlers[i] = h[i];
+    }
+}
+
+Handler HANDLERS[PROVIDER_COUNT];
+
+// The previous EventRecordCallback routing.
+__attribute__((noinline)) void DispatchChain(GUID const& providerId, uint64_t* counts)
+{
+    for (uint32_t i = 0; i < PROVIDER_COUNT; ++i) {
+        if (providerId == PROVIDERS[i].mGuid) {
+            HANDLERS[i](counts);
+            return;
+        }
+    }
+    counts[UNKNOWN_PROVIDER] += 1;
+}
+
+__attribute__((noinline)) void DispatchTable(ProviderDispatchTable<Handler> const& table, GUID const& providerId, uint64_t* counts)
+{
+    auto handler = table.Find(providerId);
+    if (handler != nullptr) {
+        handler(counts);
+    } else {
+        counts[UNKNOWN_PROVIDER] += 1;
+    }
+}
+
+uint32_t GetProviderIndex(GUID const& providerId, bool headerGuid)
+{
+    for (uint32_t i = 0; i < PROVIDER_COUNT; ++i) {
+        auto guid = headerGuid ? PROVIDERS[i].mHeaderGuid : &PROVIDERS[i].mGuid;
+        if (guid != nullptr && *guid == providerId) {
+            return i;
+        }
+    }
+    return UNKNOWN_PROVIDER;
+}
+
+bool LoadCapture(char const* path, std::vector<GUID>* mix)
+{
+    EventCaptureReader reader;
+    if (reader.Open(path) != ERROR_SUCCESS) {
+        return false;
+    }
+
+    EVENT_RECORD eventRecord = {};
+    EventCaptureRecord record;
+    while (reader.NextRecord(&record)) {
+        if (record.type_ == EVENT_CAPTURE_RECORD_EVENT) {
+            EventCaptureReader::GetEventRecord(record, &eventRecord);
+            mix->push_back(eventRecord.EventHeader.ProviderId);
+        }
+    }
+    return true;
+}
+
+void GenerateSynthetic(std::vector<GUID>* mix)
+{
+    SyntheticPresentEvents::Config config;
+    SyntheticPresentEvents::Generator generator(config);
+    SyntheticPresentEvents::EventBuffer events;
+    generator.Generate(SyntheticPresentEvents::QPC_FREQUENCY, &events);
+    for (auto const& eventRecord : events.mRecords) {
+        auto index = GetProviderIndex(eventRecord.EventHeader.ProviderId, true);
+        mix->push_back(index == UNKNOWN_PROVIDER ? eventRecord.EventHeader.ProviderId : PROVIDERS[index].mGuid);
+    }
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    size_t eventCount = argc > 1 ? (size_t) atoll(argv[1]) : 20000000;
+    char const* capturePath = argc > 2 ? argv[2] : nullptr;
+
+    GetHandlers(HANDLERS, std::make_integer_sequence<uint32_t, PROVIDER_COUNT>());
+
+    std::vector<GUID> mix;
+    if (capturePath != nullptr) {
+        if (!LoadCapture(capturePath, &mix)) {
+            fprintf(stderr, "error: failed to load event capture: %s\n", capturePath);
+            return 1;
+        }
+    } else {
+        GenerateSynthetic(&mix);
+    }
+    if (mix.empty()) {
+        fprintf(stderr, "error: no events\n");
+        return 1;
+    }
+
+    ProviderDispatchTable<Handler> table;
+    for (uint32_t i = 0; i < PROVIDER_COUNT; ++i) {
+        table.Add(PROVIDERS[i].mGuid, HANDLERS[i]);
+    }
+
+    uint64_t chainCounts[PROVIDER_COUNT + 1] = {};
+    uint64_t tableCounts[PROVIDER_COUNT + 1] = {};
+
+    auto t0 = Clock::now();
+    for (size_t i = 0, j = 0; i < eventCount; ++i, j = j + 1 == mix.size() ? 0 : j + 1) {
+        DispatchChain(mix[j], chainCounts);
+    }
+    auto t1 = Clock::now();
+    for (size_t i = 0, j = 0; i < eventCount; ++i, j = j + 1 == mix.size() ? 0 : j + 1) {
+        DispatchTable(table, mix[j], tableCounts);
+    }
+    auto t2 = Clock::now();
+
+    printf("%zu events from %s (%zu events, replayed)\n\n", eventCount,
+        capturePath != nullptr ? capturePath : "the synthetic event stream", mix.size());
+    printf("%-20s %8s %12s\n", "Provider", "Events", "Chain depth");
+    for (uint32_t i = 0; i <= PROVIDER_COUNT; ++i) {
+        if (chainCounts[i] != tableCounts[i]) {
+            fprintf(stderr, "error: events were routed to different handlers\n");
+            return 1;
+        }
+        if (chainCounts[i] != 0) {
+            printf("%-20s %7.1f%% %12u\n", i == UNKNOWN_PROVIDER ? "(unknown)" : PROVIDERS[i].mName,
+                100.0 * chainCounts[i] / eventCount, i + 1);
+        }
+    }
+
+    // The chain's cost depends on how deep the mix's providers are, so its
+    // mean depth is reported with the times.
+    double depthSum = 0.0;
+    for (uint32_t i = 0; i <= PROVIDER_COUNT; ++i) {
+        depthSum += (double) chainCounts[i] * (i + 1);
+    }
+
+    auto chainNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / eventCount;
+    auto tableNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / eventCount;
+    printf("\nGUID chain:     %.2f ns/event (mean depth %.2f)\n", chainNs, depthSum / eventCount);
+    printf("dispatch table: %.2f ns/event\n", tableNs);
+
+    return 0;
+}
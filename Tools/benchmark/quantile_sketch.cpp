@@ -0,0 +1,152 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+//
+// Measures the cost of adding values to, merging, and querying a
+// QuantileSketch, and checks the sketch's quantiles against the exact
+// quantiles of the same values.
+//
+// The values are frame times in 10MHz QPC ticks: mostly 60Hz frames with
+// jitter, a 144Hz mode, and occasional long hitches, as well as uniformly
+// random values across the sketch's whole range.  Each data set is split in
+// two sketches that are merged, so Merge() is also checked.
+//
+// Build and run (portable, does not require the Windows SDK):
+//     g++ -O2 -std=c++17 -I../../PresentMon quantile_sketch.cpp -o quantile_sketch
+//     ./quantile_sketch [valueCount]
+
+#include "QuantileSketch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <random>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+double const QUANTILES[] = { 0.0, 0.5, 0.9, 0.95, 0.99, 0.999, 1.0 };
+enum { QUANTILE_COUNT = sizeof(QUANTILES) / sizeof(QUANTILES[0]) };
+
+std::vector<uint64_t> GenerateFrameTimes(size_t count)
+{
+    std::mt19937_64 rng(1);
+    std::normal_distribution<double> frame60(166667.0, 3000.0);
+    std::normal_distribution<double> frame144(69444.0, 1500.0);
+    std::exponential_distribution<double> hitch(1.0 / 500000.0);
+
+    std::vector<uint64_t> values(count);
+    for (auto& v : values) {
+        auto r = rng() % 1000;
+        auto t = r < 600 ? frame60(rng) : r < 990 ? frame144(rng) : 166667.0 + hitch(rng);
+        v = (uint64_t) std::max(1.0, t);
+    }
+    return values;
+}
+
+std::vector<uint64_t> GenerateUniform(size_t count)
+{
+    std::mt19937_64 rng(2);
+    std::vector<uint64_t> values(count);
+    for (auto& v : values) {
+        v = rng() >> (64 - QuantileSketch::MAX_VALUE_BITS + rng() % QuantileSketch::MAX_VALUE_BITS);
+    }
+    return values;
+}
+
+// Returns the largest relative error of the sketch's quantiles.
+double CheckQuantiles(char const* name, std::vector<uint64_t> const& values, QuantileSketch const& sketch)
+{
+    auto sorted = values;
+    std::sort(sorted.begin(), sorted.end());
+
+    uint64_t estimates[QUANTILE_COUNT];
+    sketch.GetQuantiles(QUANTILES, estimates, QUANTILE_COUNT);
+
+    printf("%-12s %14s %14s %9s\n", name, "exact", "sketch", "error");
+    double maxError = 0.0;
+    for (uint32_t i = 0; i < QUANTILE_COUNT; ++i) {
+        auto rank = (size_t) ceil(QUANTILES[i] * sorted.size() - 1e-6);
+        auto exact = sorted[rank == 0 ? 0 : rank - 1];
+        auto error = exact == 0 ? (double) estimates[i] : fabs((double) estimates[i] - (double) exact) / exact;
+        maxError = std::max(maxError, error);
+        printf("    p%-7g %14llu %14llu %8.3f%%\n", 100.0 * QUANTILES[i], (unsigned long long) exact,
+            (unsigned long long) estimates[i], 100.0 * error);
+    }
+    return maxError;
+}
+
+bool Check(char const* name, std::vector<uint64_t> const& values)
+{
+    QuantileSketch a;
+    QuantileSketch b;
+    for (size_t i = 0, n = values.size(); i < n; ++i) {
+        (i < n / 3 ? a : b).Add(values[i]);
+    }
+    a.Merge(b);
+
+    if (a.GetCount() != values.size() ||
+        a.GetMin() != *std::min_element(values.begin(), values.end()) ||
+        a.GetMax() != *std::max_element(values.begin(), values.end())) {
+        fprintf(stderr, "error: %s: merged count, min, or max is wrong\n", name);
+        return false;
+    }
+
+    auto maxError = CheckQuantiles(name, values, a);
+    if (maxError > 1.0 / (1 << QuantileSketch::SUB_BUCKET_BITS)) {
+        fprintf(stderr, "error: %s: quantile error %.3f%% is larger than the bound\n", name, 100.0 * maxError);
+        return false;
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    size_t valueCount = argc > 1 ? (size_t) atoll(argv[1]) : 10000000;
+    auto frameTimes = GenerateFrameTimes(valueCount);
+
+    if (!Check("frame times", frameTimes) ||
+        !Check("uniform", GenerateUniform(valueCount))) {
+        return 1;
+    }
+
+    QuantileSketch sketch;
+    auto t0 = Clock::now();
+    for (auto v : frameTimes) {
+        sketch.Add(v);
+    }
+    auto t1 = Clock::now();
+
+    // Merge into a different sketch each time, as when summarizing many
+    // swap chains.
+    enum { MERGE_COUNT = 1000 };
+    std::vector<QuantileSketch> merged(MERGE_COUNT);
+    for (auto& m : merged) {
+        m.Merge(sketch);
+    }
+    auto t2 = Clock::now();
+
+    uint64_t estimates[QUANTILE_COUNT];
+    enum { QUERY_COUNT = 1000 };
+    uint64_t checksum = 0;
+    for (uint32_t i = 0; i < QUERY_COUNT; ++i) {
+        sketch.GetQuantiles(QUANTILES, estimates, QUANTILE_COUNT);
+        checksum += estimates[1];
+    }
+    auto t3 = Clock::now();
+
+    printf("\nsketch size:   %zu bytes\n", sizeof(QuantileSketch));
+    printf("Add():         %.2f ns/value\n", std::chrono::duration<double, std::nano>(t1 - t0).count() / frameTimes.size());
+    printf("Merge():       %.2f us (%llu values)\n", std::chrono::duration<double, std::micro>(t2 - t1).count() / MERGE_COUNT,
+        (unsigned long long) merged.back().GetCount());
+    printf("GetQuantiles(): %.2f us for %u quantiles (p50 = %llu)\n", std::chrono::duration<double, std::micro>(t3 - t2).count() / QUERY_COUNT,
+        (unsigned) QUANTILE_COUNT, (unsigned long long) (checksum / QUERY_COUNT));
+
+    return 0;
+}
@@ -0,0 +1,190 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+//
+// Measures the output thread's per-present cost of finding the swap chain a
+// completed present belongs to, comparing the previous lookup (a gProcesses
+// std::unordered_map lookup by process id followed by an mSwapChain emplace
+// by SwapChainAddress) with indexing a flat vector by the dense SwapChainId
+// assigned by PMTraceConsumer, and checking that the entry is for the
+// present's swap chain.
+//
+// Presents are spread round-robin over the given number of processes, each
+// with swapChainsPerProcess swap chains, in a shuffled order so that
+// consecutive presents rarely share a swap chain.
+//
+// Build and run (portable, does not require the Windows SDK):
+//     g++ -O2 -std=c++17 swap_chain_lookup.cpp -o swap_chain_lookup
+//     ./swap_chain_lookup [presentCount] [swapChainsPerProcess]
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct SwapChainData {
+    uint32_t mPresentHistoryCount;
+    uint32_t mNextPresentIndex;
+    uint32_t mLastDisplayedPresentIndex;
+    uint64_t mLastQpc;
+};
+
+struct ProcessInfo {
+    std::string mModuleName;
+    std::unordered_map<uint64_t, SwapChainData> mSwapChain;
+    bool mTargetProcess;
+};
+
+struct Present {
+    uint32_t ProcessId;
+    uint32_t SwapChainId;
+    uint64_t SwapChainAddress;
+    uint64_t QpcTime;
+};
+
+void InitSwapChain(SwapChainData* chain)
+{
+    chain->mPresentHistoryCount = 0;
+    chain->mNextPresentIndex = 1;
+    chain->mLastDisplayedPresentIndex = 0;
+    chain->mLastQpc = 0;
+}
+
+struct PreviousLookup {
+    std::unordered_map<uint32_t, ProcessInfo> mProcesses;
+
+    SwapChainData* Get(Present const& p)
+    {
+        auto result = mProcesses.emplace(p.ProcessId, ProcessInfo());
+        auto processInfo = &result.first->second;
+        if (result.second) {
+            processInfo->mModuleName = "process.exe";
+            processInfo->mTargetProcess = true;
+        }
+        if (!processInfo->mTargetProcess) {
+            return nullptr;
+        }
+
+        auto result2 = processInfo->mSwapChain.emplace(p.SwapChainAddress, SwapChainData());
+        auto chain = &result2.first->second;
+        if (result2.second) {
+            InitSwapChain(chain);
+        }
+        return chain;
+    }
+};
+
+struct DenseLookup {
+    struct SwapChainEntry {
+        ProcessInfo* mProcessInfo;
+        SwapChainData* mSwapChain;
+        uint32_t mProcessId;
+        uint64_t mSwapChainAddress;
+    };
+
+    std::unordered_map<uint32_t, ProcessInfo> mProcesses;
+    std::vector<SwapChainEntry> mSwapChains;
+
+    SwapChainData* Get(Present const& p)
+    {
+        if (p.SwapChainId >= mSwapChains.size()) {
+            mSwapChains.resize(p.SwapChainId + 1, SwapChainEntry());
+        }
+
+        // IDs are reused by the consumer, so the entry is checked against the
+        // present's swap chain.
+        auto entry = &mSwapChains[p.SwapChainId];
+        if (entry->mProcessInfo == nullptr || entry->mProcessId != p.ProcessId || entry->mSwapChainAddress != p.SwapChainAddress) {
+            auto result = mProcesses.emplace(p.ProcessId, ProcessInfo());
+            auto processInfo = &result.first->second;
+            if (result.second) {
+                processInfo->mModuleName = "process.exe";
+                processInfo->mTargetProcess = true;
+            }
+            entry->mProcessInfo = processInfo;
+            entry->mSwapChain = nullptr;
+            entry->mProcessId = p.ProcessId;
+            entry->mSwapChainAddress = p.SwapChainAddress;
+            if (processInfo->mTargetProcess) {
+                auto result2 = processInfo->mSwapChain.emplace(p.SwapChainAddress, SwapChainData());
+                entry->mSwapChain = &result2.first->second;
+                if (result2.second) {
+                    InitSwapChain(entry->mSwapChain);
+                }
+            }
+        }
+        return entry->mSwapChain;
+    }
+};
+
+template<typename Lookup>
+double Run(std::vector<Present> const& presents, uint64_t* checksum)
+{
+    Lookup lookup;
+    auto t0 = Clock::now();
+    for (auto const& p : presents) {
+        auto chain = lookup.Get(p);
+        if (chain != nullptr) {
+            chain->mPresentHistoryCount += 1;
+            chain->mLastQpc = p.QpcTime;
+            *checksum += chain->mPresentHistoryCount;
+        }
+    }
+    auto t1 = Clock::now();
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / presents.size();
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t presentCount = argc > 1 ? (uint32_t) atoi(argv[1]) : 4000000;
+    uint32_t swapChainsPerProcess = argc > 2 ? (uint32_t) atoi(argv[2]) : 2;
+    if (swapChainsPerProcess == 0) swapChainsPerProcess = 1;
+
+    uint32_t const processCounts[] = { 1, 16, 256, 4096 };
+    for (auto processCount : processCounts) {
+        auto swapChainCount = processCount * swapChainsPerProcess;
+
+        // Assign each swap chain a dense id, in first-present order as
+        // PMTraceConsumer does.
+        std::vector<uint32_t> order(swapChainCount);
+        for (uint32_t i = 0; i < swapChainCount; ++i) {
+            order[i] = i;
+        }
+        std::mt19937 rng(processCount);
+        std::shuffle(order.begin(), order.end(), rng);
+
+        std::vector<Present> presents(presentCount);
+        for (uint32_t i = 0; i < presentCount; ++i) {
+            auto swapChain = order[i % swapChainCount];
+            auto& p = presents[i];
+            p.ProcessId = 4 * (1000 + swapChain / swapChainsPerProcess);
+            p.SwapChainAddress = 0x1d0000000ull + 0x1000ull * swapChain;
+            p.SwapChainId = i < swapChainCount ? i : presents[i % swapChainCount].SwapChainId;
+            p.QpcTime = 1000ull * i;
+        }
+
+        uint64_t previousChecksum = 0;
+        uint64_t denseChecksum = 0;
+        auto previousNs = Run<PreviousLookup>(presents, &previousChecksum);
+        auto denseNs = Run<DenseLookup>(presents, &denseChecksum);
+        if (previousChecksum != denseChecksum) {
+            fprintf(stderr, "error: lookups produced different results\n");
+            return 1;
+        }
+
+        printf("%4u processes, %5u swap chains:  previous %6.2f ns/present  dense ids %6.2f ns/present\n",
+            processCount, swapChainCount, previousNs, denseNs);
+    }
+
+    return 0;
+}
@@ -0,0 +1,1075 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+//
+// SyntheticPresentEvents generates a time-ordered stream of the ETW events
+// that PMTraceConsumer consumes, for a configurable number of processes, swap
+// chains per process, and presents per second per swap chain.  Each swap chain
+// uses one of the PresentModes below, and its presents follow the same event
+// sequence that a real trace of that mode contains:
+//
+//   Hardware_Legacy_Flip:                 Present_Start, Flip, QueuePacket(MMIOFLIP), Present_Stop
+//                                         ... MMIOFlip ... VSyncDPC
+//   Hardware_Legacy_Copy_To_Front_Buffer: Present_Start, Blit, QueuePacket, Present_Info, Present_Stop
+//                                         ... QueuePacket_Stop
+//   Composed_Flip:                        Present_Start, TokenCompositionSurfaceObject, PresentHistoryDetailed,
+//                                         QueuePacket, Present_Info, Present_Stop
+//                                         ... PresentHistory_Info
+//                                         ... TokenStateChanged(InFrame), SCHEDULE_SURFACEUPDATE,
+//                                             TokenStateChanged(Confirmed) (or Discarded if superseded)
+//                                         ... DWM's flip ... VSyncDPC
+//   Hardware_Independent_Flip,
+//   Hardware_Composed_Independent_Flip:   same as Composed_Flip until PresentHistory_Info, then
+//                                         TokenStateChanged(InFrame/Confirmed), MMIOFlipMPO
+//                                         ... VSyncDPCMultiPlane with one or two active planes
+//   Composed_Copy_GPU_GDI:                Present_Start, Blit, PresentHistoryDetailed(BLT), QueuePacket,
+//                                         Present_Info, Present_Stop
+//                                         ... PresentHistory_Info ... GetPresentHistory, DWM's flip ... VSyncDPC
+//   Composed_Copy_CPU_GDI:                Present_Start, Blit(redirected), PresentHistory(VISTABLT), QueuePacket,
+//                                         Present_Info, Present_Stop
+//                                         ... PresentHistory_Info ... FlipChain_Pending, GetPresentHistory,
+//                                         DWM's flip ... VSyncDPC
+//
+// Composed_Composition_Atlas is not generated, since PMTraceConsumer stops
+// tracking those presents as soon as they are identified.
+//
+// Each present also submits a configurable number of non-present GPU packets,
+// which make up much of the DxgKrnl traffic in real traces.  DWM composes
+// once per vsync if any windowed presents became ready, and its own presents
+// are Hardware_Legacy_Flip.
+//
+// The generator also provides the TRACE_EVENT_INFO metadata for every event
+// it emits, which must be added to the consumer's EventMetadata with
+// AddMetadata() since the events are not decoded by TDH.  The property layouts
+// are simplified versions of the real manifests that include the properties
+// PMTraceConsumer reads.
+
+#pragma once
+
+#include "PresentMonTraceConsumer.hpp"
+#include "ETW/Microsoft_Windows_D3D9.h"
+#include "ETW/Microsoft_Windows_Dwm_Core.h"
+#include "ETW/Microsoft_Windows_DXGI.h"
+#include "ETW/Microsoft_Windows_DxgKrnl.h"
+#include "ETW/Microsoft_Windows_Win32k.h"
+#include "ETW/NT_Process.h"
+
+#include <algorithm>
+#include <queue>
+#include <stddef.h>
+
+namespace SyntheticPresentEvents {
+
+enum {
+    QPC_FREQUENCY = 10000000,
+    DWM_PROCESS_ID = 900,
+    DWM_THREAD_ID = 904,
+};
+
+struct Config {
+    uint32_t mProcessCount = 16;
+    uint32_t mSwapChainsPerProcess = 2;
+    uint32_t mPresentsPerSecond = 144;      // Per swap chain
+    uint32_t mRefreshRate = 60;
+    uint32_t mRenderPacketsPerPresent = 2;
+    uint32_t mDropEventsPerMillion = 0;     // Randomly drop events to exercise lost-present handling
+    uint64_t mSeed = 1;
+
+    // Swap chains are assigned these modes round-robin.  If empty, all
+    // generated modes are used.
+    std::vector<PresentMode> mModes;
+};
+
+// A batch of generated events.  UserData of each record points into
+// mUserData, so the records are valid until the next Generate() into the
+// same buffer.
+struct EventBuffer {
+    std::vector<EVENT_RECORD> mRecords;
+    std::vector<uint64_t> mUserData;
+    std::vector<size_t> mUserDataOffset;
+};
+
+class Generator {
+public:
+    explicit Generator(Config const& config);
+
+    // Add the metadata for every event that the generator emits.
+    void AddMetadata(EventMetadata* metadata) const;
+
+    // Replace the contents of events with all events with a timestamp before
+    // endQpc that haven't been generated yet.
+    void Generate(uint64_t endQpc, EventBuffer* events);
+
+    uint64_t GetPresentCount(PresentMode mode) const { return mPresentCount[(uint32_t) mode]; }
+    uint64_t GetDwmPresentCount() const { return mDwmPresentCount; }
+    uint64_t GetSupersededPresentCount() const { return mSupersededPresentCount; }
+    uint64_t GetEventCount() const { return mEventCount; }
+    uint64_t GetDroppedEventCount() const { return mDroppedEventCount; }
+
+private:
+    enum EventType : uint32_t {
+        D3D9_Present_Start,
+        D3D9_Present_Stop,
+        DXGI_Present_Start,
+        DXGI_Present_Stop,
+        DxgKrnl_Blit_Info,
+        DxgKrnl_Flip_Info,
+        DxgKrnl_MMIOFlip_Info,
+        DxgKrnl_MMIOFlipMultiPlaneOverlay_Info,
+        DxgKrnl_PresentHistoryDetailed_Start,
+        DxgKrnl_PresentHistory_Start,
+        DxgKrnl_PresentHistory_Info,
+        DxgKrnl_Present_Info,
+        DxgKrnl_QueuePacket_Start,
+        DxgKrnl_QueuePacket_Stop,
+        DxgKrnl_VSyncDPCMultiPlane_Info,
+        DxgKrnl_VSyncDPC_Info,
+        Win32k_TokenCompositionSurfaceObject_Info,
+        Win32k_TokenStateChanged_Info,
+        Dwm_GetPresentHistory_Info,
+        Dwm_SCHEDULE_PRESENT_Start,
+        Dwm_SCHEDULE_SURFACEUPDATE_Info,
+        Dwm_FlipChain_Pending,
+        NT_Process_Start,
+        EVENT_TYPE_COUNT
+    };
+
+    enum { NO_COUNT_PROPERTY = UINT16_MAX };
+
+    struct PropertyInfo {
+        wchar_t const* mName;
+        uint16_t mInType;
+        uint16_t mCountPropertyIndex = NO_COUNT_PROPERTY; // Index of the property holding the array count
+    };
+
+    struct EventInfo {
+        GUID mProviderId;
+        EVENT_DESCRIPTOR mDescriptor;
+        std::vector<PropertyInfo> mProperties;
+    };
+
+    enum class Runtime { DXGI, D3D9 };
+
+    struct SwapChain {
+        PresentMode mMode;
+        Runtime mRuntime;
+        uint32_t mProcessId;
+        uint32_t mThreadId;
+        uint64_t mAddress;
+        uint64_t mContext;
+        uint64_t mHwnd;
+        uint64_t mCompositionSurfaceLuid;
+        uint64_t mBindId;
+        uint64_t mPresentCount;
+        uint32_t mFlipChain;
+        uint32_t mFlipChainSerialNumber;
+        uint64_t mPresentInterval;
+        std::vector<uint32_t> mReadyPresents;   // Windowed presents that are ready for DWM to compose
+    };
+
+    struct Present {
+        uint32_t mSwapChain;
+        uint32_t mSubmitSequence;
+        uint32_t mFirstRenderSubmitSequence;
+        uint64_t mToken;
+        uint64_t mPresentCount;
+        uint32_t mFlipChainSerialNumber;
+    };
+
+    struct PendingFlip {
+        uint32_t mSubmitSequence;
+        uint32_t mPlaneCount;   // 0 for VSyncDPC, otherwise the active plane count for VSyncDPCMultiPlane
+    };
+
+    enum class ActionType { Present, GpuComplete, VSync, DwmCompose, DwmFlipReady };
+
+    struct Action {
+        uint64_t mQpc;
+        uint64_t mOrder;
+        ActionType mType;
+        uint32_t mIndex;
+
+        bool operator>(Action const& rhs) const
+        {
+            return mQpc != rhs.mQpc ? mQpc > rhs.mQpc : mOrder > rhs.mOrder;
+        }
+    };
+
+    void AddEventInfo(EventType type, GUID const& providerId, EVENT_DESCRIPTOR const& descriptor,
+                      std::initializer_list<PropertyInfo> properties);
+    template<typename T> void AddEventInfo(EventType type, GUID const& providerId,
+                                           std::initializer_list<PropertyInfo> properties);
+
+    void Schedule(uint64_t qpc, ActionType type, uint32_t index);
+    uint32_t Random(uint32_t range);
+    uint64_t Jitter(uint64_t qpc, uint32_t percent);
+    uint32_t NextSubmitSequence();
+
+    template<typename T> void Put(T value);
+    void PutString(char const* s);
+    void Emit(EventType type, uint32_t processId, uint32_t threadId, bool droppable = true);
+
+    void EmitQueuePacketStart(SwapChain const& swapChain, uint32_t packetType, uint32_t submitSequence, bool present);
+    void EmitQueuePacketStop(uint32_t submitSequence);
+    void EmitTokenStateChanged(SwapChain const& swapChain, Present const& present, Microsoft_Windows_Win32k::TokenState state, bool independentFlip);
+
+    void RunPresent(uint32_t swapChainIndex);
+    void RunGpuComplete(uint32_t presentIndex);
+    void RunVSync();
+    void RunDwmCompose();
+    void RunDwmFlipReady(uint32_t submitSequence);
+
+    Config mConfig;
+    EventInfo mEventInfo[EVENT_TYPE_COUNT];
+    std::vector<SwapChain> mSwapChains;
+    std::vector<Present> mPresents;
+    std::vector<uint32_t> mFreePresents;
+    std::vector<PendingFlip> mFlipsWaitingForVSync;
+    std::priority_queue<Action, std::vector<Action>, std::greater<Action>> mActions;
+    std::vector<uint8_t> mData;
+    EventBuffer* mEvents = nullptr;
+    uint64_t mNow = 0;
+    uint64_t mLastEventQpc = 0;
+    uint64_t mActionOrder = 0;
+    uint64_t mRandomState;
+    uint64_t mNextToken = 0x10000;
+    uint64_t mVSyncInterval;
+    uint32_t mNextSubmitSequence = 0;
+    bool mDwmComposeScheduled = false;
+    bool mProcessesStarted = false;
+    uint64_t mPresentCount[(uint32_t) PresentMode::Hardware_Composed_Independent_Flip + 1] = {};
+    uint64_t mDwmPresentCount = 0;
+    uint64_t mSupersededPresentCount = 0;
+    uint64_t mEventCount = 0;
+    uint64_t mDroppedEventCount = 0;
+};
+
+inline Generator::Generator(Config const& config)
+    : mConfig(config)
+    , mRandomState(config.mSeed == 0 ? 1 : config.mSeed)
+    , mVSyncInterval(QPC_FREQUENCY / (config.mRefreshRate == 0 ? 60 : config.mRefreshRate))
+{
+    using namespace Microsoft_Windows_DxgKrnl;
+
+    AddEventInfo<Microsoft_Windows_D3D9::Present_Start>(D3D9_Present_Start, Microsoft_Windows_D3D9::GUID, {
+        { L"pSwapchain",                 TDH_INTYPE_POINTER },
+        { L"Flags",                      TDH_INTYPE_UINT32 },
+    });
+    AddEventInfo<Microsoft_Windows_D3D9::Present_Stop>(D3D9_Present_Stop, Microsoft_Windows_D3D9::GUID, {
+        { L"Result",                     TDH_INTYPE_UINT32 },
+    });
+    AddEventInfo<Microsoft_Windows_DXGI::Present_Start>(DXGI_Present_Start, Microsoft_Windows_DXGI::GUID, {
+        { L"pIDXGISwapChain",            TDH_INTYPE_POINTER },
+        { L"Flags",                      TDH_INTYPE_UINT32 },
+        { L"SyncInterval",               TDH_INTYPE_INT32 },
+    });
+    AddEventInfo<Microsoft_Windows_DXGI::Present_Stop>(DXGI_Present_Stop, Microsoft_Windows_DXGI::GUID, {
+        { L"Result",                     TDH_INTYPE_UINT32 },
+    });
+    AddEventInfo<Blit_Info>(DxgKrnl_Blit_Info, Microsoft_Windows_DxgKrnl::GUID, {
+        { L"hwnd",                       TDH_INTYPE_POINTER },
+        { L"pDmaBuffer",                 TDH_INTYPE_POINTER },
+        { L"PresentHistoryToken",        TDH_INTYPE_UINT64 },
+        { L"hSourceAllocation",          TDH_INTYPE_POINTER },
+        { L"hDestAllocation",            TDH_INTYPE_POINTER },
+        { L"bSubmit",                    TDH_INTYPE_BOOLEAN },
+        { L"bRedirectedPresent",         TDH_INTYPE_BOOLEAN },
+        { L"Flags",                      TDH_INTYPE_UINT32 },
+    });
+    AddEventInfo<Flip_Info>(DxgKrnl_Flip_Info, Microsoft_Windows_DxgKrnl::GUID, {
+        { L"pDmaBuffer",                 TDH_INTYPE_POINTER },
+        { L"VidPnSourceId",              TDH_INTYPE_UINT32 },
+        { L"FlipToAllocation",           TDH_INTYPE_POINTER },
+        { L"FlipInterval",               TDH_INTYPE_UINT32 },
+        { L"FlipWithNoWait",             TDH_INTYPE_BOOLEAN },
+        { L"MMIOFlip",                   TDH_INTYPE_BOOLEAN },
+    });
+    AddEventInfo<MMIOFlip_Info>(DxgKrnl_MMIOFlip_Info, Microsoft_Windows_DxgKrnl::GUID, {
+        { L"pDxgAdapter",                TDH_INTYPE_POINTER },
+        { L"VidPnSourceId",              TDH_INTYPE_UINT32 },
+        { L"FlipSubmitSequence",         TDH_INTYPE_UINT32 },
+        { L"FlipToDriverAllocation",     TDH_INTYPE_POINTER },
+        { L"FlipToPhysicalAddress",      TDH_INTYPE_UINT64 },
+        { L"FlipToSegmentId",            TDH_INTYPE_UINT32 },
+        { L"FlipPresentId",              TDH_INTYPE_UINT32 },
+        { L"FlipPhysicalAdapterMask",    TDH_INTYPE_UINT32 },
+        { L"Flags",                      TDH_INTYPE_UINT32 },
+    });
+    AddEventInfo<MMIOFlipMultiPlaneOverlay_Info>(DxgKrnl_MMIOFlipMultiPlaneOverlay_Info, Microsoft_Windows_DxgKrnl::GUID, {
+        { L"pDxgAdapter",                TDH_INTYPE_POINTER },
+        { L"VidPnSourceId",              TDH_INTYPE_UINT32 },
+        { L"FlipSubmitSequence",         TDH_INTYPE_UINT64 },
+        { L"FlipToDriverAllocation",     TDH_INTYPE_POINTER },
+        { L"FlipToPhysicalAddress",      TDH_INTYPE_UINT64 },
+        { L"FlipToSegmentId",            TDH_INTYPE_UINT32 },
+        { L"FlipPresentId",              TDH_INTYPE_UINT32 },
+        { L"FlipPhysicalAdapterMask",    TDH_INTYPE_UINT32 },
+        { L"Flags",                      TDH_INTYPE_UINT32 },
+        { L"LayerIndex",                 TDH_INTYPE_UINT32 },
+        { L"FlipEntryStatusAfterFlip",   TDH_INTYPE_UINT32 },
+    });
+    AddEventInfo<PresentHistoryDetailed_Start>(DxgKrnl_PresentHistoryDetailed_Start, Microsoft_Windows_DxgKrnl::GUID, {
+        { L"hAdapter",                   TDH_INTYPE_POINTER },
+        { L"Token",                      TDH_INTYPE_UINT64 },
+        { L"Model",                      TDH_INTYPE_UINT32 },
+        { L"TokenData",                  TDH_INTYPE_UINT64 },
+    });
+    AddEventInfo<PresentHistory_Start>(DxgKrnl_PresentHistory_Start, Microsoft_Windows_DxgKrnl::GUID, {
+        { L"hAdapter",                   TDH_INTYPE_POINTER },
+        { L"Token",                      TDH_INTYPE_UINT64 },
+        { L"Model",                      TDH_INTYPE_UINT32 },
+        { L"TokenData",                  TDH_INTYPE_UINT64 },
+    });
+    AddEventInfo<PresentHistory_Info>(DxgKrnl_PresentHistory_Info, Microsoft_Windows_DxgKrnl::GUID, {
+        { L"hAdapter",                   TDH_INTYPE_POINTER },
+        { L"Token",                      TDH_INTYPE_UINT64 },
+    });
+    AddEventInfo<Present_Info>(DxgKrnl_Present_Info, Microsoft_Windows_DxgKrnl::GUID, {
+        { L"hContext",                   TDH_INTYPE_POINTER },
+        { L"hWindow",                    TDH_INTYPE_POINTER },
+        { L"VidPnSourceId",              TDH_INTYPE_UINT32 },
+        { L"Flags",                      TDH_INTYPE_UINT32 },
+    });
+    AddEventInfo<QueuePacket_Start>(DxgKrnl_QueuePacket_Start, Microsoft_Windows_DxgKrnl::GUID, {
+        { L"hContext",                   TDH_INTYPE_POINTER },
+        { L"PacketType",                 TDH_INTYPE_UINT32 },
+        { L"SubmitSequence",             TDH_INTYPE_UINT32 },
+        { L"DmaBufferSize",              TDH_INTYPE_UINT64 },
+        { L"AllocationListSize",         TDH_INTYPE_UINT32 },
+        { L"PatchLocationListSize",      TDH_INTYPE_UINT32 },
+        { L"bPresent",                   TDH_INTYPE_BOOLEAN },
+        { L"hDmaBuffer",                 TDH_INTYPE_POINTER },
+    });
+    AddEventInfo<QueuePacket_Stop>(DxgKrnl_QueuePacket_Stop, Microsoft_Windows_DxgKrnl::GUID, {
+        { L"hContext",                   TDH_INTYPE_POINTER },
+        { L"PacketType",                 TDH_INTYPE_UINT32 },
+        { L"SubmitSequence",             TDH_INTYPE_UINT32 },
+        { L"bPreempted",                 TDH_INTYPE_BOOLEAN },
+        { L"bTimeouted",                 TDH_INTYPE_BOOLEAN },
+    });
+    AddEventInfo<VSyncDPCMultiPlane_Info>(DxgKrnl_VSyncDPCMultiPlane_Info, Microsoft_Windows_DxgKrnl::GUID, {
+        { L"pDxgAdapter",                TDH_INTYPE_POINTER },
+        { L"VidPnTargetId",              TDH_INTYPE_UINT32 },
+        { L"VidPnSourceId",              TDH_INTYPE_UINT32 },
+        { L"FrameNumber",                TDH_INTYPE_UINT32 },
+        { L"FrameQpcTime",               TDH_INTYPE_INT64 },
+        { L"PlaneCount",                 TDH_INTYPE_UINT32 },
+        { L"PresentIdOrPhysicalAddress", TDH_INTYPE_UINT64, 5 },
+        { L"FlipEntryCount",             TDH_INTYPE_UINT32 },
+        { L"FlipSubmitSequence",         TDH_INTYPE_UINT64, 7 },
+    });
+    AddEventInfo<VSyncDPC_Info>(DxgKrnl_VSyncDPC_Info, Microsoft_Windows_DxgKrnl::GUID, {
+        { L"pDxgAdapter",                TDH_INTYPE_POINTER },
+        { L"VidPnTargetId",              TDH_INTYPE_UINT32 },
+        { L"ScannedPhysicalAddress",     TDH_INTYPE_UINT64 },
+        { L"VidPnSourceId",              TDH_INTYPE_UINT32 },
+        { L"FrameNumber",                TDH_INTYPE_UINT32 },
+        { L"FrameQpcTime",               TDH_INTYPE_INT64 },
+        { L"hFlipDevice",                TDH_INTYPE_POINTER },
+        { L"FlipType",                   TDH_INTYPE_UINT32 },
+        { L"FlipFenceId",                TDH_INTYPE_UINT64 },
+    });
+    AddEventInfo<Microsoft_Windows_Win32k::TokenCompositionSurfaceObject_Info>(Win32k_TokenCompositionSurfaceObject_Info, Microsoft_Windows_Win32k::GUID, {
+        { L"pCompositionSurfaceObject",  TDH_INTYPE_POINTER },
+        { L"PresentCount",               TDH_INTYPE_UINT64 },
+        { L"BindId",                     TDH_INTYPE_UINT64 },
+        { L"CompositionSurfaceLuid",     TDH_INTYPE_UINT64 },
+        { L"DestWidth",                  TDH_INTYPE_UINT32 },
+        { L"DestHeight",                 TDH_INTYPE_UINT32 },
+    });
+    AddEventInfo<Microsoft_Windows_Win32k::TokenStateChanged_Info>(Win32k_TokenStateChanged_Info, Microsoft_Windows_Win32k::GUID, {
+        { L"pCompositionSurfaceObject",  TDH_INTYPE_POINTER },
+        { L"CompositionSurfaceLuid",     TDH_INTYPE_UINT64 },
+        { L"PresentCount",               TDH_INTYPE_UINT32 },
+        { L"BindId",                     TDH_INTYPE_UINT64 },
+        { L"NewState",                   TDH_INTYPE_UINT32 },
+        { L"IndependentFlip",            TDH_INTYPE_BOOLEAN },
+    });
+    AddEventInfo<Microsoft_Windows_Dwm_Core::MILEVENT_MEDIA_UCE_PROCESSPRESENTHISTORY_GetPresentHistory_Info>(Dwm_GetPresentHistory_Info, Microsoft_Windows_Dwm_Core::GUID, {
+        { L"hwnd",                       TDH_INTYPE_POINTER },
+    });
+    AddEventInfo<Microsoft_Windows_Dwm_Core::SCHEDULE_PRESENT_Start>(Dwm_SCHEDULE_PRESENT_Start, Microsoft_Windows_Dwm_Core::GUID, {
+        { L"QpcTargetTime",              TDH_INTYPE_UINT64 },
+    });
+    AddEventInfo<Microsoft_Windows_Dwm_Core::SCHEDULE_SURFACEUPDATE_Info>(Dwm_SCHEDULE_SURFACEUPDATE_Info, Microsoft_Windows_Dwm_Core::GUID, {
+        { L"luidSurface",                TDH_INTYPE_UINT64 },
+        { L"PresentCount",               TDH_INTYPE_UINT64 },
+        { L"bindId",                     TDH_INTYPE_UINT64 },
+    });
+    AddEventInfo<Microsoft_Windows_Dwm_Core::FlipChain_Pending>(Dwm_FlipChain_Pending, Microsoft_Windows_Dwm_Core::GUID, {
+        { L"ulFlipChain",                TDH_INTYPE_UINT32 },
+        { L"ulSerialNumber",             TDH_INTYPE_UINT32 },
+        { L"hwnd",                       TDH_INTYPE_POINTER },
+    });
+
+    // NT_Process events use the classic (opcode-based) descriptor.
+    EVENT_DESCRIPTOR processStart = {};
+    processStart.Version = 3;
+    processStart.Opcode  = EVENT_TRACE_TYPE_START;
+    AddEventInfo(NT_Process_Start, NT_Process::GUID, processStart, {
+        { L"UniqueProcessKey",           TDH_INTYPE_POINTER },
+        { L"ProcessId",                  TDH_INTYPE_UINT32 },
+        { L"ParentId",                   TDH_INTYPE_UINT32 },
+        { L"SessionId",                  TDH_INTYPE_UINT32 },
+        { L"ExitStatus",                 TDH_INTYPE_INT32 },
+        { L"DirectoryTableBase",         TDH_INTYPE_POINTER },
+        { L"ImageFileName",              TDH_INTYPE_ANSISTRING },
+    });
+
+    // Create the swap chains.
+    if (mConfig.mModes.empty()) {
+        mConfig.mModes = {
+            PresentMode::Hardware_Legacy_Flip,
+            PresentMode::Hardware_Legacy_Copy_To_Front_Buffer,
+            PresentMode::Hardware_Independent_Flip,
+            PresentMode::Composed_Flip,
+            PresentMode::Hardware_Composed_Independent_Flip,
+            PresentMode::Composed_Copy_GPU_GDI,
+            PresentMode::Composed_Copy_CPU_GDI,
+        };
+    }
+
+    auto presentInterval = QPC_FREQUENCY / (mConfig.mPresentsPerSecond == 0 ? 60 : mConfig.mPresentsPerSecond);
+    for (uint32_t p = 0; p < mConfig.mProcessCount; ++p) {
+        for (uint32_t s = 0; s < mConfig.mSwapChainsPerProcess; ++s) {
+            auto index = (uint32_t) mSwapChains.size();
+
+            SwapChain swapChain = {};
+            swapChain.mMode                   = mConfig.mModes[index % mConfig.mModes.size()];
+            swapChain.mProcessId              = 1000 + 4 * p;
+            swapChain.mThreadId               = 100000 + 4 * index;
+            swapChain.mAddress                = 0x20000000000ull + 0x10000ull * index;
+            swapChain.mContext                = 0x30000000000ull + 0x10000ull * index;
+            swapChain.mHwnd                   = 0x10000ull + 2 * index;
+            swapChain.mCompositionSurfaceLuid = 0x40000000000ull + index;
+            swapChain.mBindId                 = index + 1;
+            swapChain.mFlipChain              = index + 1;
+            swapChain.mPresentInterval        = presentInterval;
+
+            // Legacy presents are sometimes made through D3D9.
+            swapChain.mRuntime = (swapChain.mMode == PresentMode::Hardware_Legacy_Flip ||
+                                  swapChain.mMode == PresentMode::Hardware_Legacy_Copy_To_Front_Buffer) && (index / mConfig.mModes.size()) % 2 == 1
+                ? Runtime::D3D9
+                : Runtime::DXGI;
+
+            mSwapChains.emplace_back(swapChain);
+
+            // Spread the first presents across the first present interval.
+            Schedule(1 + Random((uint32_t) presentInterval), ActionType::Present, index);
+        }
+    }
+
+    Schedule(mVSyncInterval, ActionType::VSync, 0);
+}
+
+inline void Generator::AddEventInfo(EventType type, GUID const& providerId, EVENT_DESCRIPTOR const& descriptor,
+                                    std::initializer_list<PropertyInfo> properties)
+{
+    auto info = &mEventInfo[type];
+    info->mProviderId = providerId;
+    info->mDescriptor = descriptor;
+    info->mProperties.assign(properties.begin(), properties.end());
+}
+
+template<typename T>
+void Generator::AddEventInfo(EventType type, GUID const& providerId, std::initializer_list<PropertyInfo> properties)
+{
+    EVENT_DESCRIPTOR descriptor = {};
+    descriptor.Id      = T::Id;
+    descriptor.Version = T::Version;
+    descriptor.Channel = T::Channel;
+    descriptor.Level   = T::Level;
+    descriptor.Opcode  = T::Opcode;
+    descriptor.Task    = T::Task;
+    descriptor.Keyword = (ULONGLONG) T::Keyword;
+    AddEventInfo(type, providerId, descriptor, properties);
+}
+
+inline void Generator::AddMetadata(EventMetadata* metadata) const
+{
+    for (auto const& info : mEventInfo) {
+        auto propertyCount = (uint32_t) info.mProperties.size();
+        auto nameOffset = (uint32_t) (offsetof(TRACE_EVENT_INFO, EventPropertyInfoArray) + sizeof(EVENT_PROPERTY_INFO) * (propertyCount == 0 ? 1 : propertyCount));
+        auto size = nameOffset;
+        for (auto const& property : info.mProperties) {
+            size += (uint32_t) (sizeof(wchar_t) * (wcslen(property.mName) + 1));
+        }
+
+        std::vector<uint64_t> buffer((size + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+        auto tei = (TRACE_EVENT_INFO*) buffer.data();
+        tei->ProviderGuid          = info.mProviderId;
+        tei->EventDescriptor       = info.mDescriptor;
+        tei->DecodingSource        = DecodingSourceXMLFile;
+        tei->PropertyCount         = propertyCount;
+        tei->TopLevelPropertyCount = propertyCount;
+
+        for (uint32_t i = 0; i < propertyCount; ++i) {
+            auto const& property = info.mProperties[i];
+            auto epi = &tei->EventPropertyInfoArray[i];
+
+            uint16_t length = 0;
+            switch (property.mInType) {
+            case TDH_INTYPE_INT32:
+            case TDH_INTYPE_UINT32:
+            case TDH_INTYPE_BOOLEAN: length = 4; break;
+            case TDH_INTYPE_INT64:
+            case TDH_INTYPE_UINT64:
+            case TDH_INTYPE_POINTER: length = 8; break;
+            }
+
+            epi->Flags                   = property.mCountPropertyIndex == NO_COUNT_PROPERTY ? (PROPERTY_FLAGS) 0 : PropertyParamCount;
+            epi->NameOffset              = nameOffset;
+            epi->nonStructType.InType    = property.mInType;
+            epi->length                  = length;
+            if (property.mCountPropertyIndex == NO_COUNT_PROPERTY) {
+                epi->count = 1;
+            } else {
+                epi->countPropertyIndex = property.mCountPropertyIndex;
+            }
+
+            auto nameSize = (uint32_t) (sizeof(wchar_t) * (wcslen(property.mName) + 1));
+            memcpy((uint8_t*) tei + nameOffset, property.mName, nameSize);
+            nameOffset += nameSize;
+        }
+
+        EventMetadataKey key = {};
+        key.guid_ = info.mProviderId;
+        key.desc_ = info.mDescriptor;
+        metadata->AddMetadata(key, tei, size);
+    }
+}
+
+inline void Generator::Schedule(uint64_t qpc, ActionType type, uint32_t index)
+{
+    mActions.push({ qpc, mActionOrder++, type, index });
+}
+
+inline uint32_t Generator::Random(uint32_t range)
+{
+    // xorshift64*
+    mRandomState ^= mRandomState >> 12;
+    mRandomState ^= mRandomState << 25;
+    mRandomState ^= mRandomState >> 27;
+    auto r = (uint32_t) ((mRandomState * 2685821657736338717ull) >> 32);
+    return range == 0 ? r : r % range;
+}
+
+// Vary qpc by up to +/- percent.
+inline uint64_t Generator::Jitter(uint64_t qpc, uint32_t percent)
+{
+    auto range = qpc * percent / 100;
+    return range == 0 ? qpc : qpc - range + Random((uint32_t) (2 * range + 1));
+}
+
+inline uint32_t Generator::NextSubmitSequence()
+{
+    mNextSubmitSequence += 1;
+    if (mNextSubmitSequence == 0) {
+        mNextSubmitSequence = 1;
+    }
+    return mNextSubmitSequence;
+}
+
+template<typename T>
+void Generator::Put(T value)
+{
+    auto offset = mData.size();
+    mData.resize(offset + sizeof(T));
+    memcpy(mData.data() + offset, &value, sizeof(T));
+}
+
+inline void Generator::PutString(char const* s)
+{
+    mData.insert(mData.end(), s, s + strlen(s) + 1);
+}
+
+// Append an event with the data accumulated by Put() and the next timestamp.
+// Events from the same action get increasing timestamps, which may run past
+// the time of the next action, but timestamps never go backwards.
+inline void Generator::Emit(EventType type, uint32_t processId, uint32_t threadId, bool droppable)
+{
+    mLastEventQpc = std::max(mNow, mLastEventQpc + 1);
+    mNow = mLastEventQpc;
+
+    if (droppable && mConfig.mDropEventsPerMillion > 0 && Random(1000000) < mConfig.mDropEventsPerMillion) {
+        mDroppedEventCount += 1;
+        mData.clear();
+        return;
+    }
+
+    auto const& info = mEventInfo[type];
+
+    EVENT_RECORD eventRecord = {};
+    eventRecord.EventHeader.Flags              = EVENT_HEADER_FLAG_64_BIT_HEADER;
+    eventRecord.EventHeader.ThreadId           = threadId;
+    eventRecord.EventHeader.ProcessId          = processId;
+    eventRecord.EventHeader.TimeStamp.QuadPart = (LONGLONG) mLastEventQpc;
+    eventRecord.EventHeader.ProviderId         = info.mProviderId;
+    eventRecord.EventHeader.EventDescriptor    = info.mDescriptor;
+    eventRecord.UserDataLength                 = (USHORT) mData.size();
+
+    auto offset = mEvents->mUserData.size();
+    mEvents->mUserData.resize(offset + (mData.size() + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+    if (!mData.empty()) {
+        memcpy(&mEvents->mUserData[offset], mData.data(), mData.size());
+    }
+    mEvents->mUserDataOffset.emplace_back(offset);
+    mEvents->mRecords.emplace_back(eventRecord);
+
+    mEventCount += 1;
+    mData.clear();
+}
+
+inline void Generator::EmitQueuePacketStart(SwapChain const& swapChain, uint32_t packetType, uint32_t submitSequence, bool present)
+{
+    Put<uint64_t>(swapChain.mContext);
+    Put<uint32_t>(packetType);
+    Put<uint32_t>(submitSequence);
+    Put<uint64_t>(0x10000);
+    Put<uint32_t>(0x400);
+    Put<uint32_t>(0x40);
+    Put<BOOL>(present);
+    Put<uint64_t>(swapChain.mContext + 0x100);
+    Emit(DxgKrnl_QueuePacket_Start, swapChain.mProcessId, swapChain.mThreadId);
+}
+
+inline void Generator::EmitQueuePacketStop(uint32_t submitSequence)
+{
+    Put<uint64_t>(0);
+    Put<uint32_t>(0);
+    Put<uint32_t>(submitSequence);
+    Put<BOOL>(FALSE);
+    Put<BOOL>(FALSE);
+    Emit(DxgKrnl_QueuePacket_Stop, 0, 0);
+}
+
+inline void Generator::EmitTokenStateChanged(SwapChain const& swapChain, Present const& present, Microsoft_Windows_Win32k::TokenState state, bool independentFlip)
+{
+    Put<uint64_t>(0);
+    Put<uint64_t>(swapChain.mCompositionSurfaceLuid);
+    Put<uint32_t>((uint32_t) present.mPresentCount);
+    Put<uint64_t>(swapChain.mBindId);
+    Put<uint32_t>((uint32_t) state);
+    Put<BOOL>(independentFlip);
+    Emit(Win32k_TokenStateChanged_Info, DWM_PROCESS_ID, DWM_THREAD_ID);
+}
+
+inline void Generator::RunPresent(uint32_t swapChainIndex)
+{
+    using namespace Microsoft_Windows_DxgKrnl;
+
+    auto& swapChain = mSwapChains[swapChainIndex];
+
+    uint32_t presentIndex = 0;
+    if (mFreePresents.empty()) {
+        presentIndex = (uint32_t) mPresents.size();
+        mPresents.emplace_back();
+    } else {
+        presentIndex = mFreePresents.back();
+        mFreePresents.pop_back();
+    }
+
+    auto& present = mPresents[presentIndex];
+    present.mSwapChain = swapChainIndex;
+    present.mToken = 0;
+    present.mPresentCount = 0;
+    present.mFlipChainSerialNumber = 0;
+
+    // The frame's rendering work.
+    present.mFirstRenderSubmitSequence = mNextSubmitSequence + 1;
+    for (uint32_t i = 0; i < mConfig.mRenderPacketsPerPresent; ++i) {
+        EmitQueuePacketStart(swapChain, (uint32_t) QueuePacketType::DXGKETW_RENDER_COMMAND_BUFFER, NextSubmitSequence(), false);
+    }
+
+    // The runtime present start.
+    if (swapChain.mRuntime == Runtime::D3D9) {
+        Put<uint64_t>(swapChain.mAddress);
+        Put<uint32_t>(0);
+        Emit(D3D9_Present_Start, swapChain.mProcessId, swapChain.mThreadId);
+    } else {
+        Put<uint64_t>(swapChain.mAddress);
+        Put<uint32_t>(0);
+        Put<int32_t>(1);
+        Emit(DXGI_Present_Start, swapChain.mProcessId, swapChain.mThreadId);
+    }
+
+    // The kernel present.
+    present.mSubmitSequence = NextSubmitSequence();
+    switch (swapChain.mMode) {
+    case PresentMode::Hardware_Legacy_Flip:
+        Put<uint64_t>(0);
+        Put<uint32_t>(0);
+        Put<uint64_t>(0);
+        Put<uint32_t>(1);
+        Put<BOOL>(FALSE);
+        Put<BOOL>(TRUE);
+        Emit(DxgKrnl_Flip_Info, swapChain.mProcessId, swapChain.mThreadId);
+        EmitQueuePacketStart(swapChain, (uint32_t) QueuePacketType::DXGKETW_MMIOFLIP_COMMAND_BUFFER, present.mSubmitSequence, false);
+        break;
+
+    case PresentMode::Hardware_Legacy_Copy_To_Front_Buffer:
+    case PresentMode::Composed_Copy_GPU_GDI:
+    case PresentMode::Composed_Copy_CPU_GDI:
+    {
+        auto redirected = swapChain.mMode == PresentMode::Composed_Copy_CPU_GDI;
+        Put<uint64_t>(swapChain.mHwnd);
+        Put<uint64_t>(0);
+        Put<uint64_t>(0);
+        Put<uint64_t>(0);
+        Put<uint64_t>(0);
+        Put<BOOL>(TRUE);
+        Put<BOOL>(redirected);
+        Put<uint32_t>(0);
+        Emit(DxgKrnl_Blit_Info, swapChain.mProcessId, swapChain.mThreadId);
+
+        if (swapChain.mMode != PresentMode::Hardware_Legacy_Copy_To_Front_Buffer) {
+            present.mToken = mNextToken;
+            mNextToken += 0x10;
+
+            uint64_t tokenData = 0;
+            if (redirected) {
+                swapChain.mFlipChainSerialNumber += 1;
+                present.mFlipChainSerialNumber = swapChain.mFlipChainSerialNumber;
+                tokenData = ((uint64_t) swapChain.mFlipChain << 32) | present.mFlipChainSerialNumber;
+            }
+
+            Put<uint64_t>(0);
+            Put<uint64_t>(present.mToken);
+            Put<uint32_t>((uint32_t) (redirected ? PresentModel::D3DKMT_PM_REDIRECTED_VISTABLT : PresentModel::D3DKMT_PM_REDIRECTED_BLT));
+            Put<uint64_t>(tokenData);
+            Emit(redirected ? DxgKrnl_PresentHistory_Start : DxgKrnl_PresentHistoryDetailed_Start, swapChain.mProcessId, swapChain.mThreadId);
+        }
+
+        EmitQueuePacketStart(swapChain, (uint32_t) QueuePacketType::DXGKETW_RENDER_COMMAND_BUFFER, present.mSubmitSequence, true);
+        Put<uint64_t>(swapChain.mContext);
+        Put<uint64_t>(swapChain.mHwnd);
+        Put<uint32_t>(0);
+        Put<uint32_t>(0);
+        Emit(DxgKrnl_Present_Info, swapChain.mProcessId, swapChain.mThreadId);
+        break;
+    }
+
+    default: // Composed_Flip, Hardware_Independent_Flip, Hardware_Composed_Independent_Flip
+        swapChain.mPresentCount += 1;
+        present.mPresentCount = swapChain.mPresentCount;
+        present.mToken = mNextToken;
+        mNextToken += 0x10;
+
+        Put<uint64_t>(0);
+        Put<uint64_t>(present.mPresentCount);
+        Put<uint64_t>(swapChain.mBindId);
+        Put<uint64_t>(swapChain.mCompositionSurfaceLuid);
+        Put<uint32_t>(1920);
+        Put<uint32_t>(1080);
+        Emit(Win32k_TokenCompositionSurfaceObject_Info, swapChain.mProcessId, swapChain.mThreadId);
+
+        Put<uint64_t>(0);
+        Put<uint64_t>(present.mToken);
+        Put<uint32_t>((uint32_t) PresentModel::D3DKMT_PM_REDIRECTED_FLIP);
+        Put<uint64_t>(0);
+        Emit(DxgKrnl_PresentHistoryDetailed_Start, swapChain.mProcessId, swapChain.mThreadId);
+
+        EmitQueuePacketStart(swapChain, (uint32_t) QueuePacketType::DXGKETW_RENDER_COMMAND_BUFFER, present.mSubmitSequence, true);
+        Put<uint64_t>(swapChain.mContext);
+        Put<uint64_t>(swapChain.mHwnd);
+        Put<uint32_t>(0);
+        Put<uint32_t>(0);
+        Emit(DxgKrnl_Present_Info, swapChain.mProcessId, swapChain.mThreadId);
+        break;
+    }
+
+    // The runtime present stop.
+    Put<uint32_t>(0);
+    Emit(swapChain.mRuntime == Runtime::D3D9 ? D3D9_Present_Stop : DXGI_Present_Stop, swapChain.mProcessId, swapChain.mThreadId);
+
+    mPresentCount[(uint32_t) swapChain.mMode] += 1;
+
+    // The GPU completes the frame in about half of the present interval.
+    Schedule(mNow + Jitter(swapChain.mPresentInterval / 2, 20), ActionType::GpuComplete, presentIndex);
+    Schedule(mNow + Jitter(swapChain.mPresentInterval, 2), ActionType::Present, swapChainIndex);
+}
+
+inline void Generator::RunGpuComplete(uint32_t presentIndex)
+{
+    using namespace Microsoft_Windows_DxgKrnl;
+
+    auto& present = mPresents[presentIndex];
+    auto& swapChain = mSwapChains[present.mSwapChain];
+
+    for (uint32_t i = 0; i < mConfig.mRenderPacketsPerPresent; ++i) {
+        EmitQueuePacketStop(present.mFirstRenderSubmitSequence + i);
+    }
+    EmitQueuePacketStop(present.mSubmitSequence);
+
+    if (present.mToken != 0) {
+        Put<uint64_t>(0);
+        Put<uint64_t>(present.mToken);
+        Emit(DxgKrnl_PresentHistory_Info, 0, 0);
+    }
+
+    switch (swapChain.mMode) {
+    case PresentMode::Hardware_Legacy_Flip:
+        Put<uint64_t>(0);
+        Put<uint32_t>(0);
+        Put<uint32_t>(present.mSubmitSequence);
+        Put<uint64_t>(0);
+        Put<uint64_t>(0);
+        Put<uint32_t>(0);
+        Put<uint32_t>(0);
+        Put<uint32_t>(1);
+        Put<uint32_t>((uint32_t) SetVidPnSourceAddressFlags::FlipOnNextVSync);
+        Emit(DxgKrnl_MMIOFlip_Info, 0, 0);
+        mFlipsWaitingForVSync.push_back({ present.mSubmitSequence, 0 });
+        break;
+
+    case PresentMode::Hardware_Independent_Flip:
+    case PresentMode::Hardware_Composed_Independent_Flip:
+    {
+        // DWM assigns the swap chain to an overlay plane instead of composing it.
+        auto independentFlip = swapChain.mMode == PresentMode::Hardware_Independent_Flip;
+        EmitTokenStateChanged(swapChain, present, Microsoft_Windows_Win32k::TokenState::InFrame, independentFlip);
+        EmitTokenStateChanged(swapChain, present, Microsoft_Windows_Win32k::TokenState::Confirmed, independentFlip);
+
+        Put<uint64_t>(0);
+        Put<uint32_t>(0);
+        Put<uint64_t>((uint64_t) present.mSubmitSequence << 32);
+        Put<uint64_t>(0);
+        Put<uint64_t>(0);
+        Put<uint32_t>(0);
+        Put<uint32_t>(0);
+        Put<uint32_t>(1);
+        Put<uint32_t>(0);
+        Put<uint32_t>(independentFlip ? 0 : 1);
+        Put<uint32_t>((uint32_t) FlipEntryStatus::FlipWaitVSync);
+        Emit(DxgKrnl_MMIOFlipMultiPlaneOverlay_Info, 0, 0);
+        mFlipsWaitingForVSync.push_back({ present.mSubmitSequence, independentFlip ? 1u : 2u });
+        break;
+    }
+
+    case PresentMode::Composed_Flip:
+    case PresentMode::Composed_Copy_GPU_GDI:
+    case PresentMode::Composed_Copy_CPU_GDI:
+        swapChain.mReadyPresents.push_back(presentIndex);
+        return;
+
+    default:
+        break;
+    }
+
+    mFreePresents.push_back(presentIndex);
+}
+
+inline void Generator::RunVSync()
+{
+    // Report everything that flipped on this vsync.  VSyncDPCMultiPlane
+    // reports all of the MPO flips that share the same plane configuration.
+    for (uint32_t planeCount = 1; planeCount <= 2; ++planeCount) {
+        uint32_t flipCount = 0;
+        for (auto const& flip : mFlipsWaitingForVSync) {
+            flipCount += flip.mPlaneCount == planeCount ? 1 : 0;
+        }
+        if (flipCount == 0) {
+            continue;
+        }
+
+        Put<uint64_t>(0);
+        Put<uint32_t>(0);
+        Put<uint32_t>(0);
+        Put<uint32_t>((uint32_t) (mNow / mVSyncInterval));
+        Put<int64_t>((int64_t) mNow);
+        Put<uint32_t>(2);
+        Put<uint64_t>(0x80000000ull);
+        Put<uint64_t>(planeCount == 2 ? 0x90000000ull : 0);
+        Put<uint32_t>(flipCount);
+        for (auto const& flip : mFlipsWaitingForVSync) {
+            if (flip.mPlaneCount == planeCount) {
+                Put<uint64_t>((uint64_t) flip.mSubmitSequence << 32);
+            }
+        }
+        Emit(DxgKrnl_VSyncDPCMultiPlane_Info, 0, 0);
+    }
+
+    for (auto const& flip : mFlipsWaitingForVSync) {
+        if (flip.mPlaneCount == 0) {
+            Put<uint64_t>(0);
+            Put<uint32_t>(0);
+            Put<uint64_t>(0x80000000ull);
+            Put<uint32_t>(0);
+            Put<uint32_t>((uint32_t) (mNow / mVSyncInterval));
+            Put<int64_t>((int64_t) mNow);
+            Put<uint64_t>(0);
+            Put<uint32_t>(0);
+            Put<uint64_t>((uint64_t) flip.mSubmitSequence << 32);
+            Emit(DxgKrnl_VSyncDPC_Info, 0, 0);
+        }
+    }
+    mFlipsWaitingForVSync.clear();
+
+    // DWM composes shortly after vsync if any windowed presents are ready.
+    if (!mDwmComposeScheduled) {
+        for (auto const& swapChain : mSwapChains) {
+            if (!swapChain.mReadyPresents.empty()) {
+                Schedule(mNow + mVSyncInterval / 10, ActionType::DwmCompose, 0);
+                mDwmComposeScheduled = true;
+                break;
+            }
+        }
+    }
+
+    Schedule(mNow + mVSyncInterval, ActionType::VSync, 0);
+}
+
+inline void Generator::RunDwmCompose()
+{
+    using namespace Microsoft_Windows_DxgKrnl;
+
+    mDwmComposeScheduled = false;
+
+    // Pick up the latest ready present from each window.
+    for (auto& swapChain : mSwapChains) {
+        auto readyCount = (uint32_t) swapChain.mReadyPresents.size();
+        for (uint32_t i = 0; i < readyCount; ++i) {
+            auto presentIndex = swapChain.mReadyPresents[i];
+            auto const& present = mPresents[presentIndex];
+            auto latest = i + 1 == readyCount;
+
+            switch (swapChain.mMode) {
+            case PresentMode::Composed_Flip:
+                if (latest) {
+                    EmitTokenStateChanged(swapChain, present, Microsoft_Windows_Win32k::TokenState::InFrame, false);
+                    Put<uint64_t>(swapChain.mCompositionSurfaceLuid);
+                    Put<uint64_t>(present.mPresentCount);
+                    Put<uint64_t>(swapChain.mBindId);
+                    Emit(Dwm_SCHEDULE_SURFACEUPDATE_Info, DWM_PROCESS_ID, DWM_THREAD_ID);
+                    EmitTokenStateChanged(swapChain, present, Microsoft_Windows_Win32k::TokenState::Confirmed, false);
+                } else {
+                    EmitTokenStateChanged(swapChain, present, Microsoft_Windows_Win32k::TokenState::Discarded, false);
+                }
+                break;
+
+            case PresentMode::Composed_Copy_CPU_GDI:
+                Put<uint32_t>(swapChain.mFlipChain);
+                Put<uint32_t>(present.mFlipChainSerialNumber);
+                Put<uint64_t>(swapChain.mHwnd);
+                Emit(Dwm_FlipChain_Pending, DWM_PROCESS_ID, DWM_THREAD_ID);
+                break;
+
+            default:
+                break;
+            }
+
+            mSupersededPresentCount += latest ? 0 : 1;
+            mFreePresents.push_back(presentIndex);
+        }
+        swapChain.mReadyPresents.clear();
+    }
+
+    Put<uint64_t>(0);
+    Emit(Dwm_GetPresentHistory_Info, DWM_PROCESS_ID, DWM_THREAD_ID);
+
+    // DWM's own present.
+    Put<uint64_t>(mNow + mVSyncInterval);
+    Emit(Dwm_SCHEDULE_PRESENT_Start, DWM_PROCESS_ID, DWM_THREAD_ID);
+
+    Put<uint64_t>(0);
+    Put<uint32_t>(0);
+    Put<uint64_t>(0);
+    Put<uint32_t>(1);
+    Put<BOOL>(FALSE);
+    Put<BOOL>(TRUE);
+    Emit(DxgKrnl_Flip_Info, DWM_PROCESS_ID, DWM_THREAD_ID);
+
+    SwapChain dwm = {};
+    dwm.mProcessId = DWM_PROCESS_ID;
+    dwm.mThreadId  = DWM_THREAD_ID;
+    dwm.mContext   = 0x50000000000ull;
+    auto submitSequence = NextSubmitSequence();
+    EmitQueuePacketStart(dwm, (uint32_t) QueuePacketType::DXGKETW_MMIOFLIP_COMMAND_BUFFER, submitSequence, false);
+
+    Put<uint64_t>(dwm.mContext);
+    Put<uint64_t>(0);
+    Put<uint32_t>(0);
+    Put<uint32_t>(0);
+    Emit(DxgKrnl_Present_Info, DWM_PROCESS_ID, DWM_THREAD_ID);
+
+    mDwmPresentCount += 1;
+
+    Schedule(mNow + mVSyncInterval / 10, ActionType::DwmFlipReady, submitSequence);
+}
+
+inline void Generator::RunDwmFlipReady(uint32_t submitSequence)
+{
+    EmitQueuePacketStop(submitSequence);
+
+    Put<uint64_t>(0);
+    Put<uint32_t>(0);
+    Put<uint32_t>(submitSequence);
+    Put<uint64_t>(0);
+    Put<uint64_t>(0);
+    Put<uint32_t>(0);
+    Put<uint32_t>(0);
+    Put<uint32_t>(1);
+    Put<uint32_t>((uint32_t) Microsoft_Windows_DxgKrnl::SetVidPnSourceAddressFlags::FlipOnNextVSync);
+    Emit(DxgKrnl_MMIOFlip_Info, 0, 0);
+
+    mFlipsWaitingForVSync.push_back({ submitSequence, 0 });
+}
+
+inline void Generator::Generate(uint64_t endQpc, EventBuffer* events)
+{
+    mEvents = events;
+    mEvents->mRecords.clear();
+    mEvents->mUserData.clear();
+    mEvents->mUserDataOffset.clear();
+
+    // Start with the process start events for DWM and each application.
+    if (!mProcessesStarted) {
+        mProcessesStarted = true;
+
+        std::vector<uint32_t> processIds(1, DWM_PROCESS_ID);
+        for (auto const& swapChain : mSwapChains) {
+            if (processIds.back() != swapChain.mProcessId) {
+                processIds.emplace_back(swapChain.mProcessId);
+            }
+        }
+
+        for (auto processId : processIds) {
+            char imageFileName[32];
+            if (processId == DWM_PROCESS_ID) {
+                snprintf(imageFileName, sizeof(imageFileName), "dwm.exe");
+            } else {
+                snprintf(imageFileName, sizeof(imageFileName), "app%u.exe", (processId - 1000) / 4);
+            }
+
+            Put<uint64_t>(0);
+            Put<uint32_t>(processId);
+            Put<uint32_t>(4);
+            Put<uint32_t>(1);
+            Put<int32_t>(0);
+            Put<uint64_t>(0);
+            PutString(imageFileName);
+            Emit(NT_Process_Start, 4, 8, false);
+        }
+    }
+
+    while (!mActions.empty() && mActions.top().mQpc < endQpc) {
+        auto action = mActions.top();
+        mActions.pop();
+
+        mNow = action.mQpc;
+        switch (action.mType) {
+        case ActionType::Present:      RunPresent(action.mIndex); break;
+        case ActionType::GpuComplete:  RunGpuComplete(action.mIndex); break;
+        case ActionType::VSync:        RunVSync(); break;
+        case ActionType::DwmCompose:   RunDwmCompose(); break;
+        case ActionType::DwmFlipReady: RunDwmFlipReady(action.mIndex); break;
+        }
+    }
+
+    // Point the records at their data now that mUserData won't grow anymore.
+    for (size_t i = 0, n = mEvents->mRecords.size(); i < n; ++i) {
+        mEvents->mRecords[i].UserData = mEvents->mUserData.data() + mEvents->mUserDataOffset[i];
+    }
+    mEvents = nullptr;
+}
+
+}
@@ -0,0 +1,140 @@
+// Copyright (C) 2022 Intel Corporation
+// SPDX-License-Identifier: MIT
+//
+// Measures the per-event cost of the PMTraceConsumer in-flight tracking map
+// operations, comparing std::map with FlatHashMap.
+//
+// Each simulated event does what the consumer's handlers do for a present in
+// flight: a find on a thread id, a find/insert/erase on a 64-bit token, and a
+// find on a Win32K (surface, present count, bind id) key.  The maps are kept
+// at a realistic steady-state size (a few in-flight presents per process).
+//
+// Before timing, both map types are driven with the same random operation
+// sequence and their contents compared, as a correctness check.
+//
+// Build and run (portable, does not require the Windows SDK):
+//     g++ -O2 -std=c++17 -I../../PresentData tracking_map_lookup.cpp -o tracking_map_lookup
+//     ./tracking_map_lookup [eventCount] [inFlightCount]
+
+#include "FlatHashMap.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <tuple>
+#include <vector>
+
+using Win32KKey = std::tuple<uint64_t, uint64_t, uint64_t>;
+
+template<template<typename, typename> class Map>
+struct Maps {
+    Map<uint32_t, std::shared_ptr<int>> byThreadId;
+    Map<uint64_t, std::shared_ptr<int>> byToken;
+    Map<Win32KKey, std::shared_ptr<int>> byWin32KToken;
+};
+
+template<typename K, typename V> using StdMap  = std::map<K, V>;
+template<typename K, typename V> using FlatMap = FlatHashMap<K, V>;
+
+static bool CheckCorrectness()
+{
+    std::mt19937_64 rng(1);
+    std::map<uint64_t, uint64_t> ref;
+    FlatHashMap<uint64_t, uint64_t> flat;
+
+    for (uint32_t i = 0; i < 2000000; ++i) {
+        auto key = rng() % 512;
+        switch (rng() % 4) {
+        case 0: ref[key] = i; flat[key] = i; break;
+        case 1: ref.emplace(key, i); flat.emplace(key, i); break;
+        case 2: {
+            auto ii = flat.find(key);
+            if ((ii == flat.end()) != (ref.find(key) == ref.end())) return false;
+            if (ii != flat.end()) flat.erase(ii);
+            ref.erase(key);
+            break;
+        }
+        case 3:
+            if ((i % 100000) == 3) { ref.clear(); flat.clear(); }
+            break;
+        }
+        if (ref.size() != flat.size()) return false;
+    }
+
+    std::vector<std::pair<uint64_t, uint64_t>> contents(flat.begin(), flat.end());
+    std::sort(contents.begin(), contents.end());
+    return contents == std::vector<std::pair<uint64_t, uint64_t>>(ref.begin(), ref.end());
+}
+
+template<template<typename, typename> class Map>
+static double Run(char const* name, uint32_t eventCount, uint32_t inFlightCount)
+{
+    Maps<Map> maps;
+    auto present = std::make_shared<int>(0);
+
+    // Keys look like the real ones: thread ids are small integers, tokens
+    // and surfaces are pointer-like.
+    auto ThreadId = [](uint64_t i) { return (uint32_t) (1000 + 4 * (i % 64)); };
+    auto Token    = [](uint64_t i) { return 0xffffa00000000000ull + i * 0x40; };
+    auto W32Key   = [](uint64_t i) { return Win32KKey(0xffffb00000000000ull + (i % 16) * 0x1000, i, 1); };
+
+    for (uint64_t i = 0; i < inFlightCount; ++i) {
+        maps.byThreadId[ThreadId(i)] = present;
+        maps.byToken.emplace(Token(i), present);
+        maps.byWin32KToken.emplace(W32Key(i), present);
+    }
+
+    uint64_t found = 0;
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = inFlightCount; i < inFlightCount + eventCount; ++i) {
+        // Lookup the present this thread is working on.
+        auto ti = maps.byThreadId.find(ThreadId(i));
+        found += ti != maps.byThreadId.end();
+
+        // Retire the oldest token and track a new one.
+        auto ki = maps.byToken.find(Token(i - inFlightCount));
+        if (ki != maps.byToken.end()) {
+            maps.byToken.erase(ki);
+        }
+        maps.byToken.emplace(Token(i), present);
+        found += maps.byToken.find(Token(i - inFlightCount / 2)) != maps.byToken.end();
+
+        // Win32K token state change.
+        auto wi = maps.byWin32KToken.find(W32Key(i - inFlightCount));
+        if (wi != maps.byWin32KToken.end()) {
+            maps.byWin32KToken.erase(wi);
+        }
+        maps.byWin32KToken.emplace(W32Key(i), present);
+        found += maps.byWin32KToken.find(W32Key(i - 1)) != maps.byWin32KToken.end();
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+
+    auto ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / eventCount;
+    printf("%-12s %8.1f ns/event (found %llu)\n", name, ns, (unsigned long long) found);
+    return ns;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t eventCount    = argc > 1 ? (uint32_t) strtoul(argv[1], nullptr, 10) : 5000000;
+    uint32_t inFlightCount = argc > 2 ? (uint32_t) strtoul(argv[2], nullptr, 10) : 48;
+    if (eventCount == 0 || inFlightCount < 2) {
+        fprintf(stderr, "usage: tracking_map_lookup [eventCount] [inFlightCount>=2]\n");
+        return 1;
+    }
+
+    if (!CheckCorrectness()) {
+        fprintf(stderr, "error: FlatHashMap contents differ from std::map\n");
+        return 1;
+    }
+
+    printf("%u events, %u presents in flight\n", eventCount, inFlightCount);
+    auto mapNs  = Run<StdMap>("std::map", eventCount, inFlightCount);
+    auto flatNs = Run<FlatMap>("FlatHashMap", eventCount, inFlightCount);
+    printf("speedup: %.2fx\n", mapNs / flatNs);
+    return 0;
+}
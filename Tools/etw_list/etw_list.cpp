@@ -32,6 +32,10 @@ void usage()
         "    --no_events          Don't print event information.\n"
         "    --no_event_structs   Don't print event structures.\n"
         "    --no_prop_enums      Don't print event property enums.\n"
+        "    --event_views        Print EventView structs (see PresentData/TraceConsumer.hpp) for the listed events.\n"
+        "    --view_field=filter  Include a property in the event views, argument can be used more than once.\n"
+        "                         filter is of the form Task::opcode::Property, and can include up to one '*'.\n"
+        "                         If not specified, all fixed-size scalar properties are included.\n"
         "    --no_keywords        Don't print keywords.\n"
         "    --no_levels          Don't print levels.\n"
         "    --no_channels        Don't print channels.\n"
@@ -646,6 +650,132 @@ void PrintCppStruct(std::vector<EventProperty> const& members, std::wstring cons
     printf("\n");
 }
 
+// Returns the type returned by the property's EventView accessor, or nullptr
+// if the property isn't a fixed-size scalar.
+wchar_t const* GetViewFieldType(EventProperty const& prop, bool useEnums, std::wstring* enumType)
+{
+    if ((prop.Flags & (PropertyStruct | PropertyParamLength | PropertyParamCount | PropertyParamFixedLength | PropertyParamFixedCount |
+                       PropertyWBEMXmlFragment | PropertyHasCustomSchema)) != 0 || prop.count > 1) {
+        return nullptr;
+    }
+
+    if (useEnums && prop.nonStructType.MapNameOffset != 0) {
+        *enumType = prop.mapName_;
+        auto n = enumType->length();
+        if (n > 5 && enumType->compare(n - 5, 5, L"_TYPE") == 0) {
+            enumType->resize(n - 5);
+        }
+        return enumType->c_str();
+    }
+
+    switch (prop.nonStructType.InType) {
+    case TDH_INTYPE_INT8:     return L"int8_t";
+    case TDH_INTYPE_UINT8:    return L"uint8_t";
+    case TDH_INTYPE_INT16:    return L"int16_t";
+    case TDH_INTYPE_UINT16:   return L"uint16_t";
+    case TDH_INTYPE_INT32:    return L"int32_t";
+    case TDH_INTYPE_BOOLEAN:
+    case TDH_INTYPE_HEXINT32:
+    case TDH_INTYPE_UINT32:   return L"uint32_t";
+    case TDH_INTYPE_INT64:    return L"int64_t";
+    case TDH_INTYPE_HEXINT64:
+    case TDH_INTYPE_UINT64:   return L"uint64_t";
+    case TDH_INTYPE_FLOAT:    return L"float";
+    case TDH_INTYPE_DOUBLE:   return L"double";
+    case TDH_INTYPE_POINTER:
+    case TDH_INTYPE_SIZET:    return L"uint64_t"; // Zero-extended from the event's pointer size
+    }
+
+    return nullptr;
+}
+
+// Print an EventView for the event's scalar properties that match fieldIds.
+// The view only names the properties and their expected sizes; the offsets
+// are bound at runtime against each event version's metadata, so that the
+// view works across versions that add, remove, or reorder properties.
+void PrintEventView(Event const& event, std::vector<Filter> const& fieldIds, bool useEnums)
+{
+    struct Field {
+        std::wstring name_;     // Property name
+        std::wstring cppName_;  // Property name as a C++ identifier
+        std::wstring type_;
+        bool isPointer_;
+    };
+
+    std::vector<Field> fields;
+    size_t maxNameWidth = 0;
+    size_t maxTypeWidth = 0;
+    for (auto const& prop : event.properties_) {
+        std::wstring enumType;
+        auto type = GetViewFieldType(prop, useEnums, &enumType);
+        if (type == nullptr) {
+            continue;
+        }
+
+        auto id = event.taskName_ + L"::" + event.opcodeName_ + L"::" + prop.name_;
+        auto keep = fieldIds.empty();
+        for (auto const& fieldId : fieldIds) {
+            if (fieldId.Matches(id.c_str())) {
+                keep = true;
+                break;
+            }
+        }
+        if (!keep) {
+            continue;
+        }
+
+        auto isPointer = prop.nonStructType.InType == TDH_INTYPE_POINTER ||
+                         prop.nonStructType.InType == TDH_INTYPE_SIZET;
+        fields.push_back({ prop.name_, CppCondition(prop.name_), type, isPointer });
+        maxNameWidth = std::max(maxNameWidth, fields.back().cppName_.length());
+        maxTypeWidth = std::max(maxTypeWidth, fields.back().type_.length());
+    }
+
+    if (fields.empty()) {
+        return;
+    }
+
+    printf("\nstruct %ls_View : public EventView {\n", event.name_.c_str());
+
+    printf("    enum Field : uint32_t {\n");
+    for (auto const& field : fields) {
+        printf("        %ls_Field,\n", field.cppName_.c_str());
+    }
+    printf(
+        "        FieldCount\n"
+        "    };\n"
+        "\n"
+        "    static EventViewField const* GetFields()\n"
+        "    {\n"
+        "        static EventViewField const fields[FieldCount] = {\n");
+    for (auto const& field : fields) {
+        auto nameWidth = (int) (maxNameWidth - field.cppName_.length());
+        if (field.isPointer_) {
+            printf("            { L\"%ls\",%*s EVENT_VIEW_POINTER_SIZE },\n", field.name_.c_str(), nameWidth, "");
+        } else {
+            printf("            { L\"%ls\",%*s sizeof(%ls) },\n", field.name_.c_str(), nameWidth, "", field.type_.c_str());
+        }
+    }
+    printf(
+        "        };\n"
+        "        return fields;\n"
+        "    }\n"
+        "\n");
+
+    for (auto const& field : fields) {
+        printf("    %-*ls %ls()%*s const { return ",
+            (int) maxTypeWidth, field.type_.c_str(),
+            field.cppName_.c_str(), (int) (maxNameWidth - field.cppName_.length()), "");
+        if (field.isPointer_) {
+            printf("GetPointer(%ls_Field); }\n", field.cppName_.c_str());
+        } else {
+            printf("Get<%ls>(%ls_Field); }\n", field.type_.c_str(), field.cppName_.c_str());
+        }
+    }
+
+    printf("};\n");
+}
+
 void CollectUsedEnums(
     Event const& event,
     std::vector<EventProperty> const& members,
@@ -728,6 +858,7 @@ int wmain(
     // Parse command line arguments
     std::vector<Filter> providerIds;
     std::vector<Filter> eventIds;
+    std::vector<Filter> viewFieldIds;
     auto sortByName = false;
     auto sortByGuid = false;
     auto showKeywords = true;
@@ -736,6 +867,7 @@ int wmain(
     auto showEvents = true;
     auto showEventStructs = true;
     auto showPropertyEnums = true;
+    auto showEventViews = false;
     for (int i = 1; i < argc; ++i) {
         if (wcsncmp(argv[i], L"--provider=", 11) == 0) {
             providerIds.emplace_back(argv[i] + 11);
@@ -789,6 +921,16 @@ int wmain(
             continue;
         }
 
+        if (wcscmp(argv[i], L"--event_views") == 0) {
+            showEventViews = true;
+            continue;
+        }
+
+        if (wcsncmp(argv[i], L"--view_field=", 13) == 0) {
+            viewFieldIds.emplace_back(argv[i] + 13);
+            continue;
+        }
+
         fprintf(stderr, "error: unrecognized argument '%ls'.\n", argv[i]);
         usage();
         return 1;
@@ -909,7 +1051,7 @@ int wmain(
         }
 
         // Print events and/or event structs ordered by task
-        if (showEvents || showEventStructs || showPropertyEnums) {
+        if (showEvents || showEventStructs || showPropertyEnums || showEventViews) {
             FilterEvents(eventIds, &events);
             auto eventCount = events.size();
             if (eventCount > 0) {
@@ -937,6 +1079,11 @@ int wmain(
 
                 // Print event descriptors
                 if (showEvents) {
+                    // The Keyword type is qualified, since it would otherwise
+                    // change meaning in the struct once the Keyword member is
+                    // declared.
+                    auto keywordType = showKeywords ? CppCondition(provider.name_) + L"::Keyword" : std::wstring(L"uint64_t");
+                    auto keywordCast = showKeywords ? L"(" + keywordType + L") " : std::wstring();
                     printf(
                         "\n"
                         "// Event descriptors:\n"
@@ -948,11 +1095,11 @@ int wmain(
                         "    static uint8_t  const Level   = level_; \\\n"
                         "    static uint8_t  const Opcode  = opcode_; \\\n"
                         "    static uint16_t const Task    = task_; \\\n"
-                        "    static %s const Keyword = %skeyword_; \\\n"
+                        "    static %ls const Keyword = %lskeyword_; \\\n"
                         "};\n"
                         "\n",
-                        showKeywords ? "Keyword " : "uint64_t",
-                        showKeywords ? "(Keyword) " : "");
+                        keywordType.c_str(),
+                        keywordCast.c_str());
 
                     for (auto const& event : events) {
                         printf("EVENT_DESCRIPTOR_DECL(%-*ls, 0x%04x, 0x%02x, 0x%02x, 0x%02x, 0x%02x, 0x%04x, 0x%016llx)\n",
@@ -1000,6 +1147,14 @@ int wmain(
                         "#pragma pack(pop)\n"
                         "#pragma warning(pop)\n");
                 }
+
+                // Print event views
+                if (showEventViews) {
+                    printf("\n// Event views:\n");
+                    for (auto const& event : events) {
+                        PrintEventView(event, viewFieldIds, showPropertyEnums);
+                    }
+                }
             }
         }
 
@@ -21,12 +21,20 @@ if not exist "%out_dir%\." mkdir "%out_dir%"
 set events=
 set events=%events% --event=Present::Start
 set events=%events% --event=Present::Stop
+set view_fields=
+set view_fields=%view_fields% --view_field=Present::Start::pSwapchain
+set view_fields=%view_fields% --view_field=Present::Start::Flags
+set view_fields=%view_fields% --view_field=Present::Stop::Result
 call :etw_list "Microsoft-Windows-D3D9" "%out_dir%\Microsoft_Windows_D3D9.h"
 
 set events=
 set events=%events% --event=MILEVENT_MEDIA_UCE_PROCESSPRESENTHISTORY_GetPresentHistory::Info
 set events=%events% --event=SCHEDULE_PRESENT::Start
 set events=%events% --event=SCHEDULE_SURFACEUPDATE::Info
+set view_fields=
+set view_fields=%view_fields% --view_field=SCHEDULE_SURFACEUPDATE::Info::luidSurface
+set view_fields=%view_fields% --view_field=SCHEDULE_SURFACEUPDATE::Info::PresentCount
+set view_fields=%view_fields% --view_field=SCHEDULE_SURFACEUPDATE::Info::bindId
 call :etw_list "Microsoft-Windows-Dwm-Core" "%out_dir%\Microsoft_Windows_Dwm_Core.h"
 
 set events=
@@ -34,6 +42,11 @@ set events=%events% --event=Present::Start
 set events=%events% --event=Present::Stop
 set events=%events% --event=PresentMultiplaneOverlay::Start
 set events=%events% --event=PresentMultiplaneOverlay::Stop
+set view_fields=
+set view_fields=%view_fields% --view_field=Present::Start::pIDXGISwapChain
+set view_fields=%view_fields% --view_field=Present::Start::Flags
+set view_fields=%view_fields% --view_field=Present::Start::SyncInterval
+set view_fields=%view_fields% --view_field=Present::Stop::Result
 call :etw_list "Microsoft-Windows-DXGI" "%out_dir%\Microsoft_Windows_DXGI.h"
 
 set events=
@@ -52,11 +65,43 @@ set events=%events% --event=PresentHistoryDetailed::Start
 set events=%events% --event=QueuePacket::Start
 set events=%events% --event=QueuePacket::Stop
 set events=%events% --event=VSyncDPC::Info
+set view_fields=
+set view_fields=%view_fields% --view_field=Blit::Info::hwnd
+set view_fields=%view_fields% --view_field=Blit::Info::bRedirectedPresent
+set view_fields=%view_fields% --view_field=Flip::Info::FlipInterval
+set view_fields=%view_fields% --view_field=Flip::Info::MMIOFlip
+set view_fields=%view_fields% --view_field=IndependentFlip::Info::SubmitSequence
+set view_fields=%view_fields% --view_field=MMIOFlip::Info::FlipSubmitSequence
+set view_fields=%view_fields% --view_field=MMIOFlip::Info::Flags
+set view_fields=%view_fields% --view_field=MMIOFlipMultiPlaneOverlay::Info::FlipSubmitSequence
+set view_fields=%view_fields% --view_field=MMIOFlipMultiPlaneOverlay::Info::FlipEntryStatusAfterFlip
+set view_fields=%view_fields% --view_field=Present::Info::hWindow
+set view_fields=%view_fields% --view_field=PresentHistory::Start::Token
+set view_fields=%view_fields% --view_field=PresentHistory::Start::Model
+set view_fields=%view_fields% --view_field=PresentHistory::Start::TokenData
+set view_fields=%view_fields% --view_field=PresentHistory::Info::Token
+set view_fields=%view_fields% --view_field=QueuePacket::Start::hContext
+set view_fields=%view_fields% --view_field=QueuePacket::Start::PacketType
+set view_fields=%view_fields% --view_field=QueuePacket::Start::SubmitSequence
+set view_fields=%view_fields% --view_field=QueuePacket::Start::bPresent
+set view_fields=%view_fields% --view_field=QueuePacket::Stop::SubmitSequence
+set view_fields=%view_fields% --view_field=VSyncDPC::Info::FlipFenceId
 call :etw_list "Microsoft-Windows-DxgKrnl" "%out_dir%\Microsoft_Windows_DxgKrnl.h"
 
 set events=
 set events=%events% --event=TokenCompositionSurfaceObject::Info
 set events=%events% --event=TokenStateChanged::Info
+set view_fields=
+set view_fields=%view_fields% --view_field=TokenCompositionSurfaceObject::Info::PresentCount
+set view_fields=%view_fields% --view_field=TokenCompositionSurfaceObject::Info::BindId
+set view_fields=%view_fields% --view_field=TokenCompositionSurfaceObject::Info::CompositionSurfaceLuid
+set view_fields=%view_fields% --view_field=TokenCompositionSurfaceObject::Info::DestWidth
+set view_fields=%view_fields% --view_field=TokenCompositionSurfaceObject::Info::DestHeight
+set view_fields=%view_fields% --view_field=TokenStateChanged::Info::CompositionSurfaceLuid
+set view_fields=%view_fields% --view_field=TokenStateChanged::Info::PresentCount
+set view_fields=%view_fields% --view_field=TokenStateChanged::Info::BindId
+set view_fields=%view_fields% --view_field=TokenStateChanged::Info::NewState
+set view_fields=%view_fields% --view_field=TokenStateChanged::Info::IndependentFlip
 call :etw_list "Microsoft-Windows-Win32k" "%out_dir%\Microsoft_Windows_Win32k.h"
 
 echo %out_dir%\NT_Process.h
@@ -78,6 +123,6 @@ exit /b 0
 
 :etw_list
     echo %~2
-    "%~dp0..\build\Release\etw_list-dev-x64.exe" --no_event_structs %events% --provider=%~1>%2
+    "%~dp0..\build\Release\etw_list-dev-x64.exe" --no_event_structs --event_views %events% %view_fields% --provider=%~1>%2
     exit /b 0
 